@@ -0,0 +1,266 @@
+// Cyphesis Online RPG Server and AI Engine
+// Copyright (C) 2014 Erik Ogenvik
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+
+#include "MindWorker.h"
+
+#include "rulesets/BaseMind.h"
+#include "rulesets/PythonScriptFactory.h"
+
+#include "common/atlas_helpers.h"
+#include "common/compose.hpp"
+#include "common/id.h"
+#include "common/Inheritance.h"
+#include "common/log.h"
+#include "common/TypeNode.h"
+
+#include <Atlas/Objects/Anonymous.h>
+#include <Atlas/Objects/Operation.h>
+
+using Atlas::Message::Element;
+using Atlas::Message::MapType;
+using Atlas::Objects::Root;
+using Atlas::Objects::Entity::Anonymous;
+using Atlas::Objects::Operation::Get;
+
+MindWorker::MindWorker()
+{
+}
+
+MindWorker::~MindWorker()
+{
+    for (auto & entry : m_minds) {
+        delete entry.second;
+    }
+    for (auto & entry : m_factories) {
+        delete entry.second;
+    }
+    for (auto & entry : m_types) {
+        delete entry.second;
+    }
+}
+
+/// \brief Get the factory for the script of a mind, loading it if required
+///
+/// @param mind The value of the mind property of the character
+/// @return the factory, or null if the script couldn't be loaded.
+PythonScriptFactory<BaseMind> * MindWorker::getFactory(const MapType & mind)
+{
+    std::string script_package;
+    std::string script_class;
+    if (GetScriptDetails(mind, "Foo", "Mind",
+                         script_package, script_class) != 0) {
+        return 0;
+    }
+    std::string key = script_package + "." + script_class;
+    auto I = m_factories.find(key);
+    if (I != m_factories.end()) {
+        return I->second;
+    }
+    PythonScriptFactory<BaseMind> * psf =
+          new PythonScriptFactory<BaseMind>(script_package, script_class);
+    if (psf->setup() != 0) {
+        log(ERROR, String::compose("Python class \"%1\" failed to load",
+                                   key));
+        delete psf;
+        psf = 0;
+    }
+    // Failures are remembered too, so the script isn't loaded again for
+    // every character which uses it.
+    m_factories.insert(std::make_pair(key, psf));
+    return psf;
+}
+
+/// \brief Get a type by name
+///
+/// Types are loaded from the server by loadTypes() before any mind is
+/// handed over. Types installed on the server after that are created here
+/// as they are seen, without any inheritance.
+const TypeNode * MindWorker::getType(const std::string & name)
+{
+    const TypeNode * type = Inheritance::instance().getType(name);
+    if (type != 0) {
+        return type;
+    }
+    auto I = m_types.find(name);
+    if (I != m_types.end()) {
+        return I->second;
+    }
+    TypeNode * node = new TypeNode(name);
+    m_types.insert(std::make_pair(name, node));
+    return node;
+}
+
+/// \brief Ask the server for the definition of a type
+void MindWorker::requestType(const std::string & name)
+{
+    Anonymous get_arg;
+    get_arg->setId(name);
+
+    Get get;
+    get->setArgs1(get_arg);
+    get->setSerialno(newSerialNo());
+
+    m_typeRequests.insert(get->getSerialno());
+    send(get);
+}
+
+/// \brief Install a type definition sent by the server, and ask for its
+/// children
+void MindWorker::typeArrived(const Operation & op)
+{
+    if (op->getClassNo() != Atlas::Objects::Operation::INFO_NO ||
+        op->getArgs().empty()) {
+        log(ERROR, "Server failed to send a requested type definition");
+        return;
+    }
+    const Root & arg = op->getArgs().front();
+    if (arg->isDefaultId()) {
+        return;
+    }
+    // Parents are requested before their children, so only the core
+    // types which are already installed can be missing here.
+    Inheritance & inheritance = Inheritance::instance();
+    if (!inheritance.hasClass(arg->getId())) {
+        if (arg->isDefaultParents() || arg->getParents().empty() ||
+            inheritance.addChild(arg) == 0) {
+            return;
+        }
+    }
+    Element children;
+    if (arg->copyAttr("children", children) != 0 || !children.isList()) {
+        return;
+    }
+    for (auto & child : children.List()) {
+        if (child.isString()) {
+            requestType(child.String());
+        }
+    }
+}
+
+/// \brief Load the entity types defined by the rules of the server
+///
+/// The worker only knows the core types, but the scripts of minds rely on
+/// the types of the entities they see having the same inheritance as on
+/// the server. The whole tree below game_entity is fetched, one type at a
+/// time, before this returns.
+/// @return 0 if all types were loaded, -1 if the connection failed.
+int MindWorker::loadTypes()
+{
+    requestType("game_entity");
+    while (!m_typeRequests.empty()) {
+        if (poll(1) == -1) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/// \brief Start running the mind of a character
+///
+/// @param ent Description of the character
+/// @param mind The value of the mind property of the character
+void MindWorker::addMind(const Root & ent, const MapType & mind)
+{
+    const std::string & id = ent->getId();
+    long intId = integerId(id);
+    if (intId == -1) {
+        log(ERROR, String::compose("Mind handed over with invalid ID \"%1\"",
+                                   id));
+        return;
+    }
+    // The server may hand back a character it took away before.
+    removeMind(id);
+
+    BaseMind * base_mind = new BaseMind(id, intId);
+    base_mind->incRef();
+    if (!ent->isDefaultParents() && !ent->getParents().empty()) {
+        base_mind->setType(getType(ent->getParents().front()));
+    }
+    PythonScriptFactory<BaseMind> * factory = getFactory(mind);
+    if (factory != 0) {
+        factory->addScript(base_mind);
+    }
+    m_minds.insert(std::make_pair(id, base_mind));
+}
+
+/// \brief Stop running the mind of a character, if it is running
+void MindWorker::removeMind(const std::string & id)
+{
+    auto I = m_minds.find(id);
+    if (I != m_minds.end()) {
+        delete I->second;
+        m_minds.erase(I);
+    }
+}
+
+void MindWorker::operation(const Operation & op)
+{
+    if (!op->isDefaultRefno()) {
+        auto J = m_typeRequests.find(op->getRefno());
+        if (J != m_typeRequests.end()) {
+            m_typeRequests.erase(J);
+            typeArrived(op);
+            return;
+        }
+    }
+
+    if (op->getClassNo() == Atlas::Objects::Operation::INFO_NO &&
+        op->isDefaultFrom() && !op->isDefaultTo() &&
+        op->getTo() == m_accountId && !op->getArgs().empty()) {
+        const Root & arg = op->getArgs().front();
+        Element mind;
+        if (arg->copyAttr("mind", mind) == 0 && mind.isMap()) {
+            addMind(arg, mind.Map());
+            return;
+        }
+    }
+
+    if (op->isDefaultTo()) {
+        AtlasStreamClient::operation(op);
+        return;
+    }
+    auto I = m_minds.find(op->getTo());
+    if (I == m_minds.end()) {
+        AtlasStreamClient::operation(op);
+        return;
+    }
+    BaseMind * mind = I->second;
+    const std::string id = mind->getId();
+
+    OpVector res;
+    mind->operation(op, res);
+    for (auto & result : res) {
+        if (result->isDefaultFrom()) {
+            result->setFrom(id);
+        }
+        send(result);
+    }
+
+    // Once the character has gone, its mind is no longer needed.
+    if (op->getClassNo() == Atlas::Objects::Operation::SIGHT_NO &&
+        !op->getArgs().empty()) {
+        Operation sub_op = Atlas::Objects::smart_dynamic_cast<Operation>(
+              op->getArgs().front());
+        if (sub_op.isValid() &&
+            sub_op->getClassNo() == Atlas::Objects::Operation::DELETE_NO &&
+            !sub_op->getArgs().empty() &&
+            sub_op->getArgs().front()->getId() == id) {
+            removeMind(id);
+        }
+    }
+}
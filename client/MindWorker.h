@@ -0,0 +1,74 @@
+// Cyphesis Online RPG Server and AI Engine
+// Copyright (C) 2014 Erik Ogenvik
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+
+#ifndef CLIENT_MIND_WORKER_H
+#define CLIENT_MIND_WORKER_H
+
+#include "common/AtlasStreamClient.h"
+
+#include <map>
+#include <set>
+#include <string>
+
+class BaseMind;
+class TypeNode;
+
+template <class T>
+class PythonScriptFactory;
+
+/// \brief Connection from a worker process which runs the minds of NPCs
+/// for a server
+///
+/// The server hands the worker characters by sending an Info op to its
+/// account, describing the character and the mind it should run. From
+/// then on, operations to the character arrive on this connection, and
+/// the worker replies on behalf of the character as a client would.
+class MindWorker : public AtlasStreamClient {
+  protected:
+    /// \brief Minds being run, keyed by character ID
+    std::map<std::string, BaseMind *> m_minds;
+    /// \brief Script factories, keyed by package and class name
+    std::map<std::string, PythonScriptFactory<BaseMind> *> m_factories;
+    /// \brief Types of characters which are not known locally
+    std::map<std::string, TypeNode *> m_types;
+    /// \brief Serial numbers of type definitions requested from the server
+    std::set<long> m_typeRequests;
+
+    virtual void operation(const Operation &);
+
+    PythonScriptFactory<BaseMind> * getFactory(
+          const Atlas::Message::MapType & mind);
+    const TypeNode * getType(const std::string & name);
+    void requestType(const std::string & name);
+    void typeArrived(const Operation & op);
+    void addMind(const Atlas::Objects::Root & ent,
+                 const Atlas::Message::MapType & mind);
+    void removeMind(const std::string & id);
+  public:
+    MindWorker();
+    virtual ~MindWorker();
+
+    int loadTypes();
+
+    /// \brief Number of minds being run
+    std::size_t minds() const {
+        return m_minds.size();
+    }
+};
+
+#endif // CLIENT_MIND_WORKER_H
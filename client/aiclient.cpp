@@ -0,0 +1,91 @@
+// Cyphesis Online RPG Server and AI Engine
+// Copyright (C) 2014 Erik Ogenvik
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "client/ClientPropertyManager.h"
+#include "client/MindWorker.h"
+
+#include "rulesets/Python_API.h"
+
+#include "common/compose.hpp"
+#include "common/globals.h"
+#include "common/Inheritance.h"
+#include "common/log.h"
+#include "common/sockets.h"
+#include "common/system.h"
+
+#include <varconf/config.h>
+
+#include <cstdlib>
+
+int main(int argc, char ** argv)
+{
+    interactive_signals();
+
+    int config_status = loadConfig(argc, argv, USAGE_CLIENT);
+    if (config_status < 0) {
+        if (config_status == CONFIG_VERSION) {
+            reportVersion(argv[0]);
+            return 0;
+        } else if (config_status == CONFIG_HELP) {
+            showUsage(argv[0], USAGE_CLIENT);
+            return 0;
+        } else if (config_status != CONFIG_ERROR) {
+            log(ERROR, "Unknown error reading configuration.");
+        }
+        // Fatal error loading config file
+        return EXIT_CONFIG_ERROR;
+    }
+
+    // The server which started this worker passes the password for the
+    // account in the environment.
+    const char * token = getenv("CYPHESIS_MIND_TOKEN");
+    if (token == 0) {
+        log(ERROR, "Mind workers must be started by the server.");
+        return EXIT_FAILURE;
+    }
+
+    init_python_api(ruleset_name, false);
+    Inheritance::instance();
+    new ClientPropertyManager();
+
+    int status = EXIT_SUCCESS;
+    {
+        MindWorker worker;
+        if (worker.connectLocal(client_socket_name) != 0) {
+            log(ERROR, String::compose("Unable to connect to server on %1",
+                                       client_socket_name));
+            status = EXIT_SOCKET_ERROR;
+        } else if (worker.loadTypes() != 0) {
+            log(ERROR, "Connection lost while loading types from server");
+            status = EXIT_SOCKET_ERROR;
+        } else if (worker.create("mind", create_session_username(),
+                                 token) != 0) {
+            log(ERROR, "Unable to create mind worker account");
+            status = EXIT_SOCKET_ERROR;
+        } else {
+            while (!exit_flag) {
+                if (worker.poll(1) == -1) {
+                    break;
+                }
+            }
+        }
+    }
+
+    shutdown_python_api();
+
+    return status;
+}
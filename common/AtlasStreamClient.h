@@ -53,6 +53,10 @@ class StreamClientSocketBase
 
         virtual int write() = 0;
         int poll(const boost::posix_time::time_duration& duration);
+
+        bool isConnected() const {
+            return m_is_connected;
+        }
     protected:
         enum
         {
@@ -26,6 +26,8 @@
 
 #include <sigc++/signal.h>
 #include <ctime>
+#include <cstdint>
+#include <vector>
 
 class ArithmeticScript;
 class LocatedEntity;
@@ -34,6 +36,7 @@ class Task;
 class Location;
 
 typedef std::map<long, LocatedEntity *> EntityDict;
+typedef std::vector<LocatedEntity *> EntityVector;
 
 /// \brief Base class for game world manager object.
 ///
@@ -218,12 +221,39 @@ class BaseWorld {
     virtual void message(const Atlas::Objects::Operation::RootOperation &,
                          LocatedEntity & obj) = 0;
 
+    /// \brief Pass an operation to the world, getting a handle which can
+    /// be used to cancel it before it's dispatched.
+    ///
+    /// \return A handle, or zero if the operation can't be cancelled.
+    virtual std::uint64_t scheduleOperation(
+          const Atlas::Objects::Operation::RootOperation & op,
+          LocatedEntity & obj) {
+        message(op, obj);
+        return 0;
+    }
+
+    /// \brief Cancel an operation passed to scheduleOperation().
+    ///
+    /// Nothing happens if the operation already has been dispatched.
+    virtual void cancelOperation(std::uint64_t handle) {}
+
     /// \brief Find an entity of the given name.
     virtual LocatedEntity * findByName(const std::string & name) = 0;
 
     /// \brief Find an entity of the given type.
     virtual LocatedEntity * findByType(const std::string & type) = 0;
 
+    /// \brief Find all the entities with the given name.
+    virtual EntityVector findAllByName(const std::string & name) const {
+        return EntityVector();
+    }
+
+    /// \brief Find all the entities of the given type.
+    virtual EntityVector findAllByType(const std::string & type,
+                                       bool subtypes = true) const {
+        return EntityVector();
+    }
+
     /// \brief Add an entity provided to the list of perceptive entities.
     virtual void addPerceptive(LocatedEntity *) = 0;
 
@@ -0,0 +1,118 @@
+// Cyphesis Online RPG Server and AI Engine
+// Copyright (C) 2014 Erik Ogenvik
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+
+#include "BroadcastEncoding.h"
+
+#include "common/CommSocket.h"
+
+#include <Atlas/Objects/RootOperation.h>
+#include <Atlas/Objects/SmartPtr.h>
+
+/// Value of TO while an operation is encoded for sharing. It is found in
+/// the encoded data to work out where the real value goes.
+static const std::string to_placeholder = "__broadcast_to__";
+
+BroadcastEncoding * BroadcastEncoding::s_current = 0;
+
+/// \brief Check that a value is encoded unchanged by all codecs
+///
+/// None of the characters allowed here are escaped by any codec, so the
+/// value can be patched into encoded data as it is.
+static bool isPlainValue(const std::string & value)
+{
+    if (value.empty()) {
+        return false;
+    }
+    for (char c : value) {
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+              (c >= 'A' && c <= 'Z') || c == '_' || c == '-' || c == '.')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+BroadcastEncoding::BroadcastEncoding() : m_previous(s_current)
+{
+    s_current = this;
+}
+
+BroadcastEncoding::~BroadcastEncoding()
+{
+    s_current = m_previous;
+}
+
+/// \brief Send an operation on a socket, sharing its encoded data
+///
+/// @param op The operation to send.
+/// @param socket The socket to send it on.
+/// @return 0 if the operation was written to the socket, or -1 if it
+/// couldn't be shared and must be encoded by the caller.
+int BroadcastEncoding::send(const Operation & op, CommSocket & socket)
+{
+    const std::type_info * codec = socket.codecType();
+    if (codec == 0 || op->isDefaultTo()) {
+        return -1;
+    }
+    const std::string to = op->getTo();
+    if (!isPlainValue(to)) {
+        return -1;
+    }
+
+    Encoding * encoding = 0;
+    for (auto & candidate : m_encodings) {
+        if (candidate.m_op.get() == op.get() && *candidate.m_codec == *codec) {
+            encoding = &candidate;
+            break;
+        }
+    }
+    if (encoding == 0) {
+        m_encodings.push_back(Encoding());
+        encoding = &m_encodings.back();
+        encoding->m_op = op;
+        encoding->m_codec = codec;
+        encoding->m_shared = false;
+
+        std::string data;
+        op->setTo(to_placeholder);
+        int ret = socket.encode(op, data);
+        op->setTo(to);
+        if (ret != 0) {
+            return -1;
+        }
+        std::string::size_type pos = data.find(to_placeholder);
+        if (pos == std::string::npos ||
+            data.find(to_placeholder, pos + 1) != std::string::npos) {
+            return -1;
+        }
+        encoding->m_head = data.substr(0, pos);
+        encoding->m_tail = data.substr(pos + to_placeholder.size());
+        encoding->m_shared = true;
+    }
+    if (!encoding->m_shared) {
+        return -1;
+    }
+
+    if (socket.writeEncoded(encoding->m_head.data(),
+                            encoding->m_head.size()) != 0) {
+        return -1;
+    }
+    socket.writeEncoded(to.data(), to.size());
+    socket.writeEncoded(encoding->m_tail.data(), encoding->m_tail.size());
+    return 0;
+}
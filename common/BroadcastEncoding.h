@@ -0,0 +1,73 @@
+// Cyphesis Online RPG Server and AI Engine
+// Copyright (C) 2014 Erik Ogenvik
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+
+#ifndef COMMON_BROADCAST_ENCODING_H
+#define COMMON_BROADCAST_ENCODING_H
+
+#include "common/OperationRouter.h"
+
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+class CommSocket;
+
+/// \brief Shares the encoding of an operation sent to many connections
+///
+/// While an instance exists, Link::send() encodes each operation only once
+/// for each type of codec. Other connections using the same type of codec
+/// get a copy of the encoded data, with the TO attribute patched in.
+///
+/// Create an instance on the stack around a loop which sends the same
+/// operation to many destinations, changing nothing but its TO.
+class BroadcastEncoding {
+  protected:
+    /// \brief An operation encoded with one type of codec
+    struct Encoding {
+        /// The operation, held so that its address isn't reused by a
+        /// different operation while this instance exists.
+        Operation m_op;
+        const std::type_info * m_codec;
+        /// Encoded data before the value of TO.
+        std::string m_head;
+        /// Encoded data after the value of TO.
+        std::string m_tail;
+        /// False if the encoded data couldn't be split around TO.
+        bool m_shared;
+    };
+
+    std::vector<Encoding> m_encodings;
+    BroadcastEncoding * m_previous;
+
+    static BroadcastEncoding * s_current;
+
+    BroadcastEncoding(const BroadcastEncoding &) = delete;
+    BroadcastEncoding & operator=(const BroadcastEncoding &) = delete;
+  public:
+    BroadcastEncoding();
+    ~BroadcastEncoding();
+
+    /// \brief The innermost instance which currently exists, if any
+    static BroadcastEncoding * current() {
+        return s_current;
+    }
+
+    int send(const Operation & op, CommSocket & socket);
+};
+
+#endif // COMMON_BROADCAST_ENCODING_H
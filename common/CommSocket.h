@@ -19,6 +19,11 @@
 #ifndef COMMON_COMM_SOCKET_H
 #define COMMON_COMM_SOCKET_H
 
+#include <Atlas/Objects/ObjectsFwd.h>
+
+#include <string>
+#include <typeinfo>
+
 namespace boost {
 namespace asio {
 class io_service;
@@ -47,6 +52,35 @@ class CommSocket {
 
     /// \brief Flush the socket
     virtual int flush() = 0;
+
+    /// \brief Check if the socket has more data waiting to be sent than
+    /// it should
+    ///
+    /// While congested, operations which are made obsolete by later ones
+    /// need not be sent.
+    virtual bool isCongested() const {
+        return false;
+    }
+
+    /// \brief Type of the codec used to encode data sent on this socket
+    ///
+    /// Sockets with the same type of codec produce the same data for an
+    /// operation, so it can be encoded once and shared between them.
+    /// @return the type, or nullptr if encoded data can't be shared.
+    virtual const std::type_info * codecType() const {
+        return nullptr;
+    }
+
+    /// \brief Encode an operation into a buffer rather than sending it
+    virtual int encode(const Atlas::Objects::Operation::RootOperation & op,
+                       std::string & data) {
+        return -1;
+    }
+
+    /// \brief Write data already encoded with this socket's type of codec
+    virtual int writeEncoded(const char * data, std::size_t length) {
+        return -1;
+    }
 };
 
 #endif // COMMON_COMM_SOCKET_H
@@ -32,6 +32,7 @@
 #include <varconf/config.h>
 
 #include <sstream>
+#include <algorithm>
 
 #include <cstring>
 #include <cstdlib>
@@ -47,6 +48,15 @@ typedef Atlas::Codecs::XML Serialiser;
 
 static const bool debug_flag = false;
 
+INT_OPTION(id_block_size, 64, CYPHESIS, "idblocksize",
+           "Number of entity ids reserved from the database at a time");
+
+/// Most property rows written by a single statement of a batch.
+static const std::size_t property_batch_rows = 10000;
+
+/// Query used to reserve a block of entity ids.
+static const char * id_block_query = "SELECT nextval('entity_ent_id_seq')";
+
 Database * Database::m_instance = NULL;
 
 static void databaseNotice(void *, const char * message)
@@ -91,17 +101,21 @@ int Database::commandOk()
     assert(m_connection != 0);
 
     int status = -1;
+    bool failed = false;
 
+    // A query of several statements gives a result for each, and fails if
+    // any of them does.
     PGresult * res;
     while ((res = PQgetResult(m_connection)) != NULL) {
         if (PQresultStatus(res) == PGRES_COMMAND_OK) {
             status = 0;
         } else {
             reportError();
+            failed = true;
         }
         PQclear(res);
     };
-    return status;
+    return failed ? -1 : status;
 }
 
 int Database::createInstanceDatabase()
@@ -172,23 +186,38 @@ int Database::connect(const std::string & context, std::string & error_msg)
         conninfos << "password=" << db_passwd << " ";
     }
 
-    const std::string cinfo = conninfos.str();
+    m_connectionInfo = conninfos.str();
 
-    m_connection = PQconnectdb(cinfo.c_str());
+    m_connection = openConnection(error_msg);
 
-    if (m_connection == NULL) {
-        error_msg = "Unknown error";
+    if (m_connection == 0) {
         return -1;
     }
 
-    if (PQstatus(m_connection) != CONNECTION_OK) {
-        error_msg = PQerrorMessage(m_connection);
-        PQfinish(m_connection);
-        m_connection = 0;
-        return -1;
+    return 0;
+}
+
+/// \brief Open a further connection to the database
+///
+/// The connection uses the same parameters as the last call to connect(),
+/// and is owned by the caller, who must close it with PQfinish().
+/// @return the new connection, or 0 if it couldn't be opened.
+PGconn * Database::openConnection(std::string & error_msg) const
+{
+    PGconn * con = PQconnectdb(m_connectionInfo.c_str());
+
+    if (con == NULL) {
+        error_msg = "Unknown error";
+        return 0;
     }
 
-    return 0;
+    if (PQstatus(con) != CONNECTION_OK) {
+        error_msg = PQerrorMessage(con);
+        PQfinish(con);
+        return 0;
+    }
+
+    return con;
 }
 
 int Database::initConnection()
@@ -299,6 +328,17 @@ int Database::decodeObject(const std::string & data,
 
 int Database::decodeMessage(const std::string & data,
                             MapType &o)
+{
+    if (decodeMessage(m_d, data, o) != 0) {
+        log(WARNING, "Database entry does not appear to be decodable");
+        return -1;
+    }
+    return 0;
+}
+
+int Database::decodeMessage(Decoder & decoder,
+                            const std::string & data,
+                            MapType &o)
 {
     if (data.empty()) {
         return 0;
@@ -306,20 +346,31 @@ int Database::decodeMessage(const std::string & data,
 
     std::stringstream str(data, std::ios::in);
 
-    Serialiser codec(str, m_d);
-    Atlas::Message::Encoder enc(codec);
+    Serialiser codec(str, decoder);
 
     // Clear the decoder
-    m_d.get();
+    decoder.get();
 
     codec.poll();
 
-    if (!m_d.check()) {
-        log(WARNING, "Database entry does not appear to be decodable");
+    if (!decoder.check()) {
         return -1;
     }
 
-    o = m_d.get();
+    o = decoder.get();
+    return 0;
+}
+
+int Database::decodeBinary(const char * field, std::string & data)
+{
+    std::size_t length;
+    unsigned char * bytes = PQunescapeBytea(
+          reinterpret_cast<const unsigned char *>(field), &length);
+    if (bytes == 0) {
+        return -1;
+    }
+    data.assign(reinterpret_cast<const char *>(bytes), length);
+    PQfreemem(bytes);
     return 0;
 }
 
@@ -335,19 +386,44 @@ int Database::encodeObject(const MapType & o,
     enc.streamMessageElement(o);
     codec.streamEnd();
 
-    std::string raw = str.str();
-    char safe[raw.size() * 2 + 1];
+    data = escapeString(str.str());
+
+    return 0;
+}
+
+/// \brief Escape a string for use in a string literal in a query
+std::string Database::escapeString(const std::string & raw)
+{
+    std::string data;
+    data.resize(raw.size() * 2 + 1);
     int errcode;
 
-    PQescapeStringConn(m_connection, safe, raw.c_str(), raw.size(), &errcode);
+    size_t length = PQescapeStringConn(m_connection, &data[0], raw.c_str(),
+                                       raw.size(), &errcode);
 
     if (errcode != 0) {
         std::cerr << "ERROR: " << errcode << std::endl << std::flush;
     }
 
-    data = safe;
+    data.resize(length);
+    return data;
+}
 
-    return 0;
+/// \brief Escape binary data for use in a bytea literal in a query
+std::string Database::escapeBinary(const std::string & raw)
+{
+    std::size_t length;
+    unsigned char * bytes = PQescapeByteaConn(m_connection,
+          reinterpret_cast<const unsigned char *>(raw.data()), raw.size(),
+          &length);
+    if (bytes == 0) {
+        reportError();
+        return std::string();
+    }
+    // The length includes the terminating zero.
+    std::string data(reinterpret_cast<const char *>(bytes), length - 1);
+    PQfreemem(bytes);
+    return data;
 }
 
 int Database::getObject(const std::string & table,
@@ -643,6 +719,38 @@ int Database::runCommandQuery(const std::string & query)
     return -1;
 }
 
+/// \brief Start reading the result of a query through a cursor
+///
+/// The cursor lives in a transaction which is open until closeCursor() is
+/// called, so only one cursor should be used at a time.
+int Database::openCursor(const std::string & name, const std::string & query)
+{
+    if (runCommandQuery("BEGIN") != 0) {
+        return -1;
+    }
+    if (runCommandQuery(compose("DECLARE %1 NO SCROLL CURSOR FOR %2",
+                                name, query)) != 0) {
+        runCommandQuery("ROLLBACK");
+        return -1;
+    }
+    return 0;
+}
+
+/// \brief Read the next rows from a cursor
+///
+/// An empty result means that all rows have been read.
+const DatabaseResult Database::fetchFromCursor(const std::string & name,
+                                               int count)
+{
+    return runSimpleSelectQuery(compose("FETCH %1 FROM %2", count, name));
+}
+
+int Database::closeCursor(const std::string & name)
+{
+    runCommandQuery(compose("CLOSE %1", name));
+    return runCommandQuery("COMMIT");
+}
+
 int Database::registerRelation(std::string & tablename,
                                const std::string & sourcetable,
                                const std::string & targettable,
@@ -916,20 +1024,59 @@ int Database::registerEntityIdGenerator()
         debug(reportError(););
         debug(std::cout << "Sequence does not yet exist"
                         << std::endl << std::flush;);
+        if (runCommandQuery("CREATE SEQUENCE entity_ent_id_seq") != 0) {
+            return -1;
+        }
     } else {
         debug(std::cout << "Sequence exists" << std::endl << std::flush;);
-        return 0;
     }
-    return runCommandQuery("CREATE SEQUENCE entity_ent_id_seq");
+
+    // Each value returned by the sequence reserves all ids after the
+    // previous value up to and including itself. This holds whatever the
+    // increment was before, so it can safely be changed here.
+    long block_size = std::max(id_block_size, 1);
+    if (runCommandQuery(compose("ALTER SEQUENCE entity_ent_id_seq "
+                                "INCREMENT BY %1", block_size)) != 0) {
+        return -1;
+    }
+    m_idBlocks.setBlockSize(block_size);
+    return 0;
 }
 
 long Database::newId(std::string & id)
 {
     assert(m_connection != 0);
 
+    long new_id = m_idBlocks.take();
+    if (new_id == -1) {
+        if (fetchIdBlock() != 0) {
+            return -1;
+        }
+        new_id = m_idBlocks.take();
+    }
+
+    if (m_idBlocks.wantsRequest()) {
+        m_idBlocks.requestSent();
+        scheduleQuery(DatabaseQuery(id_block_query, PGRES_TUPLES_OK));
+    }
+
+    id = compose("%1", new_id);
+    return new_id;
+}
+
+/// \brief Synchronously reserve a new block of entity ids
+///
+/// The block is stored as the prefetched block. If the asynchronous
+/// request for a block is the query currently in progress, its result
+/// is used instead of sending a new query.
+int Database::fetchIdBlock()
+{
     clearPendingQuery();
-    int status = PQsendQuery(m_connection,
-                             "SELECT nextval('entity_ent_id_seq')");
+    if (m_idBlocks.hasWaitingBlock()) {
+        return 0;
+    }
+
+    int status = PQsendQuery(m_connection, id_block_query);
     if (!status) {
         log(ERROR, "newId(): Database query error.");
         reportError();
@@ -941,18 +1088,29 @@ long Database::newId(std::string & id)
         reportError();
         return -1;
     }
-    const char * cid = PQgetvalue(res, 0, 0);
-    id = cid;
+    idBlockArrived(res);
     PQclear(res);
     while ((res = PQgetResult(m_connection)) != NULL) {
         PQclear(res);
         log(ERROR, "Extra database result to simple query.");
     };
-    if (id.empty()) {
+    if (!m_idBlocks.hasWaitingBlock()) {
         log(ERROR, "Unknown error getting ID from database.");
         return -1;
     }
-    return forceIntegerId(id);
+    return 0;
+}
+
+void Database::idBlockArrived(PGresult * res)
+{
+    if (PQresultStatus(res) != PGRES_TUPLES_OK || PQntuples(res) < 1) {
+        log(ERROR, "Error getting new ID block.");
+        reportError();
+        return;
+    }
+    if (!m_idBlocks.blockArrived(forceIntegerId(PQgetvalue(res, 0, 0)))) {
+        log(WARNING, "Got an ID block while one was already waiting.");
+    }
 }
 
 int Database::registerEntityTable(const std::map<std::string, int> & chunks)
@@ -1047,6 +1205,12 @@ const DatabaseResult Database::selectEntities(const std::string & loc)
     return runSimpleSelectQuery(query);
 }
 
+const DatabaseResult Database::selectAllEntities()
+{
+    return runSimpleSelectQuery("SELECT id, loc, type, seq, location "
+                                "FROM entities");
+}
+
 int Database::dropEntity(long id)
 {
     std::string query = compose("DELETE FROM properties WHERE id = '%1'", id);
@@ -1082,14 +1246,15 @@ int Database::registerPropertyTable()
     } else {
         allTables.insert("properties");
         debug(std::cout << "Table exists" << std::endl << std::flush;);
-        return 0;
+        return upgradePropertyTable();
     }
     allTables.insert("properties");
     std::string query = compose("CREATE TABLE properties ("
                                 "id integer REFERENCES entities "
                                 "ON DELETE CASCADE, "
                                 "name varchar(%1), "
-                                "value text)", consts::id_len);
+                                "value text, "
+                                "data bytea)", consts::id_len);
     if (runCommandQuery(query) != 0) {
         reportError();
         return -1;
@@ -1099,7 +1264,50 @@ int Database::registerPropertyTable()
         reportError();
         return -1;
     }
-    return 0;
+    return upgradePropertyTable();
+}
+
+/// \brief Bring a property table created by an older version up to date
+///
+/// Property values are now stored in the binary "data" column. Rows
+/// written before it was added keep their XML encoded "value" until they
+/// are next written, or until they are converted with "cydb world convert".
+///
+/// Properties are written with INSERT ... ON CONFLICT, which needs a unique
+/// index on property ids and names. Databases created before the index was
+/// added may contain duplicate rows, which are removed first.
+int Database::upgradePropertyTable()
+{
+    const DatabaseResult columns = runSimpleSelectQuery("SELECT column_name "
+            "FROM information_schema.columns WHERE table_name = 'properties' "
+            "AND column_name = 'data'");
+    if (columns.error()) {
+        return -1;
+    }
+    if (columns.empty()) {
+        log(NOTICE, "Adding binary data column to property table.");
+        if (runCommandQuery("ALTER TABLE properties "
+                            "ADD COLUMN data bytea") != 0) {
+            return -1;
+        }
+    }
+
+    const DatabaseResult res = runSimpleSelectQuery("SELECT indexname FROM "
+            "pg_indexes WHERE indexname = 'property_ids'");
+    if (res.error()) {
+        return -1;
+    }
+    if (!res.empty()) {
+        return 0;
+    }
+    log(NOTICE, "Adding unique index on property ids and names.");
+    if (runCommandQuery("DELETE FROM properties a USING properties b "
+                        "WHERE a.id = b.id AND a.name = b.name "
+                        "AND a.ctid < b.ctid") != 0) {
+        return -1;
+    }
+    return runCommandQuery("CREATE UNIQUE INDEX property_ids "
+                           "ON properties (id, name)");
 }
 
 int Database::insertProperties(const std::string & id,
@@ -1137,14 +1345,140 @@ int Database::updateProperties(const std::string & id,
     KeyValues::const_iterator I = tuples.begin();
     KeyValues::const_iterator Iend = tuples.end();
     for (; I != Iend; ++I) {
-        std::string query = compose("UPDATE properties SET value = '%3' WHERE"
-                                    " id=%1 AND name='%2'",
+        std::string query = compose("UPDATE properties SET value = '%3', "
+                                    "data = NULL WHERE id=%1 AND name='%2'",
                                     id, I->first, I->second);
         scheduleCommand(query);
     }
     return 0;
 }
 
+void Database::batchInsertEntity(const std::string & id,
+                                 const std::string & loc,
+                                 const std::string & type,
+                                 int seq,
+                                 const std::string & value)
+{
+    if (!m_batchEntityInserts.empty()) {
+        m_batchEntityInserts += ", ";
+    }
+    m_batchEntityInserts += compose("('%1'::integer, '%2'::integer, "
+                                    "'%3', %4, '%5')",
+                                    escapeString(id), escapeString(loc),
+                                    escapeString(type), seq, value);
+}
+
+/// \brief Add an entity update to the next batch
+///
+/// @param location_entity_id The id of the new location, or empty to
+/// leave the location unchanged.
+void Database::batchUpdateEntity(const std::string & id,
+                                 int seq,
+                                 const std::string & location_data,
+                                 const std::string & location_entity_id)
+{
+    if (!m_batchEntityUpdates.empty()) {
+        m_batchEntityUpdates += ", ";
+    }
+    // The types are given explicitly, as they can't be inferred from NULL.
+    m_batchEntityUpdates += compose("('%1'::integer, %2, '%3'::text, %4::integer)",
+                                    escapeString(id), seq, location_data,
+                                    location_entity_id.empty() ?
+                                    std::string("NULL") :
+                                    "'" + escapeString(location_entity_id) + "'");
+}
+
+/// \brief Add property values to the next batch
+///
+/// The values are stored in the binary data column, and are expected to
+/// have been encoded with encodeElement(). Properties which are not yet in
+/// the database are inserted, and others are updated. Later values for the
+/// same property replace earlier ones.
+void Database::batchWriteProperties(const std::string & id,
+                                    const KeyValues & tuples)
+{
+    KeyValues & batch = m_batchProperties[id];
+    KeyValues::const_iterator I = tuples.begin();
+    KeyValues::const_iterator Iend = tuples.end();
+    for (; I != Iend; ++I) {
+        batch[I->first] = I->second;
+    }
+}
+
+/// \brief Add a relation row to the next batch
+///
+/// The row is inserted after the entities in the batch, so it may refer
+/// to an entity inserted in the same batch.
+void Database::batchCreateRelationRow(const std::string & name,
+                                      const std::string & id,
+                                      const std::string & other)
+{
+    m_batchRelations += compose("INSERT INTO %1 (source, target) VALUES "
+                                "('%2'::integer, '%3'::integer);",
+                                name, escapeString(id), escapeString(other));
+}
+
+/// \brief Send all batched writes to the database
+///
+/// The writes are sent as a single query string of several statements,
+/// which the database runs as one implicit transaction. If any statement
+/// fails none of the writes take effect, and as nothing else can be sent
+/// on the connection until the string is done, no other query can end up
+/// inside the transaction.
+/// @param done Called once the batch is finished, with whether it was
+/// committed. It is not called if there was nothing to write.
+int Database::flushBatch(const sigc::slot<void, bool> & done)
+{
+    std::string query;
+    if (!m_batchEntityInserts.empty()) {
+        query += "INSERT INTO entities VALUES ";
+        query += m_batchEntityInserts;
+        query += ";";
+        m_batchEntityInserts.clear();
+    }
+    if (!m_batchEntityUpdates.empty()) {
+        query += "UPDATE entities AS e SET seq = v.seq, "
+                 "location = v.location, loc = COALESCE(v.loc, e.loc) "
+                 "FROM (VALUES ";
+        query += m_batchEntityUpdates;
+        query += ") AS v(id, seq, location, loc) WHERE e.id = v.id;";
+        m_batchEntityUpdates.clear();
+    }
+    query += m_batchRelations;
+    m_batchRelations.clear();
+    std::size_t rows = 0;
+    for (auto & entity : m_batchProperties) {
+        for (auto & property : entity.second) {
+            if (rows == 0) {
+                query += "INSERT INTO properties (id, name, value, data) VALUES ";
+            } else {
+                query += ", ";
+            }
+            query += compose("('%1'::integer, '%2', NULL, '%3'::bytea)",
+                             escapeString(entity.first),
+                             escapeString(property.first),
+                             escapeBinary(property.second));
+            if (++rows == property_batch_rows) {
+                query += " ON CONFLICT (id, name) DO UPDATE SET "
+                         "value = NULL, data = EXCLUDED.data;";
+                rows = 0;
+            }
+        }
+    }
+    if (rows != 0) {
+        query += " ON CONFLICT (id, name) DO UPDATE SET "
+                 "value = NULL, data = EXCLUDED.data;";
+    }
+    m_batchProperties.clear();
+
+    if (query.empty()) {
+        return 0;
+    }
+    DatabaseQuery batch(query, PGRES_COMMAND_OK);
+    batch.done = done;
+    return scheduleQuery(std::move(batch));
+}
+
 int Database::registerThoughtsTable()
 {
     assert(m_connection != 0);
@@ -1440,26 +1774,42 @@ int Database::removeArrayRow(const std::string & name,
 
 // General functions for handling queries at the low level.
 
-void Database::queryResult(ExecStatusType status)
+void Database::queryResult(PGresult * res)
 {
     if (!m_queryInProgress || pendingQueries.empty()) {
         log(ERROR, "Got database result when no query was pending.");
         return;
     }
     DatabaseQuery & q = pendingQueries.front();
-    if (q.second == PGRES_EMPTY_QUERY) {
-        log(ERROR, "Got database result which is already done.");
+    ExecStatusType status = PQresultStatus(res);
+    if (q.status == PGRES_EMPTY_QUERY) {
+        // Queries made up of several statements give a result for each.
+        if (status != PGRES_COMMAND_OK) {
+            log(ERROR, "Database error from async query");
+            std::cerr << "Query error in : " << q.query << std::endl << std::flush;
+            reportError();
+            q.failed = true;
+        }
         return;
     }
-    if (q.second == status) {
+    if (q.status == PGRES_TUPLES_OK) {
+        // The only asynchronous query which returns rows is the request
+        // for the next block of entity ids.
+        m_idBlocks.requestDone();
+    }
+    if (q.status == status) {
         debug(std::cout << "Query status ok" << std::endl << std::flush;);
+        if (status == PGRES_TUPLES_OK) {
+            idBlockArrived(res);
+        }
         // Mark this query as done
-        q.second = PGRES_EMPTY_QUERY;
+        q.status = PGRES_EMPTY_QUERY;
     } else {
         log(ERROR, "Database error from async query");
-        std::cerr << "Query error in : " << q.first << std::endl << std::flush;
+        std::cerr << "Query error in : " << q.query << std::endl << std::flush;
         reportError();
-        q.second = PGRES_EMPTY_QUERY;
+        q.status = PGRES_EMPTY_QUERY;
+        q.failed = true;
     }
 }
 
@@ -1470,14 +1820,19 @@ void Database::queryComplete()
         return;
     }
     DatabaseQuery & q = pendingQueries.front();
-    if (q.second != PGRES_EMPTY_QUERY) {
+    if (q.status != PGRES_EMPTY_QUERY) {
         abort();
         log(ERROR, "Got database query complete when query was not done");
         return;
     }
     debug(std::cout << "Query complete" << std::endl << std::flush;);
+    sigc::slot<void, bool> done = q.done;
+    bool ok = !q.failed;
     pendingQueries.pop_front();
     m_queryInProgress = false;
+    if (!done.empty()) {
+        done(ok);
+    }
 }
 
 int Database::launchNewQuery()
@@ -1497,9 +1852,9 @@ int Database::launchNewQuery()
     debug(std::cout << pendingQueries.size() << " queries pending"
                     << std::endl << std::flush;);
     DatabaseQuery & q = pendingQueries.front();
-    debug(std::cout << "Launching async query: " << q.first
+    debug(std::cout << "Launching async query: " << q.query
                     << std::endl << std::flush;);
-    int status = PQsendQuery(m_connection, q.first.c_str());
+    int status = PQsendQuery(m_connection, q.query.c_str());
     if (!status) {
         log(ERROR, "Database query error when launching.");
         reportError();
@@ -1513,14 +1868,18 @@ int Database::launchNewQuery()
 
 int Database::scheduleCommand(const std::string & query)
 {
-    pendingQueries.push_back(std::make_pair(query, PGRES_COMMAND_OK));
+    return scheduleQuery(DatabaseQuery(query, PGRES_COMMAND_OK));
+}
+
+int Database::scheduleQuery(DatabaseQuery query)
+{
+    debug(std::cout << "Query: " << query.query
+                    << (m_queryInProgress ? " scheduled" : " launched")
+                    << std::endl << std::flush;);
+    pendingQueries.push_back(std::move(query));
     if (!m_queryInProgress) {
-        debug(std::cout << "Query: " << query << " launched"
-                        << std::endl << std::flush;);
         return launchNewQuery();
     } else {
-        debug(std::cout << "Query: " << query << " scheduled"
-                        << std::endl << std::flush;);
         return 0;
     }
 }
@@ -1535,10 +1894,31 @@ int Database::clearPendingQuery()
     debug(std::cout << "Clearing a pending query" << std::endl << std::flush;);
 
     DatabaseQuery & q = pendingQueries.front();
-    if (q.second == PGRES_COMMAND_OK) {
+    if (q.status == PGRES_COMMAND_OK) {
+        sigc::slot<void, bool> done = q.done;
         m_queryInProgress = false;
         pendingQueries.pop_front();
-        return commandOk();
+        int ret = commandOk();
+        if (!done.empty()) {
+            done(ret == 0);
+        }
+        return ret;
+    } else if (q.status == PGRES_TUPLES_OK) {
+        m_queryInProgress = false;
+        pendingQueries.pop_front();
+        m_idBlocks.requestDone();
+        int ret = -1;
+        PGresult * res;
+        while ((res = PQgetResult(m_connection)) != NULL) {
+            if (ret != 0 && PQresultStatus(res) == PGRES_TUPLES_OK) {
+                idBlockArrived(res);
+                ret = 0;
+            } else if (PQresultStatus(res) != PGRES_TUPLES_OK) {
+                reportError();
+            }
+            PQclear(res);
+        }
+        return ret;
     } else {
         log(ERROR, "Pending query wants unknown status");
         return -1;
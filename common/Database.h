@@ -19,6 +19,8 @@
 #ifndef COMMON_DATABASE_H
 #define COMMON_DATABASE_H
 
+#include "IdBlocks.h"
+
 #include <Atlas/Message/DecoderBase.h>
 #include <Atlas/Message/Element.h>
 #include <Atlas/Objects/Decoder.h>
@@ -27,7 +29,11 @@
 
 #include <libpq-fe.h>
 
+#include <sigc++/slot.h>
+
+#include <map>
 #include <set>
+#include <vector>
 #include <memory>
 
 /// \brief Class to handle decoding Atlas encoded database records
@@ -82,7 +88,21 @@ class DatabaseResult;
 
 typedef std::vector<std::string> StringVector;
 typedef std::set<std::string> TableSet;
-typedef std::pair<std::string, ExecStatusType> DatabaseQuery;
+
+/// \brief A query waiting to be sent to the database asynchronously
+struct DatabaseQuery {
+    DatabaseQuery(const std::string & q, ExecStatusType s) : query(q),
+                                                              status(s),
+                                                              failed(false) { }
+
+    std::string query;
+    /// The status expected from the query, or PGRES_EMPTY_QUERY once done.
+    ExecStatusType status;
+    /// True if any statement in the query failed.
+    bool failed;
+    /// Called with whether the query succeeded once it is finished.
+    sigc::slot<void, bool> done;
+};
 typedef std::deque<DatabaseQuery> QueryQue;
 
 /// \brief Class to provide interface to Database connection
@@ -103,6 +123,20 @@ class Database {
     ObjectDecoder m_od;
 
     PGconn * m_connection;
+    /// Parameters used to open m_connection.
+    std::string m_connectionInfo;
+
+    /// Entity ids reserved from the database.
+    IdBlocks m_idBlocks;
+
+    /// Rows of entities to insert in the next batch.
+    std::string m_batchEntityInserts;
+    /// Rows of entities to update in the next batch.
+    std::string m_batchEntityUpdates;
+    /// Statements inserting relation rows in the next batch.
+    std::string m_batchRelations;
+    /// Property values to write in the next batch, by entity id and name.
+    std::map<std::string, std::map<std::string, std::string> > m_batchProperties;
 
     Database();
     ~Database();
@@ -112,6 +146,11 @@ class Database {
     bool tuplesOk();
     int commandOk();
 
+    int scheduleQuery(DatabaseQuery query);
+    int upgradePropertyTable();
+    int fetchIdBlock();
+    void idBlockArrived(PGresult * res);
+
   public:
     static const int MAINTAIN_VACUUM = 0x0100;
     static const int MAINTAIN_VACUUM_FULL = 0x0001;
@@ -123,6 +162,7 @@ class Database {
     typedef std::map<std::string, std::string> KeyValues;
 
     PGconn * getConnection() const { return m_connection; }
+    const TableSet & tables() const { return allTables; }
     const std::string & rule() const { return m_rule_db; }
     bool queryInProgress() const { return m_queryInProgress; }
 
@@ -135,8 +175,21 @@ class Database {
 
     int decodeMessage(const std::string & data,
                       Atlas::Message::MapType &);
+    /// \brief Decode a record using the supplied decoder
+    ///
+    /// This doesn't touch any state in the Database instance, so it can be
+    /// used from other threads, as long as each thread has its own decoder.
+    static int decodeMessage(Decoder & decoder,
+                             const std::string & data,
+                             Atlas::Message::MapType &);
+    /// \brief Decode a bytea field returned in text format
+    ///
+    /// Like the static decodeMessage(), this can be used from other threads.
+    static int decodeBinary(const char * field, std::string & data);
     int encodeObject(const Atlas::Message::MapType &,
                      std::string &);
+    std::string escapeString(const std::string &);
+    std::string escapeBinary(const std::string &);
     int putObject(const std::string & table,
                   const std::string &,
                   const Atlas::Message::MapType &,
@@ -156,6 +209,7 @@ class Database {
     void reportError();
 
     int connect(const std::string & context, std::string & error_msg);
+    PGconn * openConnection(std::string & error_msg) const;
 
     static Database * instance();
     static void cleanup();
@@ -169,6 +223,12 @@ class Database {
     const DatabaseResult runSimpleSelectQuery(const std::string & query);
     int runCommandQuery(const std::string & query);
 
+    // Interface for reading large results in chunks.
+
+    int openCursor(const std::string & name, const std::string & query);
+    const DatabaseResult fetchFromCursor(const std::string & name, int count);
+    int closeCursor(const std::string & name);
+
     // Interface for relations between tables.
 
     int registerRelation(std::string & tablename,
@@ -208,7 +268,9 @@ class Database {
     int registerEntityIdGenerator();
 
     /// Creates a new unique id for the database.
-    /// Note that this method will access the database, so it's a fairly expensive method.
+    /// Ids are reserved from the database in blocks, and the next block is
+    /// requested asynchronously before the current one runs out, so this
+    /// only waits on the database if ids are used up faster than that.
     long newId(std::string & id);
 
     // Interface for Entity and Property tables.
@@ -227,6 +289,7 @@ class Database {
                      const std::string & location_data,
                      const std::string & location_entity_id);
     const DatabaseResult selectEntities(const std::string & loc);
+    const DatabaseResult selectAllEntities();
     int dropEntity(long id);
 
     int registerPropertyTable();
@@ -236,6 +299,25 @@ class Database {
     int updateProperties(const std::string & id,
                          const KeyValues & tuples);
 
+    // Interface for writing many entities and properties in one query.
+
+    void batchInsertEntity(const std::string & id,
+                           const std::string & loc,
+                           const std::string & type,
+                           int seq,
+                           const std::string & value);
+    void batchUpdateEntity(const std::string & id,
+                           int seq,
+                           const std::string & location_data,
+                           const std::string & location_entity_id);
+    void batchWriteProperties(const std::string & id,
+                              const KeyValues & tuples);
+    void batchCreateRelationRow(const std::string & name,
+                                const std::string & id,
+                                const std::string & other);
+    int flushBatch(const sigc::slot<void, bool> & done =
+                   sigc::slot<void, bool>());
+
     int registerThoughtsTable();
     const DatabaseResult selectThoughts(const std::string & loc);
     int replaceThoughts(const std::string & id,
@@ -243,7 +325,7 @@ class Database {
 
     // Interface for CommPSQLSocket, so it can give us feedback
     
-    void queryResult(ExecStatusType);
+    void queryResult(PGresult *);
     void queryComplete();
     int launchNewQuery();
     int scheduleCommand(const std::string & query);
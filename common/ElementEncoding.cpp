@@ -0,0 +1,260 @@
+// Cyphesis Online RPG Server and AI Engine
+// Copyright (C) 2014 Erik Ogenvik
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+
+#include "ElementEncoding.h"
+
+#include <cstdint>
+#include <cstring>
+
+using Atlas::Message::Element;
+using Atlas::Message::MapType;
+using Atlas::Message::ListType;
+
+static const char tag_none = 'N';
+static const char tag_int = 'I';
+static const char tag_float = 'F';
+static const char tag_string = 'S';
+static const char tag_list = 'L';
+static const char tag_map = 'M';
+
+/// Nesting deeper than this is treated as corrupt data when decoding.
+static const int max_depth = 64;
+
+static void encodeUnsigned(std::uint64_t value, std::string & data)
+{
+    while (value >= 0x80) {
+        data.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    data.push_back(static_cast<char>(value));
+}
+
+static void encodeString(const std::string & value, std::string & data)
+{
+    encodeUnsigned(value.size(), data);
+    data.append(value);
+}
+
+static void encodeValue(const Element & element, std::string & data)
+{
+    switch (element.getType()) {
+      case Element::TYPE_INT:
+        {
+            // Zig-zag encoding keeps small negative numbers short.
+            std::int64_t value = element.Int();
+            data.push_back(tag_int);
+            encodeUnsigned((static_cast<std::uint64_t>(value) << 1) ^
+                           static_cast<std::uint64_t>(value >> 63), data);
+        }
+        break;
+      case Element::TYPE_FLOAT:
+        {
+            double value = element.Float();
+            std::uint64_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            data.push_back(tag_float);
+            for (int i = 0; i < 8; ++i) {
+                data.push_back(static_cast<char>(bits >> (i * 8)));
+            }
+        }
+        break;
+      case Element::TYPE_STRING:
+        data.push_back(tag_string);
+        encodeString(element.String(), data);
+        break;
+      case Element::TYPE_LIST:
+        {
+            const ListType & list = element.List();
+            data.push_back(tag_list);
+            encodeUnsigned(list.size(), data);
+            for (auto & item : list) {
+                encodeValue(item, data);
+            }
+        }
+        break;
+      case Element::TYPE_MAP:
+        {
+            const MapType & map = element.Map();
+            data.push_back(tag_map);
+            encodeUnsigned(map.size(), data);
+            for (auto & entry : map) {
+                encodeString(entry.first, data);
+                encodeValue(entry.second, data);
+            }
+        }
+        break;
+      default:
+        // Pointers can't be persisted.
+        data.push_back(tag_none);
+        break;
+    }
+}
+
+/// \brief Reads encoded data, keeping track of the position and of errors.
+class ElementReader {
+  private:
+    const char * m_pos;
+    const char * m_end;
+    bool m_error;
+  public:
+    ElementReader(const char * data, std::size_t length) :
+        m_pos(data), m_end(data + length), m_error(false) { }
+
+    bool error() const { return m_error; }
+    bool atEnd() const { return m_pos == m_end; }
+
+    char readByte() {
+        if (m_pos == m_end) {
+            m_error = true;
+            return 0;
+        }
+        return *m_pos++;
+    }
+
+    std::uint64_t readUnsigned() {
+        std::uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            unsigned char byte = static_cast<unsigned char>(readByte());
+            value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                return value;
+            }
+        }
+        m_error = true;
+        return 0;
+    }
+
+    void readString(std::string & value) {
+        std::uint64_t length = readUnsigned();
+        if (m_error || length > static_cast<std::uint64_t>(m_end - m_pos)) {
+            m_error = true;
+            return;
+        }
+        value.assign(m_pos, length);
+        m_pos += length;
+    }
+
+    /// Check that at least count more items could be present, so a corrupt
+    /// count can't make us allocate huge amounts of memory.
+    bool canHold(std::uint64_t count) {
+        if (m_error || count > static_cast<std::uint64_t>(m_end - m_pos)) {
+            m_error = true;
+        }
+        return !m_error;
+    }
+
+    void readValue(Element & element, int depth);
+};
+
+void ElementReader::readValue(Element & element, int depth)
+{
+    if (depth > max_depth) {
+        m_error = true;
+        return;
+    }
+    switch (readByte()) {
+      case tag_none:
+        element = Element();
+        break;
+      case tag_int:
+        {
+            std::uint64_t value = readUnsigned();
+            element = static_cast<long>(static_cast<std::int64_t>(
+                    (value >> 1) ^ (~(value & 1) + 1)));
+        }
+        break;
+      case tag_float:
+        {
+            std::uint64_t bits = 0;
+            for (int i = 0; i < 8; ++i) {
+                bits |= static_cast<std::uint64_t>(
+                        static_cast<unsigned char>(readByte())) << (i * 8);
+            }
+            double value;
+            std::memcpy(&value, &bits, sizeof(value));
+            element = value;
+        }
+        break;
+      case tag_string:
+        {
+            element = std::string();
+            readString(element.asString());
+        }
+        break;
+      case tag_list:
+        {
+            std::uint64_t count = readUnsigned();
+            if (!canHold(count)) {
+                return;
+            }
+            element = ListType(count);
+            ListType & list = element.asList();
+            for (auto & item : list) {
+                readValue(item, depth + 1);
+                if (m_error) {
+                    return;
+                }
+            }
+        }
+        break;
+      case tag_map:
+        {
+            std::uint64_t count = readUnsigned();
+            if (!canHold(count)) {
+                return;
+            }
+            element = MapType();
+            MapType & map = element.asMap();
+            std::string key;
+            for (std::uint64_t i = 0; i < count; ++i) {
+                readString(key);
+                if (m_error) {
+                    return;
+                }
+                readValue(map[key], depth + 1);
+                if (m_error) {
+                    return;
+                }
+            }
+        }
+        break;
+      default:
+        m_error = true;
+        break;
+    }
+}
+
+void encodeElement(const Element & element, std::string & data)
+{
+    data.push_back(static_cast<char>(element_encoding_version));
+    encodeValue(element, data);
+}
+
+int decodeElement(const char * data, std::size_t length, Element & element)
+{
+    ElementReader reader(data, length);
+    if (static_cast<unsigned char>(reader.readByte()) !=
+        element_encoding_version) {
+        return -1;
+    }
+    reader.readValue(element, 0);
+    if (reader.error() || !reader.atEnd()) {
+        return -1;
+    }
+    return 0;
+}
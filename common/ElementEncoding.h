@@ -0,0 +1,52 @@
+// Cyphesis Online RPG Server and AI Engine
+// Copyright (C) 2014 Erik Ogenvik
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+
+#ifndef COMMON_ELEMENT_ENCODING_H
+#define COMMON_ELEMENT_ENCODING_H
+
+#include <Atlas/Message/Element.h>
+
+#include <string>
+
+/// \brief Version of the binary element encoding written by encodeElement
+///
+/// The version is stored as the first byte of all encoded data.
+static const unsigned char element_encoding_version = 1;
+
+/// \brief Encode an Atlas element in a compact binary form
+///
+/// This is used for persisted property values, and is much cheaper to
+/// produce and to parse than the XML codec. Each value is a one byte tag
+/// followed by its payload. Integers and lengths are stored as variable
+/// length integers, and floats as eight little endian bytes.
+/// @param element The element to encode.
+/// @param data The encoded data is appended to this.
+void encodeElement(const Atlas::Message::Element & element,
+                   std::string & data);
+
+/// \brief Decode an Atlas element encoded by encodeElement
+///
+/// @param data The encoded data.
+/// @param length The length of the encoded data.
+/// @param element The decoded element is stored here.
+/// @return 0 on success, or -1 if the data is not a valid encoding of a
+/// known version.
+int decodeElement(const char * data, std::size_t length,
+                  Atlas::Message::Element & element);
+
+#endif // COMMON_ELEMENT_ENCODING_H
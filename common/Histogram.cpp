@@ -0,0 +1,56 @@
+// Cyphesis Online RPG Server and AI Engine
+// Copyright (C) 2014 Erik Ogenvik
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+
+#include "Histogram.h"
+
+#include <iostream>
+
+const long Histogram::bounds[Histogram::bucketCount] = {
+    10, 25, 50, 100, 250, 500,
+    1000, 2500, 5000, 10000, 25000, 50000,
+    100000, 250000, 1000000
+};
+
+/// \brief Write the histogram in the Prometheus text format
+///
+/// Writes a cumulative count for each bucket, followed by the sum and
+/// count of the values.
+/// @param name Name of the histogram, optionally followed by labels in
+/// braces, such as foo_usec{op="move"}.
+void Histogram::send(std::ostream & io, const std::string & name) const
+{
+    std::string::size_type brace = name.find('{');
+    std::string base = name.substr(0, brace);
+    std::string labels;
+    if (brace != std::string::npos && name.size() > brace + 2) {
+        labels = name.substr(brace + 1, name.size() - brace - 2);
+    }
+    std::string bucket_labels = labels.empty() ? labels : labels + ",";
+    std::string suffix = labels.empty() ? labels : "{" + labels + "}";
+
+    long cumulative = 0;
+    for (int i = 0; i < bucketCount; ++i) {
+        cumulative += m_buckets[i];
+        io << base << "_bucket{" << bucket_labels << "le=\"" << bounds[i]
+           << "\"} " << cumulative << std::endl;
+    }
+    io << base << "_bucket{" << bucket_labels << "le=\"+Inf\"} " << m_count
+       << std::endl;
+    io << base << "_sum" << suffix << " " << m_sum << std::endl;
+    io << base << "_count" << suffix << " " << m_count << std::endl;
+}
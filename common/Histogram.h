@@ -0,0 +1,62 @@
+// Cyphesis Online RPG Server and AI Engine
+// Copyright (C) 2014 Erik Ogenvik
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+
+#ifndef COMMON_HISTOGRAM_H
+#define COMMON_HISTOGRAM_H
+
+#include <iosfwd>
+#include <string>
+
+/// \brief Distribution of a measured duration, for the monitors output
+///
+/// Values are counted in fixed buckets, spaced roughly logarithmically
+/// from 10 microseconds to a second. Recording a value is cheap enough
+/// to do on every operation.
+class Histogram {
+  public:
+    /// Number of buckets with an upper bound.
+    static const int bucketCount = 15;
+    /// Upper bound of each bucket, in microseconds.
+    static const long bounds[bucketCount];
+  protected:
+    /// Values in each bucket, and those above the last bound.
+    long m_buckets[bucketCount + 1];
+    /// Number of values recorded.
+    long m_count;
+    /// Total of the values recorded.
+    double m_sum;
+  public:
+    Histogram() : m_buckets(), m_count(0), m_sum(0.) { }
+
+    void record(long value) {
+        int i = 0;
+        while (i < bucketCount && value > bounds[i]) {
+            ++i;
+        }
+        ++m_buckets[i];
+        ++m_count;
+        m_sum += value;
+    }
+
+    long count() const { return m_count; }
+    double sum() const { return m_sum; }
+
+    void send(std::ostream &, const std::string & name) const;
+};
+
+#endif // COMMON_HISTOGRAM_H
@@ -0,0 +1,89 @@
+// Cyphesis Online RPG Server and AI Engine
+// Copyright (C) 2014 Erik Ogenvik
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+
+#include "IdBlocks.h"
+
+#include <algorithm>
+
+IdBlocks::IdBlocks() : m_next(0), m_last(-1),
+                       m_waitingNext(-1), m_waitingLast(-1),
+                       m_blockSize(1), m_requested(false)
+{
+}
+
+void IdBlocks::setBlockSize(long block_size)
+{
+    m_blockSize = std::max(block_size, 1L);
+}
+
+/// \brief Take the next id
+///
+/// Moves on to the waiting block once the current one is used up.
+/// @return The id, or -1 if there are no ids left and no block waiting, in
+/// which case a block has to be fetched before trying again.
+long IdBlocks::take()
+{
+    if (m_next > m_last) {
+        if (m_waitingNext == -1) {
+            return -1;
+        }
+        m_next = m_waitingNext;
+        m_last = m_waitingLast;
+        m_waitingNext = -1;
+    }
+    return m_next++;
+}
+
+/// \brief Check whether the next block should be requested now
+///
+/// This is the case once half of the current block is used, so that the
+/// next one is likely to have arrived before it is needed.
+bool IdBlocks::wantsRequest() const
+{
+    return m_blockSize > 1 && !m_requested && m_waitingNext == -1 &&
+           (m_last - m_next) < m_blockSize / 2;
+}
+
+/// \brief Note that a request for the next block has been queued
+void IdBlocks::requestSent()
+{
+    m_requested = true;
+}
+
+/// \brief Note that the request for the next block is finished
+///
+/// This is called whether or not the request succeeded, so that a failed
+/// request is retried.
+void IdBlocks::requestDone()
+{
+    m_requested = false;
+}
+
+/// \brief Store a newly reserved block as the waiting block
+///
+/// @param last The value returned by the sequence.
+/// @return False if a block was already waiting, in which case it's
+/// replaced and its ids are lost.
+bool IdBlocks::blockArrived(long last)
+{
+    bool was_waiting = m_waitingNext != -1;
+    // A freshly created sequence starts at 1 rather than at the block size.
+    m_waitingNext = std::max(last - m_blockSize + 1, 1L);
+    m_waitingLast = last;
+    return !was_waiting;
+}
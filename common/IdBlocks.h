@@ -0,0 +1,64 @@
+// Cyphesis Online RPG Server and AI Engine
+// Copyright (C) 2014 Erik Ogenvik
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+
+#ifndef COMMON_ID_BLOCKS_H
+#define COMMON_ID_BLOCKS_H
+
+/// \brief Bookkeeping for entity ids reserved from the database in blocks
+///
+/// Each value returned by the id sequence reserves the block of ids after
+/// the previous value, up to and including itself. Ids are handed out from
+/// the current block, while the next block is requested ahead of time
+/// once half of the current one is used. The database queries themselves
+/// are made by Database.
+class IdBlocks {
+  protected:
+    /// The next id to hand out from the current block.
+    long m_next;
+    /// The last id in the current block.
+    long m_last;
+    /// The first id of a block waiting to be used, or -1 if none.
+    long m_waitingNext;
+    /// The last id of the block waiting to be used.
+    long m_waitingLast;
+    /// The number of ids reserved by each value from the sequence.
+    long m_blockSize;
+    /// True while a request for the next block is outstanding.
+    bool m_requested;
+  public:
+    IdBlocks();
+
+    void setBlockSize(long block_size);
+
+    long blockSize() const {
+        return m_blockSize;
+    }
+
+    /// \brief Check whether a block has arrived and not yet been used
+    bool hasWaitingBlock() const {
+        return m_waitingNext != -1;
+    }
+
+    long take();
+    bool wantsRequest() const;
+    void requestSent();
+    void requestDone();
+    bool blockArrived(long last);
+};
+
+#endif // COMMON_ID_BLOCKS_H
@@ -27,6 +27,8 @@
 
 #include <Atlas/Objects/Entity.h>
 
+#include <map>
+
 using Atlas::Message::Element;
 using Atlas::Message::ListType;
 
@@ -60,6 +62,27 @@ using Atlas::Objects::Operation::Wield;
 
 Inheritance * Inheritance::m_instance = NULL;
 
+/// \brief Unused space left in the interval of each type when numbering
+///
+/// Subtypes added later are given part of this space, so the whole tree
+/// only needs to be numbered again once it runs out.
+static const long typeIntervalSpace = 1 << 16;
+
+typedef std::multimap<const TypeNode *, TypeNode *> TypeChildMap;
+
+static long numberTree(TypeNode * type, long start,
+                       const TypeChildMap & children)
+{
+    long next = start + 1;
+    auto range = children.equal_range(type);
+    for (auto I = range.first; I != range.second; ++I) {
+        next = numberTree(I->second, next, children) + 1;
+    }
+    long end = next + typeIntervalSpace;
+    type->setInterval(start, next, end);
+    return end;
+}
+
 Root atlasOpDefinition(const std::string & name, const std::string & parent)
 {
     Atlas::Objects::Entity::Anonymous r;
@@ -95,7 +118,7 @@ Root atlasType(const std::string & name,
     return r;
 }
 
-Inheritance::Inheritance() : noClass(0)
+Inheritance::Inheritance() : noClass(0), m_typeCount(0)
 {
     Atlas::Objects::Entity::Anonymous root_desc;
 
@@ -104,8 +127,47 @@ Inheritance::Inheritance() : noClass(0)
     root_desc->setId("root");
 
     TypeNode * root = new TypeNode("root", root_desc);
+    root->setTypeId(m_typeCount++);
 
     atlasObjects["root"] = root;
+    renumber();
+}
+
+/// \brief Give a newly added type an interval within that of its parent
+///
+/// It is given half of the unused part of the parent's interval. If there
+/// is not enough left the whole tree is numbered again.
+void Inheritance::number(TypeNode * type)
+{
+    TypeNode * parent = const_cast<TypeNode *>(type->parent());
+    long space = parent->intervalEnd() - parent->intervalFree();
+    if (parent->intervalStart() < 0 || space < 4) {
+        renumber();
+        return;
+    }
+    long start = parent->intervalFree();
+    long end = start + space / 2;
+    type->setInterval(start, start + 1, end);
+    parent->setInterval(parent->intervalStart(), end + 1,
+                        parent->intervalEnd());
+}
+
+/// \brief Number the whole tree, leaving space in every interval
+void Inheritance::renumber()
+{
+    TypeChildMap children;
+    TypeNode * root = 0;
+    for (auto & entry : atlasObjects) {
+        TypeNode * type = entry.second;
+        if (type->parent() == 0) {
+            root = type;
+        } else {
+            children.insert(std::make_pair(type->parent(), type));
+        }
+    }
+    if (root != 0) {
+        numberTree(root, 0, children);
+    }
 }
 
 void Inheritance::flush()
@@ -116,6 +178,7 @@ void Inheritance::flush()
         delete I->second;
     }
     atlasObjects.clear();
+    m_typeCount = 0;
 }
 
 Inheritance & Inheritance::instance()
@@ -147,6 +210,10 @@ const Root & Inheritance::getClass(const std::string & parent)
     return I->second->description();
 }
 
+/// \brief Replace the description of a type
+///
+/// The parent of a type can't be changed, so the tree and the numbering of
+/// the types stay as they are.
 int Inheritance::updateClass(const std::string & parent,
                              const Root & description)
 {
@@ -212,8 +279,10 @@ TypeNode * Inheritance::addChild(const Root & obj)
 
     TypeNode * type = new TypeNode(child, obj);
     type->setParent(I->second);
+    type->setTypeId(m_typeCount++);
 
     atlasObjects.insert(std::make_pair(child, type));
+    number(type);
 
     return type;
 }
@@ -226,13 +295,23 @@ bool Inheritance::isTypeOf(const std::string & instance,
     if (I == Iend) {
         return false;
     }
-    return I->second->isTypeOf(base_type);
+    TypeNodeDict::const_iterator J = atlasObjects.find(base_type);
+    if (J == Iend) {
+        return false;
+    }
+    return I->second->isTypeOf(J->second);
 }
 
 bool Inheritance::isTypeOf(const TypeNode * instance,
                            const std::string & base_type) const
 {
-    return instance->isTypeOf(base_type);
+    TypeNodeDict::const_iterator I = atlasObjects.find(base_type);
+    if (I == atlasObjects.end()) {
+        // The instance may be a type unknown to the tree, such as those
+        // created by a mind worker, so fall back to comparing names.
+        return instance->isTypeOf(base_type);
+    }
+    return instance->isTypeOf(I->second);
 }
 
 bool Inheritance::isTypeOf(const TypeNode * instance,
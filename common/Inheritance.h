@@ -23,6 +23,8 @@
 #include <Atlas/Objects/Root.h>
 #include <Atlas/Objects/SmartPtr.h>
 
+#include <unordered_map>
+
 class PropertyBase;
 class TypeNode;
 
@@ -30,19 +32,28 @@ void installStandardObjects();
 void installCustomOperations();
 void installCustomEntities();
 
-typedef std::map<std::string, PropertyBase *> PropertyDict;
-typedef std::map<std::string, TypeNode *> TypeNodeDict;
+typedef std::unordered_map<std::string, TypeNode *> TypeNodeDict;
 
 /// \brief Class to manage the inheritance tree for in-game entity types
+///
+/// Each type is given a dense integer identifier, and an interval which
+/// contains the intervals of all its subtypes, so that checking if one
+/// type inherits from another does not need to walk the tree.
 class Inheritance {
   protected:
     const Atlas::Objects::Root noClass;
     TypeNodeDict atlasObjects;
 
+    /// \brief Number of type identifiers handed out
+    int m_typeCount;
+
     static Inheritance * m_instance;
 
     Inheritance();
 
+    void number(TypeNode * type);
+    void renumber();
+
   public:
     static Inheritance & instance();
     static void clear();
@@ -51,6 +62,14 @@ class Inheritance {
         return atlasObjects;
     }
 
+    /// \brief Number of type identifiers handed out
+    ///
+    /// Identifiers run from zero up to this, so they can be used to index
+    /// an array.
+    int typeCount() const {
+        return m_typeCount;
+    }
+
     const Atlas::Objects::Root & getClass(const std::string & parent);
     int updateClass(const std::string & name,
                     const Atlas::Objects::Root & obj);
@@ -18,15 +18,59 @@
 
 #include "Link.h"
 
+#include "common/BroadcastEncoding.h"
 #include "common/CommSocket.h"
 
 #include <Atlas/Objects/Encoder.h>
 #include <Atlas/Objects/Operation.h>
+#include <Atlas/Objects/RootEntity.h>
+#include <Atlas/Objects/SmartPtr.h>
 
 #include <cassert>
 
 static const bool debug_flag = false;
 
+/// \brief Find the entity moved by the Move an operation is the Sight of
+///
+/// @return The entity, or an invalid reference if the operation is not the
+/// Sight of a Move of an entity with an id.
+static Atlas::Objects::Entity::RootEntity sightedMove(const Operation & op)
+{
+    if (op->getClassNo() != Atlas::Objects::Operation::SIGHT_NO ||
+        op->getArgs().empty()) {
+        return Atlas::Objects::Entity::RootEntity(0);
+    }
+    Operation move = Atlas::Objects::smart_dynamic_cast<Operation>(
+          op->getArgs().front());
+    if (!move.isValid() ||
+        move->getClassNo() != Atlas::Objects::Operation::MOVE_NO ||
+        move->getArgs().empty()) {
+        return Atlas::Objects::Entity::RootEntity(0);
+    }
+    Atlas::Objects::Entity::RootEntity ent =
+          Atlas::Objects::smart_dynamic_cast<Atlas::Objects::Entity::RootEntity>(
+                move->getArgs().front());
+    if (!ent.isValid() || ent->isDefaultId()) {
+        return Atlas::Objects::Entity::RootEntity(0);
+    }
+    return ent;
+}
+
+/// An entity which keeps moving is the subject of another Move as soon as
+/// its course changes. One which has stopped may not be for a long time.
+static bool isMoving(const Atlas::Objects::Entity::RootEntity & ent)
+{
+    if (ent->isDefaultVelocity()) {
+        return false;
+    }
+    for (double v : ent->getVelocity()) {
+        if (v != 0.) {
+            return true;
+        }
+    }
+    return false;
+}
+
 Link::Link(CommSocket & socket, const std::string & id, long iid) :
             Router(id, iid), m_encoder(0), m_commSocket(socket)
 {
@@ -36,14 +80,75 @@ Link::~Link()
 {
 }
 
+/// \brief Send an operation to the client
+///
+/// While the client isn't keeping up, the Sight of a Move of an entity
+/// which is still moving is held back, and replaced if a later Move of the
+/// same entity comes along before it has been sent. A Move which takes an
+/// entity to a new LOC, or starts it moving, is never held back. Anything
+/// else sends the Moves held back first, so the order of operations is
+/// kept.
 void Link::send(const Operation & op) const
 {
     if (m_encoder != 0) {
-        m_encoder->streamObjectsMessage(op);
+        Atlas::Objects::Entity::RootEntity moved = sightedMove(op);
+        if (moved.isValid()) {
+            bool hold = false;
+            if (isMoving(moved)) {
+                auto I = m_movingLocs.find(moved->getId());
+                if (I == m_movingLocs.end()) {
+                    m_movingLocs.insert(std::make_pair(moved->getId(),
+                                                       moved->getLoc()));
+                } else if (I->second != moved->getLoc()) {
+                    I->second = moved->getLoc();
+                } else {
+                    hold = true;
+                }
+            } else {
+                m_movingLocs.erase(moved->getId());
+            }
+            if (hold && m_commSocket.isCongested()) {
+                // The op may be broadcast, and have its TO changed for
+                // another client before this one is sent.
+                m_pendingMoves[moved->getId()] = op.copy();
+                return;
+            }
+            m_pendingMoves.erase(moved->getId());
+        }
+        encodePending();
+        encode(op);
         m_commSocket.flush();
     }
 }
 
+/// \brief Send the Moves held back while the client wasn't keeping up
+void Link::sendPending() const
+{
+    if (m_encoder != 0 && !m_pendingMoves.empty()) {
+        encodePending();
+        m_commSocket.flush();
+    }
+}
+
+void Link::encode(const Operation & op) const
+{
+    BroadcastEncoding * broadcast = BroadcastEncoding::current();
+    if (broadcast == 0 || broadcast->send(op, m_commSocket) != 0) {
+        m_encoder->streamObjectsMessage(op);
+    }
+}
+
+void Link::encodePending() const
+{
+    if (m_pendingMoves.empty()) {
+        return;
+    }
+    for (auto & entry : m_pendingMoves) {
+        encode(entry.second);
+    }
+    m_pendingMoves.clear();
+}
+
 void Link::sendError(const Operation & op,
                      const std::string & errstring,
                      const std::string & to) const
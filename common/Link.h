@@ -21,6 +21,8 @@
 
 #include "common/Router.h"
 
+#include <map>
+
 class CommSocket;
 
 namespace Atlas {
@@ -34,6 +36,16 @@ class Link : public Router {
   protected:
     /// \brief The Atlas encoder used to send objects over this link
     Atlas::Objects::ObjectsEncoder * m_encoder;
+    /// \brief Sights of Moves held back while the client isn't keeping up
+    ///
+    /// Keyed by the id of the entity moved, so only the latest Move of each
+    /// entity is kept.
+    mutable std::map<std::string, Operation> m_pendingMoves;
+    /// \brief LOC of each entity last seen moving in a Move to the client
+    mutable std::map<std::string, std::string> m_movingLocs;
+
+    void encode(const Operation & op) const;
+    void encodePending() const;
   public:
     CommSocket & m_commSocket;
 
@@ -45,6 +57,7 @@ class Link : public Router {
     }
 
     void send(const Operation & op) const;
+    void sendPending() const;
     void sendError(const Operation & op,
                    const std::string &,
                    const std::string &) const;
@@ -18,6 +18,7 @@
 
 #include "Monitors.h"
 
+#include "Histogram.h"
 #include "Variable.h"
 
 #include <iostream>
@@ -38,6 +39,9 @@ Monitors::~Monitors()
     for (; I != Iend; ++I) {
         delete I->second;
     }
+    for (auto & entry : m_histograms) {
+        delete entry.second;
+    }
 }
 
 Monitors * Monitors::instance()
@@ -65,6 +69,19 @@ void Monitors::watch(const::std::string & name, VariableBase * monitor)
     m_variableMonitors[name] = monitor;
 }
 
+/// \brief Get the histogram with the given name, creating it if required
+///
+/// @param name Name of the histogram, optionally followed by labels in
+/// braces, such as foo_usec{op="move"}.
+Histogram * Monitors::histogram(const std::string & name)
+{
+    Histogram *& histogram = m_histograms[name];
+    if (histogram == 0) {
+        histogram = new Histogram;
+    }
+    return histogram;
+}
+
 static std::ostream & operator<<(std::ostream & s, const Element & e)
 {
     switch (e.getType()) {
@@ -98,6 +115,18 @@ void Monitors::send(std::ostream & io)
         J->second->send(io);
         io << std::endl;
     }
+
+    // Histograms sharing a name only differ in their labels, and are
+    // next to each other, so each name gets a single type line.
+    std::string type;
+    for (auto & entry : m_histograms) {
+        std::string base = entry.first.substr(0, entry.first.find('{'));
+        if (base != type) {
+            io << "# TYPE " << base << " histogram" << std::endl;
+            type = base;
+        }
+        entry.second->send(io, entry.first);
+    }
 }
 
 int Monitors::readVariable(const std::string& key, std::ostream& out_stream) const
@@ -21,6 +21,7 @@
 
 #include <Atlas/Message/Element.h>
 
+class Histogram;
 class VariableBase;
 
 /// \brief Storage for monitor values to be exported
@@ -30,6 +31,7 @@ class VariableBase;
 class Monitors {
   protected:
     typedef std::map<std::string, VariableBase *> MonitorDict;
+    typedef std::map<std::string, Histogram *> HistogramDict;
 
     static Monitors * m_instance;
 
@@ -38,12 +40,14 @@ class Monitors {
 
     Atlas::Message::MapType m_pairs;
     MonitorDict m_variableMonitors;
+    HistogramDict m_histograms;
   public:
     static Monitors * instance();
     static void cleanup();
 
     void insert(const std::string &, const Atlas::Message::Element &);
     void watch(const std::string &, VariableBase *);
+    Histogram * histogram(const std::string &);
     void send(std::ostream &);
     int readVariable(const std::string& key, std::ostream& out_stream) const;
 
@@ -0,0 +1,195 @@
+// Cyphesis Online RPG Server and AI Engine
+// Copyright (C) 2014 Erik Ogenvik
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+
+#ifndef COMMON_PROPERTY_DICT_H
+#define COMMON_PROPERTY_DICT_H
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class PropertyBase;
+
+/// \brief Interns property names, giving each a small integer key
+///
+/// Keys are handed out in the order names are first seen, and are never
+/// reused, so they can be computed once and kept.
+class PropertyKeys {
+  private:
+    typedef std::unordered_map<std::string, int> KeyMap;
+
+    static KeyMap & keys() {
+        static KeyMap s_keys;
+        return s_keys;
+    }
+
+    static std::vector<const std::string *> & names() {
+        static std::vector<const std::string *> s_names;
+        return s_names;
+    }
+  public:
+    /// \brief Get the key for a name, allocating one if it has none yet
+    static int intern(const std::string & name) {
+        KeyMap & map = keys();
+        KeyMap::const_iterator I = map.find(name);
+        if (I != map.end()) {
+            return I->second;
+        }
+        int key = map.size();
+        I = map.insert(std::make_pair(name, key)).first;
+        names().push_back(&I->first);
+        return key;
+    }
+
+    /// \brief Get the key for a name
+    ///
+    /// @return the key, or -1 if the name has never been interned, in
+    /// which case no PropertyDict can contain it.
+    static int lookup(const std::string & name) {
+        KeyMap & map = keys();
+        KeyMap::const_iterator I = map.find(name);
+        if (I == map.end()) {
+            return -1;
+        }
+        return I->second;
+    }
+
+    /// \brief Get the name which a key was allocated for
+    static const std::string & name(int key) {
+        return *names()[key];
+    }
+};
+
+/// \brief Flat storage of the properties of an entity or type
+///
+/// Entries are kept in a vector sorted by interned key, so a lookup is a
+/// single hash of the name followed by a binary search over a small array
+/// of integers. Code which looks up the same property often can intern
+/// its name once and look it up by key.
+///
+/// The interface follows std::map closely enough for existing code to
+/// iterate over entries as pairs of name and property. Unlike std::map,
+/// adding or erasing entries invalidates iterators, and entries are not
+/// in alphabetical order. Code which depends on that order, such as
+/// applying properties which affect each other, should use sorted().
+class PropertyDict {
+  public:
+    typedef std::pair<std::string, PropertyBase *> value_type;
+    typedef std::vector<value_type>::iterator iterator;
+    typedef std::vector<value_type>::const_iterator const_iterator;
+  private:
+    /// Keys of the entries, sorted.
+    std::vector<int> m_keys;
+    /// Entries, in the same order as their keys.
+    std::vector<value_type> m_entries;
+
+    std::size_t position(int key) const {
+        return std::lower_bound(m_keys.begin(), m_keys.end(), key) -
+               m_keys.begin();
+    }
+  public:
+    iterator begin() { return m_entries.begin(); }
+    iterator end() { return m_entries.end(); }
+    const_iterator begin() const { return m_entries.begin(); }
+    const_iterator end() const { return m_entries.end(); }
+
+    std::size_t size() const { return m_entries.size(); }
+    bool empty() const { return m_entries.empty(); }
+
+    void clear() {
+        m_keys.clear();
+        m_entries.clear();
+    }
+
+    iterator find(int key) {
+        std::size_t pos = position(key);
+        if (pos == m_keys.size() || m_keys[pos] != key) {
+            return end();
+        }
+        return m_entries.begin() + pos;
+    }
+
+    const_iterator find(int key) const {
+        std::size_t pos = position(key);
+        if (pos == m_keys.size() || m_keys[pos] != key) {
+            return end();
+        }
+        return m_entries.begin() + pos;
+    }
+
+    iterator find(const std::string & name) {
+        int key = PropertyKeys::lookup(name);
+        return key < 0 ? end() : find(key);
+    }
+
+    const_iterator find(const std::string & name) const {
+        int key = PropertyKeys::lookup(name);
+        return key < 0 ? end() : find(key);
+    }
+
+    /// \brief Get the property stored for a name, adding an empty entry
+    /// if there is none
+    PropertyBase *& operator[](const std::string & name) {
+        int key = PropertyKeys::intern(name);
+        std::size_t pos = position(key);
+        if (pos == m_keys.size() || m_keys[pos] != key) {
+            m_keys.insert(m_keys.begin() + pos, key);
+            m_entries.insert(m_entries.begin() + pos,
+                             value_type(name, nullptr));
+        }
+        return m_entries[pos].second;
+    }
+
+    /// \brief Get the entries in alphabetical order of name
+    std::vector<const value_type *> sorted() const {
+        std::vector<const value_type *> entries;
+        entries.reserve(m_entries.size());
+        for (auto & entry : m_entries) {
+            entries.push_back(&entry);
+        }
+        std::sort(entries.begin(), entries.end(),
+                  [](const value_type * a, const value_type * b) {
+                      return a->first < b->first;
+                  });
+        return entries;
+    }
+
+    /// \brief Remove an entry
+    ///
+    /// @return an iterator to the entry after the one removed
+    iterator erase(iterator I) {
+        m_keys.erase(m_keys.begin() + (I - m_entries.begin()));
+        return m_entries.erase(I);
+    }
+
+    /// \brief Remove the entry for a name, if there is one
+    ///
+    /// @return the number of entries removed
+    std::size_t erase(const std::string & name) {
+        iterator I = find(name);
+        if (I == end()) {
+            return 0;
+        }
+        erase(I);
+        return 1;
+    }
+};
+
+#endif // COMMON_PROPERTY_DICT_H
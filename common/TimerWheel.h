@@ -0,0 +1,470 @@
+// Cyphesis Online RPG Server and AI Engine
+// Copyright (C) 2014 Erik Ogenvik
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+
+#ifndef COMMON_TIMER_WHEEL_H
+#define COMMON_TIMER_WHEEL_H
+
+#include <boost/optional.hpp>
+
+#include <algorithm>
+#include <vector>
+
+#include <cassert>
+#include <cstdint>
+
+/// \brief A hierarchical timer wheel, holding values which are due at
+/// specific times.
+///
+/// Time is divided into ticks of a fixed resolution. The finest level of
+/// the wheel has one slot per tick, and each coarser level has slots
+/// covering all the slots of the level below. Values are placed in a slot
+/// depending on how far into the future they are due, and are moved down
+/// to finer levels as time advances. Inserting and cancelling a value is
+/// O(1), regardless of how many values are held.
+///
+/// Values which are due are handed out in time order. Each value inserted
+/// gets a handle which can be used to cancel it before it's handed out.
+template <typename T>
+class TimerWheel {
+  public:
+    /// \brief Identifies an inserted value. Zero is never a valid handle.
+    typedef std::uint64_t Handle;
+
+    /// \brief Constructor.
+    ///
+    /// @param resolution The length of a tick, in seconds.
+    explicit TimerWheel(double resolution);
+
+    /// \brief Inserts a value to be due at the specified time.
+    ///
+    /// @return A handle which can be used to cancel the value.
+    Handle insert(double time, const T & value);
+
+    /// \brief Removes a value before it's been handed out.
+    ///
+    /// @return True if the value was present, false if it already has
+    /// been handed out or cancelled.
+    bool cancel(Handle handle);
+
+    /// \brief Checks whether any values are due at the specified time.
+    ///
+    /// This advances the wheel up to the specified time. If true is
+    /// returned the earliest due value can be accessed through top().
+    bool hasDue(double now);
+
+    /// \brief Gets the earliest due value. Requires hasDue() to be true.
+    const T & top() const;
+
+    /// \brief Gets the time of the earliest due value. Requires hasDue()
+    /// to be true.
+    double topTime() const;
+
+    /// \brief Removes the earliest due value.
+    void pop();
+
+    /// \brief Gets the earliest time at which a value might be due.
+    ///
+    /// The returned time is never later than the time of any held value,
+    /// but might be earlier when the earliest value is on a coarse level.
+    /// @return False if no values are held.
+    bool nextTime(double & time) const;
+
+    /// \brief Gets the number of values held.
+    std::size_t size() const {
+        return m_size;
+    }
+
+    bool empty() const {
+        return m_size == 0;
+    }
+
+    /// \brief Removes all values.
+    void clear();
+
+  private:
+    static const unsigned int slot_bits = 8;
+    static const unsigned int slot_count = 1 << slot_bits;
+    static const std::uint64_t slot_mask = slot_count - 1;
+    static const unsigned int level_count = 4;
+    /// Values can't be placed further into the future than this.
+    static const std::uint64_t max_delta = (std::uint64_t(1) << (slot_bits * level_count)) - 1;
+
+    /// Marks a node as being in the due list rather than a slot.
+    static const int in_due = -1;
+    /// Marks a node as unused.
+    static const int unused = -2;
+
+    struct Node {
+        boost::optional<T> value;
+        double time;
+        std::uint32_t generation;
+        /// The slot the node is in, or one of in_due or unused.
+        int slot;
+        int prev;
+        int next;
+    };
+
+    const double m_resolution;
+    std::uint64_t m_currentTick;
+    std::size_t m_size;
+
+    std::vector<Node> m_nodes;
+    /// Indices of unused nodes.
+    std::vector<int> m_freeNodes;
+    /// Heads of the linked list of each slot, for all levels.
+    std::vector<int> m_slots;
+    /// Number of nodes on each level.
+    std::size_t m_levelCounts[level_count];
+    /// Values that are due, sorted by time from m_dueStart onwards.
+    std::vector<Handle> m_due;
+    std::size_t m_dueStart;
+
+    std::uint64_t tickFor(double time) const;
+    void place(int index);
+    void unlink(int index);
+    void release(int index);
+    void makeDue(int index);
+    bool isCurrent(Handle handle) const;
+    void skipStale();
+    void collectSlot(double now, bool partial);
+    void cascade(unsigned int level);
+
+    static Handle makeHandle(int index, std::uint32_t generation) {
+        return (Handle(generation) << 32) | std::uint32_t(index);
+    }
+
+    static int handleIndex(Handle handle) {
+        return (int)(handle & 0xffffffff);
+    }
+
+    static std::uint32_t handleGeneration(Handle handle) {
+        return (std::uint32_t)(handle >> 32);
+    }
+};
+
+template <typename T>
+TimerWheel<T>::TimerWheel(double resolution) :
+      m_resolution(resolution), m_currentTick(0), m_size(0),
+      m_slots(slot_count * level_count, -1), m_dueStart(0)
+{
+    assert(resolution > 0.);
+    std::fill(m_levelCounts, m_levelCounts + level_count, 0);
+}
+
+template <typename T>
+std::uint64_t TimerWheel<T>::tickFor(double time) const
+{
+    double tick = time / m_resolution;
+    if (!(tick > 0.)) {
+        return 0;
+    }
+    // Keep well clear of overflow; the delta is clamped anyway.
+    if (tick > 4.e18) {
+        return std::uint64_t(4.e18);
+    }
+    return (std::uint64_t)tick;
+}
+
+template <typename T>
+void TimerWheel<T>::place(int index)
+{
+    Node & node = m_nodes[index];
+    std::uint64_t tick = std::max(tickFor(node.time), m_currentTick);
+    std::uint64_t delta = tick - m_currentTick;
+    if (delta > max_delta) {
+        // The value will be reinserted when it reaches the finest level.
+        delta = max_delta;
+        tick = m_currentTick + delta;
+    }
+    unsigned int level = 0;
+    while (level + 1 < level_count &&
+           delta >= (std::uint64_t(1) << (slot_bits * (level + 1)))) {
+        ++level;
+    }
+    int slot = (int)(level * slot_count +
+                     ((tick >> (slot_bits * level)) & slot_mask));
+    node.slot = slot;
+    node.prev = -1;
+    node.next = m_slots[slot];
+    if (node.next != -1) {
+        m_nodes[node.next].prev = index;
+    }
+    m_slots[slot] = index;
+    ++m_levelCounts[level];
+}
+
+template <typename T>
+void TimerWheel<T>::unlink(int index)
+{
+    Node & node = m_nodes[index];
+    assert(node.slot >= 0);
+    if (node.prev != -1) {
+        m_nodes[node.prev].next = node.next;
+    } else {
+        m_slots[node.slot] = node.next;
+    }
+    if (node.next != -1) {
+        m_nodes[node.next].prev = node.prev;
+    }
+    --m_levelCounts[node.slot / slot_count];
+    node.slot = unused;
+}
+
+template <typename T>
+void TimerWheel<T>::release(int index)
+{
+    Node & node = m_nodes[index];
+    node.value = boost::none;
+    node.slot = unused;
+    // Invalidates any outstanding handle.
+    ++node.generation;
+    m_freeNodes.push_back(index);
+    --m_size;
+}
+
+template <typename T>
+typename TimerWheel<T>::Handle TimerWheel<T>::insert(double time,
+                                                       const T & value)
+{
+    int index;
+    if (!m_freeNodes.empty()) {
+        index = m_freeNodes.back();
+        m_freeNodes.pop_back();
+    } else {
+        index = (int)m_nodes.size();
+        m_nodes.push_back(Node());
+        m_nodes.back().generation = 1;
+    }
+    Node & node = m_nodes[index];
+    node.value = value;
+    node.time = time;
+    place(index);
+    ++m_size;
+    return makeHandle(index, node.generation);
+}
+
+template <typename T>
+bool TimerWheel<T>::isCurrent(Handle handle) const
+{
+    int index = handleIndex(handle);
+    return index < (int)m_nodes.size() &&
+           m_nodes[index].generation == handleGeneration(handle) &&
+           m_nodes[index].slot != unused;
+}
+
+template <typename T>
+bool TimerWheel<T>::cancel(Handle handle)
+{
+    if (!isCurrent(handle)) {
+        return false;
+    }
+    int index = handleIndex(handle);
+    if (m_nodes[index].slot != in_due) {
+        unlink(index);
+    }
+    // Handles in the due list are skipped once they are stale.
+    release(index);
+    skipStale();
+    return true;
+}
+
+template <typename T>
+void TimerWheel<T>::makeDue(int index)
+{
+    Node & node = m_nodes[index];
+    node.slot = in_due;
+    m_due.push_back(makeHandle(index, node.generation));
+}
+
+template <typename T>
+void TimerWheel<T>::collectSlot(double now, bool partial)
+{
+    int slot = (int)(m_currentTick & slot_mask);
+    int index = m_slots[slot];
+    while (index != -1) {
+        int next = m_nodes[index].next;
+        if (m_nodes[index].time <= now) {
+            unlink(index);
+            makeDue(index);
+        } else if (!partial) {
+            // Either clamped when inserted, or on the edge of a tick.
+            unlink(index);
+            place(index);
+        }
+        index = next;
+    }
+}
+
+template <typename T>
+void TimerWheel<T>::cascade(unsigned int level)
+{
+    int slot = (int)(level * slot_count +
+                     ((m_currentTick >> (slot_bits * level)) & slot_mask));
+    int index = m_slots[slot];
+    while (index != -1) {
+        int next = m_nodes[index].next;
+        unlink(index);
+        place(index);
+        index = next;
+    }
+}
+
+template <typename T>
+bool TimerWheel<T>::hasDue(double now)
+{
+    std::size_t dueBefore = m_due.size();
+    std::uint64_t target = tickFor(now);
+    while (m_currentTick < target) {
+        unsigned int emptyLevels = 0;
+        while (emptyLevels < level_count && m_levelCounts[emptyLevels] == 0) {
+            ++emptyLevels;
+        }
+        if (emptyLevels == level_count) {
+            m_currentTick = target;
+            break;
+        }
+        if (emptyLevels == 0) {
+            collectSlot(now, false);
+            ++m_currentTick;
+        } else {
+            // Skip ahead to where the first non empty level is cascaded.
+            std::uint64_t step = std::uint64_t(1) << (slot_bits * emptyLevels);
+            std::uint64_t next = (m_currentTick & ~(step - 1)) + step;
+            if (next > target) {
+                m_currentTick = target;
+                break;
+            }
+            m_currentTick = next;
+        }
+        for (unsigned int level = 1; level < level_count; ++level) {
+            std::uint64_t levelMask = (std::uint64_t(1) << (slot_bits * level)) - 1;
+            if ((m_currentTick & levelMask) != 0) {
+                break;
+            }
+            cascade(level);
+        }
+    }
+    collectSlot(now, true);
+
+    if (m_due.size() != dueBefore) {
+        const std::vector<Node> & nodes = m_nodes;
+        std::stable_sort(m_due.begin() + m_dueStart, m_due.end(),
+                         [&nodes](Handle lhs, Handle rhs) {
+                             return nodes[handleIndex(lhs)].time <
+                                    nodes[handleIndex(rhs)].time;
+                         });
+    }
+    skipStale();
+    return m_dueStart < m_due.size();
+}
+
+template <typename T>
+void TimerWheel<T>::skipStale()
+{
+    while (m_dueStart < m_due.size() && !isCurrent(m_due[m_dueStart])) {
+        ++m_dueStart;
+    }
+    if (m_dueStart == m_due.size()) {
+        m_due.clear();
+        m_dueStart = 0;
+    }
+}
+
+template <typename T>
+const T & TimerWheel<T>::top() const
+{
+    assert(m_dueStart < m_due.size());
+    return *m_nodes[handleIndex(m_due[m_dueStart])].value;
+}
+
+template <typename T>
+double TimerWheel<T>::topTime() const
+{
+    assert(m_dueStart < m_due.size());
+    return m_nodes[handleIndex(m_due[m_dueStart])].time;
+}
+
+template <typename T>
+void TimerWheel<T>::pop()
+{
+    assert(m_dueStart < m_due.size());
+    release(handleIndex(m_due[m_dueStart]));
+    ++m_dueStart;
+    skipStale();
+}
+
+template <typename T>
+bool TimerWheel<T>::nextTime(double & time) const
+{
+    if (m_dueStart < m_due.size()) {
+        time = m_nodes[handleIndex(m_due[m_dueStart])].time;
+        return true;
+    }
+    bool found = false;
+    // All nodes on the finest level are due at their slot's tick, so
+    // the first non empty slot has the earliest values on that level.
+    if (m_levelCounts[0] != 0) {
+        for (std::uint64_t i = 0; i < slot_count; ++i) {
+            int index = m_slots[(m_currentTick + i) & slot_mask];
+            if (index == -1) {
+                continue;
+            }
+            time = m_nodes[index].time;
+            for (; index != -1; index = m_nodes[index].next) {
+                time = std::min(time, m_nodes[index].time);
+            }
+            found = true;
+            break;
+        }
+    }
+    // Coarser levels can hold values due before those on the finest
+    // level until they are cascaded, so use the start of their first
+    // non empty slot as a bound.
+    for (unsigned int level = 1; level < level_count; ++level) {
+        if (m_levelCounts[level] == 0) {
+            continue;
+        }
+        std::uint64_t base = m_currentTick >> (slot_bits * level);
+        for (std::uint64_t i = 1; i <= slot_count; ++i) {
+            int slot = (int)(level * slot_count + ((base + i) & slot_mask));
+            if (m_slots[slot] != -1) {
+                double start = (double)((base + i) << (slot_bits * level)) * m_resolution;
+                time = found ? std::min(time, start) : start;
+                found = true;
+                break;
+            }
+        }
+    }
+    return found;
+}
+
+template <typename T>
+void TimerWheel<T>::clear()
+{
+    for (std::size_t i = 0; i < m_nodes.size(); ++i) {
+        if (m_nodes[i].slot != unused) {
+            release((int)i);
+        }
+    }
+    std::fill(m_slots.begin(), m_slots.end(), -1);
+    std::fill(m_levelCounts, m_levelCounts + level_count, 0);
+    m_due.clear();
+    m_dueStart = 0;
+}
+
+#endif // COMMON_TIMER_WHEEL_H
@@ -28,14 +28,22 @@ static const bool debug_flag = false;
 
 using Atlas::Message::MapType;
 
-TypeNode::TypeNode(const std::string & name) : m_name(name), m_parent(0)
+TypeNode::TypeNode(const std::string & name) : m_name(name), m_parent(0),
+                                                m_typeId(-1),
+                                                m_intervalStart(-1),
+                                                m_intervalFree(-1),
+                                                m_intervalEnd(-1)
 {
 }
 
 TypeNode::TypeNode(const std::string & name,
                    const Atlas::Objects::Root & d) : m_name(name),
                                                      m_description(d),
-                                                     m_parent(0)
+                                                     m_parent(0),
+                                                     m_typeId(-1),
+                                                     m_intervalStart(-1),
+                                                     m_intervalFree(-1),
+                                                     m_intervalEnd(-1)
 {
 }
 
@@ -99,8 +107,10 @@ void TypeNode::updateProperties(const MapType & attributes)
     MapType::const_iterator J = attributes.begin();
     PropertyBase * p;
     for (; J != Jend; ++J) {
+        // Removing and adding defaults invalidates iterators, so the end
+        // has to be checked afresh.
         PropertyDict::const_iterator I = m_defaults.find(J->first);
-        if (I == Iend) {
+        if (I == m_defaults.end()) {
             p = PropertyManager::instance()->addProperty(J->first,
                                                          J->second.getType());
             assert(p != 0);
@@ -125,8 +135,20 @@ bool TypeNode::isTypeOf(const std::string & base_type) const
     return false;
 }
 
+/// \brief check if this type inherits from another
+///
+/// If both types have been numbered by the hierarchy this is a check that
+/// the interval of this type lies within that of the base type. Otherwise
+/// the parents are walked.
 bool TypeNode::isTypeOf(const TypeNode * base_type) const
 {
+    if (base_type == 0) {
+        return false;
+    }
+    if (m_intervalStart >= 0 && base_type->m_intervalStart >= 0) {
+        return base_type->m_intervalStart <= m_intervalStart &&
+               m_intervalEnd <= base_type->m_intervalEnd;
+    }
     const TypeNode * node = this;
     do {
         if (node == base_type) {
@@ -19,15 +19,13 @@
 #ifndef COMMON_TYPE_NODE_H
 #define COMMON_TYPE_NODE_H
 
+#include "common/PropertyDict.h"
+
 #include <Atlas/Objects/Root.h>
 #include <Atlas/Objects/SmartPtr.h>
 
 #include <iostream>
 
-class PropertyBase;
-
-typedef std::map<std::string, PropertyBase *> PropertyDict;
-
 /// \brief Entry in the type hierarchy for in-game entity classes.
 class TypeNode {
   protected:
@@ -42,6 +40,16 @@ class TypeNode {
 
     /// \brief parent node
     const TypeNode * m_parent;
+
+    /// \brief dense integer identifier, or -1 if not in the hierarchy
+    int m_typeId;
+
+    /// \brief start of the interval covering this type and its subtypes
+    long m_intervalStart;
+    /// \brief start of the unused part of the interval
+    long m_intervalFree;
+    /// \brief end of the interval covering this type and its subtypes
+    long m_intervalEnd;
   public:
     TypeNode(const std::string &);
     TypeNode(const std::string &, const Atlas::Objects::Root &);
@@ -87,8 +95,48 @@ class TypeNode {
     }
 
     /// \brief set the parent node
+    ///
+    /// The interval is no longer valid once the node has moved, so it
+    /// is cleared until the hierarchy numbers the node again.
     void setParent(const TypeNode * parent) {
         m_parent = parent;
+        m_intervalStart = m_intervalFree = m_intervalEnd = -1;
+    }
+
+    /// \brief const accessor for the integer identifier
+    int typeId() const {
+        return m_typeId;
+    }
+
+    /// \brief set the integer identifier
+    void setTypeId(int id) {
+        m_typeId = id;
+    }
+
+    /// \brief const accessor for the start of the interval
+    long intervalStart() const {
+        return m_intervalStart;
+    }
+
+    /// \brief const accessor for the start of the unused interval
+    long intervalFree() const {
+        return m_intervalFree;
+    }
+
+    /// \brief const accessor for the end of the interval
+    long intervalEnd() const {
+        return m_intervalEnd;
+    }
+
+    /// \brief set the interval covering this type and its subtypes
+    ///
+    /// The interval of each subtype must lie within this one, and those
+    /// of siblings must not overlap. Positions from free up to the end
+    /// are not used by any subtype yet.
+    void setInterval(long start, long free, long end) {
+        m_intervalStart = start;
+        m_intervalFree = free;
+        m_intervalEnd = end;
     }
 };
 
@@ -34,11 +34,15 @@ using Atlas::Objects::Entity::Anonymous;
 
 static const bool debug_flag = false;
 
+unsigned long Location::s_generation = 0;
+
 Location::Location() :
     m_simple(true), m_solid(true),
     m_boxSize(consts::minBoxSize),
     m_squareBoxSize(consts::minSqrBoxSize),
-    m_loc(0)
+    m_loc(0),
+    m_cacheRoot(0), m_cacheLoc(0),
+    m_cacheParentGeneration(0), m_generation(0)
 {
 }
 
@@ -46,7 +50,9 @@ Location::Location(LocatedEntity * rf) :
     m_simple(true), m_solid(true),
     m_boxSize(consts::minBoxSize),
     m_squareBoxSize(consts::minSqrBoxSize),
-    m_loc(rf)
+    m_loc(rf),
+    m_cacheRoot(0), m_cacheLoc(0),
+    m_cacheParentGeneration(0), m_generation(0)
 {
 }
 
@@ -54,7 +60,9 @@ Location::Location(LocatedEntity * rf, const Point3D & pos) :
     m_simple(true), m_solid(true),
     m_boxSize(consts::minBoxSize),
     m_squareBoxSize(consts::minSqrBoxSize),
-    m_loc(rf), m_pos(pos)
+    m_loc(rf), m_pos(pos),
+    m_cacheRoot(0), m_cacheLoc(0),
+    m_cacheParentGeneration(0), m_generation(0)
 {
 }
 
@@ -64,7 +72,9 @@ Location::Location(LocatedEntity * rf,
     m_simple(true), m_solid(true),
     m_boxSize(consts::minBoxSize),
     m_squareBoxSize(consts::minSqrBoxSize),
-    m_loc(rf), m_pos(pos), m_velocity(velocity)
+    m_loc(rf), m_pos(pos), m_velocity(velocity),
+    m_cacheRoot(0), m_cacheLoc(0),
+    m_cacheParentGeneration(0), m_generation(0)
 {
 }
 
@@ -189,6 +199,61 @@ void Location::setVisibility(float v)
     // TODO m_radius and m_squareRadius? Unused everywhere for now.
 }
 
+/// \brief Bring the cached transform relative to the root up to date
+///
+/// The transform is rebuilt if the parent, position or orientation of this
+/// location, or the transform of any of its ancestors, has changed since it
+/// was last built. Each rebuild gives the location a new generation, which
+/// tells its children their own transforms are out of date.
+/// @return The root of the hierarchy, or null if the transform can't be
+/// determined because a position in the hierarchy is not valid.
+const Location * Location::rootTransform() const
+{
+    static const Quaternion identity(1, 0, 0, 0);
+
+    if (m_loc == 0) {
+        m_rootPos = Point3D(0, 0, 0);
+        m_rootOrientation = identity;
+        m_cacheRoot = this;
+        return this;
+    }
+    if (!m_pos.isValid()) {
+        return 0;
+    }
+    const Location & parent = m_loc->m_location;
+    const Location * root = parent.rootTransform();
+    if (root == 0) {
+        return 0;
+    }
+    const Quaternion & orientation = m_orientation.isValid() ? m_orientation
+                                                             : identity;
+    // Compare exactly, as a change smaller than the WFMath epsilon is
+    // still a change.
+    if (m_cacheRoot == root && m_cacheLoc == m_loc &&
+        m_cacheParentGeneration == parent.m_generation &&
+        m_cachePos.x() == m_pos.x() && m_cachePos.y() == m_pos.y() &&
+        m_cachePos.z() == m_pos.z() &&
+        m_cacheOrientation.scalar() == orientation.scalar() &&
+        m_cacheOrientation.vector().x() == orientation.vector().x() &&
+        m_cacheOrientation.vector().y() == orientation.vector().y() &&
+        m_cacheOrientation.vector().z() == orientation.vector().z()) {
+        return root;
+    }
+
+    m_rootPos = m_pos.toParentCoords(parent.m_rootPos,
+                                     parent.m_rootOrientation);
+    m_rootOrientation = orientation;
+    m_rootOrientation *= parent.m_rootOrientation;
+
+    m_cacheRoot = root;
+    m_cacheLoc = m_loc;
+    m_cachePos = m_pos;
+    m_cacheOrientation = orientation;
+    m_cacheParentGeneration = parent.m_generation;
+    m_generation = ++s_generation;
+    return root;
+}
+
 const Atlas::Objects::Root Location::asEntity() const
 {
     Anonymous ret;
@@ -249,6 +314,50 @@ static const Location* distanceToAncestor(const Location & self,
     return nullptr;
 }
 
+/// \brief Find the position of other relative to self from the cached
+/// transforms of each
+///
+/// @return true if both are in the same hierarchy and have valid
+/// positions, false if the full calculation is required.
+static bool cachedRelativePos(const Location & self,
+                              const Location & other, Point3D & c)
+{
+    const Location * root = self.rootTransform();
+    if (root == 0 || other.rootTransform() != root) {
+        return false;
+    }
+    c = other.rootPos().toLocalCoords(self.rootPos(), self.rootOrientation());
+    return true;
+}
+
+/// \brief Find the nearest location which is an ancestor of both self and
+/// other, in the same order as distanceToAncestor()
+static const Location * commonAncestor(const Location & self,
+                                       const Location & other)
+{
+    for (const Location * s = &self; ; s = &s->m_loc->m_location) {
+        for (const Location * o = &other; ; o = &o->m_loc->m_location) {
+            if (s == o) {
+                return s;
+            }
+            if (o->m_loc == 0) {
+                break;
+            }
+        }
+        if (s->m_loc == 0) {
+            return 0;
+        }
+    }
+}
+
+static void relativePosition(const Location & self,
+                             const Location & other, Point3D & c)
+{
+    if (!cachedRelativePos(self, other, c)) {
+        distanceToAncestor(self, other, c);
+    }
+}
+
 /// \brief Determine the vector distance from self to other.
 ///
 /// @param self Location of an entity
@@ -264,7 +373,7 @@ const Vector3D distanceTo(const Location & self, const Location & other)
 {
     static Point3D origin(0,0,0);
     Point3D pos;
-    distanceToAncestor(self, other, pos);
+    relativePosition(self, other, pos);
     Vector3D dist = pos - origin;
     if (self.orientation().isValid()) {
         dist.rotate(self.orientation());
@@ -284,32 +393,37 @@ const Vector3D distanceTo(const Location & self, const Location & other)
 const Point3D relativePos(const Location & self, const Location & other)
 {
     Point3D pos;
-    distanceToAncestor(self, other, pos);
+    relativePosition(self, other, pos);
     return pos;
 }
 
 float squareDistance(const Location & self, const Location & other)
 {
     Point3D dist;
-    distanceToAncestor(self, other, dist);
+    relativePosition(self, other, dist);
     return sqrMag(dist);
 }
 
 float squareDistanceWithAncestor(const Location & self, const Location & other, const Location** ancestor)
 {
     Point3D dist;
-    *ancestor = distanceToAncestor(self, other, dist);
-    if (ancestor) {
-        return sqrMag(dist);
+    *ancestor = commonAncestor(self, other);
+    if (*ancestor == nullptr) {
+        // Report the broken hierarchy
+        distanceToAncestor(self, other, dist);
+        return 0.f;
+    }
+    if (!cachedRelativePos(self, other, dist)) {
+        distanceToAncestor(self, other, dist);
     }
-    return 0.f;
+    return sqrMag(dist);
 }
 
 
 float squareHorizontalDistance(const Location & self, const Location & other)
 {
     Point3D dist;
-    distanceToAncestor(self, other, dist);
+    relativePosition(self, other, dist);
     dist.z() = 0.f;
     return sqrMag(dist);
 }
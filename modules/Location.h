@@ -44,6 +44,21 @@ class Location {
 
     float m_radius; // Radius of bounding sphere of box
     float m_squareRadius;
+
+    // Transform from the coordinates of children of this location to those
+    // of children of the root of the hierarchy, cached by rootTransform().
+    mutable Point3D m_rootPos;
+    mutable Quaternion m_rootOrientation;
+    mutable const Location * m_cacheRoot;
+    // Parent, position, orientation and parent generation the cached
+    // transform was built from.
+    mutable const LocatedEntity * m_cacheLoc;
+    mutable Point3D m_cachePos;
+    mutable Quaternion m_cacheOrientation;
+    mutable unsigned long m_cacheParentGeneration;
+    mutable unsigned long m_generation;
+
+    static unsigned long s_generation;
   public:
     LocatedEntity * m_loc;
     Point3D m_pos;   // Coords relative to m_loc entity
@@ -113,6 +128,18 @@ class Location {
     void modifyBBox();
     void setVisibility(float v);
 
+    const Location * rootTransform() const;
+
+    /// \brief Position of this location relative to the root
+    ///
+    /// Only valid after rootTransform() has returned non-null.
+    const Point3D & rootPos() const { return m_rootPos; }
+
+    /// \brief Orientation of this location relative to the root
+    ///
+    /// Only valid after rootTransform() has returned non-null.
+    const Quaternion & rootOrientation() const { return m_rootOrientation; }
+
     friend std::ostream & operator<<(std::ostream& s, Location& v);
 };
 
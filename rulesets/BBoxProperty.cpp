@@ -19,6 +19,7 @@
 #include "BBoxProperty.h"
 
 #include "rulesets/LocatedEntity.h"
+#include "rulesets/Domain.h"
 
 #include "common/log.h"
 
@@ -38,6 +39,12 @@ BBoxProperty::BBoxProperty()
 void BBoxProperty::apply(LocatedEntity * ent)
 {
     ent->m_location.setBBox(m_data);
+    if (ent->m_location.m_loc != 0) {
+        Domain * domain = ent->m_location.m_loc->getMovementDomain();
+        if (domain) {
+            domain->updatePosition(*ent);
+        }
+    }
 }
 
 int BBoxProperty::get(Element & val) const
@@ -162,10 +162,8 @@ void BaseMind::SoundOperation(const Operation & op, OpVector & res)
     Operation op2(Atlas::Objects::smart_dynamic_cast<Operation>(arg));
     if (op2.isValid()) {
         debug( std::cout << " args is an op!" << std::endl << std::flush;);
-        std::string event_name("sound_");
-        event_name += op2->getParents().front();
-
-        if (m_script == 0 || m_script->operation(event_name, op2, res) == 0) {
+        if (m_script == 0 ||
+            m_script->dispatch(Script::SOUND_HANDLERS, op2, res) == 0) {
             callSoundOperation(op2, res);
         }
     }
@@ -185,10 +183,8 @@ void BaseMind::SightOperation(const Operation & op, OpVector & res)
     Operation op2(Atlas::Objects::smart_dynamic_cast<Operation>(arg));
     if (op2.isValid()) {
         debug( std::cout << " args is an op!" << std::endl << std::flush;);
-        std::string event_name("sight_");
-        event_name += op2->getParents().front();
-
-        if (m_script == 0 || m_script->operation(event_name, op2, res) == 0) {
+        if (m_script == 0 ||
+            m_script->dispatch(Script::SIGHT_HANDLERS, op2, res) == 0) {
             callSightOperation(op2, res);
         }
     } else /* if (op2->getObjtype() == "object") */ {
@@ -283,7 +279,7 @@ void BaseMind::operation(const Operation & op, OpVector & res)
     m_map.sendLooks(res);
     if (m_script != 0) {
         m_script->operation("call_triggers", op, res);
-        if (m_script->operation(op->getParents().front(), op, res) != 0) {
+        if (m_script->dispatch(Script::OPERATION_HANDLERS, op, res) != 0) {
             return;
         }
     }
@@ -63,12 +63,14 @@ using Atlas::Message::ListType;
 using Atlas::Message::MapType;
 using Atlas::Objects::Root;
 using Atlas::Objects::Operation::Info;
+using Atlas::Objects::Operation::Look;
 using Atlas::Objects::Operation::Set;
 using Atlas::Objects::Operation::Sight;
 using Atlas::Objects::Operation::Sound;
 using Atlas::Objects::Operation::Tick;
 using Atlas::Objects::Operation::Move;
 using Atlas::Objects::Operation::Action;
+using Atlas::Objects::Operation::Disappearance;
 using Atlas::Objects::Operation::Unseen;
 using Atlas::Objects::Operation::Update;
 using Atlas::Objects::Operation::Wield;
@@ -81,6 +83,14 @@ static const bool debug_flag = false;
 
 long int Character::s_serialNumberNext = 0L;
 
+bool Character::s_suspendShadowMind = true;
+
+/// Number of Looks sent at once when a suspended mind resumes.
+static const std::size_t resume_looks_per_batch = 16;
+
+/// Seconds between the batches of Looks sent when a suspended mind resumes.
+static const double resume_look_interval = 0.25;
+
 // This figure is calculated to allow a character to live for 4 weeks
 // without food, during which time they will lose 40% of their mass
 // before starving.
@@ -140,11 +150,13 @@ void Character::metabolise(OpVector & res, double ammount)
     double & status = status_prop->data();
     status_prop->setFlags(flag_unsent);
 
-    Property<double> * food_prop = modPropertyType<double>(FOOD);
+    // Class defaults are only copied to this entity when they change.
+    const Property<double> * food_value = getPropertyType<double>(FOOD);
     // DIGEST
-    if (food_prop != 0) {
-        double & food = food_prop->data();
-        if (food >= foodConsumption && status < 2) {
+    if (food_value != 0) {
+        if (food_value->data() >= foodConsumption && status < 2) {
+            Property<double> * food_prop = modPropertyType<double>(FOOD);
+            double & food = food_prop->data();
             // It is important that the metabolise bit is done next, as this
             // handles the status change
             status += foodConsumption;
@@ -156,11 +168,11 @@ void Character::metabolise(OpVector & res, double ammount)
         }
     }
 
-    Property<double> * mass_prop = modPropertyType<double>(MASS);
     // If status is very high, we gain weight
     if (status > (1.5 + energyLaidDown)) {
         status -= energyLaidDown;
         status_changed = true;
+        Property<double> * mass_prop = modPropertyType<double>(MASS);
         if (mass_prop != 0) {
             double & mass = mass_prop->data();
             mass += weightGain;
@@ -176,10 +188,13 @@ void Character::metabolise(OpVector & res, double ammount)
         double energy_used = energyConsumption * ammount;
         status -= energy_used;
         status_changed = true;
-        if (mass_prop != 0) {
-            double & mass = mass_prop->data();
-            double weight_used = weightConsumption * mass * ammount;
-            if (status <= 0.5 && mass > weight_used) {
+        const Property<double> * mass_value = getPropertyType<double>(MASS);
+        if (mass_value != 0) {
+            double weight_used = weightConsumption * mass_value->data() *
+                                 ammount;
+            if (status <= 0.5 && mass_value->data() > weight_used) {
+                Property<double> * mass_prop = modPropertyType<double>(MASS);
+                double & mass = mass_prop->data();
                 // Drain away a little less energy and lose some weight
                 // This ensures there is a long term penalty to allowing
                 // something to starve
@@ -195,10 +210,13 @@ void Character::metabolise(OpVector & res, double ammount)
     const TasksProperty * tp = getPropertyClass<TasksProperty>(TASKS);
     if ((tp == 0 || !tp->busy()) && !m_movement.updateNeeded(m_location)) {
 
-        Property<double> * stamina_prop = modPropertyType<double>(STAMINA);
-        if (stamina_prop != 0) {
-            double & stamina = stamina_prop->data();
-            if (stamina < 1.f) {
+        const Property<double> * stamina_value =
+              getPropertyType<double>(STAMINA);
+        if (stamina_value != 0) {
+            if (stamina_value->data() < 1.f) {
+                Property<double> * stamina_prop =
+                      modPropertyType<double>(STAMINA);
+                double & stamina = stamina_prop->data();
                 stamina = 1.f;
                 stamina_prop->setFlags(flag_unsent);
                 stamina_prop->apply(this);
@@ -272,6 +290,7 @@ LocatedEntity * Character::findInInventory(const std::string & id)
 Character::Character(const std::string & id, long intId) :
            Thing(id, intId),
                m_movement(*new Pedestrian(*this)),
+               m_mindSuspended(false),
                m_mind(0), m_externalMind(0)
 {
     // FIXME Do we still need this?
@@ -529,8 +548,7 @@ void Character::UseOperation(const Operation & op, OpVector & res)
         return;
     }
 
-    // Are we going to modify this really?
-    EntityProperty * rhw = modPropertyClass<EntityProperty>(RIGHT_HAND_WIELD);
+    const EntityProperty * rhw = getPropertyClass<EntityProperty>(RIGHT_HAND_WIELD);
     if (rhw == 0) {
         error(op, "Character::UseOp No tool wielded, no right_hand_wield property found.", res, getId());
         return;
@@ -1782,9 +1800,17 @@ void Character::sendMind(const Operation & op, OpVector & res)
 
     if (0 != m_externalMind) {
         if (0 != m_mind) {
-            OpVector mindRes;
-            m_mind->operation(op, mindRes);
-            // Discard all the local results
+            if (s_suspendShadowMind && m_externalMind->isLinked()) {
+                // The results would be discarded, so don't run it at all.
+                m_mindSuspended = true;
+            } else {
+                if (m_mindSuspended) {
+                    resumeMind();
+                }
+                OpVector mindRes;
+                m_mind->operation(op, mindRes);
+                // Discard all the local results
+            }
         }
         debug(std::cout << "Sending to external mind" << std::endl
                          << std::flush;);
@@ -1798,6 +1824,56 @@ void Character::sendMind(const Operation & op, OpVector & res)
     }
 }
 
+/// \brief Bring the internal mind up to date after it has been suspended
+///
+/// The mind has missed everything the character perceived while an
+/// external mind was in control. Rather than copying the state of the
+/// world into its memory, the character looks at each entity the mind
+/// remembers, so the mind learns what has changed through the usual Sight
+/// and Unseen operations. A mind may remember a great many entities, so
+/// the Looks are sent in small batches spread out over time.
+///
+/// Entities which were destroyed in the meantime would never answer a Look,
+/// so the mind is told straight away that they have disappeared, which
+/// lets it expire them from memory.
+void Character::resumeMind()
+{
+    m_mindSuspended = false;
+
+    std::vector<Root> gone;
+    const MemEntityDict & entities = m_mind->getMap()->getEntities();
+    MemEntityDict::const_iterator I = entities.begin();
+    MemEntityDict::const_iterator Iend = entities.end();
+    std::size_t count = 0;
+    for (; I != Iend; ++I) {
+        if (BaseWorld::instance().getEntity(I->first) == 0) {
+            Anonymous gone_arg;
+            gone_arg->setId(I->second->getId());
+            gone.push_back(gone_arg);
+            continue;
+        }
+        Look l;
+        l->setFrom(getId());
+        l->setTo(I->second->getId());
+        std::size_t batch = count++ / resume_looks_per_batch;
+        if (batch != 0) {
+            l->setFutureSeconds(batch * resume_look_interval);
+        }
+        sendWorld(l);
+    }
+
+    if (!gone.empty()) {
+        Disappearance d;
+        d->setArgs(gone);
+        d->setTo(getId());
+        d->setSeconds(BaseWorld::instance().getTime());
+        // The external mind is in control, so anything the mind replies
+        // is discarded.
+        OpVector mindRes;
+        m_mind->operation(d, mindRes);
+    }
+}
+
 /// \brief Filter operations from the mind destined for the body.
 ///
 /// Operations from the character's mind which is either an NPC mind,
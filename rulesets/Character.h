@@ -97,7 +97,12 @@ class Character : public Thing, public virtual sigc::trackable {
     /// for wielded entities.
     sigc::connection m_rightHandWieldConnection;
 
+    /// \brief Set if the internal mind has missed operations while an
+    /// external mind was in control.
+    bool m_mindSuspended;
+
     void filterExternalOperation(const Operation &);
+    void resumeMind();
     void metabolise(OpVector &, double ammount = 1); 
     void wieldDropped();
     LocatedEntity * findInContains(LocatedEntity * ent, const std::string & id);
@@ -113,6 +118,10 @@ class Character : public Thing, public virtual sigc::trackable {
     /// \brief Emitted when the external link for this character has changed.
     sigc::signal<void> externalLinkChanged;
 
+    /// \brief Whether the internal mind stops running while an external
+    /// mind is linked, instead of running with its results discarded
+    static bool s_suspendShadowMind;
+
     explicit Character(const std::string & id, long intId);
     virtual ~Character();
 
@@ -29,6 +29,28 @@ Domain::~Domain()
 {
 }
 
+bool Domain::findObserverCandidates(const LocatedEntity& observedEntity, std::vector<LocatedEntity*>& candidates) const
+{
+    return false;
+}
+
+void Domain::addEntity(LocatedEntity& entity)
+{
+}
+
+void Domain::removeEntity(LocatedEntity& entity)
+{
+}
 
+void Domain::updatePosition(LocatedEntity& entity)
+{
+}
 
+bool Domain::addMover(LocatedEntity& entity, Motion& motion, double nextUpdate)
+{
+    return false;
+}
 
+void Domain::removeMover(LocatedEntity& entity)
+{
+}
@@ -25,9 +25,11 @@
 #include <wfmath/vector.h>
 
 #include <string>
+#include <vector>
 
 class LocatedEntity;
 class Location;
+class Motion;
 
 /// \brief Base class for movement domains
 ///
@@ -86,6 +88,22 @@ class Domain {
      */
     virtual bool isEntityVisibleFor(const LocatedEntity& observingEntity, const LocatedEntity& observedEntity) const = 0;
 
+    /**
+     * @brief Finds those entities which possibly can see the observed entity.
+     *
+     * This is used to avoid having to check every perceptive entity in the
+     * world when broadcasting perception operations. The candidates still
+     * need to be checked with isEntityVisibleFor(). Entities which aren't
+     * perceptive may be left out.
+     *
+     * The default implementation does nothing and returns false.
+     *
+     * @param observedEntity The entity being observed.
+     * @param candidates A vector to be filled with candidate observers.
+     * @return False if the domain can't narrow down the candidates, in which case all perceptive entities need to be checked.
+     */
+    virtual bool findObserverCandidates(const LocatedEntity& observedEntity, std::vector<LocatedEntity*>& candidates) const;
+
     /**
      * @brief Process visibility operation for an entity that has been moved.
      *
@@ -113,6 +131,58 @@ class Domain {
      */
     virtual float checkCollision(LocatedEntity& entity, CollisionData& collisionData) = 0;
 
+    /**
+     * @brief Called when an entity has been added as a child to the domain entity.
+     *
+     * The default implementation does nothing.
+     * @param entity The entity that was added.
+     */
+    virtual void addEntity(LocatedEntity& entity);
+
+    /**
+     * @brief Called when an entity is being removed as a child from the domain entity.
+     *
+     * The default implementation does nothing.
+     * @param entity The entity being removed.
+     */
+    virtual void removeEntity(LocatedEntity& entity);
+
+    /**
+     * @brief Called when the location of an entity has changed.
+     *
+     * This should be called whenever the position, velocity or size of an
+     * entity has been altered. Entities which aren't direct children of the
+     * domain entity are ignored.
+     * The default implementation does nothing.
+     * @param entity The entity which location has changed.
+     */
+    virtual void updatePosition(LocatedEntity& entity);
+
+    /**
+     * @brief Hands over the movement updates of a moving entity to the domain.
+     *
+     * A domain which accepts the entity integrates its movement in tick(),
+     * together with all other moving entities, instead of the entity
+     * having to schedule Update operations for itself. Calling this for
+     * an entity which already is handed over updates when it's next due.
+     *
+     * The default implementation does nothing and returns false.
+     * @param entity The moving entity.
+     * @param motion The motion of the entity, used for collision handling.
+     * @param nextUpdate The time at which the movement next needs to be updated.
+     * @return False if the domain doesn't handle the movement, in which case the entity must schedule its own updates.
+     */
+    virtual bool addMover(LocatedEntity& entity, Motion& motion, double nextUpdate);
+
+    /**
+     * @brief Stops integrating the movement of an entity.
+     *
+     * This must be called before the motion passed to addMover() is
+     * destroyed. The default implementation does nothing.
+     * @param entity The entity.
+     */
+    virtual void removeMover(LocatedEntity& entity);
+
 };
 
 #endif // RULESETS_DOMAIN_H
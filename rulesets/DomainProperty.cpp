@@ -25,6 +25,11 @@
 #include "VoidDomain.h"
 #include "LocatedEntity.h"
 
+#include "common/BaseWorld.h"
+#include "common/Tick.h"
+
+#include <Atlas/Objects/Operation.h>
+
 DomainProperty::DomainProperty()
 : m_domain(nullptr)
 {
@@ -35,8 +40,14 @@ DomainProperty::DomainProperty(const DomainProperty& rhs)
 {
 }
 
-void DomainProperty::remove(LocatedEntity * entity, const std::string &)
+void DomainProperty::install(LocatedEntity * entity, const std::string & name)
+{
+    entity->installDelegate(Atlas::Objects::Operation::TICK_NO, name);
+}
+
+void DomainProperty::remove(LocatedEntity * entity, const std::string & name)
 {
+    entity->removeDelegate(Atlas::Objects::Operation::TICK_NO, name);
     delete m_domain;
     m_domain = nullptr;
     entity->setFlags(~entity_domain);
@@ -60,6 +71,18 @@ void DomainProperty::apply(LocatedEntity * entity)
     }
 }
 
+HandlerResult DomainProperty::operation(LocatedEntity * entity,
+        const Operation & op, OpVector & res)
+{
+    if (!op->getArgs().empty() && op->getArgs().front()->getName() == "domain") {
+        if (m_domain) {
+            m_domain->tick(BaseWorld::instance().getTime());
+        }
+        return OPERATION_BLOCKED;
+    }
+    return OPERATION_IGNORED;
+}
+
 DomainProperty * DomainProperty::copy() const
 {
     return new DomainProperty(*this);
@@ -40,11 +40,18 @@ class DomainProperty : public Property<std::string>
         explicit DomainProperty();
         explicit DomainProperty(const DomainProperty& rhs);
 
+        virtual void install(LocatedEntity *, const std::string &);
         virtual void remove(LocatedEntity *, const std::string &);
         virtual DomainProperty * copy() const;
 
         virtual void apply(LocatedEntity *);
 
+        /**
+         * @brief Passes the Tick operations scheduled by the domain on to it.
+         */
+        virtual HandlerResult operation(LocatedEntity *,
+                const Operation &, OpVector &);
+
         Domain* getDomain() const;
 
     private:
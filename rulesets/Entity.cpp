@@ -112,17 +112,23 @@ PropertyBase * Entity::setAttr(const std::string & name, const Element & attr)
     prop->apply(this);
     // Mark the Entity as unclean
     resetFlags(entity_clean);
+    // The world indexes entities by name, so it must hear of a new name
+    // however it was written.
+    if (name == "name") {
+        onUpdated();
+    }
     return prop;
 }
 
 const PropertyBase * Entity::getProperty(const std::string & name) const
 {
-    PropertyDict::const_iterator I = m_properties.find(name);
+    int key = PropertyKeys::lookup(name);
+    PropertyDict::const_iterator I = m_properties.find(key);
     if (I != m_properties.end()) {
         return I->second;
     }
     if (m_type != 0) {
-        I = m_type->defaults().find(name);
+        I = m_type->defaults().find(key);
         if (I != m_type->defaults().end()) {
             return I->second;
         }
@@ -132,12 +138,13 @@ const PropertyBase * Entity::getProperty(const std::string & name) const
 
 PropertyBase * Entity::modProperty(const std::string & name)
 {
-    PropertyDict::const_iterator I = m_properties.find(name);
+    int key = PropertyKeys::lookup(name);
+    PropertyDict::const_iterator I = m_properties.find(key);
     if (I != m_properties.end()) {
         return I->second;
     }
     if (m_type != 0) {
-        I = m_type->defaults().find(name);
+        I = m_type->defaults().find(key);
         if (I != m_type->defaults().end()) {
             // We have a default for this property. Create a new instance
             // property with the same value.
@@ -481,7 +488,7 @@ void Entity::externalOperation(const Operation & op, Link &)
 void Entity::operation(const Operation & op, OpVector & res)
 {
     if (m_script != 0 &&
-        m_script->operation(op->getParents().front(), op, res) != 0) {
+        m_script->dispatch(Script::OPERATION_HANDLERS, op, res) != 0) {
         return;
     }
 
@@ -519,11 +526,12 @@ HandlerResult Entity::callDelegate(const std::string & name,
                                    OpVector & res)
 {
     PropertyBase * p = 0;
-    PropertyDict::const_iterator I = m_properties.find(name);
+    int key = PropertyKeys::lookup(name);
+    PropertyDict::const_iterator I = m_properties.find(key);
     if (I != m_properties.end()) {
         p = I->second;
     } else if (m_type != 0) {
-        I = m_type->defaults().find(name); 
+        I = m_type->defaults().find(key);
         if (I != m_type->defaults().end()) {
             p = I->second;
         }
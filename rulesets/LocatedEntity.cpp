@@ -20,6 +20,7 @@
 
 #include "Script.h"
 #include "AtlasProperties.h"
+#include "Domain.h"
 
 #include "common/Property.h"
 #include "common/TypeNode.h"
@@ -91,12 +92,13 @@ LocatedEntity::~LocatedEntity()
 /// false otherwise
 bool LocatedEntity::hasAttr(const std::string & name) const
 {
-    PropertyDict::const_iterator I = m_properties.find(name);
+    int key = PropertyKeys::lookup(name);
+    PropertyDict::const_iterator I = m_properties.find(key);
     if (I != m_properties.end()) {
         return true;
     }
     if (m_type != 0) {
-        I = m_type->defaults().find(name);
+        I = m_type->defaults().find(key);
         if (I != m_type->defaults().end()) {
             return true;
         }
@@ -113,12 +115,13 @@ bool LocatedEntity::hasAttr(const std::string & name) const
 int LocatedEntity::getAttr(const std::string & name,
                            Element & attr) const
 {
-    PropertyDict::const_iterator I = m_properties.find(name);
+    int key = PropertyKeys::lookup(name);
+    PropertyDict::const_iterator I = m_properties.find(key);
     if (I != m_properties.end()) {
         return I->second->get(attr);
     }
     if (m_type != 0) {
-        I = m_type->defaults().find(name);
+        I = m_type->defaults().find(key);
         if (I != m_type->defaults().end()) {
             return I->second->get(attr);
         }
@@ -136,12 +139,13 @@ int LocatedEntity::getAttrType(const std::string & name,
                                Element & attr,
                                int type) const
 {
-    PropertyDict::const_iterator I = m_properties.find(name);
+    int key = PropertyKeys::lookup(name);
+    PropertyDict::const_iterator I = m_properties.find(key);
     if (I != m_properties.end()) {
         return I->second->get(attr) || (attr.getType() == type ? 0 : 1);
     }
     if (m_type != 0) {
-        I = m_type->defaults().find(name);
+        I = m_type->defaults().find(key);
         if (I != m_type->defaults().end()) {
             return I->second->get(attr) || (attr.getType() == type ? 0 : 1);
         }
@@ -281,6 +285,13 @@ void LocatedEntity::addChild(LocatedEntity& childEntity)
     }
 
     childEntity.m_location.m_loc = this;
+
+    if (m_flags & entity_domain) {
+        Domain * domain = getMovementDomain();
+        if (domain) {
+            domain->addEntity(childEntity);
+        }
+    }
 }
 
 void LocatedEntity::removeChild(LocatedEntity& childEntity)
@@ -288,6 +299,12 @@ void LocatedEntity::removeChild(LocatedEntity& childEntity)
     assert(checkRef() > 0);
     assert(m_contains != 0);
     assert(m_contains->count(&childEntity));
+    if (m_flags & entity_domain) {
+        Domain * domain = getMovementDomain();
+        if (domain) {
+            domain->removeEntity(childEntity);
+        }
+    }
     m_contains->erase(&childEntity);
     if (m_contains->empty()) {
         onUpdated();
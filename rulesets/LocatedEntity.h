@@ -22,6 +22,7 @@
 #include "modules/Location.h"
 
 #include "common/Property.h"
+#include "common/PropertyDict.h"
 #include "common/Router.h"
 #include "common/log.h"
 #include "common/compose.hpp"
@@ -29,6 +30,7 @@
 #include <sigc++/signal.h>
 
 #include <set>
+#include <typeinfo>
 
 #include <cassert>
 
@@ -42,7 +44,20 @@ template <typename T>
 class Property;
 
 typedef std::set<LocatedEntity *> LocatedEntitySet;
-typedef std::map<std::string, PropertyBase *> PropertyDict;
+
+/// \brief Cast a property to a given class
+///
+/// Properties are nearly always of exactly the class asked for, which is
+/// much cheaper to check than a dynamic_cast, so that is only needed for
+/// subclasses.
+template <class PropertyT, class BaseT>
+PropertyT * property_cast(BaseT * p)
+{
+    if (typeid(*p) == typeid(PropertyT)) {
+        return static_cast<PropertyT *>(p);
+    }
+    return dynamic_cast<PropertyT *>(p);
+}
 
 /// \brief Flag indicating entity has been written to permanent store
 /// \ingroup EntityFlags
@@ -214,7 +229,7 @@ class LocatedEntity : public Router {
     {
         const PropertyBase * p = getProperty(name);
         if (p != 0) {
-            return dynamic_cast<const PropertyT *>(p);
+            return property_cast<const PropertyT>(p);
         }
         return 0;
     }
@@ -225,7 +240,7 @@ class LocatedEntity : public Router {
     {
         const PropertyBase * p = getProperty(name);
         if (p != 0) {
-            return dynamic_cast<const Property<T> *>(p);
+            return property_cast<const Property<T> >(p);
         }
         return 0;
     }
@@ -236,7 +251,7 @@ class LocatedEntity : public Router {
     {
         PropertyBase * p = modProperty(name);
         if (p != 0) {
-            return dynamic_cast<PropertyT *>(p);
+            return property_cast<PropertyT>(p);
         }
         return 0;
     }
@@ -251,7 +266,7 @@ class LocatedEntity : public Router {
     {
         PropertyBase * p = modProperty(name);
         if (p != 0) {
-            return dynamic_cast<Property<T> *>(p);
+            return property_cast<Property<T> >(p);
         }
         return 0;
     }
@@ -271,7 +286,7 @@ class LocatedEntity : public Router {
         PropertyBase * p = modProperty(name);
         PropertyT * sp = 0;
         if (p != 0) {
-            sp = dynamic_cast<PropertyT *>(p);
+            sp = property_cast<PropertyT>(p);
             //Assert that the stored property is of the correct type. If not,
             //it needs to be installed into CorePropertyManager.
             //We want to do this here, because allowing for properties to be
@@ -31,10 +31,14 @@
 #include <Atlas/Objects/Operation.h>
 #include <Atlas/Objects/Anonymous.h>
 
+#include <cmath>
 #include <sstream>
 
 static const bool debug_flag = false;
 
+/// \brief Width of the square cells used to index entities by position
+static const WFMath::CoordType grid_cell_size = 32.f;
+
 using Atlas::Message::Element;
 using Atlas::Message::MapType;
 using Atlas::Objects::Operation::Look;
@@ -45,6 +49,11 @@ using String::compose;
 
 const TypeNode * MemMap::m_entity_type = 0;
 
+static int gridCoord(WFMath::CoordType c)
+{
+    return (int)std::floor(c / grid_cell_size);
+}
+
 MemEntity * MemMap::addEntity(MemEntity * entity)
 {
     assert(entity != 0);
@@ -59,6 +68,7 @@ MemEntity * MemMap::addEntity(MemEntity * entity)
     }
     m_entities[entity->getIntId()] = entity;
     m_checkIterator = m_entities.find(next);
+    indexType(entity);
 
     if (m_script != 0) {
         debug( std::cout << this << std::endl << std::flush;);
@@ -80,7 +90,11 @@ void MemMap::readEntity(MemEntity * entity, const RootEntity & ent)
             if (entity->getType() == m_entity_type) {
                 const TypeNode * type = Inheritance::instance().getType(parents.front());
                 if (type != 0) {
+                    bool indexed = unindexType(entity);
                     entity->setType(type);
+                    if (indexed) {
+                        indexType(entity);
+                    }
                 }
             } else if (entity->getType()->name() != parents.front()) {
                 debug(std::cout << "Attempting to mutate " << entity->getType()
@@ -108,6 +122,7 @@ void MemMap::readEntity(MemEntity * entity, const RootEntity & ent)
             entity->m_location.m_loc->m_contains->insert(entity);
         }
         entity->m_location.readFromEntity(ent);
+        indexLocation(entity);
     }
     addContents(ent);
 }
@@ -206,9 +221,20 @@ void MemMap::del(const std::string & id)
             next = m_checkIterator->first;
         }
         m_entities.erase(I);
+        unindexType(ent);
+        unindexLocation(ent);
 
         ent->destroy(); // should probably go here, but maybe earlier
 
+        // Children of the deleted entity have been moved to its parent
+        if (ent->m_contains != 0) {
+            LocatedEntitySet::const_iterator K = ent->m_contains->begin();
+            LocatedEntitySet::const_iterator Kend = ent->m_contains->end();
+            for (; K != Kend; ++K) {
+                indexLocation(*K);
+            }
+        }
+
         if (next != -1) {
             m_checkIterator = m_entities.find(next);
         } else {
@@ -321,17 +347,112 @@ MemEntity * MemMap::updateAdd(const RootEntity & ent, const double & d)
     return entity;
 }
 
+void MemMap::indexType(MemEntity * entity)
+{
+    m_typeIndex[entity->getType()->name()][entity->getIntId()] = entity;
+}
+
+bool MemMap::unindexType(MemEntity * entity)
+// Remove an entity from the type index, returning true if it was there
+{
+    auto I = m_typeIndex.find(entity->getType()->name());
+    if (I == m_typeIndex.end()) {
+        return false;
+    }
+    MemEntityDict::iterator J = I->second.find(entity->getIntId());
+    if (J == I->second.end() || J->second != entity) {
+        return false;
+    }
+    I->second.erase(J);
+    if (I->second.empty()) {
+        m_typeIndex.erase(I);
+    }
+    return true;
+}
+
+void MemMap::indexLocation(LocatedEntity * entity)
+// File an entity in the grid of its current container, moving it out of
+// the cell or grid it was in before if required
+{
+    LocatedEntity * loc = entity->m_location.m_loc;
+    const Point3D & pos = entity->m_location.pos();
+    GridEntry entry;
+    entry.container = loc;
+    entry.placed = pos.isValid();
+    entry.cell = entry.placed ? GridCell(gridCoord(pos.x()), gridCoord(pos.y()))
+                              : GridCell(0, 0);
+
+    auto I = m_gridEntries.find(entity);
+    if (I != m_gridEntries.end()) {
+        const GridEntry & old = I->second;
+        if (old.container == entry.container && old.placed == entry.placed &&
+            old.cell == entry.cell) {
+            return;
+        }
+        removeFromGrid(entity, old);
+        m_gridEntries.erase(I);
+    }
+    if (loc == 0) {
+        return;
+    }
+    m_gridEntries.insert(std::make_pair(entity, entry));
+
+    Grid & grid = m_grids[loc];
+    if (entry.placed) {
+        grid.cells[entry.cell].insert(entity);
+    } else {
+        grid.unplaced.insert(entity);
+    }
+    ++grid.count;
+}
+
+void MemMap::unindexLocation(LocatedEntity * entity)
+{
+    auto I = m_gridEntries.find(entity);
+    if (I != m_gridEntries.end()) {
+        removeFromGrid(entity, I->second);
+        m_gridEntries.erase(I);
+    }
+}
+
+void MemMap::removeFromGrid(LocatedEntity * entity, const GridEntry & entry)
+{
+    auto I = m_grids.find(entry.container);
+    if (I == m_grids.end()) {
+        return;
+    }
+    Grid & grid = I->second;
+    if (entry.placed) {
+        auto J = grid.cells.find(entry.cell);
+        if (J != grid.cells.end()) {
+            J->second.erase(entity);
+            if (J->second.empty()) {
+                grid.cells.erase(J);
+            }
+        }
+    } else {
+        grid.unplaced.erase(entity);
+    }
+    if (--grid.count == 0) {
+        m_grids.erase(I);
+    }
+}
+
 EntityVector MemMap::findByType(const std::string & what)
 // Find an entity in our memory of a certain type
 {
     EntityVector res;
-    
-    MemEntityDict::const_iterator Iend = m_entities.end();
-    for (MemEntityDict::const_iterator I = m_entities.begin(); I != Iend; ++I) {
-        MemEntity * item = I->second;
+
+    auto I = m_typeIndex.find(what);
+    if (I == m_typeIndex.end()) {
+        return res;
+    }
+    MemEntityDict::const_iterator Jend = I->second.end();
+    for (MemEntityDict::const_iterator J = I->second.begin(); J != Jend; ++J) {
+        MemEntity * item = J->second;
         debug( std::cout << "F" << what << ":" << item->getType() << ":" << item->getId() << std::endl << std::flush;);
-        if (item->isVisible() && item->getType()->name() == what) {
-            res.push_back(I->second);
+        if (item->isVisible()) {
+            res.push_back(item);
         }
     }
     return res;
@@ -358,9 +479,83 @@ EntityVector MemMap::findByLocation(const Location & loc,
         return res;
     }
 #endif // NDEBUG
+    float square_range = radius * radius;
+
+    // The indexes can only be used if every child of the place has been
+    // filed through readEntity. Otherwise fall back to checking them all.
+    auto G = m_grids.find(place);
+    if (G != m_grids.end() && G->second.count == place->m_contains->size() &&
+        loc.pos().isValid()) {
+        const Grid & grid = G->second;
+
+        // If there are fewer entities of this type than there are children
+        // of the place, it is cheaper to check those.
+        auto T = m_typeIndex.find(what);
+        if (T == m_typeIndex.end()) {
+            return res;
+        }
+        if (T->second.size() < grid.count) {
+            MemEntityDict::const_iterator J = T->second.begin();
+            MemEntityDict::const_iterator Jend = T->second.end();
+            for (; J != Jend; ++J) {
+                MemEntity * item = J->second;
+                if (item->m_location.m_loc == place && item->isVisible() &&
+                    squareDistance(loc.pos(), item->m_location.pos()) < square_range) {
+                    res.push_back(item);
+                }
+            }
+            return res;
+        }
+
+        std::vector<const LocatedEntitySet *> candidates;
+        candidates.push_back(&grid.unplaced);
+        WFMath::CoordType extent = std::fabs(radius);
+        int min_x = gridCoord(loc.pos().x() - extent);
+        int max_x = gridCoord(loc.pos().x() + extent);
+        int min_y = gridCoord(loc.pos().y() - extent);
+        int max_y = gridCoord(loc.pos().y() + extent);
+        // Visit whichever is fewer, the cells covered by the radius or the
+        // cells which are occupied.
+        if ((double)(max_x - min_x + 1) * (max_y - min_y + 1) <
+            grid.cells.size()) {
+            for (int x = min_x; x <= max_x; ++x) {
+                for (int y = min_y; y <= max_y; ++y) {
+                    auto C = grid.cells.find(GridCell(x, y));
+                    if (C != grid.cells.end()) {
+                        candidates.push_back(&C->second);
+                    }
+                }
+            }
+        } else {
+            auto C = grid.cells.begin();
+            auto Cend = grid.cells.end();
+            for (; C != Cend; ++C) {
+                if (C->first.first >= min_x && C->first.first <= max_x &&
+                    C->first.second >= min_y && C->first.second <= max_y) {
+                    candidates.push_back(&C->second);
+                }
+            }
+        }
+        std::vector<const LocatedEntitySet *>::const_iterator K = candidates.begin();
+        std::vector<const LocatedEntitySet *>::const_iterator Kend = candidates.end();
+        for (; K != Kend; ++K) {
+            LocatedEntitySet::const_iterator I = (*K)->begin();
+            LocatedEntitySet::const_iterator Iend = (*K)->end();
+            for (; I != Iend; ++I) {
+                LocatedEntity * item = *I;
+                if (!item->isVisible() || item->getType()->name() != what) {
+                    continue;
+                }
+                if (squareDistance(loc.pos(), item->m_location.pos()) < square_range) {
+                    res.push_back(item);
+                }
+            }
+        }
+        return res;
+    }
+
     LocatedEntitySet::const_iterator I = place->m_contains->begin();
     LocatedEntitySet::const_iterator Iend = place->m_contains->end();
-    float square_range = radius * radius;
     for (; I != Iend; ++I) {
         assert(*I != 0);
         LocatedEntity * item = *I;
@@ -396,6 +591,8 @@ void MemMap::check(const double & time)
                 next = J->first;
             }
             m_entities.erase(m_checkIterator);
+            unindexType(me);
+            unindexLocation(me);
             // Remove deleted entity from its parents contains attribute
             if (me->m_location.m_loc != 0) {
                 assert(me->m_location.m_loc->m_contains != 0);
@@ -432,4 +629,7 @@ void MemMap::flush()
         I->second->m_location.m_loc = 0;
         I->second->decRef();
     }
+    m_typeIndex.clear();
+    m_grids.clear();
+    m_gridEntries.clear();
 }
@@ -27,7 +27,9 @@
 
 #include <list>
 #include <map>
+#include <set>
 #include <string>
+#include <unordered_map>
 
 class LocatedEntity;
 class Location;
@@ -36,6 +38,7 @@ class Script;
 class TypeNode;
 
 typedef std::vector<LocatedEntity *> EntityVector;
+typedef std::set<LocatedEntity *> LocatedEntitySet;
 typedef std::map<long, MemEntity *> MemEntityDict;
 
 /// \brief Class to handle the basic entity memory of a mind
@@ -43,9 +46,34 @@ class MemMap {
   protected:
     friend class BaseMind;
 
+    /// \brief A square cell of a spatial grid, in the horizontal plane
+    typedef std::pair<int, int> GridCell;
+
+    /// \brief Spatial grid over the remembered children of one container
+    struct Grid {
+        std::map<GridCell, LocatedEntitySet> cells;
+        /// \brief Children whose position is not known
+        LocatedEntitySet unplaced;
+        /// \brief Number of children filed in this grid
+        std::size_t count;
+    };
+
+    /// \brief Where an entity is filed in the grid of its container
+    struct GridEntry {
+        LocatedEntity * container;
+        bool placed;
+        GridCell cell;
+    };
+
     static const TypeNode * m_entity_type;
 
     MemEntityDict m_entities;
+    /// \brief Remembered entities keyed by the name of their type
+    std::unordered_map<std::string, MemEntityDict> m_typeIndex;
+    /// \brief Grids keyed by the container they cover
+    std::unordered_map<const LocatedEntity *, Grid> m_grids;
+    /// \brief Grid entries keyed by the entity they file
+    std::unordered_map<const LocatedEntity *, GridEntry> m_gridEntries;
     MemEntityDict::iterator m_checkIterator;
     std::list<std::string> m_additionsById;
     std::vector<std::string> m_addHooks;
@@ -60,6 +88,12 @@ class MemMap {
                           const Atlas::Objects::Entity::RootEntity &);
     void addContents(const Atlas::Objects::Entity::RootEntity &);
     MemEntity * addId(const std::string &, long);
+
+    void indexType(MemEntity *);
+    bool unindexType(MemEntity *);
+    void indexLocation(LocatedEntity *);
+    void unindexLocation(LocatedEntity *);
+    void removeFromGrid(LocatedEntity *, const GridEntry &);
   public:
     explicit MemMap(Script *& s);
 
@@ -0,0 +1,65 @@
+// Cyphesis Online RPG Server and AI Engine
+// Copyright (C) 2014 Erik Ogenvik
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+
+#ifndef RULESETS_MIND_HOST_H
+#define RULESETS_MIND_HOST_H
+
+#include <Atlas/Message/Element.h>
+
+class Character;
+
+/// \brief Interface to something which runs the minds of NPCs outside the
+/// world
+///
+/// If an instance has been installed, MindProperty hands characters to it
+/// instead of creating a BaseMind in the server. The host is then
+/// responsible for attaching a mind to the character as an external mind.
+class MindHost {
+  private:
+    static MindHost *& current() {
+        static MindHost * s_instance = 0;
+        return s_instance;
+    }
+  public:
+    virtual ~MindHost() {
+        if (current() == this) {
+            current() = 0;
+        }
+    }
+
+    /// \brief The host currently installed, or null if minds run in the
+    /// server
+    static MindHost * instance() {
+        return current();
+    }
+
+    /// \brief Install a host, replacing any existing one
+    static void setInstance(MindHost * host) {
+        current() = host;
+    }
+
+    /// \brief Run the mind of a character
+    ///
+    /// @param chr The character which needs a mind
+    /// @param mind The value of the mind property of the character, which
+    /// describes the script to run
+    virtual void addMind(Character & chr,
+                         const Atlas::Message::MapType & mind) = 0;
+};
+
+#endif // RULESETS_MIND_HOST_H
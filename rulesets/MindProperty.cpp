@@ -20,6 +20,7 @@
 
 #include "rulesets/Character.h"
 #include "rulesets/MindFactory.h"
+#include "rulesets/MindHost.h"
 #include "rulesets/PythonScriptFactory.h"
 #include "rulesets/BaseMind.h"
 
@@ -127,6 +128,13 @@ void MindProperty::apply(LocatedEntity * ent)
         return;
     }
 
+    // The host sets up the mind once it has been attached to the character.
+    MindHost * host = MindHost::instance();
+    if (host != 0) {
+        host->addMind(*chr, data());
+        return;
+    }
+
     chr->m_mind = m_factory->newMind(ent->getId(), ent->getIntId());
 
     //Make sure that the mind isn't deleted when shutting down by any SIGHT of DELETE of itself
@@ -37,6 +37,7 @@ using String::compose;
 static const bool debug_flag = false;
 
 Motion::Motion(LocatedEntity & body, Domain& domain) : m_entity(body), m_domain(domain), m_serialno(0),
+                                       m_updateHandle(0),
                                        m_collision(false), m_collEntity(0),
                                        m_collisionTime(0.f)
 {
@@ -46,6 +47,15 @@ Motion::~Motion()
 {
 }
 
+void Motion::reset()
+{
+    m_collision = false;
+    m_collEntity = 0;
+    m_collNormal = Vector3D();
+    m_collisionTime = 0.f;
+    m_updateHandle = 0;
+}
+
 void Motion::setMode(const std::string & mode)
 {
     m_mode = mode;
@@ -27,6 +27,7 @@
 #include <wfmath/vector.h>
 
 #include <string>
+#include <cstdint>
 
 class LocatedEntity;
 
@@ -64,6 +65,9 @@ class Motion {
     /// Refno of next expected update op
     long m_serialno;
 
+    /// Handle of the scheduled update op, used to cancel it when superseded
+    std::uint64_t m_updateHandle;
+
     /// Collision predicted flag
     bool m_collision;
     /// Entity with which collision will occur
@@ -85,6 +89,10 @@ class Motion {
         return m_serialno;
     }
 
+    std::uint64_t & updateHandle() {
+        return m_updateHandle;
+    }
+
     const bool collision() const {
         return m_collision;
     }
@@ -92,6 +100,12 @@ class Motion {
     void clearCollision() {
         m_collision = false;
     }
+
+    /// \brief Forget any predicted collision
+    ///
+    /// Called when the entity stops moving, so that when it starts moving
+    /// again it doesn't act on a collision predicted for its old path.
+    void reset();
     
     /// \brief Set the mode the motion is currently in
     ///
@@ -24,13 +24,16 @@
 
 #include "TerrainProperty.h"
 #include "LocatedEntity.h"
+#include "Motion.h"
 #include "OutfitProperty.h"
 #include "EntityProperty.h"
 
 #include "physics/Collision.h"
 
+#include "common/BaseWorld.h"
 #include "common/debug.h"
 #include "common/const.h"
+#include "common/Tick.h"
 
 #include <Atlas/Objects/Operation.h>
 #include <Atlas/Objects/Anonymous.h>
@@ -38,8 +41,10 @@
 
 #include <iostream>
 #include <unordered_set>
+#include <algorithm>
 
 #include <cassert>
+#include <cmath>
 
 static const bool debug_flag = false;
 
@@ -48,18 +53,49 @@ using Atlas::Message::MapType;
 using Atlas::Objects::Root;
 using Atlas::Objects::Entity::RootEntity;
 using Atlas::Objects::Entity::Anonymous;
+using Atlas::Objects::Operation::Move;
 using Atlas::Objects::Operation::Set;
 using Atlas::Objects::Operation::Sight;
 using Atlas::Objects::Operation::Appearance;
 using Atlas::Objects::Operation::Disappearance;
+using Atlas::Objects::Operation::Tick;
+
+/**
+ * @brief Calculates the distance within which an entity can interact with others, either by being seen or by colliding.
+ * @param entity The entity.
+ * @return The reach of the entity.
+ */
+static float calculateReach(const LocatedEntity& entity)
+{
+    const Location& location = entity.m_location;
+    //Beyond this distance the entity is too small to be seen.
+    float reach = std::sqrt(location.squareBoxSize() / consts::square_sight_factor);
+    if (location.bBox().isValid()) {
+        //Include the distance the entity can travel until its next movement update.
+        float collision_reach = location.radius();
+        if (location.velocity().isValid()) {
+            collision_reach += location.velocity().mag() * consts::move_tick;
+        }
+        reach = std::max(reach, collision_reach);
+    }
+    return reach;
+}
 
 PhysicalDomain::PhysicalDomain(LocatedEntity& entity)
-: Domain(entity)
+: Domain(entity), m_ticking(false), m_tickHandle(0), m_nextTick(0)
 {
+    if (m_entity.m_contains != nullptr) {
+        for (LocatedEntity* child : *m_entity.m_contains) {
+            indexChild(*child);
+        }
+    }
 }
 
 PhysicalDomain::~PhysicalDomain()
 {
+    if (m_tickHandle != 0) {
+        BaseWorld::instance().cancelOperation(m_tickHandle);
+    }
 }
 
 float PhysicalDomain::constrainHeight(LocatedEntity * parent,
@@ -104,7 +140,210 @@ float PhysicalDomain::constrainHeight(LocatedEntity * parent,
 
 void PhysicalDomain::tick(double t)
 {
+    // The tick op which triggered this has been dispatched.
+    m_tickHandle = 0;
+
+    std::vector<std::pair<LocatedEntity*, Operation>> ops;
+    OpVector res;
+    double nextTick = 0;
+    bool hasNextTick = false;
+
+    m_ticking = true;
+    // Movers added during the pass are appended, and not due yet, so only
+    // the ones present from the start need to be looked at.
+    std::size_t moverCount = m_movers.size();
+    for (std::size_t i = 0; i < moverCount; ++i) {
+        if (m_movers[i].entity == nullptr) {
+            continue;
+        }
+        if (m_movers[i].nextUpdate <= t) {
+            LocatedEntity& entity = *m_movers[i].entity;
+            double nextUpdate = t + consts::move_tick;
+            bool moving = integrateMover(entity, *m_movers[i].motion, t,
+                    nextUpdate, res);
+            for (auto& op : res) {
+                ops.emplace_back(&entity, op);
+            }
+            res.clear();
+            if (!moving) {
+                // The entity keeps its Motion, so clear out what's left
+                // of the collision it may just have resolved.
+                m_movers[i].motion->reset();
+                m_moverIndex.erase(&entity);
+                m_movers[i].entity = nullptr;
+                continue;
+            }
+            m_movers[i].nextUpdate = nextUpdate;
+        }
+        if (!hasNextTick || m_movers[i].nextUpdate < nextTick) {
+            nextTick = m_movers[i].nextUpdate;
+            hasNextTick = true;
+        }
+    }
+    m_ticking = false;
+
+    // Remove the movers which have stopped, or been removed, during the pass.
+    std::size_t live = 0;
+    for (std::size_t i = 0; i < m_movers.size(); ++i) {
+        if (m_movers[i].entity != nullptr) {
+            if (live != i) {
+                m_movers[live] = m_movers[i];
+                m_moverIndex[m_movers[live].entity] = live;
+            }
+            if (i >= moverCount && (!hasNextTick || m_movers[live].nextUpdate < nextTick)) {
+                nextTick = m_movers[live].nextUpdate;
+                hasNextTick = true;
+            }
+            ++live;
+        }
+    }
+    m_movers.resize(live);
+
+    BaseWorld& world = BaseWorld::instance();
+    for (auto& entry : ops) {
+        world.message(entry.second, *entry.first);
+    }
+
+    if (hasNextTick) {
+        scheduleTick(nextTick);
+    }
+}
+
+void PhysicalDomain::scheduleTick(double time)
+{
+    if (m_tickHandle != 0 && m_nextTick <= time) {
+        return;
+    }
+    BaseWorld& world = BaseWorld::instance();
+    if (m_tickHandle != 0) {
+        world.cancelOperation(m_tickHandle);
+    }
 
+    Anonymous tick_arg;
+    tick_arg->setName("domain");
+    Tick tick;
+    tick->setArgs1(tick_arg);
+    tick->setTo(m_entity.getId());
+    tick->setFutureSeconds(std::max(0., time - world.getTime()));
+    m_tickHandle = world.scheduleOperation(tick, m_entity);
+    m_nextTick = time;
+}
+
+bool PhysicalDomain::addMover(LocatedEntity& entity, Motion& motion,
+        double nextUpdate)
+{
+    // Only direct children are handled, as positions of nested entities
+    // are relative to something other than the domain entity.
+    if (entity.m_location.m_loc != &m_entity) {
+        return false;
+    }
+    auto I = m_moverIndex.find(&entity);
+    if (I != m_moverIndex.end()) {
+        Mover& mover = m_movers[I->second];
+        mover.motion = &motion;
+        mover.nextUpdate = nextUpdate;
+    } else {
+        m_moverIndex.insert(std::make_pair(&entity, m_movers.size()));
+        m_movers.push_back(Mover{&entity, &motion, nextUpdate});
+    }
+    scheduleTick(nextUpdate);
+    return true;
+}
+
+void PhysicalDomain::removeMover(LocatedEntity& entity)
+{
+    auto I = m_moverIndex.find(&entity);
+    if (I == m_moverIndex.end()) {
+        return;
+    }
+    std::size_t index = I->second;
+    m_moverIndex.erase(I);
+    if (m_ticking) {
+        // Removed when the pass is done.
+        m_movers[index].entity = nullptr;
+        return;
+    }
+    if (index != m_movers.size() - 1) {
+        m_movers[index] = m_movers.back();
+        m_moverIndex[m_movers[index].entity] = index;
+    }
+    m_movers.pop_back();
+}
+
+bool PhysicalDomain::integrateMover(LocatedEntity& entity, Motion& motion,
+        double current_time, double& nextUpdate, OpVector& res)
+{
+    Location& location = entity.m_location;
+
+    // The velocity might have been altered without the mover being removed.
+    if (!location.velocity().isValid() ||
+        location.velocity().sqrMag() < WFMath::numeric_constants<WFMath::CoordType>::epsilon()) {
+        return false;
+    }
+
+    float time_diff = (float)(current_time - location.timeStamp());
+
+    const Location old_loc = location;
+
+    bool moving = true;
+
+    // Check if a predicted collision is due.
+    if (motion.collision()) {
+        if (current_time >= motion.m_collisionTime) {
+            time_diff = (float)(motion.m_collisionTime - location.timeStamp());
+            // This flag signals that collision resolution is required later.
+            moving = false;
+        }
+    }
+
+    location.m_pos += (location.velocity() * time_diff);
+
+    // Collision resolution has to occur after position has been updated.
+    if (!moving) {
+        moving = motion.resolveCollision();
+    }
+
+    location.m_pos.z() = constrainHeight(location.m_loc, location.pos(),
+            "standing");
+    location.update(current_time);
+    entity.resetFlags(entity_pos_clean | entity_clean);
+
+    updatePosition(entity);
+
+    float update_time = consts::move_tick;
+
+    if (moving) {
+        update_time = motion.checkCollisions();
+
+        if (motion.collision()) {
+            if (update_time < WFMath::numeric_constants<WFMath::CoordType>::epsilon()) {
+                moving = motion.resolveCollision();
+            } else {
+                motion.m_collisionTime = current_time + update_time;
+            }
+        }
+    }
+
+    Move m;
+    Anonymous move_arg;
+    move_arg->setId(entity.getId());
+    location.addToEntity(move_arg);
+    m->setArgs1(move_arg);
+    m->setFrom(entity.getId());
+    m->setTo(entity.getId());
+
+    Sight s;
+    s->setArgs1(m);
+
+    res.push_back(s);
+
+    if (entity.isPerceptive()) {
+        processVisibilityForMovedEntity(entity, old_loc, res);
+    }
+    entity.onUpdated();
+
+    nextUpdate = current_time + update_time;
+    return moving;
 }
 
 void PhysicalDomain::lookAtEntity(const LocatedEntity& observingEntity, const LocatedEntity& observedEntity, const Operation & originalLookOp, OpVector& res) const
@@ -206,23 +445,28 @@ bool PhysicalDomain::isEntityVisibleFor(const LocatedEntity& observingEntity, co
         return true;
     }
     //The entity couldn't be seen just from its size; now check if it's outfitted or wielded.
-    if (observedEntity.m_location.m_loc != nullptr) {
+    return isOutfittedOrWielded(observedEntity);
+}
+
+bool PhysicalDomain::isOutfittedOrWielded(const LocatedEntity& entity) const
+{
+    if (entity.m_location.m_loc != nullptr) {
         const OutfitProperty* outfitProperty =
-                observedEntity.m_location.m_loc->getPropertyClass<OutfitProperty>(
+                entity.m_location.m_loc->getPropertyClass<OutfitProperty>(
                         "outfit");
         if (outfitProperty) {
             for (auto& entry : outfitProperty->data()) {
                 auto outfittedEntity = entry.second.get();
-                if (outfittedEntity && outfittedEntity == &observedEntity) {
+                if (outfittedEntity && outfittedEntity == &entity) {
                     return true;
                 }
             }
         }
-        //If the entity isn't large enough, and isn't outfitted, perhaps it's wielded?
-        const EntityProperty* rightHandWieldProperty = observedEntity.m_location.m_loc->getPropertyClass<EntityProperty>("right_hand_wield");
+        //If the entity isn't outfitted, perhaps it's wielded?
+        const EntityProperty* rightHandWieldProperty = entity.m_location.m_loc->getPropertyClass<EntityProperty>("right_hand_wield");
         if (rightHandWieldProperty) {
-            auto entity = rightHandWieldProperty->data().get();
-            if (entity && entity == &observedEntity) {
+            auto wielded = rightHandWieldProperty->data().get();
+            if (wielded && wielded == &entity) {
                 return true;
             }
         }
@@ -230,6 +474,80 @@ bool PhysicalDomain::isEntityVisibleFor(const LocatedEntity& observingEntity, co
     return false;
 }
 
+/**
+ * @brief Adds the entity, and those entities contained by it which can observe, to the supplied vector.
+ *
+ * The walk stops at any entity which isn't perceptive, so that inventories
+ * full of items aren't visited for every broadcast.
+ */
+/// \brief Add all perceptive entities contained in an entity
+///
+/// Containers such as houses, boats or carts aren't perceptive themselves,
+/// so the walk goes on through them and only filters what is added.
+static void addNestedObservers(const LocatedEntity& entity, std::vector<LocatedEntity*>& entities)
+{
+    if (entity.m_contains == nullptr) {
+        return;
+    }
+    for (LocatedEntity* child : *entity.m_contains) {
+        if (child->isPerceptive()) {
+            entities.push_back(child);
+        }
+        addNestedObservers(*child, entities);
+    }
+}
+
+bool PhysicalDomain::findObserverCandidates(const LocatedEntity& observedEntity,
+        std::vector<LocatedEntity*>& candidates) const
+{
+    //Everyone in the domain can see the domain entity, and outfitted or
+    //wielded entities can be seen regardless of distance.
+    if (&observedEntity == &m_entity || isOutfittedOrWielded(observedEntity)) {
+        return false;
+    }
+    const Point3D pos = relativePos(m_entity.m_location, observedEntity.m_location);
+    if (!pos.isValid()) {
+        return false;
+    }
+    //Only direct children closer than this can see the observed entity.
+    float reach = std::sqrt(observedEntity.m_location.squareBoxSize() / consts::square_sight_factor);
+    std::vector<LocatedEntity*> children;
+    m_index.findCandidates(pos.x(), pos.y(), pos.x(), pos.y(), reach, children);
+
+    candidates.push_back(&m_entity);
+    for (LocatedEntity* child : children) {
+        if (child->isPerceptive()) {
+            candidates.push_back(child);
+        }
+    }
+    //Nothing guarantees that entities nested in a child are placed within
+    //its bounds, so their distance can't be told from the index.
+    if (m_entity.m_contains != nullptr) {
+        for (LocatedEntity* child : *m_entity.m_contains) {
+            addNestedObservers(*child, candidates);
+        }
+    }
+    return true;
+}
+
+void PhysicalDomain::findVisibilityCandidates(const LocatedEntity& parent,
+        const LocatedEntity& moved_entity, const Point3D& old_pos,
+        const Point3D& new_pos, std::vector<LocatedEntity*>& candidates) const
+{
+    //Only the direct children of the domain entity are indexed.
+    if (&parent != &m_entity || !old_pos.isValid() || !new_pos.isValid()) {
+        candidates.assign(parent.m_contains->begin(), parent.m_contains->end());
+        return;
+    }
+    //Entities further away than this can't see the moved entity, neither before nor after it moved.
+    float reach = std::sqrt(moved_entity.m_location.squareBoxSize() / consts::square_sight_factor);
+    m_index.findCandidates(std::min(old_pos.x(), new_pos.x()),
+            std::min(old_pos.y(), new_pos.y()),
+            std::max(old_pos.x(), new_pos.x()),
+            std::max(old_pos.y(), new_pos.y()),
+            reach, candidates);
+}
+
 void PhysicalDomain::calculateVisibility(std::vector<Root>& appear, std::vector<Root>& disappear, Anonymous& this_ent, const LocatedEntity& parent,
         const LocatedEntity& moved_entity, const Location& old_loc, OpVector & res) const {
 
@@ -241,58 +559,95 @@ void PhysicalDomain::calculateVisibility(std::vector<Root>& appear, std::vector<
 
     //For now we'll only consider movement within the same loc. This should change as we extend the domain code.
     assert(parent.m_contains != nullptr);
-    for (const LocatedEntity* other: *parent.m_contains) {
+    std::vector<LocatedEntity*> candidates;
+    findVisibilityCandidates(parent, moved_entity, old_pos, new_pos, candidates);
+
+    //Only the direct children of the domain entity are in the index and the packed array.
+    bool indexed = &parent == &m_entity && old_pos.isValid() && new_pos.isValid();
+
+    //If the spatial index couldn't rule out a good part of the children, it's quicker to work all of them
+    //out in one pass over the packed array, and only go on with those which are in sight in any way.
+    if (indexed && candidates.size() * 8 > m_visibility.size()) {
+        VisibilityMasks masks;
+        m_visibility.calculate(old_pos, new_pos, fromSquSize, masks);
+        for (std::size_t word = 0; word < masks.wasSeen.size(); ++word) {
+            std::uint32_t bits = masks.any(word);
+            for (std::size_t i = word * 32; bits != 0; ++i, bits >>= 1) {
+                if ((bits & 1) == 0) {
+                    continue;
+                }
+                LocatedEntity* other = m_visibility.entity(i);
+                if (other == &moved_entity) {
+                    continue;
+                }
+                EntityVisibility visibility = masks.get(i);
+                processVisibility(appear, disappear, this_ent, *other, moved_entity, old_loc,
+                        visibility.wasSeen, visibility.isSeen, visibility.couldSee, visibility.canSee, res);
+            }
+        }
+        return;
+    }
+
+    for (LocatedEntity* other: candidates) {
         if (other == &moved_entity) {
             continue;
         }
 
         assert(other != nullptr);
-        float old_dist = squareDistance(other->m_location.pos(), old_pos),
-              new_dist = squareDistance(other->m_location.pos(), new_pos),
-              squ_size = other->m_location.squareBoxSize();
+        EntityVisibility visibility = VisibilityArray::calculateEntity(other->m_location.pos(),
+                other->m_location.squareBoxSize(), old_pos, new_pos, fromSquSize);
+        //Children out of sight both before and after the move are left alone, just like those which the
+        //index rules out, so that this gives the same result as the pass over the packed array.
+        if (indexed && !(visibility.wasSeen || visibility.isSeen || visibility.couldSee || visibility.canSee)) {
+            continue;
+        }
 
-        // Build appear and disappear lists, and send disappear operations
-        // to perceptive entities saying that we are disappearing
-        if (other->isPerceptive()) {
-            bool was_in_range = ((fromSquSize / old_dist) > consts::square_sight_factor),
-                 is_in_range = ((fromSquSize / new_dist) > consts::square_sight_factor);
-            if (was_in_range != is_in_range) {
-                if (was_in_range) {
-                    // Send operation to the entity in question so it
-                    // knows it is losing sight of us.
-                    Disappearance d;
-                    d->setArgs1(this_ent);
-                    d->setTo(other->getId());
-                    res.push_back(d);
-                }
-                //Note that we don't send any Appear ops for those entities that we now move within sight range of.
-                //This is because these will receive a Move op anyway as part of the broadcast, which informs them
-                //that an entity has moved within sight range anyway.
+        processVisibility(appear, disappear, this_ent, *other, moved_entity, old_loc,
+                visibility.wasSeen, visibility.isSeen, visibility.couldSee, visibility.canSee, res);
+    }
+}
+
+void PhysicalDomain::processVisibility(std::vector<Root>& appear, std::vector<Root>& disappear, Anonymous& this_ent,
+        const LocatedEntity& other, const LocatedEntity& moved_entity, const Location& old_loc,
+        bool was_in_range, bool is_in_range, bool could_see, bool can_see, OpVector & res) const {
+
+    // Build appear and disappear lists, and send disappear operations
+    // to perceptive entities saying that we are disappearing
+    if (other.isPerceptive()) {
+        if (was_in_range != is_in_range) {
+            if (was_in_range) {
+                // Send operation to the entity in question so it
+                // knows it is losing sight of us.
+                Disappearance d;
+                d->setArgs1(this_ent);
+                d->setTo(other.getId());
+                res.push_back(d);
             }
+            //Note that we don't send any Appear ops for those entities that we now move within sight range of.
+            //This is because these will receive a Move op anyway as part of the broadcast, which informs them
+            //that an entity has moved within sight range anyway.
         }
+    }
 
-        bool could_see = ((squ_size / old_dist) > consts::square_sight_factor),
-             can_see = ((squ_size / new_dist) > consts::square_sight_factor);
-        if (could_see ^ can_see) {
-            Anonymous that_ent;
-            that_ent->setId(other->getId());
-            that_ent->setStamp(other->getSeq());
-            if (could_see) {
-                // We are losing sight of that object
-                disappear.push_back(that_ent);
-                debug(std::cout << moved_entity.getId() << ": losing sight of "
-                                << other->getId() << std::endl;);
-            } else /*if (can_see)*/ {
-                // We are gaining sight of that object
-                appear.push_back(that_ent);
-                debug(std::cout << moved_entity.getId() << ": gaining sight of "
-                                << other->getId() << std::endl;);
-            }
-        } else {
-            //We've seen this entity before, and we're still seeing it. Check if there are any children that's now changing visibility.
-            if (other->m_contains && !other->m_contains->empty()) {
-                calculateVisibility(appear, disappear, this_ent, *other, moved_entity, old_loc, res);
-            }
+    if (could_see ^ can_see) {
+        Anonymous that_ent;
+        that_ent->setId(other.getId());
+        that_ent->setStamp(other.getSeq());
+        if (could_see) {
+            // We are losing sight of that object
+            disappear.push_back(that_ent);
+            debug(std::cout << moved_entity.getId() << ": losing sight of "
+                            << other.getId() << std::endl;);
+        } else /*if (can_see)*/ {
+            // We are gaining sight of that object
+            appear.push_back(that_ent);
+            debug(std::cout << moved_entity.getId() << ": gaining sight of "
+                            << other.getId() << std::endl;);
+        }
+    } else {
+        //We've seen this entity before, and we're still seeing it. Check if there are any children that's now changing visibility.
+        if (other.m_contains && !other.m_contains->empty()) {
+            calculateVisibility(appear, disappear, this_ent, other, moved_entity, old_loc, res);
         }
     }
 }
@@ -337,7 +692,15 @@ void PhysicalDomain::processDisappearanceOfEntity(const LocatedEntity& moved_ent
     const Point3D old_pos = relativePos(m_entity.m_location, old_loc);
 
     assert(m_entity.m_contains != nullptr);
-    for (const LocatedEntity* other: *m_entity.m_contains) {
+    std::vector<LocatedEntity*> candidates;
+    if (old_pos.isValid()) {
+        //Entities further away than this couldn't see the entity before it disappeared.
+        float reach = std::sqrt(fromSquSize / consts::square_sight_factor);
+        m_index.findCandidates(old_pos.x(), old_pos.y(), old_pos.x(), old_pos.y(), reach, candidates);
+    } else {
+        candidates.assign(m_entity.m_contains->begin(), m_entity.m_contains->end());
+    }
+    for (const LocatedEntity* other: candidates) {
         //No need to check if we iterate over ourselved; that won't happen if we've disappeared
 
         assert(other != nullptr);
@@ -380,7 +743,22 @@ float PhysicalDomain::checkCollision(LocatedEntity& entity, CollisionData& colli
     if (!entity.m_location.bBox().isValid()) {
         return coll_time;
     }
-    for (LocatedEntity* other_entity : *entity.m_location.m_loc->m_contains) {
+    std::vector<LocatedEntity*> candidates;
+    if (entity.m_location.m_loc == &m_entity) {
+        // Only check against those entities which could reach the path
+        // we'll travel until the next tick.
+        const Point3D& pos = entity.m_location.pos();
+        Point3D target = pos + entity.m_location.velocity() * consts::move_tick;
+        m_index.findCandidates(std::min(pos.x(), target.x()),
+                std::min(pos.y(), target.y()),
+                std::max(pos.x(), target.x()),
+                std::max(pos.y(), target.y()),
+                entity.m_location.radius(), candidates);
+    } else {
+        candidates.assign(entity.m_location.m_loc->m_contains->begin(),
+                entity.m_location.m_loc->m_contains->end());
+    }
+    for (LocatedEntity* other_entity : candidates) {
         // Don't check for collisions with ourselves
         if (&entity == other_entity) {
             continue;
@@ -459,3 +837,35 @@ float PhysicalDomain::checkCollision(LocatedEntity& entity, CollisionData& colli
                      << entity.m_location.velocity() << "*" << coll_time;);
     return coll_time;
 }
+
+void PhysicalDomain::indexChild(LocatedEntity& entity)
+{
+    m_index.insert(&entity, entity.m_location.pos(), calculateReach(entity));
+    m_visibility.insert(&entity, entity.m_location.pos(), entity.m_location.squareBoxSize());
+}
+
+void PhysicalDomain::unindexChild(LocatedEntity& entity)
+{
+    m_index.remove(&entity);
+    m_visibility.remove(&entity);
+}
+
+void PhysicalDomain::addEntity(LocatedEntity& entity)
+{
+    if (entity.m_location.m_loc == &m_entity) {
+        indexChild(entity);
+    }
+}
+
+void PhysicalDomain::removeEntity(LocatedEntity& entity)
+{
+    unindexChild(entity);
+    removeMover(entity);
+}
+
+void PhysicalDomain::updatePosition(LocatedEntity& entity)
+{
+    if (entity.m_location.m_loc == &m_entity) {
+        indexChild(entity);
+    }
+}
@@ -19,6 +19,11 @@
 #define PHYSICALDOMAIN_H_
 
 #include "Domain.h"
+#include "SpatialIndex.h"
+#include "VisibilityArray.h"
+
+#include <unordered_map>
+#include <cstdint>
 
 /**
  * @brief A regular physical domain, behaving very much like the real world.
@@ -44,6 +49,9 @@ class PhysicalDomain: public Domain
         virtual bool isEntityVisibleFor(const LocatedEntity& observingEntity,
                 const LocatedEntity& observedEntity) const;
 
+        virtual bool findObserverCandidates(const LocatedEntity& observedEntity,
+                std::vector<LocatedEntity*>& candidates) const;
+
         virtual void processVisibilityForMovedEntity(
                 const LocatedEntity& moved_entity, const Location& old_loc,
                 OpVector & res);
@@ -55,8 +63,127 @@ class PhysicalDomain: public Domain
         virtual float checkCollision(LocatedEntity& entity,
                 CollisionData& collisionData);
 
+        virtual void addEntity(LocatedEntity& entity);
+
+        virtual void removeEntity(LocatedEntity& entity);
+
+        virtual void updatePosition(LocatedEntity& entity);
+
+        virtual bool addMover(LocatedEntity& entity, Motion& motion,
+                double nextUpdate);
+
+        virtual void removeMover(LocatedEntity& entity);
+
     private:
 
+        /**
+         * @brief A moving entity, which movement is integrated by the domain.
+         */
+        struct Mover {
+            /// The entity, or null if it has been removed during a tick.
+            LocatedEntity* entity;
+            Motion* motion;
+            /// The time at which the movement next needs to be updated.
+            double nextUpdate;
+        };
+
+        /**
+         * @brief All moving direct children of the domain entity.
+         *
+         * These are kept in a contiguous array so that they can all be
+         * integrated in one pass when the domain is ticked.
+         */
+        std::vector<Mover> m_movers;
+
+        /**
+         * @brief Lookup of the index of each mover in m_movers.
+         */
+        std::unordered_map<LocatedEntity*, std::size_t> m_moverIndex;
+
+        /**
+         * @brief True while movers are being integrated.
+         */
+        bool m_ticking;
+
+        /**
+         * @brief Handle of the scheduled tick operation, or zero if none is scheduled.
+         */
+        std::uint64_t m_tickHandle;
+
+        /**
+         * @brief The time at which the scheduled tick is due.
+         */
+        double m_nextTick;
+
+        /**
+         * @brief Makes sure that the domain is ticked no later than the supplied time.
+         * @param time The time at which a tick is needed.
+         */
+        void scheduleTick(double time);
+
+        /**
+         * @brief Advances the movement of one entity to the current time.
+         *
+         * This does the same as Thing::UpdateOperation(), for an entity
+         * which movement has been handed over to the domain.
+         * @param entity The moving entity.
+         * @param motion The motion of the entity.
+         * @param current_time The current time.
+         * @param nextUpdate Set to the time when the movement next needs to be updated.
+         * @param res Operations to be sent from the entity.
+         * @return True if the entity still is moving.
+         */
+        bool integrateMover(LocatedEntity& entity, Motion& motion,
+                double current_time, double& nextUpdate, OpVector& res);
+
+        /**
+         * @brief Spatial index of all direct children of the domain entity.
+         *
+         * This is used to limit visibility and collision checks to those
+         * entities which are close enough to matter.
+         */
+        SpatialIndex m_index;
+
+        /**
+         * @brief Packed positions and sizes of all direct children of the domain entity.
+         *
+         * This is kept up to date together with m_index, and is used when
+         * the spatial index can't narrow down the visibility checks much.
+         */
+        VisibilityArray m_visibility;
+
+        /**
+         * @brief Adds a direct child of the domain entity to the indices, or updates it.
+         * @param entity The child entity.
+         */
+        void indexChild(LocatedEntity& entity);
+
+        /**
+         * @brief Removes an entity from the indices.
+         * @param entity The entity.
+         */
+        void unindexChild(LocatedEntity& entity);
+
+        /**
+         * @brief Checks if the entity is outfitted or wielded by its parent entity, in which case it can be seen regardless of its size.
+         * @param entity The entity to check.
+         * @return True if the entity is outfitted or wielded.
+         */
+        bool isOutfittedOrWielded(const LocatedEntity& entity) const;
+
+        /**
+         * @brief Fills the supplied vector with those children of "parent" which need to be considered for visibility changes.
+         * @param parent The parent entity.
+         * @param moved_entity The entity that was moved.
+         * @param old_pos The old position of the moved entity, relative to the parent.
+         * @param new_pos The new position of the moved entity, relative to the parent.
+         * @param candidates A vector to be filled.
+         */
+        void findVisibilityCandidates(const LocatedEntity& parent,
+                const LocatedEntity& moved_entity, const Point3D& old_pos,
+                const Point3D& new_pos,
+                std::vector<LocatedEntity*>& candidates) const;
+
         /**
          * @brief Calculates visibility changes for the moved entity, processing the children of the "parent" parameter.
          * @param appear A list of appear ops, to be filled.
@@ -73,6 +200,27 @@ class PhysicalDomain: public Domain
                 const LocatedEntity& parent, const LocatedEntity& moved_entity,
                 const Location& old_loc, OpVector & res) const;
 
+        /**
+         * @brief Acts on the visibility between the moved entity and one other entity, before and after the move.
+         * @param appear A list of appear ops, to be filled.
+         * @param disappear A list of disappear ops, to be filled.
+         * @param this_ent Atlas entity representing the entity that was moved.
+         * @param other The other entity.
+         * @param moved_entity The entity that was moved.
+         * @param old_loc The old location.
+         * @param was_in_range True if the other entity could see the moved entity before it moved.
+         * @param is_in_range True if the other entity can see the moved entity after it moved.
+         * @param could_see True if the moved entity could see the other entity before it moved.
+         * @param can_see True if the moved entity can see the other entity after it moved.
+         * @param res
+         */
+        void processVisibility(std::vector<Atlas::Objects::Root>& appear,
+                std::vector<Atlas::Objects::Root>& disappear,
+                Atlas::Objects::Entity::Anonymous& this_ent,
+                const LocatedEntity& other, const LocatedEntity& moved_entity,
+                const Location& old_loc, bool was_in_range, bool is_in_range,
+                bool could_see, bool can_see, OpVector & res) const;
+
 };
 
 #endif /* PHYSICALDOMAIN_H_ */
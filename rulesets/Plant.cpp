@@ -228,15 +228,16 @@ void Plant::TickOperation(const Operation & op, OpVector & res)
     }
 
 
-    //Only handle fruits if the plant is of adult size.
-    Property<int> * fruits_prop = modPropertyType<int>("fruits");
-    if (fruits_prop != nullptr) {
+    //Only handle fruits if the plant is of adult size. The class default
+    //is only copied to this plant once it can change.
+    if (getPropertyType<int>("fruits") != nullptr) {
         Element sizeAdult;
         if (getAttrType("sizeAdult", sizeAdult, Element::TYPE_FLOAT) == 0 ||
                 getAttrType("sizeAdult", sizeAdult, Element::TYPE_INT) == 0) {
             //Only drop fruits if we're an adult
             if (m_location.bBox().isValid() &&
                     (m_location.bBox().highCorner().z() >= sizeAdult.asNum())) {
+                Property<int> * fruits_prop = modPropertyType<int>("fruits");
                 if (dropFruit(res, fruits_prop) != -1) {
                     int & fruits = fruits_prop->data();
                     Element fruitChance;
@@ -25,11 +25,27 @@
 #include "Py_World.h"
 
 #include "BaseMind.h"
+#include "Domain.h"
 
 #include "common/BaseWorld.h"
 
 #include <sstream>
 
+/// \brief Let the domain an entity is in know its location was written
+///
+/// Domains which index their children have to be told, or the index would
+/// keep the entity where it was.
+static void Location_updateDomain(PyLocation * self)
+{
+    if (self->owner == 0 || self->owner->m_location.m_loc == 0) {
+        return;
+    }
+    Domain * domain = self->owner->m_location.m_loc->getMovementDomain();
+    if (domain != 0) {
+        domain->updatePosition(*self->owner);
+    }
+}
+
 static PyObject * Location_copy(PyLocation *self)
 {
 #ifndef NDEBUG
@@ -136,17 +152,26 @@ static int Location_setattro(PyLocation *self, PyObject *oname, PyObject *v)
             return -1;
         }
 #endif // NDEBUG
+        if (self->owner != 0 && self->location->m_loc != 0) {
+            Domain * domain = self->location->m_loc->getMovementDomain();
+            if (domain != 0) {
+                domain->removeEntity(*self->owner);
+            }
+        }
         self->location->m_loc = thing->m_entity.l;
+        Location_updateDomain(self);
         return 0;
     }
     if (strcmp(name, "bbox") == 0 && PyBBox_Check(v)) {
         PyBBox * box = (PyBBox *)v;
         self->location->setBBox(box->box);
+        Location_updateDomain(self);
         return 0;
     }
     if (strcmp(name, "orientation") == 0 && PyQuaternion_Check(v)) {
         PyQuaternion * quat = (PyQuaternion *)v;
         self->location->m_orientation = quat->rotation;
+        Location_updateDomain(self);
         return 0;
     }
     Vector3D vector;
@@ -199,10 +224,12 @@ static int Location_setattro(PyLocation *self, PyObject *oname, PyObject *v)
     }
     if (strcmp(name, "coordinates") == 0) {
         self->location->m_pos = Point3D(vector.x(), vector.y(), vector.z());
+        Location_updateDomain(self);
         return 0;
     }
     if (strcmp(name, "velocity") == 0) {
         self->location->m_velocity = vector;
+        Location_updateDomain(self);
         return 0;
     }
     if (strcmp(name, "bbox") == 0) {
@@ -210,6 +237,7 @@ static int Location_setattro(PyLocation *self, PyObject *oname, PyObject *v)
                                      WFMath::Point<3>(vector.x(),
                                                       vector.y(),
                                                       vector.z())));
+        Location_updateDomain(self);
         return 0;
     }
     PyErr_SetString(PyExc_AttributeError, "unknown attribute");
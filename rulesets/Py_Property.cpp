@@ -27,47 +27,94 @@
 
 #include <iostream>
 
-PyObject * Property_asPyObject(PropertyBase * property, Entity * owner)
+static PyObject * Statistics_asPyObject(PropertyBase * property,
+                                        Entity * owner)
 {
-    StatisticsProperty * sp = dynamic_cast<StatisticsProperty *>(property);
-    if (sp != 0) {
-        PythonArithmeticScript * script = dynamic_cast<PythonArithmeticScript *>(sp->script());
-        if (script != 0) {
-            PyObject * o = script->script();
-            Py_INCREF(o);
-            return o;
-        } else {
-            log(ERROR, "Unexpected non-python Statistics script");
-            // FIXME Do we need PyStatisticsProperty for this kind of thing?
-            // PyStatistics * ps = newPyStatistics();
-            // if (ps == NULL) {
-                // return NULL;
-            // }
-            // ps->m_entity = owner;
-            // return (PyObject*)ps;
-            Py_INCREF(Py_None);
-            return Py_None;
-        }
+    StatisticsProperty * sp = static_cast<StatisticsProperty *>(property);
+    PythonArithmeticScript * script = dynamic_cast<PythonArithmeticScript *>(sp->script());
+    if (script != 0) {
+        PyObject * o = script->script();
+        Py_INCREF(o);
+        return o;
+    } else {
+        log(ERROR, "Unexpected non-python Statistics script");
+        // FIXME Do we need PyStatisticsProperty for this kind of thing?
+        // PyStatistics * ps = newPyStatistics();
+        // if (ps == NULL) {
+            // return NULL;
+        // }
+        // ps->m_entity = owner;
+        // return (PyObject*)ps;
+        Py_INCREF(Py_None);
+        return Py_None;
     }
-    TerrainProperty * tp = dynamic_cast<TerrainProperty *>(property);
-    if (tp != 0) {
-        // Create a new python wrapper for this property.
-        PyProperty * prop = newPyTerrainProperty();
-        if (prop != NULL) {
-            prop->m_entity = owner;
-            prop->m_p.terrain = tp;
-        }
-        return (PyObject*)prop;
+}
+
+static PyObject * Terrain_asPyObject(PropertyBase * property, Entity * owner)
+{
+    // Create a new python wrapper for this property.
+    PyProperty * prop = newPyTerrainProperty();
+    if (prop != NULL) {
+        prop->m_entity = owner;
+        prop->m_p.terrain = static_cast<TerrainProperty *>(property);
     }
-    TerrainModProperty * tm = dynamic_cast<TerrainModProperty *>(property);
-    if (tm != 0) {
-        // Create a new python wrapper for this property
-        PyProperty * prop = newPyTerrainModProperty();
-        if (prop != NULL) {
-            prop->m_entity = owner;
-            prop->m_p.terrainmod = tm;
+    return (PyObject*)prop;
+}
+
+static PyObject * TerrainMod_asPyObject(PropertyBase * property,
+                                        Entity * owner)
+{
+    // Create a new python wrapper for this property
+    PyProperty * prop = newPyTerrainModProperty();
+    if (prop != NULL) {
+        prop->m_entity = owner;
+        prop->m_p.terrainmod = static_cast<TerrainModProperty *>(property);
+    }
+    return (PyObject*)prop;
+}
+
+template <class PropertyT>
+static bool isPropertyClass(const PropertyBase * property)
+{
+    return dynamic_cast<const PropertyT *>(property) != 0;
+}
+
+/// \brief A class of property with its own Python wrapper
+struct PropertyWrapper {
+    bool (*matches)(const PropertyBase *);
+    PyObject * (*wrap)(PropertyBase *, Entity *);
+};
+
+static const PropertyWrapper property_wrappers[] = {
+    { &isPropertyClass<StatisticsProperty>, &Statistics_asPyObject },
+    { &isPropertyClass<TerrainProperty>, &Terrain_asPyObject },
+    { &isPropertyClass<TerrainModProperty>, &TerrainMod_asPyObject },
+};
+
+static const PropertyWrapper * findWrapper(const PropertyBase * property)
+{
+    for (const PropertyWrapper & wrapper : property_wrappers) {
+        if (wrapper.matches(property)) {
+            return &wrapper;
         }
-        return (PyObject*)prop;
     }
     return 0;
 }
+
+/// \brief Check if a property has its own Python wrapper
+///
+/// Wrapped properties can be modified through the wrapper, so they must be
+/// wrapped from the entity's own instance of the property.
+bool Property_hasPyObject(const PropertyBase * property)
+{
+    return findWrapper(property) != 0;
+}
+
+PyObject * Property_asPyObject(PropertyBase * property, Entity * owner)
+{
+    const PropertyWrapper * wrapper = findWrapper(property);
+    if (wrapper == 0) {
+        return 0;
+    }
+    return wrapper->wrap(property, owner);
+}
@@ -54,6 +54,7 @@ extern PyTypeObject PyTerrainModProperty_Type;
 #define PyTerrainModProperty_Check(_o) PyObject_TypeCheck(_o, &PyTerrainModProperty_Type)
 #define PyTerrainModProperty_CheckExact(_o) (Py_Type(_o) == &PyTerrainModProperty_Type)
 
+bool Property_hasPyObject(const PropertyBase * property);
 PyObject * Property_asPyObject(PropertyBase * property, Entity * owner);
 
 PyProperty * newPyTerrainProperty();
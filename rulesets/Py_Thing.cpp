@@ -240,11 +240,13 @@ static PyObject * Entity_getattro(PyEntity *self, PyObject *oname)
         Py_RETURN_FALSE;
     }
     Entity * entity = self->m_entity.e;
-    PropertyBase * prop = entity->modProperty(name);
+    // Reading a value must not copy a class default to the entity. Only
+    // properties with their own wrapper, which can be modified through it,
+    // need an instance copy.
+    const PropertyBase * prop = entity->getProperty(name);
     if (prop != 0) {
-        PyObject * ret = Property_asPyObject(prop, entity);
-        if (ret != 0) {
-            return ret;
+        if (Property_hasPyObject(prop)) {
+            return Property_asPyObject(entity->modProperty(name), entity);
         }
         Element attr;
         // If this property is not set with a value, return none.
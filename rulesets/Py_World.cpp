@@ -78,10 +78,57 @@ static PyObject * World_get_object_ref(PyWorld *self, PyObject * id)
     return wrapper_ref;
 }
 
+/// \brief Wrap a list of entities as a list of proxies
+static PyObject * World_entity_list(const EntityVector & entities)
+{
+    PyObject * list = PyList_New(entities.size());
+    if (list == NULL) {
+        return NULL;
+    }
+    int i = 0;
+    for (LocatedEntity * ent : entities) {
+        PyObject * wrapper = wrapEntity(ent);
+        if (wrapper == NULL) {
+            Py_DECREF(list);
+            return NULL;
+        }
+        PyObject * wrapper_proxy = PyWeakref_NewProxy(wrapper, NULL);
+        Py_DECREF(wrapper);
+        if (wrapper_proxy == NULL) {
+            Py_DECREF(list);
+            return NULL;
+        }
+        PyList_SetItem(list, i++, wrapper_proxy);
+    }
+    return list;
+}
+
+static PyObject * World_find_all_by_name(PyWorld *self, PyObject * name)
+{
+    if (!PyString_CheckExact(name)) {
+        PyErr_SetString(PyExc_TypeError, "World.find_all_by_name must be string");
+        return NULL;
+    }
+    return World_entity_list(BaseWorld::instance().findAllByName(PyString_AsString(name)));
+}
+
+static PyObject * World_find_all_by_type(PyWorld *self, PyObject * args)
+{
+    char * type;
+    PyObject * subtypes = Py_True;
+    if (!PyArg_ParseTuple(args, "s|O", &type, &subtypes)) {
+        return NULL;
+    }
+    return World_entity_list(BaseWorld::instance().findAllByType(type,
+          PyObject_IsTrue(subtypes) == 1));
+}
+
 static PyMethodDef World_methods[] = {
     {"get_time",        (PyCFunction)World_get_time,        METH_NOARGS},
     {"get_object",      (PyCFunction)World_get_object,      METH_O},
     {"get_object_ref",  (PyCFunction)World_get_object_ref,  METH_O},
+    {"find_all_by_name",(PyCFunction)World_find_all_by_name,METH_O},
+    {"find_all_by_type",(PyCFunction)World_find_all_by_type,METH_VARARGS},
     {NULL,              NULL}           // sentinel
 };
 
@@ -37,10 +37,113 @@
 
 static const bool debug_flag = false;
 
+static const std::string operation_suffix = "_operation";
+
+/// \brief PythonOperationHandlers constructor
+///
+/// @param cls Python class to find the handlers of
+PythonOperationHandlers::PythonOperationHandlers(PyObject * cls)
+{
+    PyObject * names = PyObject_Dir(cls);
+    if (names == NULL) {
+        PyErr_Clear();
+        return;
+    }
+    Py_ssize_t count = PyList_Size(names);
+    for (Py_ssize_t i = 0; i < count; ++i) {
+        PyObject * name = PyList_GetItem(names, i);
+        if (!PyString_Check(name)) {
+            continue;
+        }
+        std::string method_name = PyString_AsString(name);
+        if (method_name.size() <= operation_suffix.size() ||
+            method_name.compare(method_name.size() - operation_suffix.size(),
+                                std::string::npos, operation_suffix) != 0) {
+            continue;
+        }
+        PyObject * method = PyObject_GetAttr(cls, name);
+        if (method == NULL) {
+            PyErr_Clear();
+            continue;
+        }
+        Handler & handler = m_handlers[method_name.substr(0,
+              method_name.size() - operation_suffix.size())];
+        handler.m_name = method_name;
+        // Only plain methods can be called directly with the script as
+        // their first argument. Anything else is looked up on the script
+        // each time, as it may behave differently on an instance.
+        if (PyMethod_Check(method) && PyMethod_GET_SELF(method) == NULL) {
+            handler.m_method = method;
+        } else {
+            handler.m_method = 0;
+            Py_DECREF(method);
+        }
+    }
+    Py_DECREF(names);
+}
+
+PythonOperationHandlers::~PythonOperationHandlers()
+{
+    for (auto & entry : m_handlers) {
+        Py_XDECREF(entry.second.m_method);
+    }
+}
+
+/// \brief Find the handler with the given name
+///
+/// @param name Name of the handler, without the "_operation" suffix
+/// @return the handler, or 0 if the class has no such handler
+const PythonOperationHandlers::Handler *
+PythonOperationHandlers::find(const std::string & name) const
+{
+    auto I = m_handlers.find(name);
+    if (I == m_handlers.end()) {
+        return 0;
+    }
+    return &I->second;
+}
+
+/// \brief Find the handler for the type of an operation
+///
+/// @param handlers The set of handlers to look in
+/// @param op The operation to find the handler for
+/// @return the handler, or 0 if the class has no handler for the operation
+const PythonOperationHandlers::Handler *
+PythonOperationHandlers::find(Script::Handlers handlers, const Operation & op)
+{
+    const std::string & type = op->getParents().front();
+    int op_no = op->getClassNo();
+    if (op_no < 0) {
+        return find(Script::handler_prefixes[handlers] + type);
+    }
+    std::vector<Slot> & slots = m_slots[handlers];
+    if ((std::size_t)op_no >= slots.size()) {
+        slots.resize(op_no + 1);
+    }
+    Slot & slot = slots[op_no];
+    if (slot.m_type.empty()) {
+        slot.m_type = type;
+        slot.m_handler = find(Script::handler_prefixes[handlers] + type);
+    } else if (slot.m_type != type) {
+        // Operations of a type with no class of its own share a class
+        // number, so these are looked up by name every time.
+        return find(Script::handler_prefixes[handlers] + type);
+    }
+    return slot.m_handler;
+}
+
 /// \brief PythonEntityScript constructor
-PythonEntityScript::PythonEntityScript(PyObject * o) :
-                    PythonWrapper(o)
+///
+/// @param o The Python script object
+/// @param handlers The operation handlers of the class of the script. If
+/// none are given, they are looked up from the type of the script.
+PythonEntityScript::PythonEntityScript(PyObject * o,
+      const std::shared_ptr<PythonOperationHandlers> & handlers) :
+                    PythonWrapper(o), m_handlers(handlers)
 {
+    if (!m_handlers) {
+        m_handlers.reset(new PythonOperationHandlers((PyObject*)o->ob_type));
+    }
 }
 
 PythonEntityScript::~PythonEntityScript()
@@ -52,16 +155,37 @@ bool PythonEntityScript::operation(const std::string & op_type,
                                    OpVector & res)
 {
     assert(m_wrapper != NULL);
-    std::string op_name = op_type + "_operation";
-    debug( std::cout << "Got script object for " << op_name << std::endl
-                                                            << std::flush;);
-    // This check isn't really necessary, except it saves the conversion
-    // time.
-    if (!PyObject_HasAttrString(m_wrapper, (char *)(op_name.c_str()))) {
-        debug( std::cout << "No method to be found for " << op_name
+    const PythonOperationHandlers::Handler * handler =
+          m_handlers->find(op_type);
+    if (handler == 0) {
+        debug( std::cout << "No method to be found for " << op_type
                          << std::endl << std::flush;);
         return false;
     }
+    return call(*handler, op, res);
+}
+
+bool PythonEntityScript::dispatch(Handlers handlers,
+                                  const Operation & op,
+                                  OpVector & res)
+{
+    assert(m_wrapper != NULL);
+    const PythonOperationHandlers::Handler * handler =
+          m_handlers->find(handlers, op);
+    if (handler == 0) {
+        return false;
+    }
+    return call(*handler, op, res);
+}
+
+/// \brief Call a handler of the script with an operation
+bool PythonEntityScript::call(const PythonOperationHandlers::Handler & handler,
+                              const Operation & op,
+                              OpVector & res)
+{
+    const std::string & op_name = handler.m_name;
+    debug( std::cout << "Got script object for " << op_name << std::endl
+                                                            << std::flush;);
     // Construct apropriate python object thingies from op
     PyOperation * py_op = newPyConstOperation();
     if (py_op == 0) {
@@ -69,8 +193,13 @@ bool PythonEntityScript::operation(const std::string & op_type,
     }
     py_op->operation = op;
     PyObject * ret;
-    ret = PyObject_CallMethod(m_wrapper, (char *)(op_name.c_str()),
-                                            (char *)"(O)", py_op);
+    if (handler.m_method != 0) {
+        ret = PyObject_CallFunctionObjArgs(handler.m_method, m_wrapper,
+                                           (PyObject *)py_op, NULL);
+    } else {
+        ret = PyObject_CallMethod(m_wrapper, (char *)(op_name.c_str()),
+                                                (char *)"(O)", py_op);
+    }
     Py_DECREF(py_op);
     if (ret == NULL) {
         if (PyErr_Occurred() == NULL) {
@@ -21,16 +21,72 @@
 
 #include "PythonWrapper.h"
 
+#include <map>
+#include <memory>
+#include <vector>
+
+/// \brief Table of the operation handlers of a Python script class
+///
+/// Built once when the class is loaded, from the methods of the class
+/// with names ending in "_operation". The handler for each type of
+/// operation is looked up by name the first time that type is dispatched,
+/// and after that found by indexing on the class number of the operation.
+/// \ingroup Scripts
+class PythonOperationHandlers {
+  public:
+    /// \brief A method of the script class which handles operations
+    struct Handler {
+        /// Full name of the method
+        std::string m_name;
+        /// Method of the class, to be called with the script as its first
+        /// argument, or null if it must be looked up on the script by name
+        struct _object * m_method;
+    };
+  protected:
+    /// \brief Entry in the table for one operation class number
+    struct Slot {
+        /// Type of operation the slot was filled in for, or empty
+        std::string m_type;
+        /// Handler for the type, or null if there is none
+        const Handler * m_handler;
+    };
+
+    /// Handlers by name, without the "_operation" suffix
+    std::map<std::string, Handler> m_handlers;
+    /// Handlers of each set, indexed by operation class number
+    std::vector<Slot> m_slots[Script::HANDLER_SETS];
+
+    PythonOperationHandlers(const PythonOperationHandlers &) = delete;
+    PythonOperationHandlers & operator=(const PythonOperationHandlers &) = delete;
+  public:
+    explicit PythonOperationHandlers(struct _object * cls);
+    ~PythonOperationHandlers();
+
+    const Handler * find(const std::string & name) const;
+    const Handler * find(Script::Handlers handlers,
+                         const Atlas::Objects::Operation::RootOperation & op);
+};
+
 /// \brief Script class for Python scripts attached to an Entity
 /// \ingroup Scripts
 class PythonEntityScript : public PythonWrapper {
+  protected:
+    std::shared_ptr<PythonOperationHandlers> m_handlers;
+
+    bool call(const PythonOperationHandlers::Handler & handler,
+              const Atlas::Objects::Operation::RootOperation & op,
+              OpVector & res);
   public:
-    explicit PythonEntityScript(PyObject *);
+    explicit PythonEntityScript(struct _object *,
+          const std::shared_ptr<PythonOperationHandlers> & handlers = nullptr);
     virtual ~PythonEntityScript();
 
     virtual bool operation(const std::string & opname,
                            const Atlas::Objects::Operation::RootOperation & op,
                            OpVector & res);
+    virtual bool dispatch(Handlers handlers,
+                          const Atlas::Objects::Operation::RootOperation & op,
+                          OpVector & res);
     virtual void hook(const std::string & function, LocatedEntity * entity);
 };
 
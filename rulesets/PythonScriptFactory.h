@@ -23,10 +23,19 @@
 
 #include "common/ScriptKit.h"
 
+#include <memory>
+
+class PythonOperationHandlers;
+
 /// \brief Factory implementation for creating python script objects to attach
 /// to in game objects.
 template <class T>
 class PythonScriptFactory : public ScriptKit<T>, private PythonClass {
+  protected:
+    /// \brief Operation handlers of the class, shared by its scripts
+    std::shared_ptr<PythonOperationHandlers> m_handlers;
+
+    void findHandlers();
   public:
     PythonScriptFactory(const std::string & package, const std::string & type);
     ~PythonScriptFactory();
@@ -33,10 +33,22 @@ PythonScriptFactory<T>::~PythonScriptFactory()
 {
 }
 
+template <class T>
+void PythonScriptFactory<T>::findHandlers()
+{
+    // Scripts already created keep the handlers of the class they were
+    // created from.
+    m_handlers.reset(new PythonOperationHandlers(this->m_class));
+}
+
 template <class T>
 int PythonScriptFactory<T>::setup()
 {
-    return load();
+    int ret = load();
+    if (ret == 0) {
+        findHandlers();
+    }
+    return ret;
 }
 
 template <class T>
@@ -61,7 +73,7 @@ int PythonScriptFactory<T>::addScript(T * entity) const
     Py_DECREF(wrapper);
 
     if (script != NULL) {
-        entity->setScript(new PythonEntityScript(script));
+        entity->setScript(new PythonEntityScript(script, m_handlers));
 
         Py_DECREF(script);
     }
@@ -72,7 +84,11 @@ int PythonScriptFactory<T>::addScript(T * entity) const
 template <class T>
 int PythonScriptFactory<T>::refreshClass()
 {
-    return refresh();
+    int ret = refresh();
+    if (ret == 0) {
+        findHandlers();
+    }
+    return ret;
 }
 
 #endif // RULESETS_PYTHON_SCRIPT_FACTORY_IMPL_H
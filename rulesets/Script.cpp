@@ -18,6 +18,13 @@
 
 #include "Script.h"
 
+#include <Atlas/Objects/RootOperation.h>
+
+/// \brief Prefix of the names of handlers in each set
+const char * const Script::handler_prefixes[HANDLER_SETS] = {
+    "", "sight_", "sound_"
+};
+
 Script::Script()
 {
 }
@@ -44,6 +51,24 @@ bool Script::operation(const std::string & opname,
    return false;
 }
 
+/// \brief Pass an operation to the script handler for its type
+///
+/// The handler is the one for the type of the operation in the given set
+/// of handlers. Scripts which can look up handlers by the class number
+/// of the operation override this to avoid building the name.
+/// @param handlers The set of handlers to look in
+/// @param op The operation to be passed
+/// @param res The result of the operation is returned here
+/// @return true if operation was accepted, false if it was not handled
+/// or an error occured.
+bool Script::dispatch(Handlers handlers,
+                      const Atlas::Objects::Operation::RootOperation & op,
+                      OpVector & res)
+{
+    return operation(handler_prefixes[handlers] + op->getParents().front(),
+                     op, res);
+}
+
 /// \brief Call a named function on the script, passing in the entity
 ///
 /// This function is used when object have registered function names to be
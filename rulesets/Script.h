@@ -39,11 +39,27 @@ class LocatedEntity;
 /// \ingroup Scripts
 class Script {
   public:
+    /// \brief Sets of handlers a script can have for operations
+    enum Handlers {
+        /// Handlers named <op>_operation
+        OPERATION_HANDLERS,
+        /// Handlers named sight_<op>_operation for operations seen by a mind
+        SIGHT_HANDLERS,
+        /// Handlers named sound_<op>_operation for operations heard by a mind
+        SOUND_HANDLERS,
+        HANDLER_SETS
+    };
+
+    static const char * const handler_prefixes[HANDLER_SETS];
+
     Script();
     virtual ~Script();
     virtual bool operation(const std::string & opname,
                            const Atlas::Objects::Operation::RootOperation & op,
                            OpVector & res);
+    virtual bool dispatch(Handlers handlers,
+                          const Atlas::Objects::Operation::RootOperation & op,
+                          OpVector & res);
     virtual void hook(const std::string & function, LocatedEntity * entity);
 };
 
@@ -0,0 +1,205 @@
+/*
+ Copyright (C) 2014 Erik Ogenvik
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "SpatialIndex.h"
+
+#include <algorithm>
+
+#include <cmath>
+#include <cassert>
+
+/// Cell coordinates are clamped to this, to keep them within an int.
+static const float max_cell_coord = 1.e9f;
+
+static int cellCoord(float value, float cellSize)
+{
+    float c = std::floor(value / cellSize);
+    if (c > max_cell_coord) {
+        return (int)max_cell_coord;
+    } else if (c < -max_cell_coord) {
+        return -(int)max_cell_coord;
+    }
+    return (int)c;
+}
+
+SpatialIndex::SpatialIndex(float baseCellSize, int levelCount)
+{
+    assert(baseCellSize > 0.f);
+    assert(levelCount > 0);
+    float cellSize = baseCellSize;
+    for (int i = 0; i < levelCount; ++i) {
+        Level level;
+        level.cellSize = cellSize;
+        level.count = 0;
+        m_levels.push_back(level);
+        cellSize *= 2.f;
+    }
+}
+
+SpatialIndex::~SpatialIndex()
+{
+}
+
+std::uint64_t SpatialIndex::cellKey(int x, int y)
+{
+    return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(x)) << 32)
+            | static_cast<std::uint32_t>(y);
+}
+
+SpatialIndex::Placement SpatialIndex::calculatePlacement(const Point3D& pos,
+        float reach) const
+{
+    Placement placement;
+    placement.level = -1;
+    placement.x = 0;
+    placement.y = 0;
+    if (!pos.isValid() || !std::isfinite(pos.x()) || !std::isfinite(pos.y())
+            || !std::isfinite(reach)) {
+        return placement;
+    }
+    for (size_t i = 0; i < m_levels.size(); ++i) {
+        const Level& level = m_levels[i];
+        if (reach <= level.cellSize) {
+            placement.level = (int)i;
+            placement.x = cellCoord(pos.x(), level.cellSize);
+            placement.y = cellCoord(pos.y(), level.cellSize);
+            break;
+        }
+    }
+    return placement;
+}
+
+void SpatialIndex::addToPlacement(LocatedEntity* entity,
+        const Placement& placement)
+{
+    if (placement.level == -1) {
+        m_unbounded.push_back(entity);
+    } else {
+        Level& level = m_levels[placement.level];
+        level.cells[cellKey(placement.x, placement.y)].push_back(entity);
+        ++level.count;
+    }
+}
+
+void SpatialIndex::removeFromPlacement(LocatedEntity* entity,
+        const Placement& placement)
+{
+    if (placement.level == -1) {
+        auto J = std::find(m_unbounded.begin(), m_unbounded.end(), entity);
+        assert(J != m_unbounded.end());
+        *J = m_unbounded.back();
+        m_unbounded.pop_back();
+        return;
+    }
+    Level& level = m_levels[placement.level];
+    auto I = level.cells.find(cellKey(placement.x, placement.y));
+    assert(I != level.cells.end());
+    std::vector<LocatedEntity*>& entities = I->second;
+    auto J = std::find(entities.begin(), entities.end(), entity);
+    assert(J != entities.end());
+    *J = entities.back();
+    entities.pop_back();
+    --level.count;
+    if (entities.empty()) {
+        level.cells.erase(I);
+    }
+}
+
+void SpatialIndex::insert(LocatedEntity* entity, const Point3D& pos,
+        float reach)
+{
+    assert(entity != nullptr);
+    Placement placement = calculatePlacement(pos, reach);
+    auto I = m_placements.find(entity);
+    if (I != m_placements.end()) {
+        Placement& existing = I->second;
+        if (existing.level == placement.level && existing.x == placement.x
+                && existing.y == placement.y) {
+            //The most common case; the entity has moved, but not out of its cell.
+            return;
+        }
+        removeFromPlacement(entity, existing);
+        existing = placement;
+    } else {
+        m_placements.insert(std::make_pair(entity, placement));
+    }
+    addToPlacement(entity, placement);
+}
+
+void SpatialIndex::remove(LocatedEntity* entity)
+{
+    auto I = m_placements.find(entity);
+    if (I != m_placements.end()) {
+        removeFromPlacement(entity, I->second);
+        m_placements.erase(I);
+    }
+}
+
+bool SpatialIndex::contains(LocatedEntity* entity) const
+{
+    return m_placements.find(entity) != m_placements.end();
+}
+
+std::size_t SpatialIndex::size() const
+{
+    return m_placements.size();
+}
+
+void SpatialIndex::findCandidates(float minX, float minY, float maxX,
+        float maxY, float radius, std::vector<LocatedEntity*>& result) const
+{
+    for (const Level& level : m_levels) {
+        if (level.count == 0) {
+            continue;
+        }
+        //Any entity in this level has a reach which is at most the size of a cell.
+        float expand = std::max(radius, level.cellSize);
+        int x1 = cellCoord(minX - expand, level.cellSize);
+        int y1 = cellCoord(minY - expand, level.cellSize);
+        int x2 = cellCoord(maxX + expand, level.cellSize);
+        int y2 = cellCoord(maxY + expand, level.cellSize);
+
+        double cellsInArea = ((double)x2 - x1 + 1) * ((double)y2 - y1 + 1);
+        if (cellsInArea > level.cells.size()) {
+            //It's cheaper to iterate over the occupied cells than to look up every cell in the area.
+            for (auto& entry : level.cells) {
+                int x = (int)(std::int32_t)(entry.first >> 32);
+                int y = (int)(std::int32_t)(entry.first & 0xffffffff);
+                if (x >= x1 && x <= x2 && y >= y1 && y <= y2) {
+                    result.insert(result.end(), entry.second.begin(),
+                            entry.second.end());
+                }
+            }
+        } else {
+            for (int x = x1; x <= x2; ++x) {
+                for (int y = y1; y <= y2; ++y) {
+                    auto I = level.cells.find(cellKey(x, y));
+                    if (I != level.cells.end()) {
+                        result.insert(result.end(), I->second.begin(),
+                                I->second.end());
+                    }
+                }
+            }
+        }
+    }
+    result.insert(result.end(), m_unbounded.begin(), m_unbounded.end());
+}
@@ -0,0 +1,138 @@
+/*
+ Copyright (C) 2014 Erik Ogenvik
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#ifndef SPATIALINDEX_H_
+#define SPATIALINDEX_H_
+
+#include "physics/Vector3D.h"
+
+#include <wfmath/point.h>
+
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+class LocatedEntity;
+
+/**
+ * @brief A hierarchical uniform grid over the horizontal plane, used by domains to find entities near a point.
+ *
+ * Each entity is registered with a position and a "reach", which is the
+ * largest distance at which the entity can interact with something else,
+ * either by being seen or by colliding. The entity is stored in a single
+ * cell of the finest grid level whose cell size is at least as large as
+ * the reach, which means that a query only needs to look at the cells
+ * immediately around the queried area on each level, regardless of how
+ * large the entities are.
+ *
+ * Entities with a reach larger than the coarsest level, or without a valid
+ * position, are kept in a separate list which is always returned.
+ *
+ * The index only returns candidates; callers are expected to do the exact
+ * checks themselves.
+ */
+class SpatialIndex
+{
+    public:
+
+        /**
+         * @brief Ctor.
+         * @param baseCellSize The size of the cells in the finest level.
+         * @param levelCount The number of levels. Each level has cells twice as large as the one before.
+         */
+        explicit SpatialIndex(float baseCellSize = 8.f, int levelCount = 9);
+        ~SpatialIndex();
+
+        /**
+         * @brief Inserts an entity into the index, or updates it if it's already present.
+         * @param entity The entity.
+         * @param pos The position of the entity, in the coordinate space of the index.
+         * @param reach The reach of the entity.
+         */
+        void insert(LocatedEntity* entity, const Point3D& pos, float reach);
+
+        /**
+         * @brief Removes an entity from the index.
+         *
+         * Nothing happens if the entity isn't present.
+         * @param entity The entity.
+         */
+        void remove(LocatedEntity* entity);
+
+        /**
+         * @brief Checks whether an entity is present in the index.
+         */
+        bool contains(LocatedEntity* entity) const;
+
+        /**
+         * @brief Gets the number of entities in the index.
+         */
+        std::size_t size() const;
+
+        /**
+         * @brief Finds all entities which might either be within "radius" of the supplied area, or which reach overlaps the area.
+         *
+         * The area is an axis aligned rectangle in the horizontal plane.
+         * No entity is returned more than once.
+         * @param minX Lower x bound of the area.
+         * @param minY Lower y bound of the area.
+         * @param maxX Upper x bound of the area.
+         * @param maxY Upper y bound of the area.
+         * @param radius The radius around the area to search within.
+         * @param result Candidates are appended here.
+         */
+        void findCandidates(float minX, float minY, float maxX, float maxY,
+                float radius, std::vector<LocatedEntity*>& result) const;
+
+    private:
+
+        /**
+         * @brief The location of an entity in the index.
+         */
+        struct Placement {
+            /// The level, or -1 if the entity is in the unbounded list.
+            int level;
+            int x;
+            int y;
+        };
+
+        /**
+         * @brief One level of the grid.
+         */
+        struct Level {
+            float cellSize;
+            std::size_t count;
+            std::unordered_map<std::uint64_t, std::vector<LocatedEntity*>> cells;
+        };
+
+        std::vector<Level> m_levels;
+
+        /// Entities that are either too large or lack a position.
+        std::vector<LocatedEntity*> m_unbounded;
+
+        std::unordered_map<LocatedEntity*, Placement> m_placements;
+
+        Placement calculatePlacement(const Point3D& pos, float reach) const;
+
+        void addToPlacement(LocatedEntity* entity, const Placement& placement);
+        void removeFromPlacement(LocatedEntity* entity, const Placement& placement);
+
+        static std::uint64_t cellKey(int x, int y);
+
+};
+
+#endif /* SPATIALINDEX_H_ */
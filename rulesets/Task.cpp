@@ -108,7 +108,7 @@ void Task::initTask(const Operation & op, OpVector & res)
     if (m_script == 0) {
         log(WARNING, "Task script failed");
         irrelevant();
-    } else if (!m_script->operation(op->getParents().front(), op, res)) {
+    } else if (!m_script->dispatch(Script::OPERATION_HANDLERS, op, res)) {
         log(WARNING, "Task init failed");
         irrelevant();
     }
@@ -130,6 +130,6 @@ void Task::initTask(const Operation & op, OpVector & res)
 void Task::operation(const Operation & op, OpVector & res)
 {
     if (m_script != 0) {
-        m_script->operation(op->getParents().front(), op, res);
+        m_script->dispatch(Script::OPERATION_HANDLERS, op, res);
     }
 }
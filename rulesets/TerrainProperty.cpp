@@ -17,6 +17,7 @@
 
 
 #include "TerrainProperty.h"
+#include "TerrainSegmentCache.h"
 #include "LocatedEntity.h"
 
 #include "common/BaseWorld.h"
@@ -64,7 +65,8 @@ typedef enum { ROCK = 0, SAND = 1, GRASS = 2, SILT = 3, SNOW = 4} Surface;
 
 TerrainProperty::TerrainProperty(const TerrainProperty& rhs) :
     m_data(*new Mercator::Terrain(Mercator::Terrain::SHADED)),
-    m_tileShader(nullptr)
+    m_tileShader(nullptr),
+    m_segments(new TerrainSegmentCache(m_data))
 {
     //Copy all points.
     for (auto& pointColumn : rhs.m_data.getPoints()) {
@@ -84,13 +86,14 @@ TerrainProperty::TerrainProperty(const TerrainProperty& rhs) :
 /// \brief TerrainProperty constructor
 TerrainProperty::TerrainProperty() :
       m_data(*new Mercator::Terrain(Mercator::Terrain::SHADED)),
-      m_tileShader(nullptr)
-
+      m_tileShader(nullptr),
+      m_segments(new TerrainSegmentCache(m_data))
 {
 }
 
 TerrainProperty::~TerrainProperty()
 {
+    delete m_segments;
     delete &m_data;
     delete m_tileShader;
 }
@@ -139,6 +142,8 @@ void TerrainProperty::set(const Element & ent)
     debug(std::cout << "TerrainProperty::setTerrain()"
                     << std::endl << std::flush;);
 
+    m_segments->pause();
+
     const Pointstore & base_points = m_data.getPoints();
 
     MapType::const_iterator I = t.find("points");
@@ -198,6 +203,7 @@ void TerrainProperty::set(const Element & ent)
         }
     }
 
+    m_segments->resume();
 }
 
 Mercator::TileShader* TerrainProperty::createShaders(const Atlas::Message::ListType& surfaceList) {
@@ -288,37 +294,48 @@ HandlerResult TerrainProperty::operation(LocatedEntity * e,
 
 void TerrainProperty::addMod(const Mercator::TerrainMod *mod) const
 {
+    m_segments->pause();
     m_data.addMod(mod);
+    m_segments->resume();
 }
 
 void TerrainProperty::updateMod(const Mercator::TerrainMod *mod) const
 {
+    m_segments->pause();
     m_data.updateMod(mod);
+    m_segments->resume();
 }
 
 void TerrainProperty::removeMod(const Mercator::TerrainMod *mod) const
 {
+    m_segments->pause();
     m_data.removeMod(mod);
+    m_segments->resume();
 }
 
 void TerrainProperty::clearMods(float x, float y)
 {
     Mercator::Segment *s = m_data.getSegment(x,y);
     if(s != NULL) {
+        m_segments->pause();
         s->clearMods();
+        m_segments->resume();
         //log(INFO, "Mods cleared!");
     } 
 }
 
 /// \brief Return the height and normal to the surface at the given point
+///
+/// Segments around the point are queued to be populated in the background,
+/// so that moving across the terrain rarely has to wait for one.
 bool TerrainProperty::getHeightAndNormal(float x,
                                          float y,
                                          float & height,
                                          Vector3D & normal) const
 {
     Mercator::Segment * s = m_data.getSegment(x, y);
-    if (s != 0 && !s->isValid()) {
-        s->populate();
+    if (s != 0) {
+        m_segments->acquire(*s);
     }
     return m_data.getHeightAndNormal(x, y, height, normal);
 }
@@ -337,9 +354,7 @@ int TerrainProperty::getSurface(const Point3D & pos, int & material)
         debug(std::cerr << "No terrain at this point" << std::endl << std::flush;);
         return -1;
     }
-    if (!segment->isValid()) {
-        segment->populate();
-    }
+    m_segments->acquire(*segment);
     x -= segment->getXRef();
     y -= segment->getYRef();
     assert(x <= segment->getSize());
@@ -25,6 +25,8 @@
 
 #include <set>
 
+class TerrainSegmentCache;
+
 namespace Mercator {
     class Terrain;
     class TerrainMod;
@@ -41,6 +43,8 @@ class TerrainProperty : public PropertyBase {
     Mercator::Terrain & m_data;
     /// \brief The tile shader which represents all other shaders.
     Mercator::TileShader* m_tileShader;
+    /// \brief Populates segments ahead of use, and releases unused ones.
+    TerrainSegmentCache * m_segments;
     /// FIXME This should be a reference for consistency. Or could it
     /// even be stored in the mercator terrain entity.
     /// \brief Collection of surface data, cos I don't care!
@@ -0,0 +1,366 @@
+// Cyphesis Online RPG Server and AI Engine
+// Copyright (C) 2014 Erik Ogenvik
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+
+#include "TerrainSegmentCache.h"
+
+#include <Mercator/Terrain.h>
+#include <Mercator/Segment.h>
+#include <Mercator/Surface.h>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+int TerrainSegmentCache::s_threads = 0;
+std::size_t TerrainSegmentCache::s_budget = 0;
+
+/// \brief The worker threads shared by all caches
+///
+/// Each segment a cache queues is matched by the cache being posted here,
+/// and a worker which takes it populates the next segment in the
+/// queue of that cache. The pool lock is never taken while a worker holds
+/// the lock of a cache, so caches may post while holding theirs.
+class TerrainSegmentCache::Workers {
+  protected:
+    std::mutex m_mutex;
+    std::condition_variable m_posted;
+    std::condition_variable m_finished;
+    /// Caches with a segment waiting, once for each segment.
+    std::deque<TerrainSegmentCache *> m_jobs;
+    /// Caches a worker is populating a segment of, once for each worker.
+    std::vector<TerrainSegmentCache *> m_running;
+    std::vector<std::thread> m_threads;
+    bool m_stopping;
+
+    void work();
+  public:
+    Workers();
+    ~Workers();
+
+    static Workers & instance();
+
+    void post(TerrainSegmentCache * cache, std::size_t count);
+    void cancel(TerrainSegmentCache * cache);
+    int count();
+};
+
+TerrainSegmentCache::Workers::Workers() : m_stopping(false)
+{
+}
+
+TerrainSegmentCache::Workers::~Workers()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_posted.notify_all();
+    for (auto & thread : m_threads) {
+        thread.join();
+    }
+}
+
+TerrainSegmentCache::Workers & TerrainSegmentCache::Workers::instance()
+{
+    static Workers workers;
+    return workers;
+}
+
+void TerrainSegmentCache::Workers::work()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_posted.wait(lock, [this]() {
+            return m_stopping || !m_jobs.empty();
+        });
+        if (m_stopping) {
+            return;
+        }
+        TerrainSegmentCache * cache = m_jobs.front();
+        m_jobs.pop_front();
+        m_running.push_back(cache);
+
+        lock.unlock();
+        cache->populateNext();
+        lock.lock();
+
+        m_running.erase(std::find(m_running.begin(), m_running.end(), cache));
+        m_finished.notify_all();
+    }
+}
+
+/// \brief Ask for segments of a cache to be populated
+///
+/// Starts the workers, up to the number configured, the first time there
+/// is something for them to do.
+void TerrainSegmentCache::Workers::post(TerrainSegmentCache * cache,
+                                        std::size_t count)
+{
+    if (s_threads <= 0 || count == 0) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        while ((int)m_threads.size() < s_threads) {
+            m_threads.emplace_back(&Workers::work, this);
+        }
+        m_jobs.insert(m_jobs.end(), count, cache);
+    }
+    m_posted.notify_all();
+}
+
+/// \brief Drop the work posted for a cache which is going away
+///
+/// Waits until no worker is populating a segment of the cache.
+void TerrainSegmentCache::Workers::cancel(TerrainSegmentCache * cache)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_jobs.erase(std::remove(m_jobs.begin(), m_jobs.end(), cache),
+                 m_jobs.end());
+    m_finished.wait(lock, [this, cache]() {
+        return std::find(m_running.begin(), m_running.end(), cache) ==
+               m_running.end();
+    });
+}
+
+int TerrainSegmentCache::Workers::count()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_threads.size();
+}
+
+TerrainSegmentCache::TerrainSegmentCache(Mercator::Terrain & terrain) :
+      m_terrain(terrain), m_readyBytes(0), m_populating(0), m_misses(0),
+      m_paused(false)
+{
+}
+
+TerrainSegmentCache::~TerrainSegmentCache()
+{
+    Workers::instance().cancel(this);
+}
+
+/// \brief Populate a segment and its surfaces
+void TerrainSegmentCache::populate(Mercator::Segment & segment)
+{
+    if (!segment.isValid()) {
+        segment.populate();
+    }
+    for (auto & entry : segment.getSurfaces()) {
+        if (!entry.second->isValid()) {
+            entry.second->populate();
+        }
+    }
+}
+
+/// \brief Estimate the memory used by a populated segment
+std::size_t TerrainSegmentCache::segmentBytes(const Mercator::Segment & segment)
+{
+    std::size_t size = segment.getSize();
+    std::size_t points = size * size;
+    std::size_t bytes = points * sizeof(float);
+    for (auto & entry : segment.getSurfaces()) {
+        bytes += points * entry.second->getChannels();
+    }
+    return bytes;
+}
+
+TerrainSegmentCache::Entry & TerrainSegmentCache::entry(Mercator::Segment * segment)
+{
+    auto I = m_entries.find(segment);
+    if (I == m_entries.end()) {
+        Entry entry = { COLD, false, 0, m_recent.end() };
+        I = m_entries.insert(std::make_pair(segment, entry)).first;
+    }
+    return I->second;
+}
+
+/// \brief Queue the segments around a segment to be populated
+void TerrainSegmentCache::prefetch(const Mercator::Segment & segment)
+{
+    if (s_threads <= 0) {
+        return;
+    }
+
+    int res = m_terrain.getResolution();
+    int x = segment.getXRef() / res;
+    int y = segment.getYRef() / res;
+    std::size_t queued = 0;
+    for (int i = x - 1; i <= x + 1; ++i) {
+        for (int j = y - 1; j <= y + 1; ++j) {
+            Mercator::Segment * neighbour = m_terrain.getSegment(i, j);
+            if (neighbour == 0) {
+                continue;
+            }
+            Entry & neighbour_entry = entry(neighbour);
+            if (neighbour_entry.m_state == COLD) {
+                neighbour_entry.m_state = QUEUED;
+                m_queue.push_back(neighbour);
+                ++queued;
+            }
+        }
+    }
+    Workers::instance().post(this, queued);
+}
+
+void TerrainSegmentCache::ready(Mercator::Segment * segment, Entry & entry)
+{
+    entry.m_state = READY;
+    entry.m_bytes = segmentBytes(*segment);
+    m_readyBytes += entry.m_bytes;
+    m_recent.push_front(segment);
+    entry.m_recent = m_recent.begin();
+}
+
+void TerrainSegmentCache::forget(Entry & entry)
+{
+    if (entry.m_state != READY) {
+        return;
+    }
+    m_recent.erase(entry.m_recent);
+    entry.m_recent = m_recent.end();
+    m_readyBytes -= entry.m_bytes;
+    entry.m_bytes = 0;
+    entry.m_state = COLD;
+    entry.m_prefetched = false;
+}
+
+/// \brief Release the least recently used segments until within budget
+///
+/// @param keep A segment which is about to be used, and must be kept.
+void TerrainSegmentCache::evict(const Mercator::Segment * keep)
+{
+    if (s_budget == 0) {
+        return;
+    }
+    while (m_readyBytes > s_budget && !m_recent.empty()) {
+        Mercator::Segment * victim = m_recent.back();
+        if (victim == keep) {
+            break;
+        }
+        forget(m_entries.find(victim)->second);
+        victim->invalidate(true);
+    }
+}
+
+/// \brief Populate the next segment in the queue, called by a worker
+///
+/// Does nothing while the cache is paused, in which case resume() posts
+/// the queue again.
+void TerrainSegmentCache::populateNext()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_paused || m_queue.empty()) {
+        return;
+    }
+    Mercator::Segment * segment = m_queue.front();
+    m_queue.pop_front();
+    Entry & entry = m_entries.find(segment)->second;
+    if (entry.m_state != QUEUED) {
+        // Populated by the caller while waiting in the queue.
+        return;
+    }
+    entry.m_state = POPULATING;
+    ++m_populating;
+
+    lock.unlock();
+    populate(*segment);
+    lock.lock();
+
+    --m_populating;
+    ready(segment, entry);
+    m_populated.notify_all();
+}
+
+/// \brief Make sure a segment is populated before it is used
+///
+/// If the segment is not ready yet it is populated on the calling thread,
+/// unless a worker is already populating it, in which case the worker is
+/// waited for.
+void TerrainSegmentCache::acquire(Mercator::Segment & segment)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    Entry & e = entry(&segment);
+    if (e.m_state == POPULATING) {
+        m_populated.wait(lock, [&e]() { return e.m_state != POPULATING; });
+    }
+    if (e.m_state == READY && !segment.isValid()) {
+        forget(e);
+    }
+    if (e.m_state == READY) {
+        m_recent.splice(m_recent.begin(), m_recent, e.m_recent);
+    } else {
+        // Workers skip the segment if it is still in their queue.
+        e.m_state = POPULATING;
+        ++m_misses;
+
+        lock.unlock();
+        populate(segment);
+        lock.lock();
+
+        ready(&segment, e);
+    }
+    if (!e.m_prefetched) {
+        prefetch(segment);
+        e.m_prefetched = true;
+    }
+    evict(&segment);
+}
+
+/// \brief Stop the workers before the terrain is changed
+///
+/// Waits until no segment is being populated.
+void TerrainSegmentCache::pause()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_paused = true;
+    m_populated.wait(lock, [this]() { return m_populating == 0; });
+}
+
+/// \brief Let the workers carry on after the terrain has been changed
+///
+/// Segments which were invalidated by the change must be populated again.
+void TerrainSegmentCache::resume()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto & entry : m_entries) {
+        if (entry.second.m_state == READY && !entry.first->isValid()) {
+            forget(entry.second);
+        }
+    }
+    m_paused = false;
+    Workers::instance().post(this, m_queue.size());
+}
+
+std::size_t TerrainSegmentCache::readyBytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_readyBytes;
+}
+
+int TerrainSegmentCache::misses() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_misses;
+}
+
+/// \brief The number of worker threads started so far
+int TerrainSegmentCache::workerCount()
+{
+    return Workers::instance().count();
+}
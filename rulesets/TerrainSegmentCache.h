@@ -0,0 +1,115 @@
+// Cyphesis Online RPG Server and AI Engine
+// Copyright (C) 2014 Erik Ogenvik
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+
+#ifndef RULESETS_TERRAIN_SEGMENT_CACHE_H
+#define RULESETS_TERRAIN_SEGMENT_CACHE_H
+
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <map>
+#include <mutex>
+
+namespace Mercator {
+    class Segment;
+    class Terrain;
+}
+
+/// \brief Keeps the populated segments of a terrain within a memory budget
+///
+/// Populating a segment takes milliseconds, which is too long to do on the
+/// path which moves entities. When a segment is used, the segments around
+/// it are queued to be populated by worker threads, so that entities
+/// moving across the terrain find the segments they need ready. Segments
+/// which haven't been used for the longest time have their data released
+/// when the populated segments take more memory than the budget. The
+/// worker threads are shared by the caches of all terrains.
+///
+/// Workers only touch segments which are queued, and the caller only
+/// touches segments which are populated, so the terrain must not be
+/// changed by the caller except between pause() and resume().
+class TerrainSegmentCache {
+  protected:
+    enum State { COLD, QUEUED, POPULATING, READY };
+
+    class Workers;
+
+    typedef std::list<Mercator::Segment *> SegmentList;
+
+    /// \brief What is known about one segment
+    struct Entry {
+        State m_state;
+        /// True once the segments around this one have been queued.
+        bool m_prefetched;
+        /// Memory used by the populated segment, in bytes.
+        std::size_t m_bytes;
+        /// Position in the list of populated segments.
+        SegmentList::iterator m_recent;
+    };
+
+    Mercator::Terrain & m_terrain;
+
+    std::map<Mercator::Segment *, Entry> m_entries;
+    /// Populated segments, most recently used first.
+    SegmentList m_recent;
+    /// Segments waiting for a worker.
+    std::deque<Mercator::Segment *> m_queue;
+    /// Memory used by populated segments, in bytes.
+    std::size_t m_readyBytes;
+    /// Number of segments being populated by workers.
+    int m_populating;
+    /// Number of segments which had to be populated when they were used.
+    int m_misses;
+    bool m_paused;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_populated;
+
+    TerrainSegmentCache(const TerrainSegmentCache &) = delete;
+    TerrainSegmentCache & operator=(const TerrainSegmentCache &) = delete;
+
+    Entry & entry(Mercator::Segment * segment);
+    void prefetch(const Mercator::Segment & segment);
+    void ready(Mercator::Segment * segment, Entry & entry);
+    void forget(Entry & entry);
+    void evict(const Mercator::Segment * keep);
+    void populateNext();
+
+    static void populate(Mercator::Segment & segment);
+    static std::size_t segmentBytes(const Mercator::Segment & segment);
+  public:
+    /// Number of worker threads shared by all terrains, or 0 for none.
+    static int s_threads;
+    /// Memory populated segments may use, in bytes, or 0 for no limit.
+    static std::size_t s_budget;
+
+    explicit TerrainSegmentCache(Mercator::Terrain & terrain);
+    ~TerrainSegmentCache();
+
+    void acquire(Mercator::Segment & segment);
+
+    void pause();
+    void resume();
+
+    std::size_t readyBytes() const;
+    int misses() const;
+
+    static int workerCount();
+};
+
+#endif // RULESETS_TERRAIN_SEGMENT_CACHE_H
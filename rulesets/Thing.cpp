@@ -284,6 +284,8 @@ void Thing::MoveOperation(const Operation & op, OpVector & res)
 
         // At this point the Location data for this entity has been updated.
 
+        updateDomainPosition();
+
         bool moving = false;
 
         if (m_location.velocity().isValid() &&
@@ -327,15 +329,11 @@ void Thing::MoveOperation(const Operation & op, OpVector & res)
 
             u->setRefno(m_motion->serialno());
 
-            res.push_back(u);
+            scheduleMotionUpdate(u);
 
         } else {
-            if (m_motion) {
-                //We moved previously, but have now stopped.
-
-                delete m_motion;
-                m_motion = nullptr;
-            }
+            //If we moved previously, but have now stopped.
+            stopMotion();
         }
 
         Operation m(op.copy());
@@ -379,6 +377,53 @@ void Thing::checkVisibility(const Location & old_loc, OpVector & res)
     }
 }
 
+/// \brief Let the domain we're in know that our location has changed
+///
+/// This keeps any spatial index the domain maintains of its children up to
+/// date.
+void Thing::updateDomainPosition()
+{
+    Domain * parent_domain = m_location.m_loc->getMovementDomain();
+    if (parent_domain) {
+        parent_domain->updatePosition(*this);
+    }
+}
+
+/// \brief Schedule the next movement update
+///
+/// Any update scheduled earlier is superseded by this one, so it is
+/// cancelled rather than being left in the queue to be discarded on
+/// delivery. If the domain integrates movement itself the update is
+/// handed over to it, and no Update op is sent.
+void Thing::scheduleMotionUpdate(const Operation & update)
+{
+    assert(m_motion != nullptr);
+    BaseWorld & world = BaseWorld::instance();
+    world.cancelOperation(m_motion->updateHandle());
+    m_motion->updateHandle() = 0;
+
+    Domain * domain = getMovementDomain();
+    if (domain && domain->addMover(*this, *m_motion,
+                                   world.getTime() + update->getFutureSeconds())) {
+        return;
+    }
+    m_motion->updateHandle() = world.scheduleOperation(update, *this);
+}
+
+/// \brief Stop tracking movement, cancelling any scheduled update
+void Thing::stopMotion()
+{
+    if (m_motion) {
+        BaseWorld::instance().cancelOperation(m_motion->updateHandle());
+        Domain * domain = getMovementDomain();
+        if (domain) {
+            domain->removeMover(*this);
+        }
+        delete m_motion;
+        m_motion = nullptr;
+    }
+}
+
 void Thing::SetOperation(const Operation & op, OpVector & res)
 {
     const std::vector<Root> & args = op->getArgs();
@@ -538,6 +583,8 @@ void Thing::UpdateOperation(const Operation & op, OpVector & res)
     m_location.update(current_time);
     m_flags &= ~(entity_pos_clean | entity_clean);
 
+    updateDomainPosition();
+
     float update_time = consts::move_tick;
 
     if (moving) {
@@ -578,16 +625,16 @@ void Thing::UpdateOperation(const Operation & op, OpVector & res)
         if (op->isDefaultSerialno()) {
             u->setRefno(++m_motion->serialno());
         } else {
-            // We should respect the serial number if it is present
-            // as the core code will set the reference number
-            // correctly.
+            // We should respect the serial number if it is present,
+            // setting the reference number as the core code would for
+            // a reply.
             m_motion->serialno() = op->getSerialno();
+            u->setRefno(op->getSerialno());
         }
 
-        res.push_back(u);
+        scheduleMotionUpdate(u);
     } else {
-        delete m_motion;
-        m_motion = nullptr;
+        stopMotion();
     }
 
     // This code handles sending Appearance and Disappearance operations
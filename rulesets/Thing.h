@@ -31,6 +31,9 @@
 class Thing : public Entity {
   protected:
     void checkVisibility(const Location &, OpVector &);
+    void updateDomainPosition();
+    void scheduleMotionUpdate(const Operation & update);
+    void stopMotion();
     void updateProperties(const Operation & op, OpVector & res);
   public:
 
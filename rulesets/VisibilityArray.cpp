@@ -0,0 +1,293 @@
+/*
+ Copyright (C) 2014 Erik Ogenvik
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "VisibilityArray.h"
+
+#include "common/const.h"
+
+#include <limits>
+
+#include <cassert>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+VisibilityArray::VisibilityArray()
+{
+}
+
+VisibilityArray::~VisibilityArray()
+{
+}
+
+void VisibilityArray::insert(LocatedEntity* entity, const Point3D& pos,
+        float squareBoxSize)
+{
+    std::size_t slot;
+    auto I = m_slots.find(entity);
+    if (I != m_slots.end()) {
+        slot = I->second;
+    } else {
+        slot = m_entities.size();
+        m_slots.insert(std::make_pair(entity, slot));
+        m_entities.push_back(entity);
+        m_x.push_back(0.f);
+        m_y.push_back(0.f);
+        m_z.push_back(0.f);
+        m_squareBoxSize.push_back(0.f);
+    }
+    if (pos.isValid()) {
+        m_x[slot] = pos.x();
+        m_y[slot] = pos.y();
+        m_z[slot] = pos.z();
+    } else {
+        //NaN compares false with everything, so an entity without a position can neither see nor be seen.
+        float nan = std::numeric_limits<float>::quiet_NaN();
+        m_x[slot] = nan;
+        m_y[slot] = nan;
+        m_z[slot] = nan;
+    }
+    m_squareBoxSize[slot] = squareBoxSize;
+}
+
+void VisibilityArray::remove(LocatedEntity* entity)
+{
+    auto I = m_slots.find(entity);
+    if (I == m_slots.end()) {
+        return;
+    }
+    std::size_t slot = I->second;
+    std::size_t last = m_entities.size() - 1;
+    m_slots.erase(I);
+    if (slot != last) {
+        m_entities[slot] = m_entities[last];
+        m_x[slot] = m_x[last];
+        m_y[slot] = m_y[last];
+        m_z[slot] = m_z[last];
+        m_squareBoxSize[slot] = m_squareBoxSize[last];
+        m_slots[m_entities[slot]] = slot;
+    }
+    m_entities.pop_back();
+    m_x.pop_back();
+    m_y.pop_back();
+    m_z.pop_back();
+    m_squareBoxSize.pop_back();
+}
+
+bool VisibilityArray::contains(LocatedEntity* entity) const
+{
+    return m_slots.find(entity) != m_slots.end();
+}
+
+void VisibilityArray::resizeMasks(std::size_t size, VisibilityMasks& masks)
+{
+    std::size_t words = (size + 31) / 32;
+    masks.wasSeen.assign(words, 0);
+    masks.isSeen.assign(words, 0);
+    masks.couldSee.assign(words, 0);
+    masks.canSee.assign(words, 0);
+}
+
+void VisibilityArray::calculateRange(std::size_t begin, std::size_t end,
+        const Point3D& oldPos, const Point3D& newPos, float squareBoxSize,
+        VisibilityMasks& masks) const
+{
+    const float factor = consts::square_sight_factor;
+    for (std::size_t i = begin; i < end; ++i) {
+        float dx = m_x[i] - oldPos.x(),
+              dy = m_y[i] - oldPos.y(),
+              dz = m_z[i] - oldPos.z();
+        float old_dist = factor * (dx * dx + dy * dy + dz * dz);
+        dx = m_x[i] - newPos.x();
+        dy = m_y[i] - newPos.y();
+        dz = m_z[i] - newPos.z();
+        float new_dist = factor * (dx * dx + dy * dy + dz * dz);
+
+        std::uint32_t bit = std::uint32_t(1) << (i % 32);
+        std::size_t word = i / 32;
+        if (squareBoxSize > old_dist) {
+            masks.wasSeen[word] |= bit;
+        }
+        if (squareBoxSize > new_dist) {
+            masks.isSeen[word] |= bit;
+        }
+        if (m_squareBoxSize[i] > old_dist) {
+            masks.couldSee[word] |= bit;
+        }
+        if (m_squareBoxSize[i] > new_dist) {
+            masks.canSee[word] |= bit;
+        }
+    }
+}
+
+void VisibilityArray::calculateScalar(const Point3D& oldPos,
+        const Point3D& newPos, float squareBoxSize,
+        VisibilityMasks& masks) const
+{
+    resizeMasks(m_entities.size(), masks);
+    calculateRange(0, m_entities.size(), oldPos, newPos, squareBoxSize, masks);
+}
+
+EntityVisibility VisibilityArray::calculateEntity(const Point3D& pos,
+        float squareBoxSize, const Point3D& oldPos, const Point3D& newPos,
+        float movedSquareBoxSize)
+{
+    EntityVisibility visibility = { false, false, false, false };
+    if (!pos.isValid()) {
+        return visibility;
+    }
+    const float factor = consts::square_sight_factor;
+    if (oldPos.isValid()) {
+        float dx = pos.x() - oldPos.x(),
+              dy = pos.y() - oldPos.y(),
+              dz = pos.z() - oldPos.z();
+        float old_dist = factor * (dx * dx + dy * dy + dz * dz);
+        visibility.wasSeen = movedSquareBoxSize > old_dist;
+        visibility.couldSee = squareBoxSize > old_dist;
+    }
+    if (newPos.isValid()) {
+        float dx = pos.x() - newPos.x(),
+              dy = pos.y() - newPos.y(),
+              dz = pos.z() - newPos.z();
+        float new_dist = factor * (dx * dx + dy * dy + dz * dz);
+        visibility.isSeen = movedSquareBoxSize > new_dist;
+        visibility.canSee = squareBoxSize > new_dist;
+    }
+    return visibility;
+}
+
+#if defined(__AVX__)
+
+void VisibilityArray::calculate(const Point3D& oldPos, const Point3D& newPos,
+        float squareBoxSize, VisibilityMasks& masks) const
+{
+    std::size_t size = m_entities.size();
+    resizeMasks(size, masks);
+
+    const __m256 factor = _mm256_set1_ps(consts::square_sight_factor);
+    const __m256 size_moved = _mm256_set1_ps(squareBoxSize);
+    const __m256 old_x = _mm256_set1_ps(oldPos.x()),
+                 old_y = _mm256_set1_ps(oldPos.y()),
+                 old_z = _mm256_set1_ps(oldPos.z());
+    const __m256 new_x = _mm256_set1_ps(newPos.x()),
+                 new_y = _mm256_set1_ps(newPos.y()),
+                 new_z = _mm256_set1_ps(newPos.z());
+
+    std::size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        __m256 x = _mm256_loadu_ps(&m_x[i]),
+               y = _mm256_loadu_ps(&m_y[i]),
+               z = _mm256_loadu_ps(&m_z[i]),
+               size_other = _mm256_loadu_ps(&m_squareBoxSize[i]);
+
+        __m256 dx = _mm256_sub_ps(x, old_x),
+               dy = _mm256_sub_ps(y, old_y),
+               dz = _mm256_sub_ps(z, old_z);
+        __m256 old_dist = _mm256_mul_ps(factor, _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)),
+                _mm256_mul_ps(dz, dz)));
+        dx = _mm256_sub_ps(x, new_x);
+        dy = _mm256_sub_ps(y, new_y);
+        dz = _mm256_sub_ps(z, new_z);
+        __m256 new_dist = _mm256_mul_ps(factor, _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)),
+                _mm256_mul_ps(dz, dz)));
+
+        // Ordered comparisons are false for NaN, as in the scalar code.
+        int shift = i % 32;
+        std::size_t word = i / 32;
+        masks.wasSeen[word] |= std::uint32_t(_mm256_movemask_ps(
+                _mm256_cmp_ps(size_moved, old_dist, _CMP_GT_OQ))) << shift;
+        masks.isSeen[word] |= std::uint32_t(_mm256_movemask_ps(
+                _mm256_cmp_ps(size_moved, new_dist, _CMP_GT_OQ))) << shift;
+        masks.couldSee[word] |= std::uint32_t(_mm256_movemask_ps(
+                _mm256_cmp_ps(size_other, old_dist, _CMP_GT_OQ))) << shift;
+        masks.canSee[word] |= std::uint32_t(_mm256_movemask_ps(
+                _mm256_cmp_ps(size_other, new_dist, _CMP_GT_OQ))) << shift;
+    }
+    calculateRange(i, size, oldPos, newPos, squareBoxSize, masks);
+}
+
+#elif defined(__SSE__)
+
+void VisibilityArray::calculate(const Point3D& oldPos, const Point3D& newPos,
+        float squareBoxSize, VisibilityMasks& masks) const
+{
+    std::size_t size = m_entities.size();
+    resizeMasks(size, masks);
+
+    const __m128 factor = _mm_set1_ps(consts::square_sight_factor);
+    const __m128 size_moved = _mm_set1_ps(squareBoxSize);
+    const __m128 old_x = _mm_set1_ps(oldPos.x()),
+                 old_y = _mm_set1_ps(oldPos.y()),
+                 old_z = _mm_set1_ps(oldPos.z());
+    const __m128 new_x = _mm_set1_ps(newPos.x()),
+                 new_y = _mm_set1_ps(newPos.y()),
+                 new_z = _mm_set1_ps(newPos.z());
+
+    std::size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        __m128 x = _mm_loadu_ps(&m_x[i]),
+               y = _mm_loadu_ps(&m_y[i]),
+               z = _mm_loadu_ps(&m_z[i]),
+               size_other = _mm_loadu_ps(&m_squareBoxSize[i]);
+
+        __m128 dx = _mm_sub_ps(x, old_x),
+               dy = _mm_sub_ps(y, old_y),
+               dz = _mm_sub_ps(z, old_z);
+        __m128 old_dist = _mm_mul_ps(factor, _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+                _mm_mul_ps(dz, dz)));
+        dx = _mm_sub_ps(x, new_x);
+        dy = _mm_sub_ps(y, new_y);
+        dz = _mm_sub_ps(z, new_z);
+        __m128 new_dist = _mm_mul_ps(factor, _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+                _mm_mul_ps(dz, dz)));
+
+        // _mm_cmpgt_ps is false for NaN, as in the scalar code.
+        int shift = i % 32;
+        std::size_t word = i / 32;
+        masks.wasSeen[word] |= std::uint32_t(_mm_movemask_ps(
+                _mm_cmpgt_ps(size_moved, old_dist))) << shift;
+        masks.isSeen[word] |= std::uint32_t(_mm_movemask_ps(
+                _mm_cmpgt_ps(size_moved, new_dist))) << shift;
+        masks.couldSee[word] |= std::uint32_t(_mm_movemask_ps(
+                _mm_cmpgt_ps(size_other, old_dist))) << shift;
+        masks.canSee[word] |= std::uint32_t(_mm_movemask_ps(
+                _mm_cmpgt_ps(size_other, new_dist))) << shift;
+    }
+    calculateRange(i, size, oldPos, newPos, squareBoxSize, masks);
+}
+
+#else
+
+void VisibilityArray::calculate(const Point3D& oldPos, const Point3D& newPos,
+        float squareBoxSize, VisibilityMasks& masks) const
+{
+    calculateScalar(oldPos, newPos, squareBoxSize, masks);
+}
+
+#endif
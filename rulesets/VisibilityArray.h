@@ -0,0 +1,199 @@
+/*
+ Copyright (C) 2014 Erik Ogenvik
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#ifndef VISIBILITYARRAY_H_
+#define VISIBILITYARRAY_H_
+
+#include "physics/Vector3D.h"
+
+#include <wfmath/point.h>
+
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+class LocatedEntity;
+
+/**
+ * @brief The visibility between a moved entity and one other entity.
+ *
+ * The members mean the same as the masks of VisibilityMasks.
+ */
+struct EntityVisibility {
+    bool wasSeen;
+    bool isSeen;
+    bool couldSee;
+    bool canSee;
+};
+
+/**
+ * @brief Bitmasks of the visibility between a moved entity and the entries of a VisibilityArray.
+ *
+ * Bit i of each mask refers to entry i of the array, and is stored in
+ * word i / 32.
+ */
+struct VisibilityMasks {
+    /// The entry could see the moved entity at its old position.
+    std::vector<std::uint32_t> wasSeen;
+    /// The entry can see the moved entity at its new position.
+    std::vector<std::uint32_t> isSeen;
+    /// The moved entity could see the entry from its old position.
+    std::vector<std::uint32_t> couldSee;
+    /// The moved entity can see the entry from its new position.
+    std::vector<std::uint32_t> canSee;
+
+    static bool test(const std::vector<std::uint32_t>& mask, std::size_t i)
+    {
+        return (mask[i / 32] >> (i % 32)) & 1;
+    }
+
+    /**
+     * @brief Gets the entries in a word which have any of the bits set.
+     */
+    std::uint32_t any(std::size_t word) const
+    {
+        return wasSeen[word] | isSeen[word] | couldSee[word] | canSee[word];
+    }
+
+    /**
+     * @brief Gets the visibility of one entry.
+     */
+    EntityVisibility get(std::size_t i) const
+    {
+        EntityVisibility visibility = { test(wasSeen, i), test(isSeen, i),
+                test(couldSee, i), test(canSee, i) };
+        return visibility;
+    }
+};
+
+/**
+ * @brief A packed copy of the positions and sizes of the children of a domain entity.
+ *
+ * The positions and square box sizes are kept in separate contiguous arrays
+ * ("structure of arrays"), so that the visibility of a moved entity against
+ * all of them can be worked out in one pass using SIMD instructions, instead
+ * of following pointers to each entity in turn.
+ *
+ * Like SpatialIndex, the array has to be told whenever an entity moves or
+ * changes size.
+ */
+class VisibilityArray
+{
+    public:
+
+        VisibilityArray();
+        ~VisibilityArray();
+
+        /**
+         * @brief Inserts an entity, or updates it if it's already present.
+         * @param entity The entity.
+         * @param pos The position of the entity, in the coordinate space of the array.
+         * @param squareBoxSize The square box size of the entity.
+         */
+        void insert(LocatedEntity* entity, const Point3D& pos,
+                float squareBoxSize);
+
+        /**
+         * @brief Removes an entity.
+         *
+         * The last entry is moved into the slot of the removed one, so entry
+         * indices are only stable until the next removal.
+         * Nothing happens if the entity isn't present.
+         * @param entity The entity.
+         */
+        void remove(LocatedEntity* entity);
+
+        /**
+         * @brief Checks whether an entity is present.
+         */
+        bool contains(LocatedEntity* entity) const;
+
+        /**
+         * @brief Gets the number of entries.
+         */
+        std::size_t size() const
+        {
+            return m_entities.size();
+        }
+
+        /**
+         * @brief Gets the entity of an entry.
+         */
+        LocatedEntity* entity(std::size_t index) const
+        {
+            return m_entities[index];
+        }
+
+        /**
+         * @brief Works out the visibility between a moved entity and every entry.
+         *
+         * An entity can be seen when its square box size divided by the
+         * square distance is larger than consts::square_sight_factor. This
+         * is checked by multiplying the distance instead, which avoids the
+         * divisions.
+         *
+         * Uses AVX or SSE instructions if the build targets them, and
+         * otherwise is the same as calculateScalar().
+         * @param oldPos The old position of the moved entity.
+         * @param newPos The new position of the moved entity.
+         * @param squareBoxSize The square box size of the moved entity.
+         * @param masks Filled with one bit for each entry.
+         */
+        void calculate(const Point3D& oldPos, const Point3D& newPos,
+                float squareBoxSize, VisibilityMasks& masks) const;
+
+        /**
+         * @brief Does the same as calculate(), one entry at a time.
+         */
+        void calculateScalar(const Point3D& oldPos, const Point3D& newPos,
+                float squareBoxSize, VisibilityMasks& masks) const;
+
+        /**
+         * @brief Works out the visibility between a moved entity and one entity.
+         *
+         * Gives the same result as calculate() does for an entry with the
+         * same position and size.
+         * @param pos The position of the entity.
+         * @param squareBoxSize The square box size of the entity.
+         * @param oldPos The old position of the moved entity.
+         * @param newPos The new position of the moved entity.
+         * @param movedSquareBoxSize The square box size of the moved entity.
+         */
+        static EntityVisibility calculateEntity(const Point3D& pos,
+                float squareBoxSize, const Point3D& oldPos,
+                const Point3D& newPos, float movedSquareBoxSize);
+
+    private:
+
+        std::vector<float> m_x;
+        std::vector<float> m_y;
+        std::vector<float> m_z;
+        std::vector<float> m_squareBoxSize;
+        std::vector<LocatedEntity*> m_entities;
+
+        /// The index of each entity in the arrays.
+        std::unordered_map<LocatedEntity*, std::size_t> m_slots;
+
+        void calculateRange(std::size_t begin, std::size_t end,
+                const Point3D& oldPos, const Point3D& newPos,
+                float squareBoxSize, VisibilityMasks& masks) const;
+
+        static void resizeMasks(std::size_t size, VisibilityMasks& masks);
+
+};
+
+#endif /* VISIBILITYARRAY_H_ */
@@ -19,6 +19,7 @@
 #include "VisibilityProperty.h"
 
 #include "rulesets/LocatedEntity.h"
+#include "rulesets/Domain.h"
 
 #include "common/log.h"
 
@@ -38,4 +39,10 @@ VisibilityProperty * VisibilityProperty::copy() const
 void VisibilityProperty::apply(LocatedEntity * ent)
 {
     ent->m_location.setVisibility(m_data);
+    if (ent->m_location.m_loc != 0) {
+        Domain * domain = ent->m_location.m_loc->getMovementDomain();
+        if (domain) {
+            domain->updatePosition(*ent);
+        }
+    }
 }
@@ -20,3 +20,20 @@
 #include "config.h"
 #endif
 
+#include "CommAsioClient.h"
+
+#include "common/globals.h"
+
+INT_OPTION(client_send_high_watermark, 1 << 20, CYPHESIS, "clientsendhigh",
+        "Bytes of unsent data above which operations made obsolete by later "
+        "ones are no longer sent to a client")
+;
+
+INT_OPTION(client_send_low_watermark, 1 << 18, CYPHESIS, "clientsendlow",
+        "Bytes of unsent data below which a client gets all operations again")
+;
+
+INT_OPTION(client_send_timeout, 30, CYPHESIS, "clientsendtimeout",
+        "Seconds a client may have more unsent data than allowed before it "
+        "is disconnected")
+;
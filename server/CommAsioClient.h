@@ -35,6 +35,13 @@
 #include <sstream>
 #include <deque>
 
+/// \brief Unsent data in bytes above which a client is congested
+extern int client_send_high_watermark;
+/// \brief Unsent data in bytes below which a client is no longer congested
+extern int client_send_low_watermark;
+/// \brief Seconds a client may stay congested before it is disconnected
+extern int client_send_timeout;
+
 template<typename ProtocolT>
 class CommAsioClient: public Atlas::Objects::ObjectsDecoder,
         public CommSocket,
@@ -58,13 +65,37 @@ class CommAsioClient: public Atlas::Objects::ObjectsDecoder,
 
         virtual int flush();
 
+        virtual bool isCongested() const;
+
+        virtual const std::type_info * codecType() const;
+
+        virtual int encode(const Atlas::Objects::Operation::RootOperation & op,
+                std::string & data);
+
+        virtual int writeEncoded(const char * data, std::size_t length);
+
     protected:
         typename ProtocolT::socket mSocket;
 
         boost::asio::streambuf mReadBuffer;
+        /// \brief Buffer which outgoing data is encoded into.
         boost::asio::streambuf* mWriteBuffer;
+        /// \brief Buffer being written to the socket.
+        ///
+        /// The two buffers are swapped when a write starts, so both keep
+        /// the memory they have allocated.
+        boost::asio::streambuf* mSendBuffer;
         std::iostream mStream;
         boost::asio::deadline_timer mNegotiateTimer;
+        /// \brief True while a write to the socket has not completed.
+        bool mWriteInProgress;
+        /// \brief True if a write has been posted to the io_service.
+        bool mFlushPosted;
+        /// \brief True if there is more unsent data than the high watermark,
+        /// and it has not yet dropped below the low watermark.
+        bool mCongested;
+        /// \brief When the client became congested.
+        boost::posix_time::ptime mCongestedSince;
 
         enum
         {
@@ -88,6 +119,8 @@ class CommAsioClient: public Atlas::Objects::ObjectsDecoder,
 
         void write();
 
+        void checkBacklog();
+
         void dispatch();
 
         void startNegotiation();
@@ -37,9 +37,12 @@ template<class ProtocolT>
 CommAsioClient<ProtocolT>::CommAsioClient(const std::string & name,
         boost::asio::io_service& io_service) :
         CommSocket(io_service), mSocket(io_service), mWriteBuffer(
+                new boost::asio::streambuf()), mSendBuffer(
                 new boost::asio::streambuf()), mStream(mWriteBuffer), mNegotiateTimer(
-                io_service, boost::posix_time::seconds(1)), m_codec(nullptr), m_encoder(
-                nullptr), m_negotiate(nullptr), m_link(nullptr), mName(name)
+                io_service, boost::posix_time::seconds(1)), mWriteInProgress(
+                false), mFlushPosted(false), mCongested(false), m_codec(
+                nullptr), m_encoder(nullptr), m_negotiate(nullptr), m_link(
+                nullptr), mName(name)
 {
 }
 
@@ -51,6 +54,7 @@ CommAsioClient<ProtocolT>::~CommAsioClient()
     delete m_encoder;
     delete m_codec;
     delete mWriteBuffer;
+    delete mSendBuffer;
     try {
         mSocket.shutdown(ProtocolT::socket::shutdown_both);
     } catch (const std::exception& e) {
@@ -93,42 +97,76 @@ void CommAsioClient<ProtocolT>::do_read()
 template<class ProtocolT>
 void CommAsioClient<ProtocolT>::write()
 {
-    auto self(this->shared_from_this());
-
-    //When sending data we need to make sure that nothing else writes to the streambuf (mWriteBuffer).
-    //We do this by creating a new streambuf instance. The one containing the data to be sent is
-    //then contained in a shared_ptr. When the async write operation is done the shared_ptr will
-    //be deleted. However, in order to make this a bit more efficient we'll use a custom deletor
-    //in which we'll check if the new buffer has had anything written to it. If not, we'll reuse
-    //the buffer just used for writing, as this will already have had memory allocated.
-    std::function<void(boost::asio::streambuf*)> bufferDeleter =
-            [&, self](boost::asio::streambuf* p) {
-                //Check if the existing writebuffer has had anything written to it.
-                if (this->mWriteBuffer->size() > 0) {
-                    delete p;
-                } else {
-                    //If the existing writebuffer hasn't had anything written to it we'll reuse the previous
-                    //one instead since it already have had memory allocated. This prevents unnecessary release
-                    //and re-allocation of memory.
-                    delete this->mWriteBuffer;
-                    this->mWriteBuffer = p;
-                    this->mStream.rdbuf(this->mWriteBuffer);
+    if (!mSocket.is_open()) {
+        //Nothing more will be sent, so don't let the data pile up.
+        mWriteBuffer->consume(mWriteBuffer->size());
+        return;
+    }
+    //Only one write is in flight at a time. Anything encoded in the meantime
+    //is sent in one go when it completes.
+    if (mWriteInProgress || mWriteBuffer->size() == 0) {
+        return;
+    }
 
-                }
-            };
-    std::shared_ptr<boost::asio::streambuf> buffer(mWriteBuffer, bufferDeleter);
-    mWriteBuffer = new boost::asio::streambuf();
+    //Encoding carries on into the other buffer while this one is written.
+    std::swap(mWriteBuffer, mSendBuffer);
     mStream.rdbuf(mWriteBuffer);
+    mWriteInProgress = true;
 
-    if (buffer->size() != 0) {
-        boost::asio::async_write(mSocket, buffer->data(),
-                [this, self, buffer](boost::system::error_code ec, std::size_t length)
+    auto self(this->shared_from_this());
+    boost::asio::async_write(mSocket, mSendBuffer->data(),
+            [this, self](boost::system::error_code ec, std::size_t length)
+            {
+                mWriteInProgress = false;
+                if (!ec)
                 {
-                    if (!ec)
-                    {
-                        buffer->consume(length);
-                    }
-                });
+                    mSendBuffer->consume(length);
+                    this->checkBacklog();
+                    this->write();
+                } else {
+                    //What was left unsent can't be sent after anything
+                    //written later, so the connection is of no further use.
+                    mSendBuffer->consume(mSendBuffer->size());
+                    mWriteBuffer->consume(mWriteBuffer->size());
+                    this->disconnect();
+                }
+            });
+}
+
+/// \brief Keep track of whether the client is keeping up with the data
+/// sent to it
+///
+/// A client with more unsent data than the high watermark is congested
+/// until it drops below the low watermark, at which point the Moves the
+/// link held back meanwhile are sent. One which stays congested for too
+/// long is disconnected, so a stalled client can't make the server hold on
+/// to ever more data.
+template<class ProtocolT>
+void CommAsioClient<ProtocolT>::checkBacklog()
+{
+    std::size_t backlog = mWriteBuffer->size() + mSendBuffer->size();
+    if (!mCongested) {
+        if (backlog > (std::size_t)client_send_high_watermark) {
+            mCongested = true;
+            mCongestedSince = boost::posix_time::second_clock::universal_time();
+            log(NOTICE, String::compose("Client %1 is not keeping up; "
+                    "%2 bytes waiting to be sent.", mName, backlog));
+        }
+        return;
+    }
+    if (backlog < (std::size_t)client_send_low_watermark) {
+        mCongested = false;
+        if (m_link != nullptr) {
+            m_link->sendPending();
+        }
+        return;
+    }
+    if (boost::posix_time::second_clock::universal_time() - mCongestedSince
+            > boost::posix_time::seconds(client_send_timeout)) {
+        log(WARNING, String::compose("Disconnecting client %1 which has "
+                "not kept up for %2 seconds.", mName, client_send_timeout));
+        mCongested = false;
+        disconnect();
     }
 }
 
@@ -335,7 +373,62 @@ void CommAsioClient<ProtocolT>::disconnect()
 template<class ProtocolT>
 int CommAsioClient<ProtocolT>::flush()
 {
-    write();
+    checkBacklog();
+    //Everything sent while handling the current event goes out in a single
+    //write once the handler has returned.
+    if (!mFlushPosted) {
+        mFlushPosted = true;
+        auto self(this->shared_from_this());
+        m_io_service.post([this, self]()
+        {
+            mFlushPosted = false;
+            this->write();
+        });
+    }
+    return 0;
+}
+
+template<class ProtocolT>
+bool CommAsioClient<ProtocolT>::isCongested() const
+{
+    return mCongested;
+}
+
+template<class ProtocolT>
+const std::type_info * CommAsioClient<ProtocolT>::codecType() const
+{
+    if (m_codec == nullptr) {
+        return nullptr;
+    }
+    return &typeid(*m_codec);
+}
+
+template<class ProtocolT>
+int CommAsioClient<ProtocolT>::encode(
+        const Atlas::Objects::Operation::RootOperation & op,
+        std::string & data)
+{
+    if (m_encoder == nullptr) {
+        return -1;
+    }
+    //The codec writes to mStream, so point it at a separate buffer while
+    //encoding.
+    std::stringbuf buffer;
+    mStream.rdbuf(&buffer);
+    m_encoder->streamObjectsMessage(op);
+    mStream.rdbuf(mWriteBuffer);
+    data = buffer.str();
+    return 0;
+}
+
+template<class ProtocolT>
+int CommAsioClient<ProtocolT>::writeEncoded(const char * data,
+        std::size_t length)
+{
+    if (!mSocket.is_open()) {
+        return -1;
+    }
+    mStream.write(data, length);
     return 0;
 }
 
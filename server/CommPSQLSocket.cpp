@@ -30,19 +30,13 @@
 
 static const bool debug_flag = false;
 
-/// Interval between database vacuum jobs.
-const int CommPSQLSocket::vacFreq = 25 * 60;
-/// Interval between database reindex jobs.
-const int CommPSQLSocket::reindexFreq = 30 * 60;
-
 
 /// \brief Constructor for PostgreSQL socket polling object.
 ///
 /// @param db Reference to the low level database management object.
 CommPSQLSocket::CommPSQLSocket(boost::asio::io_service& io_service, Database & db) :
                                m_io_service(io_service), m_socket(new boost::asio::ip::tcp::socket(io_service)),
-                               m_vacuumTimer(io_service), m_reindexTimer(io_service), m_reconnectTimer(io_service),
-                               m_db(db), m_vacuumFull(false)
+                               m_reconnectTimer(io_service), m_db(db)
 {
     // This assumes the database connection is already sorted, which I think
     // is okay
@@ -58,8 +52,6 @@ CommPSQLSocket::CommPSQLSocket(boost::asio::io_service& io_service, Database & d
     if (fd >= 0) {
         m_socket->assign(boost::asio::ip::tcp::v4(), fd);
     }
-    vacuum();
-    reindex();
     do_read();
 }
 
@@ -142,7 +134,7 @@ int CommPSQLSocket::read()
     PGresult * res;
     while (PQisBusy(con) == 0) {
         if ((res = PQgetResult(con)) != 0) {
-            m_db.queryResult(PQresultStatus(res));
+            m_db.queryResult(res);
             PQclear(res);
         } else {
             m_db.queryComplete();
@@ -164,38 +156,3 @@ void CommPSQLSocket::dispatch()
 
     m_db.launchNewQuery();
 }
-
-void CommPSQLSocket::vacuum()
-{
-    if (m_socket && m_socket->is_open()) {
-        if (m_vacuumFull) {
-            m_db.runMaintainance(Database::MAINTAIN_VACUUM |
-                                 Database::MAINTAIN_VACUUM_FULL);
-        } else {
-            m_db.runMaintainance(Database::MAINTAIN_VACUUM |
-                                 Database::MAINTAIN_VACUUM_ANALYZE);
-        }
-        m_vacuumFull = !m_vacuumFull;
-    }
-
-    m_vacuumTimer.expires_from_now(boost::posix_time::seconds(vacFreq));
-    m_vacuumTimer.async_wait([this](boost::system::error_code ec) {
-        if (!ec) {
-            this->vacuum();
-        }
-    });
-}
-
-
-void CommPSQLSocket::reindex()
-{
-    if (m_socket && m_socket->is_open()) {
-        m_db.runMaintainance(Database::MAINTAIN_REINDEX);
-    }
-    m_reindexTimer.expires_from_now(boost::posix_time::seconds(reindexFreq));
-    m_reindexTimer.async_wait([this](boost::system::error_code ec) {
-        if (!ec) {
-            this->reindex();
-        }
-    });
-}
@@ -34,31 +34,18 @@ class CommPSQLSocket {
 
     boost::asio::io_service& m_io_service;
     boost::asio::ip::tcp::socket* m_socket;
-    boost::asio::deadline_timer m_vacuumTimer;
-    boost::asio::deadline_timer m_reindexTimer;
     boost::asio::deadline_timer m_reconnectTimer;
 
 
     /// Reference to the low level database management object.
     Database & m_db;
 
-    /// Flag indicating whether the next vacuum job should be vacuum full.
-    bool m_vacuumFull;
-
     void do_read();
     int read();
     void dispatch();
 
-    void vacuum();
-    void reindex();
-
     void tryReConnect();
   public:
-    /// Interval between database vacuum jobs.
-    static const int vacFreq;
-    /// Interval between database reindex jobs.
-    static const int reindexFreq;
-
     CommPSQLSocket(boost::asio::io_service& io_service, Database & db);
     virtual ~CommPSQLSocket();
 };
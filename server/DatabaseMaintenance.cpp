@@ -0,0 +1,373 @@
+// Cyphesis Online RPG Server and AI Engine
+// Copyright (C) 2014 Erik Ogenvik
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+
+#include "DatabaseMaintenance.h"
+
+#include "common/Database.h"
+#include "common/Monitors.h"
+#include "common/Variable.h"
+#include "common/compose.hpp"
+#include "common/debug.h"
+#include "common/globals.h"
+#include "common/log.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <cstdlib>
+
+#include <unistd.h>
+
+using String::compose;
+
+static const bool debug_flag = false;
+
+BOOL_OPTION(db_vacuum_full, false, CYPHESIS, "dbvacuumfull",
+        "Use VACUUM FULL when vacuuming database tables. This locks each "
+        "table while it is rewritten")
+;
+
+/// Dead tuples a table must have before it is vacuumed.
+const long DatabaseMaintenance::minDeadTuples = 50;
+/// Further dead tuples needed, as a fraction of the live tuples.
+const double DatabaseMaintenance::deadTupleRatio = 0.2;
+/// Shortest time between checks, in seconds.
+const int DatabaseMaintenance::minInterval = 60;
+/// Longest time between checks, in seconds.
+const int DatabaseMaintenance::maxInterval = 30 * 60;
+
+static const char * statistics_query =
+    "SELECT relname, n_live_tup, n_dead_tup, n_tup_upd + n_tup_del AS writes"
+    " FROM pg_stat_user_tables";
+
+/// \brief Constructor for the database maintenance scheduler
+///
+/// No connection is made until start() is called.
+/// @param db Reference to the low level database management object.
+DatabaseMaintenance::DatabaseMaintenance(boost::asio::io_service & io_service,
+                                         Database & db) :
+                     m_io_service(io_service), m_db(db),
+                     m_connection(0), m_socket(0), m_timer(io_service),
+                     m_lastDuration(0), m_totalDuration(0),
+                     m_vacuumCount(0), m_vacuumFailures(0),
+                     m_checkInterval(0), m_commandFailed(false)
+{
+    Monitors::instance()->watch("db_vacuum_last_duration_msec",
+                                new Variable<int>(m_lastDuration));
+    Monitors::instance()->watch("db_vacuum_total_duration_msec",
+                                new Variable<int>(m_totalDuration));
+    Monitors::instance()->watch("db_vacuums",
+                                new Variable<int>(m_vacuumCount));
+    Monitors::instance()->watch("db_vacuum_failures",
+                                new Variable<int>(m_vacuumFailures));
+    Monitors::instance()->watch("db_maintenance_check_interval_sec",
+                                new Variable<int>(m_checkInterval));
+}
+
+DatabaseMaintenance::~DatabaseMaintenance()
+{
+    m_timer.cancel();
+    closeConnection();
+}
+
+long DatabaseMaintenance::now()
+{
+    return std::chrono::duration_cast<std::chrono::seconds>(
+          clock::now().time_since_epoch()).count();
+}
+
+/// \brief Open the maintenance connection, and schedule the first check
+///
+/// @return 0 if the connection was opened. If it wasn't, another attempt
+/// is made when the first check is due.
+int DatabaseMaintenance::start()
+{
+    int ret = openConnection();
+    schedule(minInterval);
+    return ret;
+}
+
+int DatabaseMaintenance::openConnection()
+{
+    std::string error_message;
+    m_connection = m_db.openConnection(error_message);
+    if (m_connection == 0) {
+        log(ERROR, "Connection to database for maintenance failed:");
+        log_formatted(ERROR, error_message);
+        return -1;
+    }
+
+    if (PQsetnonblocking(m_connection, 1) == -1) {
+        log(ERROR, "Unable to put database maintenance connection in "
+                   "non-blocking mode.");
+    }
+
+    // The socket gets its own descriptor, so closing it leaves the one
+    // libpq owns alone.
+    int fd = ::dup(PQsocket(m_connection));
+    if (fd < 0) {
+        log(ERROR, "Unable to poll database maintenance connection.");
+        closeConnection();
+        return -1;
+    }
+    m_socket = new boost::asio::ip::tcp::socket(m_io_service);
+    m_socket->assign(boost::asio::ip::tcp::v4(), fd);
+    return 0;
+}
+
+void DatabaseMaintenance::closeConnection()
+{
+    delete m_socket;
+    m_socket = 0;
+    if (m_connection != 0) {
+        PQfinish(m_connection);
+        m_connection = 0;
+    }
+    m_commands.clear();
+}
+
+void DatabaseMaintenance::schedule(int seconds)
+{
+    m_checkInterval = seconds;
+    m_timer.expires_from_now(boost::posix_time::seconds(seconds));
+    m_timer.async_wait([this](boost::system::error_code ec) {
+        if (!ec) {
+            this->check();
+        }
+    });
+}
+
+/// \brief Read the statistics of the tables, to see which need a vacuum
+void DatabaseMaintenance::check()
+{
+    if (m_connection == 0 && openConnection() != 0) {
+        schedule(minInterval);
+        return;
+    }
+    if (!m_commands.empty()) {
+        return;
+    }
+    m_commands.push_back(std::string());
+    launchCommand();
+}
+
+void DatabaseMaintenance::launchCommand()
+{
+    assert(!m_commands.empty());
+    const std::string & table = m_commands.front();
+    std::string query = table.empty() ? statistics_query
+                                      : vacuumCommand(table);
+    debug(std::cout << "Launching maintenance: " << query
+                    << std::endl << std::flush;);
+    if (!PQsendQuery(m_connection, query.c_str())) {
+        log(ERROR, "Database maintenance error when launching.");
+        log_formatted(ERROR, PQerrorMessage(m_connection));
+        closeConnection();
+        schedule(minInterval);
+        return;
+    }
+    PQflush(m_connection);
+    m_commandStart = clock::now();
+    m_commandFailed = false;
+    do_read();
+}
+
+void DatabaseMaintenance::do_read()
+{
+    m_socket->async_read_some(boost::asio::null_buffers(),
+            [this](boost::system::error_code ec, std::size_t length)
+            {
+                if (ec == boost::asio::error::operation_aborted) {
+                    return;
+                }
+                int result = ec ? -1 : this->read();
+                if (result == 0) {
+                    this->do_read();
+                } else if (result > 0) {
+                    this->commandComplete();
+                } else {
+                    log(ERROR, "Connection to database for maintenance lost.");
+                    this->closeConnection();
+                    this->schedule(minInterval);
+                }
+            });
+}
+
+/// \brief Read whatever results of the command in progress have arrived
+///
+/// @return 1 if the command is complete, 0 if more is to come, or -1 if
+/// the connection has failed.
+int DatabaseMaintenance::read()
+{
+    if (PQconsumeInput(m_connection) == 0) {
+        return -1;
+    }
+
+    while (PQisBusy(m_connection) == 0) {
+        PGresult * res = PQgetResult(m_connection);
+        if (res == 0) {
+            return 1;
+        }
+        commandResult(res);
+        PQclear(res);
+    }
+    return 0;
+}
+
+void DatabaseMaintenance::commandResult(PGresult * res)
+{
+    ExecStatusType status = PQresultStatus(res);
+    if (status != PGRES_COMMAND_OK && status != PGRES_TUPLES_OK) {
+        log(ERROR, "Database maintenance failed:");
+        log_formatted(ERROR, PQresultErrorMessage(res));
+        m_commandFailed = true;
+        return;
+    }
+    if (!m_commands.front().empty()) {
+        return;
+    }
+
+    const TableSet & tables = m_db.tables();
+    long time = now();
+    int rows = PQntuples(res);
+    for (int i = 0; i < rows; ++i) {
+        std::string table = PQgetvalue(res, i, 0);
+        if (tables.find(table) == tables.end()) {
+            continue;
+        }
+        if (updateTable(table,
+                        std::strtol(PQgetvalue(res, i, 1), 0, 10),
+                        std::strtol(PQgetvalue(res, i, 2), 0, 10),
+                        std::strtol(PQgetvalue(res, i, 3), 0, 10),
+                        time)) {
+            m_commands.push_back(table);
+        }
+    }
+}
+
+void DatabaseMaintenance::commandComplete()
+{
+    const std::string & table = m_commands.front();
+    if (!table.empty() && m_commandFailed) {
+        tableVacuumFailed(table);
+    } else if (!table.empty()) {
+        int duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+              clock::now() - m_commandStart).count();
+        debug(std::cout << "Vacuum of " << table << " took " << duration
+                        << "ms" << std::endl << std::flush;);
+        tableVacuumed(table, duration);
+    }
+    m_commands.pop_front();
+
+    if (m_commands.empty()) {
+        schedule(nextCheck());
+    } else {
+        launchCommand();
+    }
+}
+
+/// \brief Record the statistics of a table
+///
+/// @param table Name of the table.
+/// @param live Number of live tuples in the table.
+/// @param dead Number of dead tuples in the table.
+/// @param writes Total number of updates and deletes on the table.
+/// @param time Time the statistics were read, in seconds.
+/// @return true if the table has enough dead tuples to need a vacuum.
+bool DatabaseMaintenance::updateTable(const std::string & table,
+                                      long live, long dead,
+                                      long writes, long time)
+{
+    std::map<std::string, TableStats>::iterator I = m_tables.find(table);
+    if (I == m_tables.end()) {
+        TableStats stats = { live, dead, writes, 0., time, 0 };
+        I = m_tables.insert(std::make_pair(table, stats)).first;
+        Monitors::instance()->watch(
+              compose("db_vacuum_duration_msec{table=\"%1\"}", table),
+              new Variable<int>(I->second.m_duration));
+    } else {
+        TableStats & stats = I->second;
+        // The totals go backwards if the statistics have been reset, in
+        // which case the rate from the last pair of checks is kept.
+        if (time > stats.m_checked && writes >= stats.m_writes) {
+            stats.m_writeRate = (double)(writes - stats.m_writes) /
+                                (time - stats.m_checked);
+        }
+        stats.m_live = live;
+        stats.m_dead = dead;
+        stats.m_writes = writes;
+        stats.m_checked = time;
+    }
+    return dead >= minDeadTuples + deadTupleRatio * live;
+}
+
+/// \brief Record that a table has been vacuumed
+///
+/// @param table Name of the table.
+/// @param duration Time the vacuum took, in milliseconds.
+void DatabaseMaintenance::tableVacuumed(const std::string & table,
+                                        int duration)
+{
+    std::map<std::string, TableStats>::iterator I = m_tables.find(table);
+    if (I != m_tables.end()) {
+        I->second.m_dead = 0;
+        I->second.m_duration = duration;
+    }
+    m_lastDuration = duration;
+    m_totalDuration += duration;
+    ++m_vacuumCount;
+}
+
+/// \brief Record that the vacuum of a table failed
+///
+/// The statistics of the table are left as they are, so it is vacuumed
+/// again after the next check.
+/// @param table Name of the table.
+void DatabaseMaintenance::tableVacuumFailed(const std::string & table)
+{
+    ++m_vacuumFailures;
+}
+
+/// \brief Predict how long it will be until a table needs a vacuum
+///
+/// Each table is assumed to keep gaining dead tuples at the rate it has
+/// been updated and deleted from since the previous check.
+/// @return the time until the next check, in seconds.
+int DatabaseMaintenance::nextCheck() const
+{
+    double interval = maxInterval;
+    for (auto & entry : m_tables) {
+        const TableStats & stats = entry.second;
+        double remaining = minDeadTuples + deadTupleRatio * stats.m_live -
+                           stats.m_dead;
+        if (remaining <= 0) {
+            interval = 0;
+        } else if (stats.m_writeRate > 0) {
+            interval = std::min(interval, remaining / stats.m_writeRate);
+        }
+    }
+    return std::max(minInterval, std::min(maxInterval, (int)interval));
+}
+
+std::string DatabaseMaintenance::vacuumCommand(const std::string & table) const
+{
+    if (db_vacuum_full) {
+        return "VACUUM FULL ANALYZE " + table;
+    }
+    return "VACUUM ANALYZE " + table;
+}
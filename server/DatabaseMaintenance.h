@@ -0,0 +1,125 @@
+// Cyphesis Online RPG Server and AI Engine
+// Copyright (C) 2014 Erik Ogenvik
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+
+#ifndef SERVER_DATABASE_MAINTENANCE_H
+#define SERVER_DATABASE_MAINTENANCE_H
+
+#include <boost/asio.hpp>
+#include <boost/asio/deadline_timer.hpp>
+
+#include <chrono>
+#include <deque>
+#include <map>
+#include <string>
+
+#include <libpq-fe.h>
+
+class Database;
+
+/// \brief Vacuum the database tables on a connection of its own
+///
+/// Maintenance commands block the connection they run on until they
+/// finish, so they are kept off the connection used for storage. Rather
+/// than vacuuming every table on a fixed timer, the statistics PostgreSQL
+/// keeps for each table are checked, and only tables with enough dead
+/// tuples are vacuumed. The time until the next check is predicted from
+/// the rate at which tables have been accumulating dead tuples.
+/// \ingroup ServerSockets
+class DatabaseMaintenance {
+  protected:
+    /// \brief What is known about one table
+    struct TableStats {
+        /// Live tuples at the last check.
+        long m_live;
+        /// Dead tuples at the last check, or since the table was vacuumed.
+        long m_dead;
+        /// Total of updates and deletes at the last check.
+        long m_writes;
+        /// Updates and deletes per second, measured between checks.
+        double m_writeRate;
+        /// Time of the last check, in seconds.
+        long m_checked;
+        /// Time taken by the last vacuum of the table, in milliseconds.
+        int m_duration;
+    };
+
+    typedef std::chrono::steady_clock clock;
+
+    boost::asio::io_service & m_io_service;
+    Database & m_db;
+
+    PGconn * m_connection;
+    boost::asio::ip::tcp::socket * m_socket;
+    boost::asio::deadline_timer m_timer;
+
+    std::map<std::string, TableStats> m_tables;
+    /// Tables to vacuum, starting with the one in progress. An empty name
+    /// stands for the query which reads the table statistics.
+    std::deque<std::string> m_commands;
+    clock::time_point m_commandStart;
+
+    /// Time taken by the last vacuum of any table, in milliseconds.
+    int m_lastDuration;
+    /// Time taken by all vacuums so far, in milliseconds.
+    int m_totalDuration;
+    /// Number of vacuums which have succeeded so far.
+    int m_vacuumCount;
+    /// Number of vacuums which have failed so far.
+    int m_vacuumFailures;
+    /// Seconds until the check which is scheduled next.
+    int m_checkInterval;
+    /// Set if the command in progress has returned an error.
+    bool m_commandFailed;
+
+    int openConnection();
+    void closeConnection();
+
+    void check();
+    void schedule(int seconds);
+    void launchCommand();
+    void do_read();
+    int read();
+    void commandResult(PGresult * res);
+    void commandComplete();
+
+    static long now();
+  public:
+    /// Dead tuples a table must have before it is vacuumed.
+    static const long minDeadTuples;
+    /// Further dead tuples needed, as a fraction of the live tuples.
+    static const double deadTupleRatio;
+    /// Shortest time between checks, in seconds.
+    static const int minInterval;
+    /// Longest time between checks, in seconds.
+    static const int maxInterval;
+
+    DatabaseMaintenance(boost::asio::io_service & io_service, Database & db);
+    ~DatabaseMaintenance();
+
+    int start();
+
+    bool updateTable(const std::string & table, long live, long dead,
+                     long writes, long time);
+    void tableVacuumed(const std::string & table, int duration);
+    void tableVacuumFailed(const std::string & table);
+    int nextCheck() const;
+
+    std::string vacuumCommand(const std::string & table) const;
+};
+
+#endif // SERVER_DATABASE_MAINTENANCE_H
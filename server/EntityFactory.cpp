@@ -100,15 +100,16 @@ void EntityFactoryBase::initializeEntity(LocatedEntity& thing,
         MapType attrs = attributes->asMessage();
         // Apply the attribute values
         thing.merge(attrs);
-        // Then set up the default class properties
-        for (auto& propIter : m_type->defaults()) {
-            PropertyBase * prop = propIter.second;
+        // Then set up the default class properties, in the same
+        // alphabetical order as they have always been applied.
+        for (auto propIter : m_type->defaults().sorted()) {
+            PropertyBase * prop = propIter->second;
             // If a property is in the class it won't have been installed
             // as setAttr() checks
-            prop->install(&thing, propIter.first);
+            prop->install(&thing, propIter->first);
             // The property will have been applied if it has an overriden
             // value, so we only apply it the value is still default.
-            if (attrs.find(propIter.first) == attrs.end()) {
+            if (attrs.find(propIter->first) == attrs.end()) {
                 prop->apply(&thing);
             }
         }
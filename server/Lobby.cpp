@@ -26,6 +26,7 @@
 #include "common/debug.h"
 #include "common/log.h"
 #include "common/serialno.h"
+#include "common/BroadcastEncoding.h"
 
 #include <Atlas/Objects/Operation.h>
 #include <Atlas/Objects/Anonymous.h>
@@ -105,6 +106,7 @@ void Lobby::operation(const Operation & op, OpVector & res)
     const std::string & to = op->getTo();
     if (to.empty() || to == getId()) {
         Operation newop(op.copy());
+        BroadcastEncoding broadcast;
         AccountDict::const_iterator I = m_accounts.begin();
         AccountDict::const_iterator Iend = m_accounts.end();
         for (; I != Iend; ++I) {
@@ -0,0 +1,118 @@
+// Cyphesis Online RPG Server and AI Engine
+// Copyright (C) 2014 Erik Ogenvik
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+
+#include "MindWorkerAccount.h"
+
+#include "Connection.h"
+#include "MindWorkerPool.h"
+
+#include "rulesets/Character.h"
+#include "rulesets/ExternalMind.h"
+
+#include "common/Setup.h"
+
+#include <Atlas/Objects/Anonymous.h>
+#include <Atlas/Objects/Operation.h>
+
+using Atlas::Message::MapType;
+using Atlas::Objects::Entity::Anonymous;
+using Atlas::Objects::Operation::Info;
+using Atlas::Objects::Operation::Look;
+using Atlas::Objects::Operation::Setup;
+
+MindWorkerAccount::MindWorkerAccount(Connection * conn,
+                                     const std::string & username,
+                                     const std::string & passwd,
+                                     const std::string & id, long intId) :
+                   Account(conn, username, passwd, id, intId)
+{
+    MindWorkerPool * pool = MindWorkerPool::instance();
+    if (pool != 0) {
+        pool->addWorker(this);
+    }
+}
+
+MindWorkerAccount::~MindWorkerAccount()
+{
+    MindWorkerPool * pool = MindWorkerPool::instance();
+    if (pool != 0) {
+        pool->removeWorker(this);
+    }
+}
+
+const char * MindWorkerAccount::getType() const
+{
+    return "mind";
+}
+
+bool MindWorkerAccount::isPersisted() const
+{
+    return false;
+}
+
+int MindWorkerAccount::characterError(const Operation & op,
+                                      const Atlas::Objects::Root & ent,
+                                      OpVector & res) const
+{
+    error(op, "Mind workers can not create characters", res, getId());
+    return -1;
+}
+
+/// \brief Hand the mind of a character to the worker
+///
+/// The character is connected to the worker as its external mind, and the
+/// worker is sent an Info op describing the character, including the mind
+/// it should run. The character is then set up as if its mind had just
+/// been created in the server.
+/// @param chr The character which needs a mind
+/// @param mind The value of the mind property of the character
+/// @return 0 if the worker is now running the mind, or -1 otherwise.
+int MindWorkerAccount::hostMind(Character & chr, const MapType & mind)
+{
+    if (m_connection == 0) {
+        return -1;
+    }
+    if (chr.m_externalMind != 0 && chr.m_externalMind->isLinked()) {
+        return -1;
+    }
+    if (connectCharacter(&chr) != 0) {
+        return -1;
+    }
+
+    Anonymous info_arg;
+    chr.addToEntity(info_arg);
+    info_arg->setAttr("mind", mind);
+
+    Info info;
+    info->setTo(getId());
+    info->setArgs1(info_arg);
+    m_connection->send(info);
+
+    Setup s;
+    Anonymous setup_arg;
+    setup_arg->setName("mind");
+    s->setTo(chr.getId());
+    s->setArgs1(setup_arg);
+    chr.sendWorld(s);
+
+    Look l;
+    l->setTo(chr.getId());
+    chr.sendWorld(l);
+
+    return 0;
+}
@@ -0,0 +1,49 @@
+// Cyphesis Online RPG Server and AI Engine
+// Copyright (C) 2014 Erik Ogenvik
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+
+#ifndef SERVER_MIND_WORKER_ACCOUNT_H
+#define SERVER_MIND_WORKER_ACCOUNT_H
+
+#include "Account.h"
+
+class Character;
+
+/// \brief Account used by a worker process which runs the minds of NPCs
+///
+/// Workers connect on the local socket, and are handed characters by the
+/// MindWorkerPool. Each character is connected to the worker's connection
+/// as an external mind, so the world sees no difference between a mind
+/// run by a worker and a client controlling a character.
+class MindWorkerAccount : public Account {
+  protected:
+    virtual int characterError(const Operation & op,
+                               const Atlas::Objects::Root & ent,
+                               OpVector & res) const;
+  public:
+    MindWorkerAccount(Connection * conn, const std::string & username,
+                      const std::string & passwd,
+                      const std::string & id, long intId);
+    virtual ~MindWorkerAccount();
+
+    virtual const char * getType() const;
+    virtual bool isPersisted() const;
+
+    int hostMind(Character & chr, const Atlas::Message::MapType & mind);
+};
+
+#endif // SERVER_MIND_WORKER_ACCOUNT_H
@@ -0,0 +1,346 @@
+// Cyphesis Online RPG Server and AI Engine
+// Copyright (C) 2014 Erik Ogenvik
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+
+#include "MindWorkerPool.h"
+
+#include "MindWorkerAccount.h"
+
+#include "rulesets/Character.h"
+#include "rulesets/ExternalMind.h"
+
+#include "common/globals.h"
+#include "common/log.h"
+#include "common/compose.hpp"
+#include "common/system.h"
+
+#include <sigc++/adaptors/bind.h>
+#include <sigc++/functors/mem_fun.h>
+
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using Atlas::Message::MapType;
+
+/// Environment variable which passes the token to worker processes.
+static const char * const token_variable = "CYPHESIS_MIND_TOKEN";
+
+/// Number of random bytes in a token.
+static const int token_size = 16;
+
+MindWorkerPool * MindWorkerPool::m_instance = 0;
+
+/// \brief Generate a token which can't be guessed
+///
+/// @return the token, or an empty string if no random data is available.
+static std::string generateToken()
+{
+    static const char hex_digits[] = "0123456789abcdef";
+
+    std::ifstream urandom("/dev/urandom", std::ios::binary);
+    char bytes[token_size];
+    if (!urandom.read(bytes, token_size)) {
+        return std::string();
+    }
+    std::string token;
+    for (unsigned char b : bytes) {
+        token.push_back(hex_digits[b >> 4]);
+        token.push_back(hex_digits[b & 0xf]);
+    }
+    return token;
+}
+
+static void setCloseOnExec(int fd)
+{
+    int flags = fcntl(fd, F_GETFD);
+    if (flags != -1 && (flags & FD_CLOEXEC) == 0) {
+        fcntl(fd, F_SETFD, flags | FD_CLOEXEC);
+    }
+}
+
+/// \brief Stop worker processes from inheriting the descriptors of the
+/// server
+///
+/// Marks every open descriptor apart from the standard ones close-on-exec.
+/// The open descriptors are listed in /proc where it's available.
+static void closeDescriptorsOnExec()
+{
+    DIR * fds = opendir("/proc/self/fd");
+    if (fds == 0) {
+        long max_fd = sysconf(_SC_OPEN_MAX);
+        for (long fd = 3; fd < max_fd; ++fd) {
+            setCloseOnExec(fd);
+        }
+        return;
+    }
+    int own_fd = dirfd(fds);
+    struct dirent * entry;
+    while ((entry = readdir(fds)) != 0) {
+        char * end;
+        long fd = strtol(entry->d_name, &end, 10);
+        if (end == entry->d_name || *end != '\0' || fd < 3 || fd == own_fd) {
+            continue;
+        }
+        setCloseOnExec(fd);
+    }
+    closedir(fds);
+}
+
+MindWorkerPool::MindWorkerPool(int size, const std::string & command) :
+                m_size(size), m_command(command), m_token(generateToken())
+{
+    if (m_token.empty()) {
+        log(ERROR, "Unable to generate a token for mind workers. No worker "
+                   "will be able to log in.");
+        return;
+    }
+    // Only child processes of the server see the token.
+    setenv(token_variable, m_token.c_str(), 1);
+}
+
+MindWorkerPool::~MindWorkerPool()
+{
+    for (auto & entry : m_minds) {
+        entry.second.m_linkConnection.disconnect();
+        entry.second.m_destroyedConnection.disconnect();
+    }
+    for (pid_t pid : m_processes) {
+        kill(pid, SIGTERM);
+    }
+    unsetenv(token_variable);
+}
+
+/// \brief Check whether an account was created with the token of the pool
+///
+/// @param hash The password hash of the account
+/// @return true if the account was created by a worker the pool started.
+bool MindWorkerPool::checkToken(const std::string & hash) const
+{
+    return !m_token.empty() && check_password(m_token, hash) == 0;
+}
+
+/// \brief Called when the external mind of a character is linked or
+/// unlinked
+///
+/// If the character has lost the worker running its mind, it waits for
+/// another.
+void MindWorkerPool::characterLinkChanged(long id)
+{
+    auto I = m_minds.find(id);
+    if (I == m_minds.end()) {
+        return;
+    }
+    Mind & mind = I->second;
+    ExternalMind * external = mind.m_character->m_externalMind;
+    if (external != 0 && external->isLinked()) {
+        return;
+    }
+    releaseMind(mind);
+    m_pending.insert(id);
+}
+
+/// \brief Called when a character with a mind run by the pool is destroyed
+void MindWorkerPool::characterDestroyed(long id)
+{
+    auto I = m_minds.find(id);
+    if (I == m_minds.end()) {
+        return;
+    }
+    releaseMind(I->second);
+    I->second.m_linkConnection.disconnect();
+    I->second.m_destroyedConnection.disconnect();
+    m_minds.erase(I);
+    m_pending.erase(id);
+}
+
+/// \brief Take a mind off the worker running it, if any
+void MindWorkerPool::releaseMind(Mind & mind)
+{
+    if (mind.m_worker == 0) {
+        return;
+    }
+    auto I = m_workers.find(mind.m_worker);
+    if (I != m_workers.end() && I->second > 0) {
+        --I->second;
+    }
+    mind.m_worker = 0;
+}
+
+/// \brief Find the connected worker running the fewest minds
+///
+/// @return the worker, or null if no worker is connected.
+MindWorkerAccount * MindWorkerPool::leastLoaded() const
+{
+    MindWorkerAccount * worker = 0;
+    std::size_t load = 0;
+    for (auto & entry : m_workers) {
+        if (entry.first->m_connection == 0) {
+            continue;
+        }
+        if (worker == 0 || entry.second < load) {
+            worker = entry.first;
+            load = entry.second;
+        }
+    }
+    return worker;
+}
+
+/// \brief Start a worker process
+///
+/// The worker is given the instance name of this server, so it connects
+/// back to the right local socket.
+/// @return 0 if the process was started, or -1 otherwise.
+int MindWorkerPool::spawnWorker()
+{
+    // Build the arguments before forking, so the child does nothing but
+    // exec.
+    std::string instance_arg = "--instance=" + instance;
+    // Don't let the worker hold on to the sockets of the server.
+    closeDescriptorsOnExec();
+
+    pid_t pid = fork();
+    if (pid == -1) {
+        log(ERROR, String::compose("Unable to start mind worker: %1",
+                                   strerror(errno)));
+        return -1;
+    }
+    if (pid == 0) {
+        execlp(m_command.c_str(), m_command.c_str(),
+               instance_arg.c_str(), (char *)0);
+        _exit(EXIT_FAILURE);
+    }
+    m_processes.insert(pid);
+    log(INFO, String::compose("Started mind worker process %1", pid));
+    return 0;
+}
+
+/// \brief Forget worker processes which have exited
+void MindWorkerPool::reapWorkers()
+{
+    auto I = m_processes.begin();
+    while (I != m_processes.end()) {
+        int status;
+        pid_t ret = waitpid(*I, &status, WNOHANG);
+        if (ret == *I || (ret == -1 && errno == ECHILD)) {
+            log(WARNING, String::compose("Mind worker process %1 has exited",
+                                         *I));
+            I = m_processes.erase(I);
+        } else {
+            ++I;
+        }
+    }
+}
+
+void MindWorkerPool::addMind(Character & chr, const MapType & mind)
+{
+    long id = chr.getIntId();
+    auto I = m_minds.find(id);
+    if (I != m_minds.end()) {
+        // The next worker to take on the character gets the new mind.
+        I->second.m_mind = mind;
+        return;
+    }
+    Mind & entry = m_minds[id];
+    entry.m_character = &chr;
+    entry.m_mind = mind;
+    entry.m_worker = 0;
+    entry.m_linkConnection = chr.externalLinkChanged.connect(sigc::bind(
+          sigc::mem_fun(this, &MindWorkerPool::characterLinkChanged), id));
+    entry.m_destroyedConnection = chr.destroyed.connect(sigc::bind(
+          sigc::mem_fun(this, &MindWorkerPool::characterDestroyed), id));
+    m_pending.insert(id);
+}
+
+/// \brief Add a worker which has connected
+void MindWorkerPool::addWorker(MindWorkerAccount * worker)
+{
+    m_workers.insert(std::make_pair(worker, 0));
+}
+
+/// \brief Remove a worker which is being destroyed
+///
+/// Any characters it was running minds for wait for another worker.
+void MindWorkerPool::removeWorker(MindWorkerAccount * worker)
+{
+    m_workers.erase(worker);
+    for (auto & entry : m_minds) {
+        if (entry.second.m_worker == worker) {
+            entry.second.m_worker = 0;
+            m_pending.insert(entry.first);
+        }
+    }
+}
+
+/// \brief Do the periodic work of the pool
+///
+/// Restarts worker processes which have exited, and hands characters
+/// waiting for a mind to the connected workers, spreading them evenly.
+void MindWorkerPool::idle()
+{
+    reapWorkers();
+    // Start at most one process each time, so a worker which fails at
+    // once doesn't get restarted in a tight loop.
+    if (m_processes.size() < (std::size_t)m_size) {
+        spawnWorker();
+    }
+
+    auto I = m_workers.begin();
+    while (I != m_workers.end()) {
+        if (I->first->m_connection == 0) {
+            MindWorkerAccount * worker = I->first;
+            I = m_workers.erase(I);
+            for (auto & entry : m_minds) {
+                if (entry.second.m_worker == worker) {
+                    entry.second.m_worker = 0;
+                    m_pending.insert(entry.first);
+                }
+            }
+        } else {
+            ++I;
+        }
+    }
+
+    auto J = m_pending.begin();
+    while (J != m_pending.end()) {
+        MindWorkerAccount * worker = leastLoaded();
+        if (worker == 0) {
+            break;
+        }
+        Mind & mind = m_minds[*J];
+        // Remove it from pending first, as connecting the character
+        // triggers characterLinkChanged().
+        long id = *J;
+        J = m_pending.erase(J);
+        if (worker->hostMind(*mind.m_character, mind.m_mind) != 0) {
+            // The character is controlled from elsewhere, and comes back
+            // when that link is dropped.
+            log(NOTICE, String::compose("Unable to run mind of character %1 "
+                                        "in a worker", id));
+            continue;
+        }
+        mind.m_worker = worker;
+        ++m_workers[worker];
+    }
+}
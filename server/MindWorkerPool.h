@@ -0,0 +1,128 @@
+// Cyphesis Online RPG Server and AI Engine
+// Copyright (C) 2014 Erik Ogenvik
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+
+#ifndef SERVER_MIND_WORKER_POOL_H
+#define SERVER_MIND_WORKER_POOL_H
+
+#include "rulesets/MindHost.h"
+
+#include <sigc++/connection.h>
+
+#include <map>
+#include <set>
+#include <string>
+
+#include <sys/types.h>
+
+class MindWorkerAccount;
+
+/// \brief Runs the minds of NPCs in a pool of worker processes
+///
+/// Keeps a configured number of worker processes running. Each worker
+/// connects back on the local socket with a MindWorkerAccount, and
+/// characters which need a mind are handed to the worker running the
+/// fewest minds. If a worker goes away, its characters are handed to the
+/// remaining workers.
+///
+/// Work is done from idle(), which should be called regularly, so that
+/// characters are never connected or re-homed from inside the code which
+/// tears down a connection.
+///
+/// Only processes started by the pool may log in as workers. They are
+/// given a random token in the environment, which they use as the password
+/// of their account.
+class MindWorkerPool : public MindHost {
+  protected:
+    /// \brief A character with a mind run by the pool
+    struct Mind {
+        Character * m_character;
+        Atlas::Message::MapType m_mind;
+        /// Worker running the mind, or null if it is waiting for one
+        MindWorkerAccount * m_worker;
+        sigc::connection m_linkConnection;
+        sigc::connection m_destroyedConnection;
+    };
+
+    /// \brief An instance pointer for singleton behaviour
+    static MindWorkerPool * m_instance;
+
+    /// \brief Minds of characters, keyed by character integer ID
+    std::map<long, Mind> m_minds;
+    /// \brief IDs of characters waiting for a worker
+    std::set<long> m_pending;
+    /// \brief Workers which are connected, and how many minds each runs
+    std::map<MindWorkerAccount *, std::size_t> m_workers;
+    /// \brief Worker processes started by the pool
+    std::set<pid_t> m_processes;
+    /// \brief Number of worker processes to keep running
+    int m_size;
+    /// \brief Command used to start a worker process
+    std::string m_command;
+    /// \brief Password which workers started by the pool log in with
+    std::string m_token;
+
+    explicit MindWorkerPool(int size, const std::string & command);
+    ~MindWorkerPool();
+
+    void characterLinkChanged(long id);
+    void characterDestroyed(long id);
+    void releaseMind(Mind & mind);
+    MindWorkerAccount * leastLoaded() const;
+    int spawnWorker();
+    void reapWorkers();
+  public:
+    /// \brief Create the pool and install it as the mind host
+    ///
+    /// @param size Number of worker processes to start. If zero, no
+    /// processes are started, but workers started by other means are used.
+    /// @param command Command used to start a worker process
+    static void init(int size, const std::string & command) {
+        if (m_instance == 0) {
+            m_instance = new MindWorkerPool(size, command);
+            MindHost::setInstance(m_instance);
+        }
+    }
+    static MindWorkerPool * instance() {
+        return m_instance;
+    }
+    static void del() {
+        if (m_instance != 0) {
+            delete m_instance;
+            m_instance = 0;
+        }
+    }
+
+    virtual void addMind(Character & chr,
+                         const Atlas::Message::MapType & mind);
+
+    bool checkToken(const std::string & hash) const;
+
+    void addWorker(MindWorkerAccount * worker);
+    void removeWorker(MindWorkerAccount * worker);
+
+    void idle();
+
+    /// \brief Number of characters waiting for a worker
+    std::size_t pending() const {
+        return m_pending.size();
+    }
+
+    friend class MindWorkerPooltest;
+};
+
+#endif // SERVER_MIND_WORKER_POOL_H
@@ -27,6 +27,7 @@
 #include "rulesets/MindProperty.h"
 
 #include "common/Database.h"
+#include "common/ElementEncoding.h"
 #include "common/TypeNode.h"
 #include "common/Property.h"
 #include "common/debug.h"
@@ -52,8 +53,10 @@
 
 #include <iostream>
 #include <unordered_set>
+#include <thread>
 
 using Atlas::Message::MapType;
+using Atlas::Message::ListType;
 using Atlas::Message::Element;
 
 using String::compose;
@@ -62,6 +65,115 @@ typedef Database::KeyValues KeyValues;
 
 static const bool debug_flag = false;
 
+/// Number of rows read at a time when restoring properties and thoughts.
+static const int restore_chunk_size = 10000;
+
+/// Most entity updates written in a single batch.
+static const int max_batch_updates = 5000;
+
+/// Entity updates are deferred while more queries than this are waiting.
+static const std::size_t max_queued_queries = 16;
+
+/// Rows decoded by each thread should at least be this many, to make
+/// starting the thread worth it.
+static const int min_rows_per_thread = 500;
+
+/// \brief Decode rows of a database result in parallel
+///
+/// Decoding is the most expensive part of restoring the world, so the rows
+/// are split between as many threads as the machine has cores.
+/// @param rows The number of rows.
+/// @param decodeRows Called with a range of rows to decode on each thread.
+template <typename DecodeRows>
+static void decodeInParallel(int rows, const DecodeRows & decodeRows)
+{
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::max(1, std::min(threads, rows / min_rows_per_thread));
+
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; ++i) {
+        workers.emplace_back(decodeRows, rows * i / threads,
+                             rows * (i + 1) / threads);
+    }
+    decodeRows(0, rows / threads);
+    for (auto & worker : workers) {
+        worker.join();
+    }
+}
+
+/// \brief Decode a column of Atlas encoded data in a database result
+///
+/// @param res The database result.
+/// @param column The column to decode.
+/// @param decoded Decoded data for each row is stored here.
+/// @param failed Set to true for each row which couldn't be decoded.
+static void decodeColumn(const DatabaseResult & res,
+                         const char * column,
+                         std::vector<MapType> & decoded,
+                         std::vector<char> & failed)
+{
+    int rows = res.size();
+    decoded.clear();
+    decoded.resize(rows);
+    failed.assign(rows, 0);
+
+    decodeInParallel(rows, [&](int begin, int end) {
+        Decoder decoder;
+        for (int i = begin; i < end; ++i) {
+            if (Database::decodeMessage(decoder, res.field(column, i),
+                                        decoded[i]) != 0) {
+                failed[i] = 1;
+            }
+        }
+    });
+}
+
+/// \brief Decode the property values in a database result
+///
+/// Values are read from the binary data column. Rows written by older
+/// versions only have the XML encoded value column, which is used instead.
+/// @param res The database result.
+/// @param decoded Decoded values for each row are stored here.
+/// @param failed Set to true for each row which couldn't be decoded.
+static void decodeProperties(const DatabaseResult & res,
+                             std::vector<Element> & decoded,
+                             std::vector<char> & failed)
+{
+    int rows = res.size();
+    decoded.clear();
+    decoded.resize(rows);
+    failed.assign(rows, 0);
+
+    decodeInParallel(rows, [&](int begin, int end) {
+        Decoder decoder;
+        std::string data;
+        MapType map;
+        for (int i = begin; i < end; ++i) {
+            const char * binary = res.field("data", i);
+            if (binary[0] != 0) {
+                if (Database::decodeBinary(binary, data) != 0 ||
+                    decodeElement(data.data(), data.size(),
+                                  decoded[i]) != 0) {
+                    failed[i] = 1;
+                }
+                continue;
+            }
+            map.clear();
+            if (Database::decodeMessage(decoder, res.field("value", i),
+                                        map) != 0) {
+                failed[i] = 1;
+                continue;
+            }
+            MapType::iterator J = map.find("val");
+            if (J == map.end()) {
+                failed[i] = 1;
+                continue;
+            }
+            decoded[i] = std::move(J->second);
+        }
+    });
+}
+
 StorageManager:: StorageManager(WorldRouter & world) :
         m_mindInspector(nullptr),
       m_insertEntityCount(0), m_updateEntityCount(0),
@@ -120,17 +232,15 @@ void StorageManager::entityInserted(LocatedEntity * ent)
         // This entity is not persisted.
         return;
     }
+    ent->updated.connect(sigc::bind(sigc::mem_fun(this, &StorageManager::entityUpdated), ent));
+    ent->containered.connect(sigc::bind(sigc::mem_fun(this, &StorageManager::entityContainered), ent));
     if (ent->getFlags() & (entity_clean)) {
         // This entity has just been restored from the database, so does
         // not need to be inserted, but will need to be updated.
-        // For non-restored entities that have been newly created this
-        // signal will be connected later once the initial database insert
-        // has been done.
-        ent->updated.connect(sigc::bind(sigc::mem_fun(this, &StorageManager::entityUpdated), ent));
-        ent->containered.connect(sigc::bind(sigc::mem_fun(this, &StorageManager::entityContainered), ent));
         return;
     }
-    // Queue the entity to be inserted into the persistence tables.
+    // Queue the entity to be inserted into the persistence tables. Updates
+    // are ignored while it is queued, as the insert writes everything.
     m_unstoredEntities.push_back(EntityRef(ent));
     ent->setFlags(entity_queued);
 }
@@ -173,49 +283,146 @@ bool StorageManager::persistance_characterDeleted(const std::string& entityId)
 
 void StorageManager::encodeProperty(PropertyBase * prop, std::string & store)
 {
-    Atlas::Message::MapType map;
-    prop->get(map["val"]);
-    Database::instance()->encodeObject(map, store);
+    Element val;
+    prop->get(val);
+    encodeElement(val, store);
 }
 
-void StorageManager::restorePropertiesRecursively(LocatedEntity * ent)
+int StorageManager::readEntities(RestoredEntities & restored)
 {
     Database * db = Database::instance();
-    PropertyManager * pm = PropertyManager::instance();
-    DatabaseResult res = db->selectProperties(ent->getId());
+    restored.entities = db->selectAllEntities();
+    if (restored.entities.error()) {
+        return -1;
+    }
 
-    //Keep track of those properties that have been set on the instance, so we'll know what
-    //type properties we should ignore.
-    std::unordered_set<std::string> instanceProperties;
+    std::vector<char> failed;
+    decodeColumn(restored.entities, "location", restored.locations, failed);
 
-    DatabaseResult::const_iterator I = res.begin();
-    DatabaseResult::const_iterator Iend = res.end();
-    for (; I != Iend; ++I) {
-        const std::string name = I.column("name");
-        if (name.empty()) {
-            log(ERROR, compose("No name column in property row for %1",
-                               ent->getId()));
+    int rows = restored.entities.size();
+    for (int i = 0; i < rows; ++i) {
+        const char * loc = restored.entities.field("loc", i);
+        // Only the root entity has no location.
+        if (loc[0] == 0) {
             continue;
         }
-        const std::string val_string = I.column("value");
-        if (name.empty()) {
-            log(ERROR, compose("No value column in property row for %1,%2",
-                               ent->getId(), name));
-            continue;
+        restored.children[forceIntegerId(loc)].push_back(i);
+    }
+    log(INFO, compose("Read %1 entities from storage.", rows));
+    return 0;
+}
+
+int StorageManager::readProperties(RestoredEntities & restored)
+{
+    Database * db = Database::instance();
+    if (db->openCursor("restore_properties",
+                       "SELECT id, name, value, data FROM properties") != 0) {
+        return -1;
+    }
+
+    std::vector<Element> values;
+    std::vector<char> failed;
+    int count = 0;
+    while (true) {
+        DatabaseResult res = db->fetchFromCursor("restore_properties",
+                                                 restore_chunk_size);
+        if (res.error()) {
+            db->closeCursor("restore_properties");
+            return -1;
         }
-        MapType prop_data;
-        db->decodeMessage(val_string, prop_data);
-        MapType::const_iterator J = prop_data.find("val");
-        if (J == prop_data.end()) {
-            log(ERROR, compose("No property value data for %1:%2",
-                               ent->getId(), name));
-            continue;
+        if (res.empty()) {
+            break;
+        }
+        decodeProperties(res, values, failed);
+        int rows = res.size();
+        for (int i = 0; i < rows; ++i) {
+            const std::string id = res.field("id", i);
+            const std::string name = res.field("name", i);
+            if (name.empty()) {
+                log(ERROR, compose("No name column in property row for %1",
+                                   id));
+                continue;
+            }
+            if (failed[i]) {
+                log(ERROR, compose("Property value data for %1:%2 does "
+                                   "not appear to be decodable", id, name));
+                continue;
+            }
+            restored.properties[forceIntegerId(id)].emplace_back(name,
+                                                                 values[i]);
+        }
+        count += rows;
+    }
+    log(INFO, compose("Read %1 properties from storage.", count));
+    return db->closeCursor("restore_properties");
+}
+
+int StorageManager::readThoughts(RestoredEntities & restored)
+{
+    Database * db = Database::instance();
+    if (db->openCursor("restore_thoughts",
+                       "SELECT id, thought FROM thoughts") != 0) {
+        return -1;
+    }
+
+    std::vector<MapType> thoughts;
+    std::vector<char> failed;
+    while (true) {
+        DatabaseResult res = db->fetchFromCursor("restore_thoughts",
+                                                 restore_chunk_size);
+        if (res.error()) {
+            db->closeCursor("restore_thoughts");
+            return -1;
+        }
+        if (res.empty()) {
+            break;
         }
+        decodeColumn(res, "thought", thoughts, failed);
+        int rows = res.size();
+        for (int i = 0; i < rows; ++i) {
+            const std::string id = res.field("id", i);
+            if (res.field("thought", i)[0] == 0) {
+                log(ERROR, compose("No thought column in property row for %1",
+                                   id));
+                continue;
+            }
+            if (failed[i]) {
+                log(WARNING, "Database entry does not appear to be decodable");
+            }
+            restored.thoughts[forceIntegerId(id)].push_back(thoughts[i]);
+        }
+    }
+    return db->closeCursor("restore_thoughts");
+}
+
+void StorageManager::restorePropertiesRecursively(LocatedEntity * ent,
+        const RestoredEntities & restored)
+{
+    PropertyManager * pm = PropertyManager::instance();
+
+    //Keep track of those properties that have been set on the instance, so we'll know what
+    //type properties we should ignore.
+    std::unordered_set<std::string> instanceProperties;
+
+    static const std::vector<std::pair<std::string, Element>> noProperties;
+    auto propertiesI = restored.properties.find(ent->getIntId());
+    const auto & properties = propertiesI != restored.properties.end() ?
+                              propertiesI->second : noProperties;
+
+    for (auto & property : properties) {
+        const std::string & name = property.first;
         const TypeNode * type = ent->getType();
         assert(type != 0);
-        const Element & val = J->second;
-        PropertyBase * prop = ent->modProperty(name);
+        const Element & val = property.second;
         Element existing_val;
+        //Skip values which are the same as those already on the entity or
+        //in its class, without copying the class default to the entity.
+        const PropertyBase * existing = ent->getProperty(name);
+        if (existing != 0 && existing->get(existing_val) == 0 &&
+            existing_val == val) {
+            continue;
+        }
+        PropertyBase * prop = ent->modProperty(name);
         if (prop == 0) {
             prop = pm->addProperty(name, val.getType());
             //If the property didn't exist on the entity, check if the property exists in Type defaults,
@@ -253,12 +460,14 @@ void StorageManager::restorePropertiesRecursively(LocatedEntity * ent)
     }
 
     if (ent->getType()) {
-        for (auto& propIter : ent->getType()->defaults()) {
-            if (!instanceProperties.count(propIter.first)) {
-                PropertyBase * prop = propIter.second;
+        // Defaults are applied in alphabetical order, as they are when
+        // the entity is first created.
+        for (auto propIter : ent->getType()->defaults().sorted()) {
+            if (!instanceProperties.count(propIter->first)) {
+                PropertyBase * prop = propIter->second;
                 // If a property is in the class it won't have been installed
                 // as setAttr() checks
-                prop->install(ent, propIter.first);
+                prop->install(ent, propIter->first);
                 // The property will have been applied if it has an overriden
                 // value, so we only apply it the value is still default.
                 prop->apply(ent);
@@ -270,7 +479,7 @@ void StorageManager::restorePropertiesRecursively(LocatedEntity * ent)
     //Now restore all properties of the child entities.
     if (ent->m_contains) {
         for (auto& childEntity : *ent->m_contains) {
-            restorePropertiesRecursively(childEntity);
+            restorePropertiesRecursively(childEntity, restored);
         }
     }
 
@@ -295,33 +504,16 @@ void StorageManager::restorePropertiesRecursively(LocatedEntity * ent)
         ent->m_location.m_loc->sendWorld(sight);
     }
 
-    restoreThoughts(ent);
+    restoreThoughts(ent, restored);
 
 }
 
-void StorageManager::restoreThoughts(LocatedEntity * ent)
+void StorageManager::restoreThoughts(LocatedEntity * ent,
+                                     const RestoredEntities & restored)
 {
-    Database * db = Database::instance();
-    const DatabaseResult res = db->selectThoughts(ent->getId());
-    Atlas::Message::ListType thoughts_data;
-
-    DatabaseResult::const_iterator I = res.begin();
-    DatabaseResult::const_iterator Iend = res.end();
-    for (; I != Iend; ++I) {
-        const std::string thought = I.column("thought");
-        if (thought.empty()) {
-            log(ERROR,
-                    compose("No thought column in property row for %1",
-                            ent->getId()));
-            continue;
-        }
-        MapType thought_data;
-        db->decodeMessage(thought, thought_data);
-        thoughts_data.push_back(thought_data);
-    }
-
-    if (!thoughts_data.empty()) {
-        OpVector opRes;
+    auto I = restored.thoughts.find(ent->getIntId());
+    if (I != restored.thoughts.end()) {
+        const ListType & thoughts_data = I->second;
 
         Atlas::Objects::Operation::Think thoughtOp;
         thoughtOp->setArgsAsList(thoughts_data);
@@ -370,11 +562,11 @@ void StorageManager::insertEntity(LocatedEntity * ent)
     }
     Database::instance()->encodeObject(map, location);
 
-    Database::instance()->insertEntity(ent->getId(),
-                                       ent->m_location.m_loc->getId(),
-                                       ent->getType()->name(),
-                                       ent->getSeq(),
-                                       location);
+    Database::instance()->batchInsertEntity(ent->getId(),
+                                            ent->m_location.m_loc->getId(),
+                                            ent->getType()->name(),
+                                            ent->getSeq(),
+                                            location);
     ++m_insertEntityCount;
     KeyValues property_tuples;
     const PropertyDict & properties = ent->getProperties();
@@ -389,14 +581,12 @@ void StorageManager::insertEntity(LocatedEntity * ent)
         prop->setFlags(per_clean | per_seen);
     }
     if (!property_tuples.empty()) {
-        Database::instance()->insertProperties(ent->getId(), property_tuples);
+        Database::instance()->batchWriteProperties(ent->getId(),
+                                                   property_tuples);
         ++m_insertPropertyCount;
     }
     ent->resetFlags(entity_queued);
     ent->setFlags(entity_clean | entity_pos_clean | entity_orient_clean);
-    ent->updated.connect(sigc::bind(sigc::mem_fun(this, &StorageManager::entityUpdated), ent));
-    ent->containered.connect(sigc::bind(sigc::mem_fun(this, &StorageManager::entityContainered), ent));
-
 }
 
 void StorageManager::updateEntity(LocatedEntity * ent)
@@ -410,19 +600,14 @@ void StorageManager::updateEntity(LocatedEntity * ent)
     Database::instance()->encodeObject(map, location);
 
     //Under normal circumstances only the top world won't have a location.
-    if (ent->m_location.m_loc) {
-        Database::instance()->updateEntity(ent->getId(),
-                                       ent->getSeq(),
-                                       location,
-                                       ent->m_location.m_loc->getId());
-    } else {
-        Database::instance()->updateEntityWithoutLoc(ent->getId(),
-                                       ent->getSeq(),
-                                       location);
-    }
+    Database::instance()->batchUpdateEntity(ent->getId(),
+                                            ent->getSeq(),
+                                            location,
+                                            ent->m_location.m_loc ?
+                                            ent->m_location.m_loc->getId() :
+                                            std::string());
     ++m_updateEntityCount;
-    KeyValues new_property_tuples;
-    KeyValues upd_property_tuples;
+    KeyValues property_tuples;
     const PropertyDict & properties = ent->getProperties();
     PropertyDict::const_iterator I = properties.begin();
     PropertyDict::const_iterator Iend = properties.end();
@@ -431,42 +616,82 @@ void StorageManager::updateEntity(LocatedEntity * ent)
         if (prop->flags() & per_mask) {
             continue;
         }
-        // FIXME check if this is new or just modded.
+        // New and modified properties are written the same way, but
+        // are counted separately.
         if (prop->flags() & per_seen) {
-            encodeProperty(prop, upd_property_tuples[I->first]);
             ++m_updatePropertyCount;
         } else {
-            encodeProperty(prop, new_property_tuples[I->first]);
             ++m_insertPropertyCount;
         }
+        encodeProperty(prop, property_tuples[I->first]);
         prop->setFlags(per_clean | per_seen);
     }
-    if (!new_property_tuples.empty()) {
-        Database::instance()->insertProperties(ent->getId(),
-                                               new_property_tuples);
-    }
-    if (!upd_property_tuples.empty()) {
-        Database::instance()->updateProperties(ent->getId(),
-                                               upd_property_tuples);
+    if (!property_tuples.empty()) {
+        Database::instance()->batchWriteProperties(ent->getId(),
+                                                   property_tuples);
     }
     ent->resetFlags(entity_queued);
     ent->setFlags(entity_clean);
 }
 
-void StorageManager::restoreChildren(LocatedEntity * parent)
+/// \brief Called when a batch of writes is finished
+///
+/// Entities are marked clean as they are added to a batch, so that changes
+/// made while the batch is in flight are noticed. If the batch failed,
+/// nothing in it was written, so everything in it is queued again.
+void StorageManager::batchWritten(bool ok, std::shared_ptr<WrittenBatch> batch)
 {
-    Database * db = Database::instance();
-    DatabaseResult res = db->selectEntities(parent->getId());
+    if (ok) {
+        return;
+    }
+    log(ERROR, compose("Writing %1 new and %2 modified entities to the "
+                       "database failed. They will be written again.",
+                       batch->inserted.size(), batch->updated.size()));
+    for (auto & ent : batch->inserted) {
+        if (ent.get() == 0) {
+            continue;
+        }
+        ent->resetFlags(entity_clean_mask);
+        ent->setFlags(entity_queued);
+        m_unstoredEntities.push_back(ent);
+    }
+    for (auto & ent : batch->updated) {
+        if (ent.get() == 0) {
+            continue;
+        }
+        // Which of the properties were in the batch isn't known, so all
+        // of them are written again.
+        for (auto & entry : ent->getProperties()) {
+            entry.second->resetFlags(per_clean);
+        }
+        ent->resetFlags(entity_clean);
+        if (ent->getFlags() & entity_queued) {
+            continue;
+        }
+        m_dirtyEntities.push_back(ent);
+        ent->setFlags(entity_queued);
+    }
+    for (auto & data : batch->characters) {
+        m_addedCharacters.push_back(data);
+    }
+}
+
+void StorageManager::restoreChildren(LocatedEntity * parent,
+                                     const RestoredEntities & restored)
+{
+    auto childrenI = restored.children.find(parent->getIntId());
+    if (childrenI == restored.children.end()) {
+        return;
+    }
+    const DatabaseResult & res = restored.entities;
     EntityBuilder * eb = EntityBuilder::instance();
 
-    // Iterate over res creating entities, and sorting out position, location
+    // Iterate over the rows creating entities, and sorting out position, location
     // and orientation. Restore children, but don't restore any properties yet.
-    DatabaseResult::const_iterator I = res.begin();
-    DatabaseResult::const_iterator Iend = res.end();
-    for (; I != Iend; ++I) {
-        const std::string id = I.column("id");
+    for (int row : childrenI->second) {
+        const std::string id = res.field("id", row);
         const int int_id = forceIntegerId(id);
-        const std::string type = I.column("type");
+        const std::string type = res.field("type", row);
         //By sending an empty attributes pointer we're telling the builder not to apply any default
         //attributes. We will instead apply all attributes ourselves when we later on restore attributes.
         Atlas::Objects::SmartPtr<Atlas::Objects::Entity::RootEntityData> attrs(nullptr);
@@ -478,10 +703,7 @@ void StorageManager::restoreChildren(LocatedEntity * parent)
             continue;
         }
         
-        const std::string location_string = I.column("location");
-        MapType loc_data;
-        db->decodeMessage(location_string, loc_data);
-        child->m_location.readFromMessage(loc_data);
+        child->m_location.readFromMessage(restored.locations[row]);
         if (!child->m_location.pos().isValid()) {
             std::cout << "No pos data" << std::endl << std::flush;
             log(ERROR, compose("Entity %1 restored from database has no "
@@ -492,7 +714,7 @@ void StorageManager::restoreChildren(LocatedEntity * parent)
         child->m_location.m_loc = parent;
         child->setFlags(entity_clean | entity_pos_clean | entity_orient_clean);
         BaseWorld::instance().addEntity(child);
-        restoreChildren(child);
+        restoreChildren(child, restored);
     }
 }
 
@@ -508,11 +730,14 @@ void StorageManager::tick()
         m_destroyedEntities.pop_front();
     }
 
+    std::shared_ptr<WrittenBatch> batch = std::make_shared<WrittenBatch>();
+
     while (!m_unstoredEntities.empty()) {
         const EntityRef & ent = m_unstoredEntities.front();
         if (ent.get() != 0) {
             debug( std::cout << "storing " << ent->getId() << std::endl << std::flush; );
             insertEntity(ent.get());
+            batch->inserted.push_back(ent);
             ++inserts;
         } else {
             debug( std::cout << "deleted" << std::endl << std::flush; );
@@ -522,7 +747,10 @@ void StorageManager::tick()
 
     while (!m_addedCharacters.empty()) {
         auto& data = m_addedCharacters.front();
-        Database::instance()->createRelationRow(Persistence::instance()->getCharacterAccountRelationName(), data.account_id, data.entity_id);
+        // The character may be inserted in this same batch, so the row
+        // has to go in the batch after it.
+        Database::instance()->batchCreateRelationRow(Persistence::instance()->getCharacterAccountRelationName(), data.account_id, data.entity_id);
+        batch->characters.push_back(data);
         m_addedCharacters.pop_front();
     }
 
@@ -532,21 +760,26 @@ void StorageManager::tick()
         m_deletedCharacters.pop_front();
     }
 
-    while (!m_dirtyEntities.empty()) {
-        if (Database::instance()->queryQueueSize() > 200) {
-            debug(std::cout << "Too many" << std::endl << std::flush;);
-            break;
-        }
+    // Each tick writes its changes as a single batch. If the database
+    // is falling behind, leave the dirty entities for a later batch rather
+    // than queuing more; each entity is only queued once however often it
+    // changes, so the backlog is bounded.
+    bool databaseBehind = Database::instance()->queryQueueSize() >
+                          max_queued_queries;
+    while (!m_dirtyEntities.empty() && !databaseBehind &&
+           updates < max_batch_updates) {
         const EntityRef & ent = m_dirtyEntities.front();
         if (ent.get() != 0) {
             debug( std::cout << "updating " << ent->getId() << std::endl << std::flush; );
             updateEntity(ent.get());
+            batch->updated.push_back(ent);
             ++updates;
         } else {
             debug( std::cout << "deleted" << std::endl << std::flush; );
         }
         m_dirtyEntities.pop_front();
     }
+    Database::instance()->flushBatch(sigc::bind(sigc::mem_fun(this, &StorageManager::batchWritten), batch));
     if (inserts > 0 || updates > 0) {
         debug(std::cout << "I: " << inserts << " U: " << updates
                         << std::endl << std::flush;);
@@ -626,14 +859,23 @@ int StorageManager::restoreWorld()
     log(INFO, "Starting restoring world from storage.");
     LocatedEntity * ent = &BaseWorld::instance().getRootEntity();
 
+    //Read everything up front in a few large queries, rather than querying
+    //for the children, properties and thoughts of each entity in turn.
+    RestoredEntities restored;
+    if (readEntities(restored) != 0 || readProperties(restored) != 0 ||
+        readThoughts(restored) != 0) {
+        log(ERROR, "Could not read the world from storage.");
+        return -1;
+    }
+
     //The order here is important. We want to restore the children before we restore the properties.
     //The reason for this is that some properties (such as "outfit") refer to child entities; if
     //the child isn't present when the property is installed there will be issues.
     //We do this by first restoring the children, without any properties, and the assigning the properties to
     //all entities in order.
-    restoreChildren(ent);
+    restoreChildren(ent, restored);
 
-    restorePropertiesRecursively(ent);
+    restorePropertiesRecursively(ent, restored);
 
     log(INFO, "Completed restoring world from storage.");
     return 0;
@@ -21,6 +21,7 @@
 
 #include "Persistence.h"
 
+#include "common/Database.h"
 #include "common/OperationRouter.h"
 #include "modules/EntityRef.h"
 
@@ -29,7 +30,10 @@
 #include <deque>
 #include <string>
 #include <map>
+#include <memory>
 #include <set>
+#include <unordered_map>
+#include <vector>
 
 class Entity;
 class WorldRouter;
@@ -91,18 +95,49 @@ class StorageManager : public sigc::trackable {
     void entityUpdated(LocatedEntity *);
     void entityContainered(const LocatedEntity *oldLocation, LocatedEntity *entity);
 
+    /// \brief Entity state read from the database when restoring the world.
+    struct RestoredEntities {
+        RestoredEntities() : entities(0) { }
+
+        /// \brief All rows in the entities table.
+        DatabaseResult entities;
+        /// \brief Decoded location data for each row in entities.
+        std::vector<Atlas::Message::MapType> locations;
+        /// \brief Rows in entities for the children of each entity.
+        std::unordered_map<long, std::vector<int>> children;
+        /// \brief Decoded property values for each entity.
+        std::unordered_map<long, std::vector<std::pair<std::string,
+                Atlas::Message::Element>>> properties;
+        /// \brief Decoded thoughts for each entity.
+        std::unordered_map<long, Atlas::Message::ListType> thoughts;
+    };
+
     void encodeProperty(PropertyBase *, std::string &);
-    void restorePropertiesRecursively(LocatedEntity *);
 
-    void restoreThoughts(LocatedEntity *);
+    int readEntities(RestoredEntities &);
+    int readProperties(RestoredEntities &);
+    int readThoughts(RestoredEntities &);
+
+    void restorePropertiesRecursively(LocatedEntity *,
+                                      const RestoredEntities &);
+
+    void restoreThoughts(LocatedEntity *, const RestoredEntities &);
     /// \brief Requests thoughts from the entity, if it has a mind.
     ///
     /// \return True if a thoughts query was sent.
     bool storeThoughts(LocatedEntity *);
 
+    /// \brief Writes sent to the database in a single batch.
+    struct WrittenBatch {
+        std::vector<EntityRef> inserted;
+        std::vector<EntityRef> updated;
+        std::vector<Persistence::AddCharacterData> characters;
+    };
+
     void insertEntity(LocatedEntity *);
     void updateEntity(LocatedEntity *);
-    void restoreChildren(LocatedEntity *);
+    void batchWritten(bool ok, std::shared_ptr<WrittenBatch> batch);
+    void restoreChildren(LocatedEntity *, const RestoredEntities &);
 
     /// \brief Callback for m_mindInspector when thoughts arrive.
     void thoughtsReceived(const std::string& entityId, const Operation& thoughts);
@@ -18,6 +18,8 @@
 
 #include "TrustedConnection.h"
 
+#include "MindWorkerAccount.h"
+#include "MindWorkerPool.h"
 #include "Player.h"
 #include "SystemAccount.h"
 
@@ -51,6 +53,17 @@ Account * TrustedConnection::newAccount(const std::string & type,
         return new SystemAccount(this, username, hash, id, intId);
     } else if (type == "admin") {
         return new Admin(this, username, hash, id, intId);
+    } else if (type == "mind") {
+        // Only workers started by this server may run minds.
+        MindWorkerPool * pool = MindWorkerPool::instance();
+        if (pool == 0 || !pool->checkToken(hash)) {
+            log(WARNING, String::compose("Local client tried to create "
+                                         "mind account \"%1\" without "
+                                         "the token of the mind workers.",
+                                         username));
+            return 0;
+        }
+        return new MindWorkerAccount(this, username, hash, id, intId);
     } else {
         if (type != "player") {
             log(WARNING, String::compose("Local client tried to create "
@@ -36,14 +36,19 @@
 #include "common/serialno.h"
 #include "common/compose.hpp"
 #include "common/Inheritance.h"
+#include "common/Histogram.h"
 #include "common/Monitors.h"
 #include "common/SystemTime.h"
 #include "common/Variable.h"
 #include "common/Tick.h"
+#include "common/BroadcastEncoding.h"
 
 #include <Atlas/Objects/Operation.h>
 #include <Atlas/Objects/Anonymous.h>
 
+#include <sigc++/adaptors/bind.h>
+#include <sigc++/functors/mem_fun.h>
+
 #include <sstream>
 #include <algorithm>
 
@@ -55,6 +60,17 @@ using Atlas::Objects::Entity::Anonymous;
 
 static const bool debug_flag = false;
 
+INT_OPTION(dispatch_budget, 5000, CYPHESIS, "dispatchbudget",
+           "Time in microseconds spent dispatching operations before "
+           "handling client communications");
+
+/// Resolution of the future operation queue, in seconds.
+static const double op_queue_resolution = 0.01;
+
+/// The dispatch budget may grow to this multiple of the configured budget
+/// while no client communications are pending.
+static const int max_budget_factor = 4;
+
 /**
  * \brief Acts as a RAII scoped guard for an entity.
  */
@@ -124,17 +140,35 @@ inline OpQueEntry::~OpQueEntry()
 /// but I am not clear why. Need to look into why.
 WorldRouter::WorldRouter(const SystemTime & time) :
       BaseWorld(*new World(consts::rootWorldId, consts::rootWorldIntId)),
-      m_entityCount(1), m_operation_queues_dirty(false)
-          
+      m_operationQueue(op_queue_resolution),
+      m_entityCount(1), m_operation_queues_dirty(false),
+      m_dispatchBudget(dispatch_budget),
+      m_immediateQueueDepth(0), m_operationQueueDepth(0),
+      m_suspendedQueueDepth(0), m_opsPerSecond(0), m_dispatchLatency(0),
+      m_opsThisSecond(0), m_dispatchLatencyThisSecond(0),
+      m_statisticsStart(std::chrono::steady_clock::now())
 {
     m_initTime = time.seconds();
     m_gameWorld.incRef();
     EntityBuilder::init();
     m_gameWorld.setType(Inheritance::instance().getType("world"));
     m_eobjects[m_gameWorld.getIntId()] = &m_gameWorld;
+    indexEntity(&m_gameWorld);
     m_perceptives.insert(&m_gameWorld);
     //WorldTime tmp_date("612-1-1 08:57:00");
     Monitors::instance()->watch("entities", new Variable<int>(m_entityCount));
+    Monitors::instance()->watch("world_queue_depth{queue=\"immediate\"}",
+                                new Variable<int>(m_immediateQueueDepth));
+    Monitors::instance()->watch("world_queue_depth{queue=\"future\"}",
+                                new Variable<int>(m_operationQueueDepth));
+    Monitors::instance()->watch("world_queue_depth{queue=\"suspended\"}",
+                                new Variable<int>(m_suspendedQueueDepth));
+    Monitors::instance()->watch("world_ops_per_second",
+                                new Variable<int>(m_opsPerSecond));
+    Monitors::instance()->watch("world_dispatch_latency_usec",
+                                new Variable<int>(m_dispatchLatency));
+    Monitors::instance()->watch("world_dispatch_budget_usec",
+                                new Variable<int>(m_dispatchBudget));
 }
 
 /// \brief Destructor for the world object.
@@ -151,7 +185,7 @@ WorldRouter::~WorldRouter()
     //Make sure to clear the queues first so that there's nothing referencing entities
     //in them.
     m_immediateQueue = OpQueue();
-    m_operationQueue = OpPriorityQueue();
+    m_operationQueue.clear();
     m_suspendedQueue = OpQueue();
 
     EntityDict::const_iterator Jend = m_eobjects.end();
@@ -185,7 +219,9 @@ void WorldRouter::markQueueAsClean()
 /// queue. The From attribute of the operation is set to the id of
 /// the entity that is responsible for adding the operation to the
 /// queue.
-void WorldRouter::addOperationToQueue(const Operation & op, LocatedEntity & ent)
+/// \return A handle to the queued operation if it was placed in the future
+/// queue, or zero if it is to be dispatched immediately.
+OpTimerWheel::Handle WorldRouter::addOperationToQueue(const Operation & op, LocatedEntity & ent)
 {
     assert(op.isValid());
     assert(op->getFrom() != "cheat");
@@ -195,12 +231,12 @@ void WorldRouter::addOperationToQueue(const Operation & op, LocatedEntity & ent)
     if (!op->hasAttrFlag(Atlas::Objects::Operation::FUTURE_SECONDS_FLAG)) {
         op->setSeconds(getTime());
         m_immediateQueue.push(OpQueEntry(op, ent));
-        return;
+        return 0;
     }
     double t = getTime() + op->getFutureSeconds();
     op->setSeconds(t);
     op->setFutureSeconds(0.);
-    m_operationQueue.push(OpQueEntry(op, ent));
+    return m_operationQueue.insert(t, OpQueEntry(op, ent));
 }
 
 /// \brief Add a new entity to the world.
@@ -215,8 +251,12 @@ LocatedEntity * WorldRouter::addEntity(LocatedEntity * ent)
     debug(std::cout << "WorldRouter::addEntity(" << ent->getIntId() << ")" << std::endl
                     << std::flush;);
     assert(ent->getIntId() != 0);
+    bool is_new = m_eobjects.find(ent->getIntId()) == m_eobjects.end();
     m_eobjects[ent->getIntId()] = ent;
     ++m_entityCount;
+    if (is_new) {
+        indexEntity(ent);
+    }
     assert(ent->m_location.isValid());
 
     if (!ent->m_location.isValid()) {
@@ -248,6 +288,10 @@ LocatedEntity * WorldRouter::addEntity(LocatedEntity * ent)
     //check that the child wasn't already present
     if (child_inserted) {
         ent->m_location.m_loc->incRef();
+        Domain* parentDomain = ent->m_location.m_loc->getMovementDomain();
+        if (parentDomain) {
+            parentDomain->addEntity(*ent);
+        }
     }
     // FIXME Should we call this every time a new child is inserted (now it's just called if the container is empty first
     if (cont_change) {
@@ -445,6 +489,7 @@ void WorldRouter::delEntity(LocatedEntity * ent)
     assert(ent->getIntId() != 0);
     m_perceptives.erase(ent);
     m_eobjects.erase(ent->getIntId());
+    unindexEntity(ent);
     --m_entityCount;
     ent->destroy();
     ent->updated.emit();
@@ -475,6 +520,23 @@ void WorldRouter::message(const Operation & op, LocatedEntity & ent)
                     << std::flush;);
 }
 
+/// \brief Pass an operation to the World, getting a handle to cancel it.
+///
+/// Only operations scheduled for the future can be cancelled.
+std::uint64_t WorldRouter::scheduleOperation(const Operation & op,
+                                             LocatedEntity & ent)
+{
+    return addOperationToQueue(op, ent);
+}
+
+/// \brief Remove an operation from the future queue before it is dispatched.
+void WorldRouter::cancelOperation(std::uint64_t handle)
+{
+    if (handle != 0) {
+        m_operationQueue.cancel(handle);
+    }
+}
+
 /// \brief Determine the broadcast list to be used to broadcast an operation.
 ///
 /// Check the type of operation, and work out which list of entities
@@ -516,6 +578,8 @@ void WorldRouter::deliverTo(const Operation & op, LocatedEntity & ent)
             return;
         }
     }
+    typedef std::chrono::steady_clock clock;
+    clock::time_point start = clock::now();
     OpVector res;
     ent.operation(op, res);
     OpVector::const_iterator Iend = res.end();
@@ -527,6 +591,9 @@ void WorldRouter::deliverTo(const Operation & op, LocatedEntity & ent)
         }
         message(*I, ent);
     }
+    deliverHistogram(op, ent)->record(
+          std::chrono::duration_cast<std::chrono::microseconds>(
+                clock::now() - start).count());
 }
 
 /// \brief Main in-game operation dispatch function.
@@ -579,11 +646,27 @@ void WorldRouter::operation(const Operation & op, LocatedEntity & from)
     } else if (broadcastPerception(op)) {
         auto fromDomain = from.getMovementDomain();
         if (fromDomain) {
+            // Only TO differs between the copies sent to observers, so the
+            // op need only be encoded once for all the clients among them.
+            BroadcastEncoding broadcast;
             // Where broadcasts go depends on type of op
-            for (auto& entity : m_perceptives) {
-                if (fromDomain->isEntityVisibleFor(*entity, from)) {
-                    op->setTo(entity->getId());
-                    deliverTo(op, *entity);
+            std::vector<LocatedEntity*> observers;
+            if (fromDomain->findObserverCandidates(from, observers)) {
+                // The domain has narrowed down which entities are close
+                // enough to possibly see the op.
+                for (auto& entity : observers) {
+                    if (m_perceptives.find(entity) != m_perceptives.end() &&
+                        fromDomain->isEntityVisibleFor(*entity, from)) {
+                        op->setTo(entity->getId());
+                        deliverTo(op, *entity);
+                    }
+                }
+            } else {
+                for (auto& entity : m_perceptives) {
+                    if (fromDomain->isEntityVisibleFor(*entity, from)) {
+                        op->setTo(entity->getId());
+                        deliverTo(op, *entity);
+                    }
                 }
             }
         }
@@ -608,58 +691,174 @@ void WorldRouter::addPerceptive(LocatedEntity * perceptive)
     m_perceptives.insert(perceptive);
 }
 
+/// Main world loop function, when nothing is known about client traffic.
+bool WorldRouter::idle()
+{
+    return idle(false);
+}
+
 /// Main world loop function.
 /// This function is called whenever the communications code is idle.
 /// It updates the in-game time, and dispatches operations that are
-/// now due for dispatch. The number of operations dispatched is limited
-/// to 10 to ensure that client communications are always handled in a timely
-/// manner. If the maximum number of operations are dispatched, the return 
-/// value indicates that this is the case, and the communications code
-/// will call this function again as soon as possible rather than sleeping.
+/// now due for dispatch. Operations are dispatched until a time budget
+/// runs out, to ensure that client communications are always handled in a
+/// timely manner. The budget is the configured "dispatchbudget" while
+/// there is client traffic pending, and is allowed to grow while the
+/// queues are backed up and the clients are quiet. If the budget runs out
+/// before all due operations are dispatched, the return value indicates
+/// that this is the case, and the communications code will call this
+/// function again as soon as possible rather than sleeping.
 /// This ensures that the maximum possible number of operations are dispatched
 /// without becoming unresponsive to client communications traffic.
-bool WorldRouter::idle()
+/// @param ioPending True if client communications were handled since the
+/// last call.
+bool WorldRouter::idle(bool ioPending)
 {
-	unsigned int op_count = 0;
-    while (op_count < 10 && !m_immediateQueue.empty()) {
-        ++op_count;
+    typedef std::chrono::steady_clock clock;
+    clock::time_point start = clock::now();
+    clock::time_point deadline = start + std::chrono::microseconds(m_dispatchBudget);
+
+    clock::time_point now = start;
+    // Always dispatch at least one op, so that the world makes progress
+    // even with a very small budget.
+    while (!m_immediateQueue.empty()) {
         dispatchOperation(m_immediateQueue.front());
         m_immediateQueue.pop();
-    }
-
-    //If there still are immediate ops to deliver we are absolutely busy.
-    if (!m_immediateQueue.empty()) {
-        return true;
+        ++m_opsThisSecond;
+        now = clock::now();
+        if (now >= deadline) {
+            break;
+        }
     }
 
     double realtime = getTime();
-    while (op_count < 10 && !m_operationQueue.empty() && m_operationQueue.top()->getSeconds() <= realtime) {
-        ++op_count;
-        dispatchOperation(m_operationQueue.top());
-        m_operationQueue.pop();
+    if (m_immediateQueue.empty() && now < deadline) {
+        while (m_operationQueue.hasDue(realtime)) {
+            int lateness = (int)((realtime - m_operationQueue.topTime()) * 1000000);
+            m_dispatchLatencyThisSecond = std::max(m_dispatchLatencyThisSecond, lateness);
+            // Take a copy, as dispatching may add to the queue.
+            OpQueEntry entry(m_operationQueue.top());
+            m_operationQueue.pop();
+            dispatchOperation(entry);
+            ++m_opsThisSecond;
+            now = clock::now();
+            if (now >= deadline) {
+                break;
+            }
+        }
     }
 
     // If there are still immediate or regular ops to deliver return true
     // to tell the server not to sleep when polling clients. This ensures
     // that we keep processing ops at a the maximum rate without leaving
     // clients unattended.
-    if (!m_immediateQueue.empty() || (!m_operationQueue.empty() && m_operationQueue.top()->getSeconds() <= realtime)) {
-        return true;
+    bool busy = !m_immediateQueue.empty() || m_operationQueue.hasDue(realtime);
+
+    // Adapt the budget for the next call. Client traffic brings it back
+    // towards the configured budget, to keep communications responsive,
+    // while a backlog with no client traffic lets it grow so that fewer
+    // polls are needed to work through the queues.
+    int base_budget = std::max(dispatch_budget, 1);
+    if (ioPending) {
+        m_dispatchBudget = std::max(base_budget, m_dispatchBudget / 2);
+    } else if (busy) {
+        m_dispatchBudget = std::min(base_budget * max_budget_factor, m_dispatchBudget * 2);
     } else {
-        return false;
+        m_dispatchBudget = base_budget;
+    }
+
+    updateStatistics(now);
+
+    return busy;
+}
+
+/// \brief Update the values exposed through monitors.
+///
+/// Queue depths are updated on every call, while the op rate and
+/// dispatch latency are published once per second.
+void WorldRouter::updateStatistics(const std::chrono::steady_clock::time_point & now)
+{
+    m_immediateQueueDepth = (int)m_immediateQueue.size();
+    m_operationQueueDepth = (int)m_operationQueue.size();
+    m_suspendedQueueDepth = (int)m_suspendedQueue.size();
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - m_statisticsStart).count();
+    if (elapsed >= 1000000) {
+        m_opsPerSecond = (int)(((long long)m_opsThisSecond * 1000000) / elapsed);
+        m_dispatchLatency = m_dispatchLatencyThisSecond;
+        m_opsThisSecond = 0;
+        m_dispatchLatencyThisSecond = 0;
+        m_statisticsStart = now;
     }
 }
 
 double WorldRouter::secondsUntilNextOp() const {
-    if (m_operationQueue.empty()) {
+    double nextTime;
+    if (!m_operationQueue.nextTime(nextTime)) {
         //600 is a fairly large number of seconds
         return 600.0;
     }
-    return m_operationQueue.top()->getSeconds() - getTime();
+    return nextTime - getTime();
+}
+
+/// \brief Get the name of the type of an op, for keying and labelling
+/// histograms
+///
+/// Ops of types defined by the rules all have the same class number, so
+/// the name is used to tell them apart.
+static const std::string & opLabel(const Operation & op)
+{
+    static const std::string unknown("unknown");
+    const std::list<std::string> & parents = op->getParents();
+    return parents.empty() ? unknown : parents.front();
+}
+
+/// \brief Get the histograms for the type of an op
+///
+/// The histograms are created and handed to the monitors the first time
+/// an op of the type is dispatched.
+WorldRouter::OpHistograms & WorldRouter::opHistograms(const Operation & op)
+{
+    const std::string & label = opLabel(op);
+    auto I = m_opHistograms.find(label);
+    if (I == m_opHistograms.end()) {
+        OpHistograms histograms;
+        histograms.m_dispatch = Monitors::instance()->histogram(
+              String::compose("world_op_dispatch_usec{op=\"%1\"}", label));
+        histograms.m_wait = Monitors::instance()->histogram(
+              String::compose("world_op_queue_wait_usec{op=\"%1\"}", label));
+        I = m_opHistograms.insert(std::make_pair(label, histograms)).first;
+    }
+    return I->second;
+}
+
+/// \brief Get the histogram for delivering a type of op to an entity type
+Histogram * WorldRouter::deliverHistogram(const Operation & op,
+                                          const LocatedEntity & ent)
+{
+    std::map<const TypeNode *, Histogram *> & histograms =
+          opHistograms(op).m_deliver;
+    auto I = histograms.find(ent.getType());
+    if (I == histograms.end()) {
+        std::string type = ent.getType() ? ent.getType()->name() : "none";
+        Histogram * histogram = Monitors::instance()->histogram(
+              String::compose("world_op_deliver_usec{op=\"%1\",type=\"%2\"}",
+                              opLabel(op), type));
+        I = histograms.insert(std::make_pair(ent.getType(), histogram)).first;
+    }
+    return I->second;
 }
 
 void WorldRouter::dispatchOperation(const OpQueEntry& oqe)
 {
+    typedef std::chrono::steady_clock clock;
+    OpHistograms & histograms = opHistograms(oqe.op);
+    if (!oqe->isDefaultSeconds()) {
+        long wait = (long)((getTime() - oqe->getSeconds()) * 1000000);
+        histograms.m_wait->record(std::max(0L, wait));
+    }
+    clock::time_point start = clock::now();
+
     Dispatching.emit(oqe.op);
     try {
         operation(oqe.op, *oqe.from);
@@ -676,42 +875,151 @@ void WorldRouter::dispatchOperation(const OpQueEntry& oqe)
                                    "sent to \"%1\" from \"%2\"",
                                    oqe->getTo(), oqe->getFrom()));
     }
+    histograms.m_dispatch->record(
+          std::chrono::duration_cast<std::chrono::microseconds>(
+                clock::now() - start).count());
 }
 
 
+/// \brief Add an entity to the name and type indexes
+///
+/// The entity is watched so that the name index follows changes to its
+/// name.
+void WorldRouter::indexEntity(LocatedEntity * ent)
+{
+    const TypeNode * type = ent->getType();
+    if (type != 0) {
+        m_typeIndex[type][ent->getIntId()] = ent;
+    }
+    indexName(ent);
+    ent->updated.connect(sigc::bind(sigc::mem_fun(this, &WorldRouter::entityUpdated), ent));
+}
+
+/// \brief Remove an entity from the name and type indexes
+void WorldRouter::unindexEntity(LocatedEntity * ent)
+{
+    auto I = m_typeIndex.find(ent->getType());
+    if (I != m_typeIndex.end()) {
+        I->second.erase(ent->getIntId());
+        if (I->second.empty()) {
+            m_typeIndex.erase(I);
+        }
+    }
+    unindexName(ent);
+}
+
+/// \brief Store an entity in the name index under its current name
+void WorldRouter::indexName(LocatedEntity * ent)
+{
+    std::string name;
+    Element name_attr;
+    if (ent->getAttrType("name", name_attr, Element::TYPE_STRING) == 0) {
+        name = name_attr.String();
+    }
+    auto I = m_indexedNames.find(ent);
+    if (I != m_indexedNames.end()) {
+        if (I->second == name) {
+            return;
+        }
+        unindexName(ent);
+    }
+    if (!name.empty()) {
+        m_nameIndex[name][ent->getIntId()] = ent;
+        m_indexedNames[ent] = name;
+    }
+}
+
+void WorldRouter::unindexName(LocatedEntity * ent)
+{
+    auto I = m_indexedNames.find(ent);
+    if (I == m_indexedNames.end()) {
+        return;
+    }
+    auto J = m_nameIndex.find(I->second);
+    if (J != m_nameIndex.end()) {
+        J->second.erase(ent->getIntId());
+        if (J->second.empty()) {
+            m_nameIndex.erase(J);
+        }
+    }
+    m_indexedNames.erase(I);
+}
+
+/// \brief Called when an entity in the world is modified
+void WorldRouter::entityUpdated(LocatedEntity * ent)
+{
+    if (ent->isDestroyed()) {
+        return;
+    }
+    indexName(ent);
+}
+
 /// Find an entity of the given name. This is provided to allow administrators
-/// to perform certain admin tasks. It finds and returns the first instance
-/// with the name provided in the game world.
+/// to perform certain admin tasks. It finds and returns the instance with the
+/// lowest ID with the name provided in the game world.
 /// @param name string specifying name of the instance required.
 /// @return a pointer to an entity with the type required, or zero if an
 /// instance with this name was not found.
 LocatedEntity * WorldRouter::findByName(const std::string & name)
 {
-    Element name_attr;
-    EntityDict::const_iterator Iend = m_eobjects.end();
-    for (EntityDict::const_iterator I = m_eobjects.begin(); I != Iend; ++I) {
-        if (I->second->getAttr("name", name_attr) == 0) {
-            if (name_attr == name) {
-                return I->second;
-            }
-        }
+    auto I = m_nameIndex.find(name);
+    if (I == m_nameIndex.end()) {
+        return NULL;
     }
-    return NULL;
+    return I->second.begin()->second;
 }
 
 /// Find an entity of the given type. This is provided to allow administrators
-/// to perform certain admin tasks. It finds and returns the first instance
-/// of the type provided in the game world.
+/// to perform certain admin tasks. It finds and returns the instance with the
+/// lowest ID of exactly the type provided in the game world.
 /// @param type string specifying the class name of the instance required.
 /// @return a pointer to an entity of the type required, or zero if no
 /// instance was found.
 LocatedEntity * WorldRouter::findByType(const std::string & type)
 {
-    EntityDict::const_iterator Iend = m_eobjects.end();
-    for(EntityDict::const_iterator I = m_eobjects.begin(); I != Iend; ++I) {
-        if (I->second->getType()->name() == type) {
-            return I->second;
+    auto I = m_typeIndex.find(Inheritance::instance().getType(type));
+    if (I == m_typeIndex.end()) {
+        return NULL;
+    }
+    return I->second.begin()->second;
+}
+
+/// \brief Find all the entities with the given name
+///
+/// @return the entities, in order of ID.
+EntityVector WorldRouter::findAllByName(const std::string & name) const
+{
+    EntityVector res;
+    auto I = m_nameIndex.find(name);
+    if (I != m_nameIndex.end()) {
+        res.reserve(I->second.size());
+        for (auto & entry : I->second) {
+            res.push_back(entry.second);
+        }
+    }
+    return res;
+}
+
+/// \brief Find all the entities of the given type
+///
+/// @param type the class name of the instances required.
+/// @param subtypes if true, instances of types which inherit from it are
+/// included as well.
+EntityVector WorldRouter::findAllByType(const std::string & type,
+                                        bool subtypes) const
+{
+    EntityVector res;
+    const TypeNode * base = Inheritance::instance().getType(type);
+    if (base == 0) {
+        return res;
+    }
+    for (auto & entry : m_typeIndex) {
+        if (entry.first == base ||
+            (subtypes && entry.first->isTypeOf(base))) {
+            for (auto & ent : entry.second) {
+                res.push_back(ent.second);
+            }
         }
     }
-    return NULL;
+    return res;
 }
@@ -20,18 +20,25 @@
 #define SERVER_WORLD_ROUTER_H
 
 #include "common/BaseWorld.h"
+#include "common/TimerWheel.h"
+
+#include <sigc++/trackable.h>
 
 #include <list>
 #include <set>
 #include <queue>
+#include <chrono>
+#include <unordered_map>
 
 
+class Histogram;
+class TypeNode;
 class Spawn;
 
 struct OpQueEntry;
 
 typedef std::queue<OpQueEntry> OpQueue;
-typedef std::priority_queue<OpQueEntry, std::vector<OpQueEntry>, std::greater<OpQueEntry> > OpPriorityQueue;
+typedef TimerWheel<OpQueEntry> OpTimerWheel;
 typedef std::set<LocatedEntity *> EntitySet;
 typedef std::map<std::string, std::pair<Spawn *, std::string>> SpawnDict;
 
@@ -40,10 +47,10 @@ typedef std::map<std::string, std::pair<Spawn *, std::string>> SpawnDict;
 /// This class has one instance which manages the game world.
 /// It maintains a list of all ih-game (IG) objects in the server.
 /// It explicitly also maintains lists of perceptive entities.
-class WorldRouter : public BaseWorld {
+class WorldRouter : public BaseWorld, public sigc::trackable {
   private:
     /// An ordered queue of operations to be dispatched in the future
-    OpPriorityQueue m_operationQueue;
+    OpTimerWheel m_operationQueue;
     /// An ordered queue of operations to be dispatched now
     OpQueue m_immediateQueue;
     /// An ordered queue of suspended operations to be dispatched when resumed.
@@ -56,9 +63,55 @@ class WorldRouter : public BaseWorld {
     SpawnDict m_spawns;
     /// Keeps track of if the operation queues are dirty.
     bool m_operation_queues_dirty;
+    /// Current time budget for dispatching ops in idle(), in microseconds.
+    int m_dispatchBudget;
+    /// Number of ops in the immediate queue, for monitoring.
+    int m_immediateQueueDepth;
+    /// Number of ops in the future queue, for monitoring.
+    int m_operationQueueDepth;
+    /// Number of ops in the suspended queue, for monitoring.
+    int m_suspendedQueueDepth;
+    /// Number of ops dispatched during the last full second.
+    int m_opsPerSecond;
+    /// Worst lateness of a future op during the last full second, in microseconds.
+    int m_dispatchLatency;
+    /// Number of ops dispatched so far in the current second.
+    int m_opsThisSecond;
+    /// Worst lateness of a future op so far in the current second.
+    int m_dispatchLatencyThisSecond;
+    /// Start of the current second of op statistics.
+    std::chrono::steady_clock::time_point m_statisticsStart;
+
+    /// \brief Histograms kept for each type of op
+    struct OpHistograms {
+        /// Time taken to dispatch the op, in microseconds.
+        Histogram * m_dispatch;
+        /// Time the op spent queued before dispatch, in microseconds.
+        Histogram * m_wait;
+        /// Time taken to deliver the op, by receiving type.
+        std::map<const TypeNode *, Histogram *> m_deliver;
+    };
+    /// Histograms for each type of op, by type name.
+    std::map<std::string, OpHistograms> m_opHistograms;
+    /// Entities with each name, by integer ID.
+    std::unordered_map<std::string, EntityDict> m_nameIndex;
+    /// Name each entity is stored under in the name index.
+    std::unordered_map<const LocatedEntity *, std::string> m_indexedNames;
+    /// Entities of each type, by integer ID.
+    std::unordered_map<const TypeNode *, EntityDict> m_typeIndex;
+
+    void updateStatistics(const std::chrono::steady_clock::time_point & now);
+    OpHistograms & opHistograms(const Atlas::Objects::Operation::RootOperation &);
+    Histogram * deliverHistogram(const Atlas::Objects::Operation::RootOperation &,
+                                 const LocatedEntity &);
+    void indexEntity(LocatedEntity *);
+    void unindexEntity(LocatedEntity *);
+    void indexName(LocatedEntity *);
+    void unindexName(LocatedEntity *);
+    void entityUpdated(LocatedEntity *);
   protected:
-    void addOperationToQueue(const Atlas::Objects::Operation::RootOperation &,
-                             LocatedEntity &);
+    OpTimerWheel::Handle addOperationToQueue(const Atlas::Objects::Operation::RootOperation &,
+                                             LocatedEntity &);
     bool broadcastPerception(const Atlas::Objects::Operation::RootOperation &) const;
     void deliverTo(const Atlas::Objects::Operation::RootOperation &,
                    LocatedEntity &);
@@ -73,6 +126,7 @@ class WorldRouter : public BaseWorld {
     virtual ~WorldRouter();
 
     bool idle();
+    bool idle(bool ioPending);
 
     /**
      * Gets the number of seconds until the next operation needs to be dispatched.
@@ -105,8 +159,14 @@ class WorldRouter : public BaseWorld {
     virtual void addPerceptive(LocatedEntity *);
     virtual void message(const Atlas::Objects::Operation::RootOperation &,
                          LocatedEntity &);
+    virtual std::uint64_t scheduleOperation(const Atlas::Objects::Operation::RootOperation &,
+                                            LocatedEntity &);
+    virtual void cancelOperation(std::uint64_t handle);
     virtual LocatedEntity * findByName(const std::string & name);
     virtual LocatedEntity * findByType(const std::string & type);
+    virtual EntityVector findAllByName(const std::string & name) const;
+    virtual EntityVector findAllByType(const std::string & type,
+                                       bool subtypes = true) const;
 
     /**
      * @brief Checks if the operation queues have been marked as dirty.
@@ -22,6 +22,7 @@
 #include "CommHttpClient.h"
 #include "CommPythonClient.h"
 #include "CommPSQLSocket.h"
+#include "DatabaseMaintenance.h"
 #include "CommMetaClient.h"
 #include "CommMDNSPublisher.h"
 #include "CommAsioListener_impl.h"
@@ -38,8 +39,11 @@
 #include "Admin.h"
 #include "TeleportAuthenticator.h"
 #include "TrustedConnection.h"
+#include "MindWorkerPool.h"
 
 #include "rulesets/Python_API.h"
+#include "rulesets/Character.h"
+#include "rulesets/TerrainSegmentCache.h"
 #include "rulesets/LocatedEntity.h"
 
 #include "common/id.h"
@@ -92,6 +96,30 @@ STRING_OPTION(mserver, "metaserver.worldforge.org", CYPHESIS, "metaserver",
         "Hostname to use as the metaserver")
 ;
 
+INT_OPTION(mind_workers, 0, CYPHESIS, "mindworkers",
+        "Number of worker processes to run NPC minds in, or zero to run "
+        "them in the server")
+;
+
+BOOL_OPTION(suspend_shadow_minds, true, CYPHESIS, "suspendshadowminds",
+        "Flag to control whether the NPC mind of a character stops running "
+        "while a client controls it")
+;
+
+STRING_OPTION(mind_worker_command, "cyaiclient", CYPHESIS, "mindworkercommand",
+        "Command used to start a mind worker process")
+;
+
+INT_OPTION(terrain_threads, 2, CYPHESIS, "terrainthreads",
+        "Number of threads populating terrain segments ahead of use, or zero "
+        "to populate them when they are first used")
+;
+
+INT_OPTION(terrain_cache_size, 256, CYPHESIS, "terraincache",
+        "Megabytes of populated terrain to keep in memory, or zero for no "
+        "limit")
+;
+
 // Keep a reference to the global io_service so that it can be awoken
 // in our signals callback.
 boost::asio::io_service* sGlobalIoService = nullptr;
@@ -152,6 +180,12 @@ int main(int argc, char ** argv)
 
     readConfigItem(instance, "usedatabase", database_flag);
 
+    Character::s_suspendShadowMind = suspend_shadow_minds;
+    TerrainSegmentCache::s_threads = terrain_threads;
+    if (terrain_cache_size > 0) {
+        TerrainSegmentCache::s_budget = (std::size_t)terrain_cache_size << 20;
+    }
+
     // If we are a daemon logging to syslog, we need to set it up.
     initLogger();
 
@@ -223,6 +257,16 @@ int main(int argc, char ** argv)
 
     TeleportAuthenticator::init();
 
+    // The pool must be in place before the world is restored, so that it
+    // is handed the minds of restored characters.
+    IdleConnector* mind_idle = nullptr;
+    if (mind_workers > 0) {
+        MindWorkerPool::init(mind_workers, mind_worker_command);
+        mind_idle = new IdleConnector(*io_service);
+        mind_idle->idling.connect(sigc::mem_fun(MindWorkerPool::instance(),
+                &MindWorkerPool::idle));
+    }
+
     StorageManager * store = new StorageManager(*world);
 
     // This ID is currently generated every time, but should perhaps be
@@ -250,6 +294,7 @@ int main(int argc, char ** argv)
     IdleConnector* storage_idle = nullptr;
 
     CommPSQLSocket * dbsocket = nullptr;
+    DatabaseMaintenance * dbmaintenance = nullptr;
     if (database_flag) {
         // log(INFO, _("Restoring world from database..."));
 
@@ -265,6 +310,10 @@ int main(int argc, char ** argv)
         dbsocket = new CommPSQLSocket(*io_service,
                 Persistence::instance()->m_db);
 
+        dbmaintenance = new DatabaseMaintenance(*io_service,
+                Persistence::instance()->m_db);
+        dbmaintenance->start();
+
         storage_idle = new IdleConnector(*io_service);
         storage_idle->idling.connect(
                 sigc::mem_fun(store, &StorageManager::tick));
@@ -467,21 +516,23 @@ int main(int argc, char ** argv)
     boost::asio::deadline_timer softExitTimer(*io_service);
     // Loop until the exit flag is set. The exit flag can be set anywhere in
     // the code easily.
+    //Keeps track of whether any io handlers were run since the world was last idled.
+    bool ioPending = false;
     while (!exit_flag) {
         try {
             time.update();
-            bool busy = world->idle();
+            bool busy = world->idle(ioPending);
             world->markQueueAsClean();
             //If the world is busy we should just poll.
             if (busy) {
-                io_service->poll();
+                ioPending = io_service->poll() > 0;
             } else {
                 //If it's not busy however we should run until we get a task.
                 //We will either get an io task, or we will be triggered by the timer
                 //which is set to expire when the next op should be dispatched.
                 double secondsUntilNextOp = world->secondsUntilNextOp();
                 if (secondsUntilNextOp <= 0.0) {
-                    io_service->poll();
+                    ioPending = io_service->poll() > 0;
                 } else {
                     bool nextOpTimeExpired = false;
                     boost::posix_time::microseconds waitTime((long long)(secondsUntilNextOp * 1000000));
@@ -497,6 +548,8 @@ int main(int argc, char ** argv)
                         io_service->run_one();
                     } while (!world->isQueueDirty() && !nextOpTimeExpired &&
                             !exit_flag_soft && !exit_flag && !soft_exit_in_progress);
+                    //If we were woken by anything other than the timer it was client traffic.
+                    ioPending = !nextOpTimeExpired;
                     nextOpTimer.cancel();
                 }
             }
@@ -582,6 +635,8 @@ int main(int argc, char ** argv)
     tcp_atlas_clients.clear();
 
     delete storage_idle;
+    delete mind_idle;
+    delete dbmaintenance;
 
     delete io_service;
 
@@ -599,6 +654,7 @@ int main(int argc, char ** argv)
     EntityBuilder::del();
     ArithmeticBuilder::del();
     TeleportAuthenticator::del();
+    MindWorkerPool::del();
 
     Inheritance::clear();
 
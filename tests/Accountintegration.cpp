@@ -399,6 +399,7 @@ LocatedEntity * TestWorld::addNewEntity(const std::string &,
 #include "common/const.h"
 #include "common/globals.h"
 #include "common/log.h"
+#include "common/Histogram.h"
 #include "common/Monitors.h"
 #include "common/PropertyFactory.h"
 #include "common/system.h"
@@ -1175,6 +1176,13 @@ bool_config_register::bool_config_register(bool & var,
 {
 }
 
+int_config_register::int_config_register(int & var,
+                                         const char * section,
+                                         const char * setting,
+                                         const char * help)
+{
+}
+
 CommSocket::CommSocket(boost::asio::io_service & svr) : m_io_service(svr) { }
 
 CommSocket::~CommSocket()
@@ -1308,6 +1316,11 @@ void Monitors::watch(const::std::string & name, VariableBase * monitor)
 {
 }
 
+Histogram * Monitors::histogram(const std::string & name)
+{
+    return new Histogram;
+}
+
 Shaker::Shaker()
 {
 }
@@ -1326,6 +1339,11 @@ bool TypeNode::isTypeOf(const std::string & base_type) const
     return false;
 }
 
+bool TypeNode::isTypeOf(const TypeNode * base_type) const
+{
+    return false;
+}
+
 void TypeNode::addProperties(const Atlas::Message::MapType & attributes)
 {
 }
@@ -187,14 +187,22 @@ LocatedEntity * BaseWorld::getEntity(long id) const
     return 0;
 }
 
-TypeNode::TypeNode(const std::string & name) : m_name(name), m_parent(0)
+TypeNode::TypeNode(const std::string & name) : m_name(name), m_parent(0),
+                                                m_typeId(-1),
+                                                m_intervalStart(-1),
+                                                m_intervalFree(-1),
+                                                m_intervalEnd(-1)
 {
 }
 
 TypeNode::TypeNode(const std::string & name,
                    const Atlas::Objects::Root & d) : m_name(name),
                                                      m_description(d),
-                                                     m_parent(0)
+                                                     m_parent(0),
+                                                     m_typeId(-1),
+                                                     m_intervalStart(-1),
+                                                     m_intervalFree(-1),
+                                                     m_intervalEnd(-1)
 {
 }
 
@@ -30,6 +30,7 @@
 #include "rulesets/Character.h"
 
 #include "rulesets/AtlasProperties.h"
+#include "rulesets/BaseMind.h"
 #include "rulesets/BBoxProperty.h"
 #include "rulesets/Domain.h"
 #include "rulesets/EntityProperty.h"
@@ -42,6 +43,7 @@
 #include "rulesets/Task.h"
 #include "rulesets/TasksProperty.h"
 
+#include "common/compose.hpp"
 #include "common/const.h"
 #include "common/id.h"
 #include "common/log.h"
@@ -72,8 +74,12 @@
 #include "stubs/rulesets/stubLocatedEntity.h"
 #include "stubs/rulesets/stubMovement.h"
 #include "stubs/rulesets/stubDomain.h"
+#include "stubs/rulesets/stubBaseMind.h"
+#include "stubs/rulesets/stubMemEntity.h"
 
+#include <algorithm>
 #include <cstdlib>
+#include <set>
 
 #include <cassert>
 
@@ -99,11 +105,30 @@ class TestLink : public Link
     }
 };
 
+class TestMind : public BaseMind
+{
+  public:
+    int m_operations;
+
+    TestMind(const std::string & id, long iid) :
+        BaseMind(id, iid), m_operations(0)
+    {
+    }
+
+    virtual void operation(const Operation &, OpVector &)
+    {
+        ++m_operations;
+    }
+};
+
+static int stub_ExternalMind_operation_count = 0;
+
 class Charactertest : public Cyphesis::TestBase
 {
   private:
     static Operation m_BaseWorld_message_called;
     static LocatedEntity * m_BaseWorld_message_called_from;
+    static std::vector<Operation> m_BaseWorld_messages;
 
     Character * m_character;
     TypeNode * m_type;
@@ -123,18 +148,21 @@ class Charactertest : public Cyphesis::TestBase
     void test_unlinkExternal_unlinked();
     void test_unlinkExternal_nomind();
     void test_filterExternalOperation();
+    void test_sendMind_suspended();
 
     static void BaseWorld_message_called(const Operation & op, LocatedEntity &);
 };
 
 Operation Charactertest::m_BaseWorld_message_called(0);
 LocatedEntity * Charactertest::m_BaseWorld_message_called_from(0);
+std::vector<Operation> Charactertest::m_BaseWorld_messages;
 
 void Charactertest::BaseWorld_message_called(const Operation & op,
                                              LocatedEntity & ent)
 {
     m_BaseWorld_message_called = op;
     m_BaseWorld_message_called_from = &ent;
+    m_BaseWorld_messages.push_back(op);
 }
 
 Charactertest::Charactertest()
@@ -149,6 +177,7 @@ Charactertest::Charactertest()
     ADD_TEST(Charactertest::test_unlinkExternal_unlinked);
     ADD_TEST(Charactertest::test_unlinkExternal_nomind);
     ADD_TEST(Charactertest::test_filterExternalOperation);
+    ADD_TEST(Charactertest::test_sendMind_suspended);
 }
 
 void Charactertest::setup()
@@ -159,6 +188,8 @@ void Charactertest::setup()
 
     m_BaseWorld_message_called = 0;
     m_BaseWorld_message_called_from = 0;
+    m_BaseWorld_messages.clear();
+    stub_ExternalMind_operation_count = 0;
 }
 
 void Charactertest::teardown()
@@ -359,6 +390,67 @@ void Charactertest::test_filterExternalOperation()
     ASSERT_EQUAL(m_BaseWorld_message_called_from, m_character);
 }
 
+// While a client controls the character its NPC mind is suspended, and
+// operations only go to the client. Once the client lets go the mind runs
+// again, and looks at everything it remembers, a batch at a time.
+void Charactertest::test_sendMind_suspended()
+{
+    bool suspend = Character::s_suspendShadowMind;
+    Character::s_suspendShadowMind = true;
+
+    TestMind * mind = new TestMind("1", 1);
+    for (int i = 0; i < 40; ++i) {
+        mind->getMap()->getAdd(String::compose("%1", i + 10));
+    }
+    m_character->m_mind = mind;
+    m_character->m_externalMind = new ExternalMind(*m_character);
+    Link * l = new TestLink(*(CommSocket*)0, "2", 2);
+    m_character->m_externalMind->linkUp(l);
+
+    Atlas::Objects::Operation::Sight op;
+    OpVector res;
+
+    m_character->sendMind(op, res);
+    ASSERT_EQUAL(mind->m_operations, 0);
+    ASSERT_EQUAL(stub_ExternalMind_operation_count, 1);
+    ASSERT_TRUE(m_BaseWorld_messages.empty());
+
+    m_character->m_externalMind->linkUp(0);
+    m_character->sendMind(op, res);
+    ASSERT_EQUAL(mind->m_operations, 1);
+    ASSERT_EQUAL(stub_ExternalMind_operation_count, 2);
+
+    // Every remembered entity is looked at, but only the first batch of
+    // Looks goes out straight away.
+    ASSERT_EQUAL(m_BaseWorld_messages.size(), 40u);
+    std::set<std::string> looked_at;
+    std::size_t immediate = 0;
+    double latest = 0.;
+    for (auto & look : m_BaseWorld_messages) {
+        ASSERT_EQUAL(look->getClassNo(), Atlas::Objects::Operation::LOOK_NO);
+        ASSERT_EQUAL(look->getFrom(), m_character->getId());
+        looked_at.insert(look->getTo());
+        if (look->isDefaultFutureSeconds()) {
+            ++immediate;
+        } else {
+            latest = std::max(latest, look->getFutureSeconds());
+        }
+    }
+    ASSERT_EQUAL(looked_at.size(), 40u);
+    ASSERT_GREATER(immediate, 0u);
+    ASSERT_LESS(immediate, 40u);
+    ASSERT_GREATER(latest, 0.);
+
+    // From then on the mind just runs.
+    m_BaseWorld_messages.clear();
+    m_character->sendMind(op, res);
+    ASSERT_EQUAL(mind->m_operations, 2);
+    ASSERT_EQUAL(stub_ExternalMind_operation_count, 3);
+    ASSERT_TRUE(m_BaseWorld_messages.empty());
+
+    Character::s_suspendShadowMind = suspend;
+}
+
 int main(int argc, char ** argv)
 {
     Charactertest t;
@@ -402,6 +494,22 @@ void ExternalMind::linkUp(Link * c)
 
 void ExternalMind::operation(const Operation & op, OpVector & res)
 {
+    ++stub_ExternalMind_operation_count;
+}
+
+MemMap::MemMap(Script *& s) : m_script(s)
+{
+}
+
+MemEntity * MemMap::getAdd(const std::string & id)
+{
+    // Only remembers the entity, which is all the character needs.
+    long int_id = strtol(id.c_str(), 0, 10);
+    MemEntity *& entity = m_entities[int_id];
+    if (entity == 0) {
+        entity = new MemEntity(id, int_id);
+    }
+    return entity;
 }
 
 Pedestrian::Pedestrian(LocatedEntity & body) : Movement(body)
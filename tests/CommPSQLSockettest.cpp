@@ -53,11 +53,6 @@ void log(LogLevel, const std::string & msg)
 {
 }
 
-int Database::runMaintainance(int command)
-{
-    return 0;
-}
-
 int Database::launchNewQuery()
 {
     return 0;
@@ -67,7 +62,7 @@ int Database::initConnection()
 {
 }
 
-void Database::queryResult(ExecStatusType status)
+void Database::queryResult(PGresult * res)
 {
 }
 
@@ -0,0 +1,234 @@
+// Cyphesis Online RPG Server and AI Engine
+// Copyright (C) 2014 Erik Ogenvik
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+#ifndef DEBUG
+#define DEBUG
+#endif
+
+#include "TestBase.h"
+
+#include "server/DatabaseMaintenance.h"
+
+#include "common/Database.h"
+
+class DatabaseMaintenancetest : public Cyphesis::TestBase
+{
+  protected:
+    boost::asio::io_service * m_io_service;
+    DatabaseMaintenance * m_maintenance;
+  public:
+    DatabaseMaintenancetest();
+
+    void setup();
+    void teardown();
+
+    void test_threshold();
+    void test_nextCheck_idle();
+    void test_nextCheck_rate();
+    void test_nextCheck_clamped();
+    void test_vacuumed();
+    void test_vacuum_failed();
+    void test_stats_reset();
+    void test_vacuumCommand();
+};
+
+DatabaseMaintenancetest::DatabaseMaintenancetest()
+{
+    ADD_TEST(DatabaseMaintenancetest::test_threshold);
+    ADD_TEST(DatabaseMaintenancetest::test_nextCheck_idle);
+    ADD_TEST(DatabaseMaintenancetest::test_nextCheck_rate);
+    ADD_TEST(DatabaseMaintenancetest::test_nextCheck_clamped);
+    ADD_TEST(DatabaseMaintenancetest::test_vacuumed);
+    ADD_TEST(DatabaseMaintenancetest::test_vacuum_failed);
+    ADD_TEST(DatabaseMaintenancetest::test_stats_reset);
+    ADD_TEST(DatabaseMaintenancetest::test_vacuumCommand);
+}
+
+void DatabaseMaintenancetest::setup()
+{
+    m_io_service = new boost::asio::io_service;
+    m_maintenance = new DatabaseMaintenance(*m_io_service,
+                                            *Database::instance());
+}
+
+void DatabaseMaintenancetest::teardown()
+{
+    delete m_maintenance;
+    delete m_io_service;
+}
+
+void DatabaseMaintenancetest::test_threshold()
+{
+    long min = DatabaseMaintenance::minDeadTuples;
+    ASSERT_TRUE(!m_maintenance->updateTable("entities", 0, min - 1, 0, 0));
+    ASSERT_TRUE(m_maintenance->updateTable("entities", 0, min, 0, 0));
+
+    // Larger tables need proportionally more dead tuples.
+    ASSERT_TRUE(!m_maintenance->updateTable("properties", 1000, min, 0, 0));
+    ASSERT_TRUE(m_maintenance->updateTable("properties", 1000,
+                                           min + 200, 0, 0));
+}
+
+void DatabaseMaintenancetest::test_nextCheck_idle()
+{
+    ASSERT_EQUAL(m_maintenance->nextCheck(), DatabaseMaintenance::maxInterval);
+
+    m_maintenance->updateTable("entities", 1000, 0, 500, 100);
+    m_maintenance->updateTable("entities", 1000, 0, 500, 200);
+    ASSERT_EQUAL(m_maintenance->nextCheck(), DatabaseMaintenance::maxInterval);
+}
+
+void DatabaseMaintenancetest::test_nextCheck_rate()
+{
+    // 250 dead tuples are needed, and the table gains one a second.
+    m_maintenance->updateTable("entities", 1000, 0, 0, 1000);
+    m_maintenance->updateTable("entities", 1000, 100, 100, 1100);
+    ASSERT_EQUAL(m_maintenance->nextCheck(), 150);
+
+    // The busiest table decides when to check again.
+    m_maintenance->updateTable("properties", 1000, 0, 0, 1000);
+    m_maintenance->updateTable("properties", 1000, 100, 1000, 1100);
+    ASSERT_EQUAL(m_maintenance->nextCheck(), DatabaseMaintenance::minInterval);
+}
+
+void DatabaseMaintenancetest::test_nextCheck_clamped()
+{
+    m_maintenance->updateTable("entities", 0, 0, 0, 1000);
+    m_maintenance->updateTable("entities", 0, 0, 1, 2000);
+    ASSERT_EQUAL(m_maintenance->nextCheck(), DatabaseMaintenance::maxInterval);
+
+    m_maintenance->updateTable("entities", 0, 0, 100000, 2001);
+    ASSERT_EQUAL(m_maintenance->nextCheck(), DatabaseMaintenance::minInterval);
+}
+
+void DatabaseMaintenancetest::test_vacuumed()
+{
+    ASSERT_TRUE(m_maintenance->updateTable("entities", 0, 1000, 0, 0));
+    ASSERT_EQUAL(m_maintenance->nextCheck(), DatabaseMaintenance::minInterval);
+
+    m_maintenance->tableVacuumed("entities", 20);
+    ASSERT_EQUAL(m_maintenance->nextCheck(), DatabaseMaintenance::maxInterval);
+
+    // A table which is not known is ignored.
+    m_maintenance->tableVacuumed("rules", 20);
+}
+
+void DatabaseMaintenancetest::test_vacuum_failed()
+{
+    ASSERT_TRUE(m_maintenance->updateTable("entities", 0, 1000, 0, 0));
+
+    // The table still needs a vacuum, so it's checked again soon.
+    m_maintenance->tableVacuumFailed("entities");
+    ASSERT_EQUAL(m_maintenance->nextCheck(), DatabaseMaintenance::minInterval);
+}
+
+void DatabaseMaintenancetest::test_stats_reset()
+{
+    m_maintenance->updateTable("entities", 1000, 0, 0, 1000);
+    m_maintenance->updateTable("entities", 1000, 100, 100, 1100);
+    ASSERT_EQUAL(m_maintenance->nextCheck(), 150);
+
+    // Totals which go backwards keep the rate which was measured before.
+    m_maintenance->updateTable("entities", 1000, 100, 0, 1200);
+    ASSERT_EQUAL(m_maintenance->nextCheck(), 150);
+}
+
+void DatabaseMaintenancetest::test_vacuumCommand()
+{
+    ASSERT_EQUAL(m_maintenance->vacuumCommand("entities"),
+                 "VACUUM ANALYZE entities");
+}
+
+int main()
+{
+    DatabaseMaintenancetest t;
+
+    return t.run();
+}
+
+// stubs
+
+#include "common/globals.h"
+#include "common/log.h"
+#include "common/Monitors.h"
+#include "common/Variable.h"
+
+#include "stubs/common/stubDatabase.h"
+
+VariableBase::~VariableBase()
+{
+}
+
+template <typename T>
+Variable<T>::Variable(const T & variable) : m_variable(variable)
+{
+}
+
+template <typename T>
+Variable<T>::~Variable()
+{
+}
+
+template <typename T>
+void Variable<T>::send(std::ostream & o)
+{
+}
+
+template class Variable<int>;
+
+Monitors * Monitors::m_instance = NULL;
+
+Monitors::Monitors()
+{
+}
+
+Monitors::~Monitors()
+{
+}
+
+Monitors * Monitors::instance()
+{
+    if (m_instance == NULL) {
+        m_instance = new Monitors();
+    }
+    return m_instance;
+}
+
+void Monitors::watch(const::std::string & name, VariableBase * monitor)
+{
+}
+
+bool_config_register::bool_config_register(bool & var,
+                                           const char * section,
+                                           const char * setting,
+                                           const char * help)
+{
+}
+
+const char * const CYPHESIS = "cyphesis";
+
+void log(LogLevel lvl, const std::string & msg)
+{
+}
+
+void log_formatted(LogLevel lvl, const std::string & msg)
+{
+}
@@ -27,6 +27,7 @@
 
 #include "common/const.h"
 #include "common/compose.hpp"
+#include "common/globals.h"
 #include "common/log.h"
 
 #include <cstdlib>
@@ -101,6 +102,13 @@ long forceIntegerId(const std::string & id)
     return intId;
 }
 
+int_config_register::int_config_register(int & var,
+                                         const char * section,
+                                         const char * setting,
+                                         const char * help)
+{
+}
+
 template <typename T>
 int readConfigItem(const std::string & section, const std::string & key, T & storage)
 {
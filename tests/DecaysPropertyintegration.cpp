@@ -231,6 +231,13 @@ bool Script::operation(const std::string & opname,
    return false;
 }
 
+bool Script::dispatch(Handlers handlers,
+                      const Atlas::Objects::Operation::RootOperation & op,
+                      OpVector & res)
+{
+   return false;
+}
+
 void Script::hook(const std::string & function, LocatedEntity * entity)
 {
 }
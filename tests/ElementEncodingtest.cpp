@@ -0,0 +1,127 @@
+// Cyphesis Online RPG Server and AI Engine
+// Copyright (C) 2014 Erik Ogenvik
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+#ifndef DEBUG
+#define DEBUG
+#endif
+
+#include "common/ElementEncoding.h"
+
+#include <cassert>
+
+using Atlas::Message::Element;
+using Atlas::Message::MapType;
+using Atlas::Message::ListType;
+
+static Element roundTrip(const Element & element)
+{
+    std::string data;
+    encodeElement(element, data);
+    Element decoded;
+    int ret = decodeElement(data.data(), data.size(), decoded);
+    assert(ret == 0);
+    return decoded;
+}
+
+int main()
+{
+    {
+        assert(roundTrip(Element()) == Element());
+        assert(roundTrip(0) == Element(0));
+        assert(roundTrip(1) == Element(1));
+        assert(roundTrip(-1) == Element(-1));
+        assert(roundTrip(123456789L) == Element(123456789L));
+        assert(roundTrip(-123456789L) == Element(-123456789L));
+        assert(roundTrip(0.5) == Element(0.5));
+        assert(roundTrip(-1e300) == Element(-1e300));
+        assert(roundTrip("") == Element(""));
+        assert(roundTrip("foo") == Element("foo"));
+    }
+
+    {
+        MapType map;
+        map["int"] = 23;
+        map["float"] = 1.5;
+        map["string"] = "bar";
+        ListType list;
+        list.push_back(1);
+        list.push_back("two");
+        list.push_back(MapType());
+        list.push_back(ListType());
+        map["list"] = list;
+        MapType inner;
+        inner["none"] = Element();
+        map["map"] = inner;
+
+        assert(roundTrip(map) == Element(map));
+    }
+
+    {
+        // Small integers and short strings should take only a few bytes.
+        std::string data;
+        encodeElement(5, data);
+        assert(data.size() == 3);
+        data.clear();
+        encodeElement("foo", data);
+        assert(data.size() == 6);
+    }
+
+    {
+        // Data from an unknown version is rejected.
+        std::string data;
+        encodeElement(1, data);
+        data[0] = static_cast<char>(element_encoding_version + 1);
+        Element decoded;
+        assert(decodeElement(data.data(), data.size(), decoded) != 0);
+    }
+
+    {
+        // Truncated or corrupt data is rejected.
+        MapType map;
+        map["foo"] = "bar";
+        map["baz"] = ListType(3, 1.0);
+        std::string data;
+        encodeElement(map, data);
+        Element decoded;
+        for (std::size_t i = 0; i < data.size(); ++i) {
+            assert(decodeElement(data.data(), i, decoded) != 0);
+        }
+        std::string extra = data + "x";
+        assert(decodeElement(extra.data(), extra.size(), decoded) != 0);
+    }
+
+    {
+        // A count larger than the remaining data is rejected.
+        std::string data;
+        data.push_back(static_cast<char>(element_encoding_version));
+        data.push_back('L');
+        data.append("\xff\xff\xff\xff\x0f", 5);
+        Element decoded;
+        assert(decodeElement(data.data(), data.size(), decoded) != 0);
+    }
+
+    {
+        Element decoded;
+        assert(decodeElement("", 0, decoded) != 0);
+    }
+
+    return 0;
+}
@@ -0,0 +1,121 @@
+// Cyphesis Online RPG Server and AI Engine
+// Copyright (C) 2014 Erik Ogenvik
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+#ifndef DEBUG
+#define DEBUG
+#endif
+
+#include "TestBase.h"
+
+#include "common/Histogram.h"
+
+#include <sstream>
+
+class Histogramtest : public Cyphesis::TestBase
+{
+  protected:
+    Histogram * m_histogram;
+  public:
+    Histogramtest();
+
+    void setup();
+    void teardown();
+
+    void test_record();
+    void test_send();
+    void test_send_labels();
+};
+
+Histogramtest::Histogramtest()
+{
+    ADD_TEST(Histogramtest::test_record);
+    ADD_TEST(Histogramtest::test_send);
+    ADD_TEST(Histogramtest::test_send_labels);
+}
+
+void Histogramtest::setup()
+{
+    m_histogram = new Histogram;
+}
+
+void Histogramtest::teardown()
+{
+    delete m_histogram;
+}
+
+void Histogramtest::test_record()
+{
+    ASSERT_EQUAL(m_histogram->count(), 0);
+
+    m_histogram->record(5);
+    m_histogram->record(100);
+    m_histogram->record(5000000);
+    ASSERT_EQUAL(m_histogram->count(), 3);
+    ASSERT_EQUAL(m_histogram->sum(), 5000105.);
+}
+
+void Histogramtest::test_send()
+{
+    m_histogram->record(5);
+    m_histogram->record(10);
+    m_histogram->record(11);
+    m_histogram->record(5000000);
+
+    std::stringstream ss;
+    m_histogram->send(ss, "foo_usec");
+    std::string out = ss.str();
+
+    // Bucket counts are cumulative, and a value on a bound is counted in
+    // that bucket.
+    ASSERT_NOT_EQUAL(out.find("foo_usec_bucket{le=\"10\"} 2\n"),
+                     std::string::npos);
+    ASSERT_NOT_EQUAL(out.find("foo_usec_bucket{le=\"25\"} 3\n"),
+                     std::string::npos);
+    ASSERT_NOT_EQUAL(out.find("foo_usec_bucket{le=\"1000000\"} 3\n"),
+                     std::string::npos);
+    ASSERT_NOT_EQUAL(out.find("foo_usec_bucket{le=\"+Inf\"} 4\n"),
+                     std::string::npos);
+    ASSERT_NOT_EQUAL(out.find("foo_usec_count 4\n"), std::string::npos);
+    ASSERT_NOT_EQUAL(out.find("foo_usec_sum "), std::string::npos);
+}
+
+void Histogramtest::test_send_labels()
+{
+    m_histogram->record(30);
+
+    std::stringstream ss;
+    m_histogram->send(ss, "foo_usec{op=\"move\"}");
+    std::string out = ss.str();
+
+    ASSERT_NOT_EQUAL(out.find("foo_usec_bucket{op=\"move\",le=\"50\"} 1\n"),
+                     std::string::npos);
+    ASSERT_NOT_EQUAL(out.find("foo_usec_count{op=\"move\"} 1\n"),
+                     std::string::npos);
+    ASSERT_NOT_EQUAL(out.find("foo_usec_sum{op=\"move\"} 30\n"),
+                     std::string::npos);
+}
+
+int main()
+{
+    Histogramtest t;
+
+    return t.run();
+}
@@ -0,0 +1,210 @@
+// Cyphesis Online RPG Server and AI Engine
+// Copyright (C) 2014 Erik Ogenvik
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+#ifndef DEBUG
+#define DEBUG
+#endif
+
+#include "TestBase.h"
+
+#include "common/IdBlocks.h"
+
+#include <set>
+
+class IdBlockstest : public Cyphesis::TestBase
+{
+  protected:
+    IdBlocks * m_blocks;
+    /// The last value returned by the simulated id sequence.
+    long m_sequence;
+
+    long nextval();
+  public:
+    IdBlockstest();
+
+    void setup();
+    void teardown();
+
+    void test_empty();
+    void test_fetch();
+    void test_request();
+    void test_request_failed();
+    void test_refill();
+    void test_block_size_one();
+};
+
+IdBlockstest::IdBlockstest()
+{
+    ADD_TEST(IdBlockstest::test_empty);
+    ADD_TEST(IdBlockstest::test_fetch);
+    ADD_TEST(IdBlockstest::test_request);
+    ADD_TEST(IdBlockstest::test_request_failed);
+    ADD_TEST(IdBlockstest::test_refill);
+    ADD_TEST(IdBlockstest::test_block_size_one);
+}
+
+void IdBlockstest::setup()
+{
+    m_blocks = new IdBlocks;
+    m_blocks->setBlockSize(64);
+    m_sequence = 0;
+}
+
+void IdBlockstest::teardown()
+{
+    delete m_blocks;
+}
+
+/// Behaves like nextval() on a new sequence incrementing by the block size.
+long IdBlockstest::nextval()
+{
+    if (m_sequence == 0) {
+        m_sequence = 1;
+    } else {
+        m_sequence += m_blocks->blockSize();
+    }
+    return m_sequence;
+}
+
+void IdBlockstest::test_empty()
+{
+    ASSERT_TRUE(!m_blocks->hasWaitingBlock());
+    ASSERT_EQUAL(m_blocks->take(), -1);
+}
+
+void IdBlockstest::test_fetch()
+{
+    ASSERT_TRUE(m_blocks->blockArrived(nextval()));
+    ASSERT_TRUE(m_blocks->hasWaitingBlock());
+
+    // A new sequence starts at 1, so the first block only holds one id.
+    ASSERT_EQUAL(m_blocks->take(), 1);
+    ASSERT_TRUE(!m_blocks->hasWaitingBlock());
+    ASSERT_EQUAL(m_blocks->take(), -1);
+
+    ASSERT_TRUE(m_blocks->blockArrived(nextval()));
+    for (long id = 2; id <= 65; ++id) {
+        ASSERT_EQUAL(m_blocks->take(), id);
+    }
+    ASSERT_EQUAL(m_blocks->take(), -1);
+}
+
+void IdBlockstest::test_request()
+{
+    m_blocks->blockArrived(nextval());
+    m_blocks->take();
+    m_blocks->blockArrived(nextval());
+    m_blocks->take();
+
+    // Plenty left in the current block.
+    ASSERT_TRUE(!m_blocks->wantsRequest());
+
+    for (int i = 0; i < 32; ++i) {
+        m_blocks->take();
+    }
+    ASSERT_TRUE(m_blocks->wantsRequest());
+
+    // Only one request at a time.
+    m_blocks->requestSent();
+    ASSERT_TRUE(!m_blocks->wantsRequest());
+
+    m_blocks->blockArrived(nextval());
+    m_blocks->requestDone();
+    ASSERT_TRUE(!m_blocks->wantsRequest());
+
+    // Ids continue into the waiting block once the current one is used up.
+    long id = m_blocks->take();
+    while (id != 65) {
+        ASSERT_NOT_EQUAL(id, -1);
+        id = m_blocks->take();
+    }
+    ASSERT_EQUAL(m_blocks->take(), 66);
+    ASSERT_TRUE(!m_blocks->hasWaitingBlock());
+}
+
+void IdBlockstest::test_request_failed()
+{
+    m_blocks->blockArrived(nextval());
+    m_blocks->take();
+
+    ASSERT_TRUE(m_blocks->wantsRequest());
+    m_blocks->requestSent();
+    ASSERT_TRUE(!m_blocks->wantsRequest());
+
+    // The request is made again if no block arrived.
+    m_blocks->requestDone();
+    ASSERT_TRUE(m_blocks->wantsRequest());
+}
+
+void IdBlockstest::test_refill()
+{
+    // Hand out ids the way Database::newId() does, with each request for
+    // a block being answered a few ids later.
+    std::set<long> ids;
+    int fetches = 0;
+    int requests = 0;
+    int answer_in = -1;
+    for (int i = 0; i < 10000; ++i) {
+        if (answer_in >= 0 && answer_in-- == 0) {
+            m_blocks->blockArrived(nextval());
+            m_blocks->requestDone();
+        }
+        long id = m_blocks->take();
+        if (id == -1) {
+            ++fetches;
+            m_blocks->blockArrived(nextval());
+            id = m_blocks->take();
+        }
+        ASSERT_NOT_EQUAL(id, -1);
+        ASSERT_TRUE(ids.insert(id).second);
+        if (m_blocks->wantsRequest()) {
+            ++requests;
+            m_blocks->requestSent();
+            answer_in = 10;
+        }
+    }
+    ASSERT_EQUAL(ids.size(), 10000u);
+    // Only the very first block, which holds a single id, and the one
+    // requested right after it, are fetched while waiting.
+    ASSERT_LESS(fetches, 3);
+    ASSERT_GREATER(requests, 10000 / 64 - 2);
+}
+
+void IdBlockstest::test_block_size_one()
+{
+    m_blocks->setBlockSize(0);
+    ASSERT_EQUAL(m_blocks->blockSize(), 1);
+
+    // Without blocks every id is fetched as it's needed.
+    ASSERT_TRUE(!m_blocks->wantsRequest());
+    m_blocks->blockArrived(nextval());
+    ASSERT_EQUAL(m_blocks->take(), 1);
+    m_blocks->blockArrived(nextval());
+    ASSERT_EQUAL(m_blocks->take(), 2);
+    ASSERT_EQUAL(m_blocks->take(), -1);
+}
+
+int main()
+{
+    IdBlockstest t;
+
+    return t.run();
+}
@@ -27,6 +27,7 @@
 
 #include "common/Inheritance.h"
 
+#include "common/compose.hpp"
 #include "common/log.h"
 #include "common/OperationRouter.h"
 #include "common/TypeNode.h"
@@ -99,6 +100,8 @@ class Inheritancetest : public Cyphesis::TestBase
     void test_isTypeOf_string();
     void test_isTypeOf_TypeNode();
     void test_isTypeOf_TypeNode2();
+    void test_typeId();
+    void test_intervals();
     void test_flush();
 };
 
@@ -125,6 +128,8 @@ Inheritancetest::Inheritancetest()
     ADD_TEST(Inheritancetest::test_isTypeOf_string);
     ADD_TEST(Inheritancetest::test_isTypeOf_TypeNode);
     ADD_TEST(Inheritancetest::test_isTypeOf_TypeNode2);
+    ADD_TEST(Inheritancetest::test_typeId);
+    ADD_TEST(Inheritancetest::test_intervals);
     ADD_TEST(Inheritancetest::test_flush);
 }
 
@@ -337,6 +342,79 @@ void Inheritancetest::test_isTypeOf_TypeNode2()
     assert(i.isTypeOf(root_operation, root_operation));
 }
 
+void Inheritancetest::test_typeId()
+{
+    Inheritance & i = Inheritance::instance();
+
+    int count = i.typeCount();
+    ASSERT_EQUAL(count, (int)i.getAllObjects().size());
+
+    // Identifiers are dense, so each one below the count is used once.
+    std::vector<bool> used(count, false);
+    for (auto & entry : i.getAllObjects()) {
+        int id = entry.second->typeId();
+        ASSERT_TRUE(id >= 0 && id < count);
+        ASSERT_TRUE(!used[id]);
+        used[id] = true;
+    }
+
+    Root r;
+    r->setId("squigglymuff");
+    r->setParents(std::list<std::string>(1, "root_operation"));
+    TypeNode * type = i.addChild(r);
+    ASSERT_NOT_NULL(type);
+    ASSERT_EQUAL(type->typeId(), count);
+    ASSERT_EQUAL(i.typeCount(), count + 1);
+}
+
+void Inheritancetest::test_intervals()
+{
+    Inheritance & i = Inheritance::instance();
+
+    // Add enough siblings and a deep enough chain that the space left in
+    // the intervals runs out, and the tree has to be numbered again.
+    std::string parent = "talk";
+    for (int n = 0; n < 40; ++n) {
+        Root sibling;
+        sibling->setId(String::compose("sibling%1", n));
+        sibling->setParents(std::list<std::string>(1, "talk"));
+        ASSERT_NOT_NULL(i.addChild(sibling));
+
+        Root child;
+        child->setId(String::compose("chain%1", n));
+        child->setParents(std::list<std::string>(1, parent));
+        ASSERT_NOT_NULL(i.addChild(child));
+        parent = child->getId();
+    }
+
+    // The interval of every type lies within that of each of its
+    // ancestors, and does not overlap with other types at the same level.
+    for (auto & entry : i.getAllObjects()) {
+        const TypeNode * type = entry.second;
+        ASSERT_TRUE(type->intervalStart() >= 0);
+        ASSERT_TRUE(type->intervalStart() < type->intervalFree());
+        ASSERT_TRUE(type->intervalFree() <= type->intervalEnd());
+        for (auto & other : i.getAllObjects()) {
+            const TypeNode * base = other.second;
+            bool is_ancestor = false;
+            for (const TypeNode * t = type; t != 0; t = t->parent()) {
+                if (t == base) {
+                    is_ancestor = true;
+                }
+            }
+            bool inside = base->intervalStart() <= type->intervalStart() &&
+                          type->intervalEnd() <= base->intervalEnd();
+            ASSERT_EQUAL(inside, is_ancestor);
+        }
+    }
+
+    ASSERT_TRUE(i.isTypeOf("chain39", "chain0"));
+    ASSERT_TRUE(i.isTypeOf("chain39", "communicate"));
+    ASSERT_TRUE(!i.isTypeOf("chain39", "sibling0"));
+    ASSERT_TRUE(!i.isTypeOf("sibling39", "chain0"));
+    ASSERT_TRUE(i.isTypeOf("sibling39", "talk"));
+}
+
 void Inheritancetest::test_flush()
 {
     Inheritance & i = Inheritance::instance();
@@ -396,14 +474,22 @@ int THINK_NO = -1;
 int RELAY_NO = -1;
 } } }
 
-TypeNode::TypeNode(const std::string & name) : m_name(name), m_parent(0)
+TypeNode::TypeNode(const std::string & name) : m_name(name), m_parent(0),
+                                                m_typeId(-1),
+                                                m_intervalStart(-1),
+                                                m_intervalFree(-1),
+                                                m_intervalEnd(-1)
 {
 }
 
 TypeNode::TypeNode(const std::string & name,
                    const Atlas::Objects::Root & d) : m_name(name),
                                                      m_description(d),
-                                                     m_parent(0)
+                                                     m_parent(0),
+                                                     m_typeId(-1),
+                                                     m_intervalStart(-1),
+                                                     m_intervalFree(-1),
+                                                     m_intervalEnd(-1)
 {
 }
 
@@ -425,6 +511,13 @@ bool TypeNode::isTypeOf(const std::string & base_type) const
 
 bool TypeNode::isTypeOf(const TypeNode * base_type) const
 {
+    if (base_type == 0) {
+        return false;
+    }
+    if (m_intervalStart >= 0 && base_type->m_intervalStart >= 0) {
+        return base_type->m_intervalStart <= m_intervalStart &&
+               m_intervalEnd <= base_type->m_intervalEnd;
+    }
     const TypeNode * node = this;
     do {
         if (node == base_type) {
@@ -513,6 +513,10 @@ int CommSocket::flush()
     return 0;
 }
 
+int client_send_high_watermark = 1 << 20;
+int client_send_low_watermark = 1 << 18;
+int client_send_timeout = 30;
+
 Peer::Peer(CommSocket & client,
            ServerRouting & svr,
            const std::string & addr,
@@ -632,6 +636,10 @@ void Link::send(const Operation & op) const
 {
 }
 
+void Link::sendPending() const
+{
+}
+
 void Link::disconnect()
 {
 }
@@ -26,10 +26,13 @@
 #include "Sink.h"
 #include "TestBase.h"
 
+#include "common/BroadcastEncoding.h"
 #include "common/CommSocket.h"
 #include "common/Link.h"
 
+#include <Atlas/Objects/Anonymous.h>
 #include <Atlas/Objects/Encoder.h>
+#include <Atlas/Objects/Operation.h>
 #include <Atlas/Objects/RootOperation.h>
 #include <Atlas/Objects/SmartPtr.h>
 
@@ -61,6 +64,24 @@ void TestLink::operation(const Operation&, OpVector&)
 }
 
 
+/// A Sink which counts the messages streamed to it
+class MessageCount : public Sink
+{
+  public:
+    int m_messages;
+    std::string m_to;
+
+    MessageCount() : m_messages(0) { }
+
+    virtual void streamMessage() { ++m_messages; }
+    virtual void mapStringItem(const std::string& name,
+                               const std::string& value) {
+        if (name == "to") {
+            m_to = value;
+        }
+    }
+};
+
 class TestCommSocket : public CommSocket
 {
   public:
@@ -71,10 +92,43 @@ class TestCommSocket : public CommSocket
     virtual void disconnect();
     virtual int flush();
 
+    virtual bool isCongested() const;
+    virtual const std::type_info * codecType() const;
+    virtual int encode(const Operation & op, std::string & data);
+    virtual int writeEncoded(const char * data, std::size_t length);
+
+    bool m_congested;
+    bool m_shared;
+    int m_encodeCount;
+    std::string m_written;
 };
 
-TestCommSocket::TestCommSocket(boost::asio::io_service & svr) : CommSocket(svr)
+TestCommSocket::TestCommSocket(boost::asio::io_service & svr) :
+      CommSocket(svr), m_congested(false), m_shared(false), m_encodeCount(0)
+{
+}
+
+bool TestCommSocket::isCongested() const
 {
+    return m_congested;
+}
+
+const std::type_info * TestCommSocket::codecType() const
+{
+    return m_shared ? &typeid(TestCommSocket) : nullptr;
+}
+
+int TestCommSocket::encode(const Operation & op, std::string & data)
+{
+    ++m_encodeCount;
+    data = "<to>" + op->getTo() + "</to>";
+    return 0;
+}
+
+int TestCommSocket::writeEncoded(const char * data, std::size_t length)
+{
+    m_written.append(data, length);
+    return 0;
 }
 
 TestCommSocket::~TestCommSocket()
@@ -102,6 +156,10 @@ class Linktest : public Cyphesis::TestBase
     void test_sendError();
     void test_sendError_connected();
     void test_disconnect();
+    void test_send_broadcast();
+    void test_send_broadcast_unshared();
+    void test_send_broadcast_temporaries();
+    void test_send_congested();
 
     static void set_CommSocket_flush_called();
     static void set_CommSocket_disconnect_called();
@@ -138,6 +196,10 @@ Linktest::Linktest()
     ADD_TEST(Linktest::test_sendError);
     ADD_TEST(Linktest::test_sendError_connected);
     ADD_TEST(Linktest::test_disconnect);
+    ADD_TEST(Linktest::test_send_broadcast);
+    ADD_TEST(Linktest::test_send_broadcast_unshared);
+    ADD_TEST(Linktest::test_send_broadcast_temporaries);
+    ADD_TEST(Linktest::test_send_congested);
 }
 
 void Linktest::setup()
@@ -215,6 +277,207 @@ void Linktest::test_disconnect()
     ASSERT_TRUE(CommSocket_disconnect_called);
 }
 
+void Linktest::test_send_broadcast()
+{
+    m_encoder = new Atlas::Objects::ObjectsEncoder(*m_bridge);
+
+    TestCommSocket socket1(*(boost::asio::io_service*)0);
+    TestCommSocket socket2(*(boost::asio::io_service*)0);
+    socket1.m_shared = true;
+    socket2.m_shared = true;
+    TestLink link1(socket1, "2", 2);
+    TestLink link2(socket2, "3", 3);
+    link1.setEncoder(m_encoder);
+    link2.setEncoder(m_encoder);
+
+    Operation op;
+    {
+        BroadcastEncoding broadcast;
+        ASSERT_EQUAL(BroadcastEncoding::current(), &broadcast);
+
+        op->setTo("4");
+        link1.send(op);
+        op->setTo("5");
+        link2.send(op);
+    }
+    ASSERT_NULL(BroadcastEncoding::current());
+
+    // The op is encoded once, and each socket gets its own TO.
+    ASSERT_EQUAL(socket1.m_encodeCount + socket2.m_encodeCount, 1);
+    ASSERT_EQUAL(socket1.m_written, "<to>4</to>");
+    ASSERT_EQUAL(socket2.m_written, "<to>5</to>");
+    ASSERT_EQUAL(op->getTo(), "5");
+
+    // Outside a broadcast the op is encoded as usual.
+    link1.send(op);
+    ASSERT_EQUAL(socket1.m_encodeCount + socket2.m_encodeCount, 1);
+    ASSERT_EQUAL(socket1.m_written, "<to>4</to>");
+}
+
+void Linktest::test_send_broadcast_unshared()
+{
+    m_encoder = new Atlas::Objects::ObjectsEncoder(*m_bridge);
+
+    TestCommSocket socket(*(boost::asio::io_service*)0);
+    TestLink link(socket, "2", 2);
+    link.setEncoder(m_encoder);
+
+    BroadcastEncoding broadcast;
+
+    // The socket's codec can't share data.
+    Operation op;
+    op->setTo("4");
+    link.send(op);
+    ASSERT_EQUAL(socket.m_encodeCount, 0);
+
+    // An op without TO can't be shared.
+    socket.m_shared = true;
+    Operation op2;
+    link.send(op2);
+    ASSERT_EQUAL(socket.m_encodeCount, 0);
+
+    // Nor can one with a TO that a codec may escape.
+    op->setTo("<4>");
+    link.send(op);
+    ASSERT_EQUAL(socket.m_encodeCount, 0);
+    ASSERT_TRUE(socket.m_written.empty());
+}
+
+void Linktest::test_send_broadcast_temporaries()
+{
+    m_encoder = new Atlas::Objects::ObjectsEncoder(*m_bridge);
+
+    TestCommSocket socket(*(boost::asio::io_service*)0);
+    socket.m_shared = true;
+    TestLink link(socket, "2", 2);
+    link.setEncoder(m_encoder);
+
+    BroadcastEncoding broadcast;
+
+    // Ops made and released one after another inside a broadcast may be
+    // allocated at the same address, but are still encoded separately.
+    for (int i = 0; i < 3; ++i) {
+        Operation op;
+        op->setTo("4");
+        link.send(op);
+    }
+    ASSERT_EQUAL(socket.m_encodeCount, 3);
+    ASSERT_EQUAL(socket.m_written, "<to>4</to><to>4</to><to>4</to>");
+}
+
+void Linktest::test_send_congested()
+{
+    MessageCount * count = new MessageCount;
+    delete m_bridge;
+    m_bridge = count;
+    m_encoder = new Atlas::Objects::ObjectsEncoder(*m_bridge);
+    m_link->setEncoder(m_encoder);
+
+    Atlas::Objects::Entity::Anonymous move_arg;
+    move_arg->setId("2");
+    move_arg->setLoc("1");
+    move_arg->setVelocity(std::vector<double>(3, 1.));
+    Atlas::Objects::Operation::Move move;
+    move->setArgs1(move_arg);
+    Atlas::Objects::Operation::Sight sight;
+    sight->setArgs1(move);
+
+    Atlas::Objects::Entity::Anonymous other_arg;
+    other_arg->setId("3");
+    other_arg->setLoc("1");
+    other_arg->setVelocity(std::vector<double>(3, 1.));
+    Atlas::Objects::Operation::Move other_move;
+    other_move->setArgs1(other_arg);
+    Atlas::Objects::Operation::Sight other_sight;
+    other_sight->setArgs1(other_move);
+
+    Atlas::Objects::Entity::Anonymous stop_arg;
+    stop_arg->setId("2");
+    stop_arg->setLoc("1");
+    stop_arg->setVelocity(std::vector<double>(3, 0.));
+    Atlas::Objects::Operation::Move stop;
+    stop->setArgs1(stop_arg);
+    Atlas::Objects::Operation::Sight stop_sight;
+    stop_sight->setArgs1(stop);
+
+    Atlas::Objects::Entity::Anonymous enter_arg;
+    enter_arg->setId("2");
+    enter_arg->setLoc("4");
+    enter_arg->setVelocity(std::vector<double>(3, 1.));
+    Atlas::Objects::Operation::Move enter;
+    enter->setArgs1(enter_arg);
+    Atlas::Objects::Operation::Sight enter_sight;
+    enter_sight->setArgs1(enter);
+
+    Atlas::Objects::Operation::Sight set_sight;
+    set_sight->setArgs1(Atlas::Objects::Operation::Set());
+
+    TestCommSocket * socket = static_cast<TestCommSocket *>(m_socket);
+
+    CommSocket_flush_called = false;
+    m_link->send(sight);
+    m_link->send(other_sight);
+    ASSERT_TRUE(CommSocket_flush_called);
+    ASSERT_EQUAL(count->m_messages, 2);
+
+    // A congested socket holds back moves until something else is sent,
+    // keeping only the latest one for each entity.
+    socket->m_congested = true;
+    CommSocket_flush_called = false;
+    m_link->send(sight);
+    m_link->send(other_sight);
+    m_link->send(sight);
+    ASSERT_TRUE(!CommSocket_flush_called);
+    ASSERT_EQUAL(count->m_messages, 2);
+
+    m_link->send(set_sight);
+    ASSERT_TRUE(CommSocket_flush_called);
+    ASSERT_EQUAL(count->m_messages, 5);
+
+    // A move which stops an entity replaces the one held back for it, but
+    // is sent straight away along with the others.
+    m_link->send(sight);
+    m_link->send(other_sight);
+    ASSERT_EQUAL(count->m_messages, 5);
+    m_link->send(stop_sight);
+    ASSERT_EQUAL(count->m_messages, 7);
+
+    CommSocket_flush_called = false;
+    m_link->send(move);
+    ASSERT_TRUE(CommSocket_flush_called);
+    ASSERT_EQUAL(count->m_messages, 8);
+
+    // The move which starts an entity moving again is not held back, but
+    // those that follow are.
+    m_link->send(sight);
+    ASSERT_EQUAL(count->m_messages, 9);
+    m_link->send(sight);
+    ASSERT_EQUAL(count->m_messages, 9);
+
+    // Neither is a move to a new LOC, which replaces the one held back.
+    m_link->send(enter_sight);
+    ASSERT_EQUAL(count->m_messages, 10);
+    m_link->send(enter_sight);
+    ASSERT_EQUAL(count->m_messages, 10);
+
+    // A held move is not affected by later changes to the op, which may
+    // be broadcast to other clients.
+    m_link->send(sight);
+    ASSERT_EQUAL(count->m_messages, 11);
+    m_link->send(sight);
+    sight->setTo("5");
+    ASSERT_EQUAL(count->m_messages, 11);
+
+    // Moves held back are sent once the socket catches up.
+    socket->m_congested = false;
+    count->m_to.clear();
+    m_link->sendPending();
+    ASSERT_EQUAL(count->m_messages, 12);
+    ASSERT_TRUE(count->m_to.empty());
+    m_link->sendPending();
+    ASSERT_EQUAL(count->m_messages, 12);
+}
+
 int main()
 {
     Linktest t;
@@ -38,6 +38,38 @@
 #include <Atlas/Objects/RootOperation.h>
 
 #include <cassert>
+#include <cmath>
+
+/// Find the position and orientation of a location relative to the root of
+/// its hierarchy by walking up it one parent at a time, without the cache
+static void walkToRoot(const Location & loc, Point3D & pos,
+                       Quaternion & orientation)
+{
+    static const Quaternion identity(Quaternion::Identity());
+
+    pos = Point3D(0, 0, 0);
+    orientation = identity;
+    for (const Location * l = &loc; l->m_loc != 0;
+         l = &l->m_loc->m_location) {
+        const Quaternion & o = l->m_orientation.isValid() ? l->m_orientation
+                                                          : identity;
+        pos = pos.toParentCoords(l->m_pos, o);
+        orientation *= o;
+    }
+}
+
+/// Check the cached transform of a location against the one found by
+/// walking up its hierarchy
+static void checkRootTransform(const Location & loc, const Location & root)
+{
+    Point3D pos;
+    Quaternion orientation;
+    walkToRoot(loc, pos, orientation);
+
+    assert(loc.rootTransform() == &root);
+    assert(loc.rootPos().isEqualTo(pos, 0.0001f));
+    assert(loc.rootOrientation().isEqualTo(orientation, 0.0001f));
+}
 
 
 void testDistanceFunctions()
@@ -336,6 +368,104 @@ void testDistanceFunctions()
         ent2.m_location.m_loc = 0;
     }
 
+    // Cached transforms must follow changes anywhere up the hierarchy
+    {
+        Entity tlve("0", 0), ent1("1", 1), ent2("2", 2), ent3("3", 3);
+
+        ent1.m_location.m_loc = &tlve;
+        ent1.m_location.m_pos = Point3D(1, 1, 0);
+
+        ent2.m_location.m_loc = &ent1;
+        ent2.m_location.m_pos = Point3D(1, 0, 0);
+
+        ent3.m_location.m_loc = &tlve;
+        ent3.m_location.m_pos = Point3D(0, 0, 0);
+
+        Point3D relPos = relativePos(ent3.m_location, ent2.m_location);
+        assert(relPos == Point3D(2, 1, 0));
+        assert(ent2.m_location.rootTransform() == &tlve.m_location);
+
+        // Move the parent
+        ent1.m_location.m_pos = Point3D(5, 5, 0);
+        relPos = relativePos(ent3.m_location, ent2.m_location);
+        assert(relPos == Point3D(6, 5, 0));
+
+        // Turn the parent a quarter turn, which is not its own inverse
+        ent1.m_location.m_orientation = WFMath::Quaternion(2, M_PI / 2.f);
+        Point3D walkedPos;
+        Quaternion walkedOrientation;
+        walkToRoot(ent2.m_location, walkedPos, walkedOrientation);
+        assert(walkedPos != Point3D(6, 5, 0));
+        relPos = relativePos(ent3.m_location, ent2.m_location);
+        assert(relPos.isEqualTo(walkedPos, 0.0001f));
+        assert(std::fabs(squareDistance(ent3.m_location, ent2.m_location) -
+                         sqrMag(walkedPos)) < 0.001f);
+        checkRootTransform(ent2.m_location, tlve.m_location);
+
+        // Seen from a turned sibling of the parent, the cached result
+        // matches the one found the long way
+        ent3.m_location.m_orientation = WFMath::Quaternion(2, -M_PI / 2.f);
+        Point3D siblingPos;
+        Quaternion siblingOrientation;
+        walkToRoot(ent3.m_location, siblingPos, siblingOrientation);
+        relPos = relativePos(ent3.m_location, ent2.m_location);
+        assert(relPos.isEqualTo(walkedPos.toLocalCoords(siblingPos,
+                                                        siblingOrientation),
+                                0.0001f));
+        ent3.m_location.m_orientation = Quaternion();
+
+        // Move the child to another parent
+        ent2.m_location.m_loc = &ent3;
+        relPos = relativePos(ent3.m_location, ent2.m_location);
+        assert(relPos == Point3D(1, 0, 0));
+
+        // A position which is not valid can't be cached
+        ent3.m_location.m_pos = Point3D();
+        assert(ent2.m_location.rootTransform() == 0);
+
+        const Location * ancestor = 0;
+        ent3.m_location.m_pos = Point3D(0, 0, 0);
+        squareDistanceWithAncestor(ent1.m_location, ent2.m_location, &ancestor);
+        assert(ancestor == &tlve.m_location);
+        squareDistanceWithAncestor(ent3.m_location, ent2.m_location, &ancestor);
+        assert(ancestor == &ent3.m_location);
+
+        ent1.m_location.m_loc = 0;
+        ent2.m_location.m_loc = 0;
+        ent3.m_location.m_loc = 0;
+    }
+
+    // Cached transforms of nested children match those found by walking
+    // up their parents
+    {
+        Entity tlve("0", 0), ent1("1", 1), ent2("2", 2), ent3("3", 3);
+
+        ent1.m_location.m_loc = &tlve;
+        ent1.m_location.m_pos = Point3D(3, 1, 0);
+        ent1.m_location.m_orientation = WFMath::Quaternion(2, M_PI / 2.f);
+
+        ent2.m_location.m_loc = &ent1;
+        ent2.m_location.m_pos = Point3D(1, 2, 0);
+        ent2.m_location.m_orientation = WFMath::Quaternion(0, M_PI / 2.f);
+
+        ent3.m_location.m_loc = &ent2;
+        ent3.m_location.m_pos = Point3D(2, 0, 1);
+
+        checkRootTransform(ent3.m_location, tlve.m_location);
+        checkRootTransform(ent2.m_location, tlve.m_location);
+
+        // A change at the top reaches the grandchild
+        ent1.m_location.m_orientation = WFMath::Quaternion(2, M_PI / 4.f);
+        checkRootTransform(ent3.m_location, tlve.m_location);
+
+        ent1.m_location.m_pos = Point3D(-2, 4, 1);
+        checkRootTransform(ent3.m_location, tlve.m_location);
+
+        ent1.m_location.m_loc = 0;
+        ent2.m_location.m_loc = 0;
+        ent3.m_location.m_loc = 0;
+    }
+
 }
 
 int main()
@@ -38,6 +38,7 @@
 #include <Atlas/Objects/Operation.h>
 #include <Atlas/Objects/SmartPtr.h>
 
+#include <algorithm>
 #include <cstdlib>
 
 #include <cassert>
@@ -73,6 +74,9 @@ class MemMaptest : public Cyphesis::TestBase
     void test_findByLoc_results();
     void test_findByLoc_invalid();
     void test_findByLoc_consistency_check();
+    void test_findByLoc_grid();
+    void test_findByLoc_grid_move();
+    void test_findByType();
 
     static void Script_hook_called(const std::string &, LocatedEntity *);
 };
@@ -113,6 +117,9 @@ MemMaptest::MemMaptest()
     ADD_TEST(MemMaptest::test_findByLoc_results);
     ADD_TEST(MemMaptest::test_findByLoc_invalid);
     ADD_TEST(MemMaptest::test_findByLoc_consistency_check);
+    ADD_TEST(MemMaptest::test_findByLoc_grid);
+    ADD_TEST(MemMaptest::test_findByLoc_grid_move);
+    ADD_TEST(MemMaptest::test_findByType);
 }
 
 void MemMaptest::setup()
@@ -381,6 +388,148 @@ void MemMaptest::test_findByLoc_consistency_check()
     ASSERT_TRUE(res.empty());
 }
 
+void MemMaptest::test_findByLoc_grid()
+{
+    MemEntity * tlve = new MemEntity("3", 3);
+    tlve->setVisible();
+    tlve->setType(MemMap::m_entity_type);
+    m_memMap->addEntity(tlve);
+
+    Anonymous data;
+    data->setLoc("3");
+
+    MemEntity * e4 = new MemEntity("4", 4);
+    e4->setVisible();
+    e4->setType(m_sampleType);
+    e4->m_location.m_pos = Point3D(1,1,0);
+    m_memMap->readEntity(e4, data);
+    m_memMap->addEntity(e4);
+
+    MemEntity * e5 = new MemEntity("5", 5);
+    e5->setVisible();
+    e5->setType(m_sampleType);
+    e5->m_location.m_pos = Point3D(2,2,0);
+    m_memMap->readEntity(e5, data);
+    m_memMap->addEntity(e5);
+
+    // A long way from the others, in a different cell
+    MemEntity * e6 = new MemEntity("6", 6);
+    e6->setVisible();
+    e6->setType(m_sampleType);
+    e6->m_location.m_pos = Point3D(1000,1000,0);
+    m_memMap->readEntity(e6, data);
+    m_memMap->addEntity(e6);
+
+    ASSERT_EQUAL(tlve->m_contains->size(), 3u);
+    ASSERT_EQUAL(m_memMap->m_grids.size(), 1u);
+    ASSERT_EQUAL(m_memMap->m_grids[tlve].count, 3u);
+    ASSERT_EQUAL(m_memMap->m_grids[tlve].cells.size(), 2u);
+
+    Location find_here(tlve, Point3D(0,0,0));
+
+    // Radius too small
+    EntityVector res = m_memMap->findByLocation(find_here,
+                                                1.f,
+                                                "sample_type");
+    ASSERT_TRUE(res.empty());
+
+    // Only the cells near the origin are checked
+    res = m_memMap->findByLocation(find_here, 5.f, "sample_type");
+    ASSERT_EQUAL(res.size(), 2u);
+    ASSERT_TRUE(std::find(res.begin(), res.end(), e6) == res.end());
+
+    res = m_memMap->findByLocation(find_here, 2000.f, "sample_type");
+    ASSERT_EQUAL(res.size(), 3u);
+
+    res = m_memMap->findByLocation(find_here, 2000.f, "non_sample_type");
+    ASSERT_TRUE(res.empty());
+}
+
+void MemMaptest::test_findByLoc_grid_move()
+{
+    MemEntity * tlve = new MemEntity("3", 3);
+    tlve->setVisible();
+    tlve->setType(MemMap::m_entity_type);
+    m_memMap->addEntity(tlve);
+
+    MemEntity * e5 = new MemEntity("5", 5);
+    e5->setVisible();
+    e5->setType(MemMap::m_entity_type);
+    m_memMap->addEntity(e5);
+
+    Anonymous data;
+    data->setLoc("3");
+
+    MemEntity * e4 = new MemEntity("4", 4);
+    e4->setVisible();
+    e4->setType(m_sampleType);
+    e4->m_location.m_pos = Point3D(1000,1000,0);
+    m_memMap->readEntity(e4, data);
+    m_memMap->addEntity(e4);
+
+    Location find_here(tlve, Point3D(0,0,0));
+
+    EntityVector res = m_memMap->findByLocation(find_here,
+                                                5.f,
+                                                "sample_type");
+    ASSERT_TRUE(res.empty());
+
+    // Move it near the origin
+    e4->m_location.m_pos = Point3D(1,1,0);
+    m_memMap->readEntity(e4, data);
+
+    res = m_memMap->findByLocation(find_here, 5.f, "sample_type");
+    ASSERT_EQUAL(res.size(), 1u);
+    ASSERT_EQUAL(res.front(), e4);
+
+    // Move it into another container
+    data->setLoc("5");
+    m_memMap->readEntity(e4, data);
+
+    res = m_memMap->findByLocation(find_here, 5.f, "sample_type");
+    ASSERT_TRUE(res.empty());
+    ASSERT_EQUAL(m_memMap->m_grids.count(tlve), 0u);
+    ASSERT_EQUAL(m_memMap->m_grids[e5].count, 1u);
+
+    Location find_there(e5, Point3D(0,0,0));
+    res = m_memMap->findByLocation(find_there, 5.f, "sample_type");
+    ASSERT_EQUAL(res.size(), 1u);
+}
+
+void MemMaptest::test_findByType()
+{
+    MemEntity * e3 = new MemEntity("3", 3);
+    e3->setVisible();
+    e3->setType(m_sampleType);
+    m_memMap->addEntity(e3);
+
+    MemEntity * e4 = new MemEntity("4", 4);
+    e4->setVisible();
+    e4->setType(MemMap::m_entity_type);
+    m_memMap->addEntity(e4);
+
+    // Not visible, so never found
+    MemEntity * e5 = new MemEntity("5", 5);
+    e5->setType(m_sampleType);
+    m_memMap->addEntity(e5);
+
+    EntityVector res = m_memMap->findByType("sample_type");
+    ASSERT_EQUAL(res.size(), 1u);
+    ASSERT_EQUAL(res.front(), e3);
+
+    // Learning the type of e4 moves it in the index
+    Anonymous data;
+    data->setParents(std::list<std::string>(1, "sample_type"));
+    m_memMap->readEntity(e4, data);
+
+    res = m_memMap->findByType("sample_type");
+    ASSERT_EQUAL(res.size(), 2u);
+    ASSERT_EQUAL(res.front(), e3);
+    ASSERT_EQUAL(res.back(), e4);
+
+    ASSERT_TRUE(m_memMap->findByType("non_sample_type").empty());
+}
+
 int main()
 {
     MemMaptest t;
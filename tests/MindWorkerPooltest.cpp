@@ -0,0 +1,368 @@
+// Cyphesis Online RPG Server and AI Engine
+// Copyright (C) 2014 Erik Ogenvik
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+#ifndef DEBUG
+#define DEBUG
+#endif
+
+#include "TestBase.h"
+
+#include "server/MindWorkerPool.h"
+
+#include "server/MindWorkerAccount.h"
+#include "server/Connection.h"
+
+#include "rulesets/Character.h"
+#include "rulesets/ExternalMind.h"
+
+#include "common/compose.hpp"
+#include "common/log.h"
+
+#include <cstdlib>
+#include <vector>
+
+using Atlas::Message::MapType;
+
+static std::vector<std::pair<MindWorkerAccount *, long> > stub_hostMind_calls;
+static int stub_hostMind_result = 0;
+
+class MindWorkerPooltest : public Cyphesis::TestBase
+{
+  protected:
+    MindWorkerPool * m_pool;
+    Connection * m_connection;
+    std::vector<Character *> m_characters;
+    std::vector<MindWorkerAccount *> m_workers;
+
+    Character * newCharacter();
+    MindWorkerAccount * newWorker();
+    std::size_t load(MindWorkerAccount * worker);
+  public:
+    MindWorkerPooltest();
+
+    void setup();
+    void teardown();
+
+    void test_no_workers();
+    void test_assign();
+    void test_balance();
+    void test_rehome();
+    void test_destroyed();
+    void test_host_failed();
+    void test_token();
+};
+
+MindWorkerPooltest::MindWorkerPooltest()
+{
+    ADD_TEST(MindWorkerPooltest::test_no_workers);
+    ADD_TEST(MindWorkerPooltest::test_assign);
+    ADD_TEST(MindWorkerPooltest::test_balance);
+    ADD_TEST(MindWorkerPooltest::test_rehome);
+    ADD_TEST(MindWorkerPooltest::test_destroyed);
+    ADD_TEST(MindWorkerPooltest::test_host_failed);
+    ADD_TEST(MindWorkerPooltest::test_token);
+}
+
+void MindWorkerPooltest::setup()
+{
+    stub_hostMind_calls.clear();
+    stub_hostMind_result = 0;
+    // No processes are started by a pool of size zero.
+    MindWorkerPool::init(0, "cyaiclient");
+    m_pool = MindWorkerPool::instance();
+    m_connection = new Connection(*(CommSocket*)0,
+                                  *(ServerRouting*)0,
+                                  "addr", "3", 3);
+}
+
+void MindWorkerPooltest::teardown()
+{
+    MindWorkerPool::del();
+    ASSERT_NULL(MindHost::instance());
+    for (Character * chr : m_characters) {
+        delete chr;
+    }
+    m_characters.clear();
+    for (MindWorkerAccount * worker : m_workers) {
+        delete worker;
+    }
+    m_workers.clear();
+    delete m_connection;
+}
+
+Character * MindWorkerPooltest::newCharacter()
+{
+    long id = m_characters.size() + 1;
+    Character * chr = new Character(String::compose("%1", id), id);
+    m_characters.push_back(chr);
+    return chr;
+}
+
+MindWorkerAccount * MindWorkerPooltest::newWorker()
+{
+    long id = m_workers.size() + 100;
+    MindWorkerAccount * worker = new MindWorkerAccount(m_connection,
+          "worker", "", String::compose("%1", id), id);
+    m_workers.push_back(worker);
+    m_pool->addWorker(worker);
+    return worker;
+}
+
+std::size_t MindWorkerPooltest::load(MindWorkerAccount * worker)
+{
+    auto I = m_pool->m_workers.find(worker);
+    if (I == m_pool->m_workers.end()) {
+        return 0;
+    }
+    return I->second;
+}
+
+void MindWorkerPooltest::test_no_workers()
+{
+    ASSERT_EQUAL(MindHost::instance(), static_cast<MindHost *>(m_pool));
+
+    m_pool->addMind(*newCharacter(), MapType());
+    ASSERT_EQUAL(m_pool->pending(), 1u);
+
+    m_pool->idle();
+    ASSERT_EQUAL(m_pool->pending(), 1u);
+    ASSERT_TRUE(stub_hostMind_calls.empty());
+}
+
+void MindWorkerPooltest::test_assign()
+{
+    Character * chr = newCharacter();
+    m_pool->addMind(*chr, MapType());
+    MindWorkerAccount * worker = newWorker();
+
+    m_pool->idle();
+    ASSERT_EQUAL(m_pool->pending(), 0u);
+    ASSERT_EQUAL(stub_hostMind_calls.size(), 1u);
+    ASSERT_EQUAL(stub_hostMind_calls.front().first, worker);
+    ASSERT_EQUAL(stub_hostMind_calls.front().second, chr->getIntId());
+    ASSERT_EQUAL(load(worker), 1u);
+
+    // Setting the mind again doesn't hand the character over again.
+    m_pool->addMind(*chr, MapType());
+    m_pool->idle();
+    ASSERT_EQUAL(stub_hostMind_calls.size(), 1u);
+}
+
+void MindWorkerPooltest::test_balance()
+{
+    MindWorkerAccount * worker1 = newWorker();
+    MindWorkerAccount * worker2 = newWorker();
+    for (int i = 0; i < 5; ++i) {
+        m_pool->addMind(*newCharacter(), MapType());
+    }
+
+    m_pool->idle();
+    ASSERT_EQUAL(m_pool->pending(), 0u);
+    ASSERT_EQUAL(stub_hostMind_calls.size(), 5u);
+    ASSERT_EQUAL(load(worker1) + load(worker2), 5u);
+    ASSERT_TRUE(load(worker1) >= 2u);
+    ASSERT_TRUE(load(worker2) >= 2u);
+}
+
+void MindWorkerPooltest::test_rehome()
+{
+    MindWorkerAccount * worker1 = newWorker();
+    Character * chr = newCharacter();
+    m_pool->addMind(*chr, MapType());
+    m_pool->idle();
+    ASSERT_EQUAL(load(worker1), 1u);
+
+    // The worker goes away, which unlinks the character.
+    MindWorkerAccount * worker2 = newWorker();
+    worker1->m_connection = 0;
+    chr->externalLinkChanged.emit();
+    ASSERT_EQUAL(m_pool->pending(), 1u);
+    ASSERT_EQUAL(load(worker1), 0u);
+
+    m_pool->idle();
+    ASSERT_EQUAL(m_pool->pending(), 0u);
+    ASSERT_TRUE(m_pool->m_workers.find(worker1) == m_pool->m_workers.end());
+    ASSERT_EQUAL(stub_hostMind_calls.size(), 2u);
+    ASSERT_EQUAL(stub_hostMind_calls.back().first, worker2);
+    ASSERT_EQUAL(load(worker2), 1u);
+
+    // A worker being destroyed also hands its characters on.
+    MindWorkerAccount * worker3 = newWorker();
+    m_pool->removeWorker(worker2);
+    ASSERT_EQUAL(m_pool->pending(), 1u);
+    m_pool->idle();
+    ASSERT_EQUAL(stub_hostMind_calls.back().first, worker3);
+}
+
+void MindWorkerPooltest::test_destroyed()
+{
+    MindWorkerAccount * worker = newWorker();
+    Character * chr = newCharacter();
+    m_pool->addMind(*chr, MapType());
+    m_pool->idle();
+    ASSERT_EQUAL(load(worker), 1u);
+
+    chr->destroyed.emit();
+    ASSERT_TRUE(m_pool->m_minds.empty());
+    ASSERT_EQUAL(load(worker), 0u);
+
+    // Signals from the character are no longer followed.
+    chr->externalLinkChanged.emit();
+    ASSERT_EQUAL(m_pool->pending(), 0u);
+}
+
+void MindWorkerPooltest::test_host_failed()
+{
+    MindWorkerAccount * worker = newWorker();
+    Character * chr = newCharacter();
+    m_pool->addMind(*chr, MapType());
+    stub_hostMind_result = -1;
+
+    m_pool->idle();
+    ASSERT_EQUAL(stub_hostMind_calls.size(), 1u);
+    ASSERT_EQUAL(m_pool->pending(), 0u);
+    ASSERT_EQUAL(load(worker), 0u);
+
+    // It is tried again once whatever controls it lets go.
+    stub_hostMind_result = 0;
+    chr->externalLinkChanged.emit();
+    m_pool->idle();
+    ASSERT_EQUAL(stub_hostMind_calls.size(), 2u);
+    ASSERT_EQUAL(load(worker), 1u);
+}
+
+void MindWorkerPooltest::test_token()
+{
+    // Workers get the token in their environment.
+    const char * token = getenv("CYPHESIS_MIND_TOKEN");
+    ASSERT_NOT_NULL(token);
+    ASSERT_EQUAL(m_pool->m_token, token);
+    ASSERT_EQUAL(m_pool->m_token.size(), 32u);
+
+    ASSERT_TRUE(m_pool->checkToken(m_pool->m_token));
+    ASSERT_TRUE(!m_pool->checkToken(""));
+    ASSERT_TRUE(!m_pool->checkToken("guess"));
+
+    // Each pool has its own token.
+    std::string old_token = m_pool->m_token;
+    MindWorkerPool::del();
+    ASSERT_NULL(getenv("CYPHESIS_MIND_TOKEN"));
+    MindWorkerPool::init(0, "cyaiclient");
+    m_pool = MindWorkerPool::instance();
+    ASSERT_NOT_EQUAL(m_pool->m_token, old_token);
+    ASSERT_TRUE(!m_pool->checkToken(old_token));
+}
+
+int main()
+{
+    MindWorkerPooltest t;
+
+    return t.run();
+}
+
+// stubs
+
+#include "common/globals.h"
+
+#include "stubs/server/stubConnection.h"
+#include "stubs/common/stubLink.h"
+
+MindWorkerAccount::MindWorkerAccount(Connection * conn,
+                                     const std::string & username,
+                                     const std::string & passwd,
+                                     const std::string & id, long intId) :
+                   Account(conn, username, passwd, id, intId)
+{
+}
+
+MindWorkerAccount::~MindWorkerAccount()
+{
+}
+
+const char * MindWorkerAccount::getType() const
+{
+    return "mind";
+}
+
+bool MindWorkerAccount::isPersisted() const
+{
+    return false;
+}
+
+int MindWorkerAccount::characterError(const Operation & op,
+                                      const Atlas::Objects::Root & ent,
+                                      OpVector & res) const
+{
+    return -1;
+}
+
+int MindWorkerAccount::hostMind(Character & chr, const MapType & mind)
+{
+    stub_hostMind_calls.push_back(std::make_pair(this, chr.getIntId()));
+    return stub_hostMind_result;
+}
+
+#include "stubs/server/stubAccount.h"
+
+ConnectableRouter::ConnectableRouter(const std::string & id,
+                                 long iid,
+                                 Connection *c) :
+                 Router(id, iid),
+                 m_connection(c)
+{
+}
+
+ConnectableRouter::~ConnectableRouter()
+{
+}
+
+#include "stubs/rulesets/stubCharacter.h"
+#include "stubs/rulesets/stubThing.h"
+#include "stubs/rulesets/stubEntity.h"
+#include "stubs/rulesets/stubLocatedEntity.h"
+#include "stubs/common/stubRouter.h"
+#include "stubs/common/stubTypeNode.h"
+#include "stubs/modules/stubLocation.h"
+#include "common/Property_impl.h"
+#include "stubs/common/stubProperty.h"
+#include "stubs/common/stubBaseWorld.h"
+
+std::string instance("cyphesis");
+
+int check_password(const std::string & pwd, const std::string & hash)
+{
+    return pwd == hash ? 0 : -1;
+}
+
+void log(LogLevel lvl, const std::string & msg)
+{
+}
+
+void logEvent(LogEvent lev, const std::string & msg)
+{
+}
+
+void addToEntity(const Vector3D & v, std::vector<double> & vd)
+{
+    vd.resize(3);
+    vd[0] = v[0];
+    vd[1] = v[1];
+    vd[2] = v[2];
+}
@@ -23,6 +23,7 @@
 #define DEBUG
 #endif
 
+#include "common/Histogram.h"
 #include "common/Monitors.h"
 #include "common/Variable.h"
 
@@ -54,6 +55,23 @@ int main()
     ss.clear();
     assert(m->readVariable("nonexistent",ss) != 0);
 
+    Histogram * h = m->histogram("baz_usec{op=\"move\"}");
+    assert(h != 0);
+    assert(m->histogram("baz_usec{op=\"move\"}") == h);
+    assert(m->histogram("baz_usec{op=\"talk\"}") != h);
+    h->record(12);
+
+    {
+        // Histograms which only differ in labels share a type line.
+        std::stringstream hs;
+        m->send(hs);
+        std::string out = hs.str();
+        std::string::size_type type = out.find("# TYPE baz_usec histogram\n");
+        assert(type != std::string::npos);
+        assert(out.find("# TYPE baz_usec", type + 1) == std::string::npos);
+        assert(out.find("baz_usec_count{op=\"move\"} 1\n") != std::string::npos);
+    }
+
     m->send(std::cout);
 
     Monitors::cleanup();
@@ -24,6 +24,7 @@
 #endif
 
 #include "TestBase.h"
+#include "TestWorld.h"
 
 #include "rulesets/Motion.h"
 
@@ -61,6 +62,7 @@ class Motiontest : public Cyphesis::TestBase
     void test_checkCollision_inner2();
     void test_checkCollision_inner3();
     void test_checkCollision_inner4();
+    void test_tick_stop_restart();
 };
 
 void Motiontest::setup()
@@ -112,6 +114,7 @@ Motiontest::Motiontest()
     ADD_TEST(Motiontest::test_checkCollision_inner2);
     ADD_TEST(Motiontest::test_checkCollision_inner3);
     ADD_TEST(Motiontest::test_checkCollision_inner4);
+    ADD_TEST(Motiontest::test_tick_stop_restart);
 }
 
 void Motiontest::teardown()
@@ -362,6 +365,41 @@ void Motiontest::test_checkCollision_inner4()
     inner.m_location.m_loc = 0;
 }
 
+void Motiontest::test_tick_stop_restart()
+{
+    TestWorld world(*tlve);
+
+    ent->m_location.m_bBox = BBox(Point3D(-1,-1,-1), Point3D(1,1,1));
+    ent->m_location.update(0);
+    other->m_location.m_bBox = BBox(Point3D(-1,-1,-1), Point3D(5,1,1));
+    other->m_location.m_pos = Point3D(3, 0, 0);
+
+    // Predict a collision, and hand the motion to the domain.
+    motion->checkCollisions();
+    assert(motion->collision());
+    motion->m_collisionTime = 0.5f;
+    ASSERT_TRUE(domain->addMover(*ent, *motion, 0.));
+
+    // The entity stops before getting there.
+    ent->m_location.m_velocity = Vector3D(0,0,0);
+    domain->tick(0.1);
+    ASSERT_TRUE(!motion->collision());
+    ASSERT_EQUAL(motion->m_collisionTime, 0.f);
+
+    // Once it starts moving again, somewhere else, the old collision
+    // mustn't cut its movement short.
+    other->m_location.m_pos = Point3D(100, 0, 0);
+    ent->m_location.m_pos = Point3D(1, 1, 0);
+    ent->m_location.m_velocity = Vector3D(1,0,0);
+    ent->m_location.update(1.);
+    ASSERT_TRUE(domain->addMover(*ent, *motion, 1.));
+    domain->tick(2.);
+    ASSERT_EQUAL(ent->m_location.pos().x(), 2.f);
+    ASSERT_TRUE(!motion->collision());
+
+    domain->removeMover(*ent);
+}
+
 int main()
 {
     Motiontest t;
@@ -371,6 +409,7 @@ int main()
 
 // stubs
 
+#include "common/BaseWorld.h"
 #include "common/const.h"
 #include "common/log.h"
 #include "common/Property_impl.h"
@@ -506,12 +545,27 @@ void LocatedEntity::removeChild(LocatedEntity& childEntity)
 
 }
 #include "stubs/common/stubRouter.h"
+#include "stubs/common/stubBaseWorld.h"
 #include "stubs/modules/stubLocation.h"
 #include "stubs/common/stubTypeNode.h"
 #include "stubs/common/stubProperty.h"
 #include "rulesets/EntityProperty.h"
 #include "stubs/rulesets/stubEntityProperty.h"
 
+namespace Atlas { namespace Objects { namespace Operation {
+int TICK_NO = -1;
+} } }
+
+void TestWorld::message(const Operation & op, LocatedEntity & ent)
+{
+}
+
+LocatedEntity * TestWorld::addNewEntity(const std::string &,
+                                        const Atlas::Objects::Entity::RootEntity &)
+{
+    return 0;
+}
+
 void log(LogLevel lvl, const std::string & msg)
 {
 }
@@ -520,6 +520,10 @@ int CommSocket::flush()
     return 0;
 }
 
+int client_send_high_watermark = 1 << 20;
+int client_send_low_watermark = 1 << 18;
+int client_send_timeout = 30;
+
 ExternalMind::ExternalMind(LocatedEntity & e) : Router(e.getId(), e.getIntId()),
                                          m_external(0), m_entity(e)
 {
@@ -562,6 +566,10 @@ void Link::send(const Operation & op) const
     stub_CommClient_sent_op = op;
 }
 
+void Link::sendPending() const
+{
+}
+
 void Link::disconnect()
 {
 }
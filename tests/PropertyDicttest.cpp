@@ -0,0 +1,182 @@
+// Cyphesis Online RPG Server and AI Engine
+// Copyright (C) 2014 Erik Ogenvik
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+#ifndef DEBUG
+#define DEBUG
+#endif
+
+#include "TestBase.h"
+
+#include "common/PropertyDict.h"
+
+class PropertyDicttest : public Cyphesis::TestBase
+{
+  protected:
+    PropertyDict * m_dict;
+  public:
+    PropertyDicttest();
+
+    void setup();
+    void teardown();
+
+    void test_keys();
+    void test_insert_find();
+    void test_find_key();
+    void test_iterate();
+    void test_sorted();
+    void test_erase();
+};
+
+PropertyDicttest::PropertyDicttest()
+{
+    ADD_TEST(PropertyDicttest::test_keys);
+    ADD_TEST(PropertyDicttest::test_insert_find);
+    ADD_TEST(PropertyDicttest::test_find_key);
+    ADD_TEST(PropertyDicttest::test_iterate);
+    ADD_TEST(PropertyDicttest::test_sorted);
+    ADD_TEST(PropertyDicttest::test_erase);
+}
+
+void PropertyDicttest::setup()
+{
+    m_dict = new PropertyDict;
+}
+
+void PropertyDicttest::teardown()
+{
+    delete m_dict;
+}
+
+// The dict never dereferences the pointers it stores.
+static PropertyBase * fake(long i)
+{
+    return reinterpret_cast<PropertyBase *>(i);
+}
+
+void PropertyDicttest::test_keys()
+{
+    ASSERT_EQUAL(PropertyKeys::lookup("test_keys_unseen"), -1);
+    int key = PropertyKeys::intern("test_keys_seen");
+    ASSERT_TRUE(key >= 0);
+    ASSERT_EQUAL(PropertyKeys::intern("test_keys_seen"), key);
+    ASSERT_EQUAL(PropertyKeys::lookup("test_keys_seen"), key);
+    ASSERT_EQUAL(PropertyKeys::name(key), "test_keys_seen");
+    ASSERT_NOT_EQUAL(PropertyKeys::intern("test_keys_other"), key);
+}
+
+void PropertyDicttest::test_insert_find()
+{
+    ASSERT_TRUE(m_dict->empty());
+    ASSERT_TRUE(m_dict->find("mode") == m_dict->end());
+
+    (*m_dict)["mode"] = fake(1);
+    (*m_dict)["bbox"] = fake(2);
+    (*m_dict)["outfit"] = fake(3);
+    ASSERT_EQUAL(m_dict->size(), 3u);
+
+    PropertyDict::const_iterator I = m_dict->find("bbox");
+    ASSERT_TRUE(I != m_dict->end());
+    ASSERT_EQUAL(I->first, "bbox");
+    ASSERT_EQUAL(I->second, fake(2));
+
+    // Assigning to an existing name replaces the entry.
+    (*m_dict)["bbox"] = fake(4);
+    ASSERT_EQUAL(m_dict->size(), 3u);
+    ASSERT_EQUAL(m_dict->find("bbox")->second, fake(4));
+
+    // A name known to the interner, but not in this dict.
+    PropertyKeys::intern("test_insert_find_absent");
+    ASSERT_TRUE(m_dict->find("test_insert_find_absent") == m_dict->end());
+}
+
+void PropertyDicttest::test_find_key()
+{
+    (*m_dict)["mode"] = fake(1);
+    int key = PropertyKeys::lookup("mode");
+    ASSERT_TRUE(key >= 0);
+    ASSERT_TRUE(m_dict->find(key) != m_dict->end());
+    ASSERT_EQUAL(m_dict->find(key)->second, fake(1));
+    ASSERT_TRUE(m_dict->find(-1) == m_dict->end());
+
+    const PropertyDict & dict = *m_dict;
+    ASSERT_TRUE(dict.find(key) != dict.end());
+    ASSERT_TRUE(dict.find("mode") != dict.end());
+}
+
+void PropertyDicttest::test_iterate()
+{
+    (*m_dict)["a"] = fake(1);
+    (*m_dict)["b"] = fake(2);
+    (*m_dict)["c"] = fake(3);
+
+    long sum = 0;
+    for (auto & entry : *m_dict) {
+        ASSERT_EQUAL(m_dict->find(entry.first)->second, entry.second);
+        sum += reinterpret_cast<long>(entry.second);
+    }
+    ASSERT_EQUAL(sum, 6);
+}
+
+void PropertyDicttest::test_sorted()
+{
+    // Interned in the opposite order to their names.
+    (*m_dict)["test_sorted_c"] = fake(1);
+    (*m_dict)["test_sorted_b"] = fake(2);
+    (*m_dict)["test_sorted_a"] = fake(3);
+
+    std::vector<const PropertyDict::value_type *> entries = m_dict->sorted();
+    ASSERT_EQUAL(entries.size(), 3u);
+    ASSERT_EQUAL(entries[0]->first, "test_sorted_a");
+    ASSERT_EQUAL(entries[0]->second, fake(3));
+    ASSERT_EQUAL(entries[1]->first, "test_sorted_b");
+    ASSERT_EQUAL(entries[2]->first, "test_sorted_c");
+    ASSERT_EQUAL(entries[2]->second, fake(1));
+}
+
+void PropertyDicttest::test_erase()
+{
+    (*m_dict)["a"] = fake(1);
+    (*m_dict)["b"] = fake(2);
+    (*m_dict)["c"] = fake(3);
+
+    ASSERT_EQUAL(m_dict->erase("b"), 1u);
+    ASSERT_EQUAL(m_dict->erase("b"), 0u);
+    ASSERT_TRUE(m_dict->find("b") == m_dict->end());
+    ASSERT_EQUAL(m_dict->find("a")->second, fake(1));
+    ASSERT_EQUAL(m_dict->find("c")->second, fake(3));
+
+    PropertyDict::iterator I = m_dict->begin();
+    while (I != m_dict->end()) {
+        I = m_dict->erase(I);
+    }
+    ASSERT_TRUE(m_dict->empty());
+    ASSERT_TRUE(m_dict->find("a") == m_dict->end());
+
+    (*m_dict)["c"] = fake(5);
+    m_dict->clear();
+    ASSERT_TRUE(m_dict->empty());
+}
+
+int main()
+{
+    PropertyDicttest t;
+
+    return t.run();
+}
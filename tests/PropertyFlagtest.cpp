@@ -116,6 +116,7 @@ using Atlas::Objects::Entity::RootEntity;
 
 
 Motion::Motion(LocatedEntity & body, Domain& domain) : m_entity(body), m_domain(domain), m_serialno(0),
+                                m_updateHandle(0),
                                 m_collision(false), m_collEntity(0),
                                 m_collisionTime(0.f)
 {
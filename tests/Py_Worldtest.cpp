@@ -49,6 +49,11 @@ int main()
     run_python_string("w.get_object('0')");
     run_python_string("w.get_object('1')");
     expect_python_error("w.get_object(1)", PyExc_TypeError);
+    run_python_string("assert w.find_all_by_name('foo') == []");
+    expect_python_error("w.find_all_by_name(1)", PyExc_TypeError);
+    run_python_string("assert w.find_all_by_type('thing') == []");
+    run_python_string("assert w.find_all_by_type('thing', False) == []");
+    expect_python_error("w.find_all_by_type(1)", PyExc_TypeError);
     run_python_string("w == World()");
 
     shutdown_python_api();
@@ -36,6 +36,7 @@
 #include "common/Tick.h"
 #include "common/BaseWorld.h"
 
+#include <Atlas/Objects/Generic.h>
 #include <Atlas/Objects/Operation.h>
 
 #include <cassert>
@@ -105,6 +106,8 @@ int main()
                       "  return Operation('sight')\n"
                       " def move_operation(self, op):\n"
                       "  return Operation('sight') + Operation('move')\n"
+                      " def sight_move_operation(self, op): pass\n"
+                      " def custom_operation(self, op): pass\n"
                       " def test_hook(self, ent): pass\n");
     run_python_string("testmod.TestEntity=TestEntity");
 
@@ -146,6 +149,26 @@ int main()
     Script * script = e->script();
     assert(script != 0);
 
+    // Handlers are found by class number once the type has been seen
+    assert(script->dispatch(Script::OPERATION_HANDLERS, op1, res));
+    assert(script->dispatch(Script::OPERATION_HANDLERS, op1, res));
+    assert(!script->dispatch(Script::OPERATION_HANDLERS, op2, res));
+    assert(!script->dispatch(Script::OPERATION_HANDLERS, op2, res));
+    assert(script->dispatch(Script::SIGHT_HANDLERS, op6, res));
+    assert(!script->dispatch(Script::SOUND_HANDLERS, op6, res));
+    assert(script->operation("look", op1, res));
+    assert(script->operation("sight_move", op6, res));
+    assert(!script->operation("create", op2, res));
+
+    // Operations of types with no class share a class number
+    Atlas::Objects::Operation::Generic op8;
+    op8->setParents(std::list<std::string>(1, "other"));
+    assert(!script->dispatch(Script::OPERATION_HANDLERS, op8, res));
+    Atlas::Objects::Operation::Generic op9;
+    op9->setParents(std::list<std::string>(1, "custom"));
+    assert(script->dispatch(Script::OPERATION_HANDLERS, op9, res));
+    assert(!script->dispatch(Script::OPERATION_HANDLERS, op8, res));
+
     script->hook("nohookfunction", e);
     script->hook("test_hook", e);
 
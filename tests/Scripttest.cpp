@@ -39,5 +39,8 @@ int main()
     bool ret = test_script.operation("op", op, res);
     assert(!ret);
 
+    ret = test_script.dispatch(Script::OPERATION_HANDLERS, op, res);
+    assert(!ret);
+
     test_script.hook("function", 0);
 }
@@ -0,0 +1,134 @@
+/*
+ Copyright (C) 2014 Erik Ogenvik
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+#ifndef DEBUG
+#define DEBUG
+#endif
+
+#include "rulesets/SpatialIndex.h"
+
+#include <algorithm>
+
+#include <cassert>
+
+static char entityStorage[4];
+
+static LocatedEntity * const entity1 = reinterpret_cast<LocatedEntity*>(&entityStorage[0]);
+static LocatedEntity * const entity2 = reinterpret_cast<LocatedEntity*>(&entityStorage[1]);
+static LocatedEntity * const entity3 = reinterpret_cast<LocatedEntity*>(&entityStorage[2]);
+static LocatedEntity * const entity4 = reinterpret_cast<LocatedEntity*>(&entityStorage[3]);
+
+static bool found(const std::vector<LocatedEntity*>& result, LocatedEntity* entity)
+{
+    return std::count(result.begin(), result.end(), entity) == 1;
+}
+
+int main()
+{
+    {
+        SpatialIndex index;
+        assert(index.size() == 0);
+
+        index.insert(entity1, Point3D(0, 0, 0), 1.f);
+        index.insert(entity2, Point3D(1000, 1000, 0), 1.f);
+        assert(index.size() == 2);
+        assert(index.contains(entity1));
+        assert(index.contains(entity2));
+
+        std::vector<LocatedEntity*> result;
+        index.findCandidates(0, 0, 0, 0, 10, result);
+        assert(found(result, entity1));
+        assert(!found(result, entity2));
+
+        result.clear();
+        index.findCandidates(990, 990, 990, 990, 20, result);
+        assert(!found(result, entity1));
+        assert(found(result, entity2));
+
+        // Moving an entity updates its placement.
+        index.insert(entity2, Point3D(2, 2, 0), 1.f);
+        assert(index.size() == 2);
+        result.clear();
+        index.findCandidates(0, 0, 0, 0, 10, result);
+        assert(found(result, entity1));
+        assert(found(result, entity2));
+
+        index.remove(entity1);
+        assert(!index.contains(entity1));
+        assert(index.size() == 1);
+        result.clear();
+        index.findCandidates(0, 0, 0, 0, 10, result);
+        assert(!found(result, entity1));
+        assert(found(result, entity2));
+
+        // Removing something not present is a no-op.
+        index.remove(entity1);
+        assert(index.size() == 1);
+    }
+
+    {
+        // An entity with a large reach is found even when the queried
+        // radius is small.
+        SpatialIndex index(8.f, 4);
+        index.insert(entity1, Point3D(0, 0, 0), 50.f);
+        index.insert(entity2, Point3D(0, 0, 0), 2.f);
+
+        std::vector<LocatedEntity*> result;
+        index.findCandidates(45, 0, 45, 0, 1, result);
+        assert(found(result, entity1));
+        assert(!found(result, entity2));
+
+        // An entity with a reach larger than the coarsest level is always
+        // found.
+        index.insert(entity3, Point3D(0, 0, 0), 1000.f);
+        result.clear();
+        index.findCandidates(5000, 5000, 5000, 5000, 1, result);
+        assert(found(result, entity3));
+        assert(!found(result, entity1));
+    }
+
+    {
+        // Entities without a valid position are always found.
+        SpatialIndex index;
+        index.insert(entity4, Point3D(), 1.f);
+        std::vector<LocatedEntity*> result;
+        index.findCandidates(100, 100, 100, 100, 1, result);
+        assert(found(result, entity4));
+    }
+
+    {
+        // Negative coordinates and areas spanning many cells.
+        SpatialIndex index(1.f, 2);
+        index.insert(entity1, Point3D(-10, -10, 0), 0.5f);
+        index.insert(entity2, Point3D(10, 10, 0), 0.5f);
+        std::vector<LocatedEntity*> result;
+        index.findCandidates(-20, -20, 20, 20, 0, result);
+        assert(found(result, entity1));
+        assert(found(result, entity2));
+
+        result.clear();
+        index.findCandidates(-11, -11, -9, -9, 0, result);
+        assert(found(result, entity1));
+        assert(!found(result, entity2));
+    }
+
+    return 0;
+}
@@ -64,7 +64,9 @@ class TestStorageManager : public StorageManager
         updateEntity(e);
     }
     void test_restoreChildren(LocatedEntity * e) {
-        restoreChildren(e);
+        RestoredEntities restored;
+        readEntities(restored);
+        restoreChildren(e, restored);
     }
 
 
@@ -308,6 +310,13 @@ bool Script::operation(const std::string & opname,
    return false;
 }
 
+bool Script::dispatch(Handlers handlers,
+                      const Atlas::Objects::Operation::RootOperation & op,
+                      OpVector & res)
+{
+   return false;
+}
+
 void Script::hook(const std::string & function, LocatedEntity * entity)
 {
 }
@@ -344,6 +353,11 @@ const char * DatabaseResult::const_iterator::column(const char * column) const
     return "";
 }
 
+const char * DatabaseResult::field(const char * column, int row) const
+{
+    return "";
+}
+
 VariableBase::~VariableBase()
 {
 }
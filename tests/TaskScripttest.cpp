@@ -166,6 +166,13 @@ bool Script::operation(const std::string & opname,
    return false;
 }
 
+bool Script::dispatch(Handlers handlers,
+                      const Atlas::Objects::Operation::RootOperation & op,
+                      OpVector & res)
+{
+   return operation(op->getParents().front(), op, res);
+}
+
 void Script::hook(const std::string & function, LocatedEntity * entity)
 {
 }
@@ -246,6 +246,13 @@ bool Script::operation(const std::string & opname,
    return Tasktest::get_Script_operation_ret();
 }
 
+bool Script::dispatch(Handlers handlers,
+                      const Atlas::Objects::Operation::RootOperation & op,
+                      OpVector & res)
+{
+   return operation(op->getParents().front(), op, res);
+}
+
 void Script::hook(const std::string & function, LocatedEntity * entity)
 {
 }
@@ -0,0 +1,201 @@
+// Cyphesis Online RPG Server and AI Engine
+// Copyright (C) 2014 Erik Ogenvik
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+#ifndef DEBUG
+#define DEBUG
+#endif
+
+#include "TestBase.h"
+
+#include "rulesets/TerrainSegmentCache.h"
+
+#include <Mercator/Terrain.h>
+#include <Mercator/Segment.h>
+
+#include <chrono>
+
+class TerrainSegmentCachetest : public Cyphesis::TestBase
+{
+  protected:
+    Mercator::Terrain * m_terrain;
+    TerrainSegmentCache * m_cache;
+    std::size_t m_segmentBytes;
+
+    void waitForBytes(std::size_t bytes);
+  public:
+    TerrainSegmentCachetest();
+
+    void setup();
+    void teardown();
+
+    void test_acquire();
+    void test_prefetch();
+    void test_budget();
+    void test_resume();
+    void test_shared_workers();
+};
+
+TerrainSegmentCachetest::TerrainSegmentCachetest()
+{
+    ADD_TEST(TerrainSegmentCachetest::test_acquire);
+    ADD_TEST(TerrainSegmentCachetest::test_prefetch);
+    ADD_TEST(TerrainSegmentCachetest::test_budget);
+    ADD_TEST(TerrainSegmentCachetest::test_resume);
+    ADD_TEST(TerrainSegmentCachetest::test_shared_workers);
+}
+
+void TerrainSegmentCachetest::setup()
+{
+    // Four by four points make three by three segments.
+    m_terrain = new Mercator::Terrain;
+    for (int x = 0; x < 4; ++x) {
+        for (int y = 0; y < 4; ++y) {
+            m_terrain->setBasePoint(x, y, x + y);
+        }
+    }
+    std::size_t size = m_terrain->getResolution() + 1;
+    m_segmentBytes = size * size * sizeof(float);
+    m_cache = new TerrainSegmentCache(*m_terrain);
+}
+
+void TerrainSegmentCachetest::teardown()
+{
+    delete m_cache;
+    delete m_terrain;
+    TerrainSegmentCache::s_threads = 0;
+    TerrainSegmentCache::s_budget = 0;
+}
+
+void TerrainSegmentCachetest::waitForBytes(std::size_t bytes)
+{
+    for (int i = 0; i < 1000 && m_cache->readyBytes() != bytes; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+void TerrainSegmentCachetest::test_acquire()
+{
+    Mercator::Segment * segment = m_terrain->getSegment(1, 1);
+    ASSERT_NOT_NULL(segment);
+    ASSERT_TRUE(!segment->isValid());
+
+    m_cache->acquire(*segment);
+    ASSERT_TRUE(segment->isValid());
+    ASSERT_EQUAL(m_cache->misses(), 1);
+    ASSERT_EQUAL(m_cache->readyBytes(), m_segmentBytes);
+
+    m_cache->acquire(*segment);
+    ASSERT_EQUAL(m_cache->misses(), 1);
+    ASSERT_EQUAL(m_cache->readyBytes(), m_segmentBytes);
+}
+
+void TerrainSegmentCachetest::test_prefetch()
+{
+    TerrainSegmentCache::s_threads = 1;
+
+    m_cache->acquire(*m_terrain->getSegment(1, 1));
+    ASSERT_EQUAL(m_cache->misses(), 1);
+
+    // The eight segments around it are populated by the worker.
+    waitForBytes(9 * m_segmentBytes);
+    ASSERT_EQUAL(m_cache->readyBytes(), 9 * m_segmentBytes);
+
+    m_cache->acquire(*m_terrain->getSegment(0, 0));
+    m_cache->acquire(*m_terrain->getSegment(2, 1));
+    ASSERT_EQUAL(m_cache->misses(), 1);
+}
+
+void TerrainSegmentCachetest::test_budget()
+{
+    TerrainSegmentCache::s_budget = 2 * m_segmentBytes;
+
+    Mercator::Segment * first = m_terrain->getSegment(0, 0);
+    Mercator::Segment * second = m_terrain->getSegment(1, 0);
+    Mercator::Segment * third = m_terrain->getSegment(2, 0);
+
+    m_cache->acquire(*first);
+    m_cache->acquire(*second);
+    m_cache->acquire(*first);
+    m_cache->acquire(*third);
+
+    // The segment used longest ago is released.
+    ASSERT_EQUAL(m_cache->readyBytes(), 2 * m_segmentBytes);
+    ASSERT_TRUE(first->isValid());
+    ASSERT_TRUE(!second->isValid());
+    ASSERT_TRUE(third->isValid());
+
+    m_cache->acquire(*second);
+    ASSERT_TRUE(second->isValid());
+    ASSERT_EQUAL(m_cache->misses(), 4);
+}
+
+void TerrainSegmentCachetest::test_resume()
+{
+    Mercator::Segment * segment = m_terrain->getSegment(0, 0);
+    Mercator::Segment * other = m_terrain->getSegment(2, 2);
+    m_cache->acquire(*segment);
+    m_cache->acquire(*other);
+    ASSERT_EQUAL(m_cache->readyBytes(), 2 * m_segmentBytes);
+
+    // Changing a point invalidates the segments around it.
+    m_cache->pause();
+    m_terrain->setBasePoint(0, 0, 10);
+    m_cache->resume();
+    ASSERT_EQUAL(m_cache->readyBytes(), m_segmentBytes);
+
+    m_cache->acquire(*segment);
+    ASSERT_TRUE(segment->isValid());
+    ASSERT_EQUAL(m_cache->misses(), 3);
+}
+
+void TerrainSegmentCachetest::test_shared_workers()
+{
+    TerrainSegmentCache::s_threads = 1;
+
+    Mercator::Terrain terrain;
+    for (int x = 0; x < 4; ++x) {
+        for (int y = 0; y < 4; ++y) {
+            terrain.setBasePoint(x, y, x - y);
+        }
+    }
+    TerrainSegmentCache * other = new TerrainSegmentCache(terrain);
+
+    m_cache->acquire(*m_terrain->getSegment(1, 1));
+    other->acquire(*terrain.getSegment(1, 1));
+
+    // Both terrains are populated by the same worker.
+    waitForBytes(9 * m_segmentBytes);
+    ASSERT_EQUAL(m_cache->readyBytes(), 9 * m_segmentBytes);
+    for (int i = 0; i < 1000 && other->readyBytes() != 9 * m_segmentBytes; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_EQUAL(other->readyBytes(), 9 * m_segmentBytes);
+    ASSERT_EQUAL(TerrainSegmentCache::workerCount(), 1);
+
+    delete other;
+}
+
+int main()
+{
+    TerrainSegmentCachetest t;
+
+    return t.run();
+}
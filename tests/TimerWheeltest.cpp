@@ -0,0 +1,232 @@
+// Cyphesis Online RPG Server and AI Engine
+// Copyright (C) 2014 Erik Ogenvik
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+#ifndef DEBUG
+#define DEBUG
+#endif
+
+#include "TestBase.h"
+
+#include "common/TimerWheel.h"
+
+class TimerWheeltest : public Cyphesis::TestBase
+{
+  protected:
+    TimerWheel<int> * m_wheel;
+  public:
+    TimerWheeltest();
+
+    void setup();
+    void teardown();
+
+    void test_empty();
+    void test_order();
+    void test_not_due();
+    void test_cancel();
+    void test_cancel_due();
+    void test_far_future();
+    void test_past();
+    void test_nextTime();
+    void test_clear();
+};
+
+TimerWheeltest::TimerWheeltest()
+{
+    ADD_TEST(TimerWheeltest::test_empty);
+    ADD_TEST(TimerWheeltest::test_order);
+    ADD_TEST(TimerWheeltest::test_not_due);
+    ADD_TEST(TimerWheeltest::test_cancel);
+    ADD_TEST(TimerWheeltest::test_cancel_due);
+    ADD_TEST(TimerWheeltest::test_far_future);
+    ADD_TEST(TimerWheeltest::test_past);
+    ADD_TEST(TimerWheeltest::test_nextTime);
+    ADD_TEST(TimerWheeltest::test_clear);
+}
+
+void TimerWheeltest::setup()
+{
+    m_wheel = new TimerWheel<int>(0.01);
+}
+
+void TimerWheeltest::teardown()
+{
+    delete m_wheel;
+}
+
+void TimerWheeltest::test_empty()
+{
+    ASSERT_TRUE(m_wheel->empty());
+    ASSERT_TRUE(!m_wheel->hasDue(100.));
+    double time;
+    ASSERT_TRUE(!m_wheel->nextTime(time));
+}
+
+void TimerWheeltest::test_order()
+{
+    // Spread over all levels, inserted out of order.
+    m_wheel->insert(5000., 5);
+    m_wheel->insert(1.005, 2);
+    m_wheel->insert(0.5, 1);
+    m_wheel->insert(30., 3);
+    m_wheel->insert(700., 4);
+    m_wheel->insert(1.001, 0);
+    ASSERT_EQUAL(m_wheel->size(), 6u);
+
+    ASSERT_TRUE(m_wheel->hasDue(10000.));
+
+    int expected[] = { 1, 0, 2, 3, 4, 5 };
+    for (int value : expected) {
+        ASSERT_TRUE(m_wheel->hasDue(10000.));
+        ASSERT_EQUAL(m_wheel->top(), value);
+        m_wheel->pop();
+    }
+    ASSERT_TRUE(!m_wheel->hasDue(10000.));
+    ASSERT_TRUE(m_wheel->empty());
+}
+
+void TimerWheeltest::test_not_due()
+{
+    m_wheel->insert(1.0, 1);
+    m_wheel->insert(1.004, 2);
+    m_wheel->insert(3.0, 3);
+
+    ASSERT_TRUE(!m_wheel->hasDue(0.9));
+    // Within the same tick as the second value, which isn't due yet.
+    ASSERT_TRUE(m_wheel->hasDue(1.002));
+    ASSERT_EQUAL(m_wheel->top(), 1);
+    ASSERT_EQUAL(m_wheel->topTime(), 1.0);
+    m_wheel->pop();
+    ASSERT_TRUE(!m_wheel->hasDue(1.002));
+
+    ASSERT_TRUE(m_wheel->hasDue(1.004));
+    ASSERT_EQUAL(m_wheel->top(), 2);
+    m_wheel->pop();
+
+    ASSERT_TRUE(!m_wheel->hasDue(2.999));
+    ASSERT_TRUE(m_wheel->hasDue(3.0));
+    ASSERT_EQUAL(m_wheel->top(), 3);
+    m_wheel->pop();
+    ASSERT_TRUE(m_wheel->empty());
+}
+
+void TimerWheeltest::test_cancel()
+{
+    TimerWheel<int>::Handle h1 = m_wheel->insert(1.0, 1);
+    TimerWheel<int>::Handle h2 = m_wheel->insert(20.0, 2);
+    m_wheel->insert(2.0, 3);
+    ASSERT_NOT_EQUAL(h1, 0u);
+    ASSERT_NOT_EQUAL(h1, h2);
+
+    ASSERT_TRUE(m_wheel->cancel(h1));
+    ASSERT_TRUE(m_wheel->cancel(h2));
+    ASSERT_TRUE(!m_wheel->cancel(h1));
+    ASSERT_EQUAL(m_wheel->size(), 1u);
+
+    ASSERT_TRUE(m_wheel->hasDue(100.));
+    ASSERT_EQUAL(m_wheel->top(), 3);
+    m_wheel->pop();
+    ASSERT_TRUE(!m_wheel->hasDue(100.));
+
+    // A reused node must not be cancellable through the old handle.
+    TimerWheel<int>::Handle h4 = m_wheel->insert(200., 4);
+    ASSERT_TRUE(!m_wheel->cancel(h1));
+    ASSERT_TRUE(!m_wheel->cancel(h2));
+    ASSERT_EQUAL(m_wheel->size(), 1u);
+    ASSERT_TRUE(m_wheel->cancel(h4));
+    ASSERT_TRUE(m_wheel->empty());
+}
+
+void TimerWheeltest::test_cancel_due()
+{
+    TimerWheel<int>::Handle h1 = m_wheel->insert(1.0, 1);
+    m_wheel->insert(1.5, 2);
+    TimerWheel<int>::Handle h3 = m_wheel->insert(1.7, 3);
+
+    ASSERT_TRUE(m_wheel->hasDue(2.));
+    ASSERT_TRUE(m_wheel->cancel(h1));
+    ASSERT_TRUE(m_wheel->cancel(h3));
+    ASSERT_EQUAL(m_wheel->top(), 2);
+    m_wheel->pop();
+    ASSERT_TRUE(!m_wheel->hasDue(2.));
+    ASSERT_TRUE(m_wheel->empty());
+}
+
+void TimerWheeltest::test_far_future()
+{
+    // Further away than the wheel covers.
+    m_wheel->insert(1.e8, 1);
+    ASSERT_TRUE(!m_wheel->hasDue(5.e7));
+    ASSERT_TRUE(!m_wheel->hasDue(9.9e7));
+    ASSERT_TRUE(m_wheel->hasDue(1.e8));
+    ASSERT_EQUAL(m_wheel->top(), 1);
+}
+
+void TimerWheeltest::test_past()
+{
+    ASSERT_TRUE(!m_wheel->hasDue(50.));
+    m_wheel->insert(10., 1);
+    ASSERT_TRUE(m_wheel->hasDue(50.));
+    ASSERT_EQUAL(m_wheel->top(), 1);
+}
+
+void TimerWheeltest::test_nextTime()
+{
+    double time;
+    m_wheel->insert(0.5, 1);
+    ASSERT_TRUE(m_wheel->nextTime(time));
+    ASSERT_EQUAL(time, 0.5);
+
+    m_wheel->insert(1000., 2);
+    ASSERT_TRUE(m_wheel->nextTime(time));
+    ASSERT_EQUAL(time, 0.5);
+
+    ASSERT_TRUE(m_wheel->hasDue(1.));
+    m_wheel->pop();
+
+    // The remaining value is on a coarse level; the time returned must
+    // not be later than it.
+    ASSERT_TRUE(m_wheel->nextTime(time));
+    ASSERT_TRUE(time <= 1000.);
+    ASSERT_TRUE(time > 1.);
+
+    ASSERT_TRUE(!m_wheel->hasDue(time));
+    ASSERT_TRUE(m_wheel->hasDue(1000.));
+    ASSERT_TRUE(m_wheel->nextTime(time));
+    ASSERT_EQUAL(time, 1000.);
+}
+
+void TimerWheeltest::test_clear()
+{
+    TimerWheel<int>::Handle h1 = m_wheel->insert(1., 1);
+    m_wheel->insert(100., 2);
+    m_wheel->clear();
+    ASSERT_TRUE(m_wheel->empty());
+    ASSERT_TRUE(!m_wheel->hasDue(1000.));
+    m_wheel->insert(2., 3);
+    ASSERT_TRUE(!m_wheel->cancel(h1));
+    ASSERT_EQUAL(m_wheel->size(), 1u);
+}
+
+int main()
+{
+    TimerWheeltest t;
+
+    return t.run();
+}
@@ -31,6 +31,8 @@
 #include "rulesets/ExternalMind.h"
 #include "rulesets/ExternalProperty.h"
 #include "server/Lobby.h"
+#include "server/MindWorkerAccount.h"
+#include "server/MindWorkerPool.h"
 #include "server/Player.h"
 #include "server/ServerRouting.h"
 #include "server/WorldRouter.h"
@@ -158,6 +160,28 @@ int main()
         assert(ac != 0);
     }
     
+    {
+        // Mind accounts can't be created without a pool of workers.
+        Account * ac = tc->test_newAccount("mind",
+                                           "bob",
+                                           "unit_test_hash",
+                                           "1", 1);
+
+        assert(ac == 0);
+    }
+
+    {
+        // Nor without the token the pool gives its workers.
+        MindWorkerPool::init(0, "cyaiclient");
+        Account * ac = tc->test_newAccount("mind",
+                                           "bob",
+                                           "unit_test_hash",
+                                           "1", 1);
+
+        assert(ac == 0);
+        MindWorkerPool::del();
+    }
+
     {
         Account * ac = tc->test_newAccount("player",
                                            "bob",
@@ -204,6 +228,8 @@ int CommSocket::flush()
 #include "stubs/server/stubAdmin.h"
 #include "stubs/server/stubPlayer.h"
 #include "stubs/server/stubSystemAccount.h"
+#include "stubs/server/stubMindWorkerAccount.h"
+#include "stubs/server/stubMindWorkerPool.h"
 #include "stubs/server/stubAccount.h"
 
 ConnectableRouter::ConnectableRouter(const std::string & id,
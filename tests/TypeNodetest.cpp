@@ -44,6 +44,25 @@ int main()
     assert(!foo.isTypeOf(&bar));
     assert(bar.isTypeOf(&foo));
 
+    // Once numbered, the intervals are used instead of the parents.
+    TypeNode baz("baz");
+    baz.setParent(&foo);
+    foo.setInterval(0, 9, 20);
+    bar.setInterval(1, 2, 4);
+    baz.setInterval(5, 6, 8);
+
+    assert(bar.isTypeOf(&foo));
+    assert(baz.isTypeOf(&foo));
+    assert(!baz.isTypeOf(&bar));
+    assert(!foo.isTypeOf(&baz));
+    assert(!baz.isTypeOf(0));
+
+    // Moving a node clears its interval, so the parents are walked.
+    baz.setParent(&bar);
+    assert(baz.intervalStart() == -1);
+    assert(baz.isTypeOf(&bar));
+    assert(baz.isTypeOf(&foo));
+
     foo.defaults();
     return 0;
 }
@@ -0,0 +1,147 @@
+/*
+ Copyright (C) 2014 Erik Ogenvik
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+// Times the two ways PhysicalDomain::calculateVisibility() checks the direct
+// children of the domain entity against a moved entity: the candidates from
+// the SpatialIndex one entity at a time, or a pass over the VisibilityArray
+// which only goes on with the entries in sight. Both include the index query,
+// as calculateVisibility() always does it to choose between them. This is not
+// run as part of "make check"; build it with "make VisibilityArraybenchmark".
+
+#include "rulesets/SpatialIndex.h"
+#include "rulesets/VisibilityArray.h"
+
+#include "common/const.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include <cstdlib>
+
+/// Stands in for the parts of an entity read by the visibility checks.
+struct Neighbour {
+    Point3D pos;
+    float squareBoxSize;
+};
+
+typedef std::chrono::steady_clock clock_type;
+
+static double elapsed(clock_type::time_point start, int passes)
+{
+    return std::chrono::duration<double, std::micro>(clock_type::now() - start).count() / passes;
+}
+
+/// Places count entities at random within a square of the given side.
+static void run(int count, float side)
+{
+    std::vector<Neighbour*> neighbours;
+    SpatialIndex index;
+    VisibilityArray array;
+    for (int i = 0; i < count; ++i) {
+        Neighbour* n = new Neighbour;
+        n->pos = Point3D((std::rand() % 20000) / 20000.f * side - side / 2,
+                         (std::rand() % 20000) / 20000.f * side - side / 2,
+                         (std::rand() % 100) / 10.f);
+        n->squareBoxSize = (std::rand() % 1000) / 100.f;
+        neighbours.push_back(n);
+        LocatedEntity* entity = reinterpret_cast<LocatedEntity*>(n);
+        index.insert(entity, n->pos,
+                     std::sqrt(n->squareBoxSize / consts::square_sight_factor));
+        array.insert(entity, n->pos, n->squareBoxSize);
+    }
+
+    const Point3D old_pos(0, 0, 0), new_pos(1, 1, 0);
+    const float fromSquSize = 4.f;
+    const float reach = std::sqrt(fromSquSize / consts::square_sight_factor);
+    int passes = std::max(1, 2000000 / count);
+
+    std::vector<LocatedEntity*> candidates;
+    index.findCandidates(old_pos.x(), old_pos.y(), new_pos.x(), new_pos.y(),
+                         reach, candidates);
+    bool packed = candidates.size() * 8 > array.size();
+
+    // The candidates of the index, following a pointer to each entity.
+    long seen = 0;
+    clock_type::time_point start = clock_type::now();
+    for (int pass = 0; pass < passes; ++pass) {
+        candidates.clear();
+        index.findCandidates(old_pos.x(), old_pos.y(), new_pos.x(), new_pos.y(),
+                             reach, candidates);
+        for (LocatedEntity* entity : candidates) {
+            const Neighbour* other = reinterpret_cast<Neighbour*>(entity);
+            EntityVisibility visibility = VisibilityArray::calculateEntity(
+                    other->pos, other->squareBoxSize, old_pos, new_pos,
+                    fromSquSize);
+            if (visibility.wasSeen || visibility.isSeen ||
+                visibility.couldSee || visibility.canSee) {
+                ++seen;
+            }
+        }
+    }
+    double index_time = elapsed(start, passes);
+
+    // One pass over the array, then the entries with any bit set.
+    VisibilityMasks masks;
+    start = clock_type::now();
+    for (int pass = 0; pass < passes; ++pass) {
+        candidates.clear();
+        index.findCandidates(old_pos.x(), old_pos.y(), new_pos.x(), new_pos.y(),
+                             reach, candidates);
+        array.calculate(old_pos, new_pos, fromSquSize, masks);
+        for (std::size_t word = 0; word < masks.wasSeen.size(); ++word) {
+            std::uint32_t bits = masks.any(word);
+            for (std::size_t i = word * 32; bits != 0; ++i, bits >>= 1) {
+                if ((bits & 1) != 0 && array.entity(i) != 0) {
+                    ++seen;
+                }
+            }
+        }
+    }
+    double array_time = elapsed(start, passes);
+
+    std::cout << count << " neighbours in " << side << "x" << side << ", "
+              << candidates.size() << " candidates: "
+              << "index " << index_time << "us, "
+              << "array " << array_time << "us, "
+              << "uses " << (packed ? "array" : "index")
+              << " (" << seen << ")" << std::endl;
+
+    for (Neighbour* n : neighbours) {
+        delete n;
+    }
+}
+
+int main()
+{
+#if defined(__AVX__)
+    std::cout << "Using AVX" << std::endl;
+#elif defined(__SSE__)
+    std::cout << "Using SSE" << std::endl;
+#else
+    std::cout << "Using scalar code only" << std::endl;
+#endif
+    for (int count : {1000, 10000, 100000}) {
+        // Spread out over a large world, and crowded together.
+        run(count, 2000.f);
+        run(count, 200.f);
+    }
+    return 0;
+}
@@ -0,0 +1,163 @@
+/*
+ Copyright (C) 2014 Erik Ogenvik
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+#ifndef DEBUG
+#define DEBUG
+#endif
+
+#include "rulesets/VisibilityArray.h"
+
+#include <cstdlib>
+#include <vector>
+
+#include <cassert>
+
+static char entityStorage[200];
+
+static LocatedEntity * entityAt(int i)
+{
+    return reinterpret_cast<LocatedEntity*>(&entityStorage[i]);
+}
+
+static bool sameMasks(const VisibilityMasks& a, const VisibilityMasks& b)
+{
+    return a.wasSeen == b.wasSeen && a.isSeen == b.isSeen &&
+           a.couldSee == b.couldSee && a.canSee == b.canSee;
+}
+
+int main()
+{
+    {
+        VisibilityArray array;
+        assert(array.size() == 0);
+
+        array.insert(entityAt(0), Point3D(0, 0, 0), 1.f);
+        array.insert(entityAt(1), Point3D(1000, 0, 0), 1.f);
+        array.insert(entityAt(2), Point3D(2, 0, 0), 1.f);
+        assert(array.size() == 3);
+        assert(array.contains(entityAt(1)));
+
+        // Updating an entity doesn't add another entry.
+        array.insert(entityAt(1), Point3D(1, 0, 0), 1.f);
+        assert(array.size() == 3);
+
+        // The last entry takes the place of a removed one.
+        array.remove(entityAt(0));
+        assert(array.size() == 2);
+        assert(!array.contains(entityAt(0)));
+        assert(array.entity(0) == entityAt(2));
+        assert(array.entity(1) == entityAt(1));
+
+        array.remove(entityAt(0));
+        assert(array.size() == 2);
+    }
+
+    {
+        VisibilityArray array;
+        // A small entity next to the moved entity's old position.
+        array.insert(entityAt(0), Point3D(0, 1, 0), 0.1f);
+        // A large entity next to its new position.
+        array.insert(entityAt(1), Point3D(1000, 1, 0), 100.f);
+        // An entity without a position.
+        array.insert(entityAt(2), Point3D(), 100.f);
+
+        VisibilityMasks masks;
+        array.calculate(Point3D(0, 0, 0), Point3D(1000, 0, 0), 1.f, masks);
+        assert(masks.wasSeen.size() == 1);
+
+        assert(VisibilityMasks::test(masks.wasSeen, 0));
+        assert(!VisibilityMasks::test(masks.isSeen, 0));
+        assert(VisibilityMasks::test(masks.couldSee, 0));
+        assert(!VisibilityMasks::test(masks.canSee, 0));
+
+        assert(!VisibilityMasks::test(masks.wasSeen, 1));
+        assert(VisibilityMasks::test(masks.isSeen, 1));
+        assert(!VisibilityMasks::test(masks.couldSee, 1));
+        assert(VisibilityMasks::test(masks.canSee, 1));
+
+        assert(!VisibilityMasks::test(masks.wasSeen, 2));
+        assert(!VisibilityMasks::test(masks.isSeen, 2));
+        assert(!VisibilityMasks::test(masks.couldSee, 2));
+        assert(!VisibilityMasks::test(masks.canSee, 2));
+    }
+
+    // The vectorised and scalar versions must agree, including on the
+    // entries left over after the last full vector.
+    for (int count = 0; count < 200; count += 7) {
+        VisibilityArray array;
+        for (int i = 0; i < count; ++i) {
+            array.insert(entityAt(i),
+                         Point3D(std::rand() % 200 - 100,
+                                 std::rand() % 200 - 100,
+                                 std::rand() % 10),
+                         (std::rand() % 1000) / 100.f);
+        }
+        VisibilityMasks masks, scalarMasks;
+        array.calculate(Point3D(3, 4, 0), Point3D(10, -20, 1), 4.f, masks);
+        array.calculateScalar(Point3D(3, 4, 0), Point3D(10, -20, 1), 4.f,
+                              scalarMasks);
+        assert(masks.wasSeen.size() == (count + 31u) / 32);
+        assert(sameMasks(masks, scalarMasks));
+    }
+
+    // The visibility of each entry in the masks, and the entries with any
+    // bit set, are the same as working out each entity from its location.
+    {
+        VisibilityArray array;
+        std::vector<Point3D> positions;
+        std::vector<float> sizes;
+        for (int i = 0; i < 100; ++i) {
+            positions.push_back(Point3D(std::rand() % 40 - 20,
+                                        std::rand() % 40 - 20, 0));
+            sizes.push_back((std::rand() % 1000) / 100.f);
+            array.insert(entityAt(i), positions[i], sizes[i]);
+        }
+        // Locations written after they were first inserted.
+        positions[3] = Point3D(4, 4, 0);
+        positions[10] = Point3D(-18, 19, 0);
+        sizes[20] = 50.f;
+        positions[30] = Point3D();
+        for (int i : {3, 10, 20, 30}) {
+            array.insert(entityAt(i), positions[i], sizes[i]);
+        }
+        array.remove(entityAt(50));
+
+        Point3D oldPos(3, 4, 0), newPos(5, 5, 0);
+        VisibilityMasks masks;
+        array.calculate(oldPos, newPos, 4.f, masks);
+
+        for (std::size_t i = 0; i < array.size(); ++i) {
+            int n = reinterpret_cast<char*>(array.entity(i)) - entityStorage;
+            EntityVisibility packed = masks.get(i);
+            EntityVisibility live = VisibilityArray::calculateEntity(
+                    positions[n], sizes[n], oldPos, newPos, 4.f);
+            assert(packed.wasSeen == live.wasSeen);
+            assert(packed.isSeen == live.isSeen);
+            assert(packed.couldSee == live.couldSee);
+            assert(packed.canSee == live.canSee);
+            bool any = (masks.any(i / 32) >> (i % 32)) & 1;
+            assert(any == (live.wasSeen || live.isSeen ||
+                           live.couldSee || live.canSee));
+        }
+    }
+
+    return 0;
+}
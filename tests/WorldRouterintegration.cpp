@@ -38,6 +38,7 @@
 #include "common/id.h"
 #include "common/Inheritance.h"
 #include "common/log.h"
+#include "common/Histogram.h"
 #include "common/Monitors.h"
 #include "common/SystemTime.h"
 #include "common/Tick.h"
@@ -65,11 +66,13 @@ class WorldRouterintegration : public Cyphesis::TestBase
     void teardown();
 
     void test_sequence();
+    void test_indexes();
 };
 
 WorldRouterintegration::WorldRouterintegration()
 {
     ADD_TEST(WorldRouterintegration::test_sequence);
+    ADD_TEST(WorldRouterintegration::test_indexes);
 }
 
 void WorldRouterintegration::setup()
@@ -208,6 +211,53 @@ void WorldRouterintegration::test_sequence()
     delete test_world;
 }
 
+void WorldRouterintegration::test_indexes()
+{
+    database_flag = false;
+
+    WorldRouter * test_world = new WorldRouter(SystemTime());
+
+    Anonymous alice_ent;
+    alice_ent->setName("alice");
+    LocatedEntity * alice = test_world->addNewEntity("thing", alice_ent);
+    ASSERT_NOT_NULL(alice);
+
+    Anonymous bob_ent;
+    bob_ent->setName("bob");
+    LocatedEntity * bob = test_world->addNewEntity("character", bob_ent);
+    ASSERT_NOT_NULL(bob);
+
+    ASSERT_EQUAL(test_world->findByName("alice"), alice);
+    ASSERT_EQUAL(test_world->findByName("bob"), bob);
+    ASSERT_NULL(test_world->findByName("carol"));
+
+    ASSERT_EQUAL(test_world->findByType("thing"), alice);
+    ASSERT_EQUAL(test_world->findByType("character"), bob);
+    ASSERT_EQUAL(test_world->findByType("world"), &test_world->m_gameWorld);
+    ASSERT_NULL(test_world->findByType("plant"));
+
+    // Subtypes are included unless asked otherwise.
+    ASSERT_EQUAL(test_world->findAllByType("thing").size(), 2u);
+    ASSERT_EQUAL(test_world->findAllByType("thing", false).size(), 1u);
+    ASSERT_EQUAL(test_world->findAllByType("character").size(), 1u);
+    ASSERT_EQUAL(test_world->findAllByType("game_entity").size(), 3u);
+    ASSERT_TRUE(test_world->findAllByType("__no_such_type__").empty());
+
+    // The name index follows changes to names, even when nothing else
+    // reports the entity as updated.
+    alice->setAttr("name", "bob");
+    ASSERT_NULL(test_world->findByName("alice"));
+    ASSERT_EQUAL(test_world->findAllByName("bob").size(), 2u);
+
+    test_world->delEntity(bob);
+    ASSERT_EQUAL(test_world->findByName("bob"), alice);
+    ASSERT_EQUAL(test_world->findAllByName("bob").size(), 1u);
+    ASSERT_TRUE(test_world->findAllByType("character").empty());
+    ASSERT_EQUAL(test_world->findAllByType("thing").size(), 1u);
+
+    delete test_world;
+}
+
 int main()
 {
     WorldRouterintegration t;
@@ -941,4 +991,9 @@ Monitors * Monitors::instance()
 void Monitors::watch(const::std::string & name, VariableBase * monitor)
 {
 }
+
+Histogram * Monitors::histogram(const std::string & name)
+{
+    return new Histogram;
+}
 #endif // 0
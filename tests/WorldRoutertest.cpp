@@ -39,6 +39,7 @@
 #include "common/id.h"
 #include "common/Inheritance.h"
 #include "common/log.h"
+#include "common/Histogram.h"
 #include "common/Monitors.h"
 #include "common/SystemTime.h"
 #include "common/Tick.h"
@@ -46,6 +47,8 @@
 
 #include <Atlas/Objects/Anonymous.h>
 
+#include <sstream>
+
 #include <cstdio>
 #include <cstdlib>
 
@@ -79,6 +82,7 @@ class WorldRoutertest : public Cyphesis::TestBase
     void test_createSpawnPoint();
     void test_delEntity();
     void test_delEntity_world();
+    void test_monitors();
 };
 
 WorldRoutertest::WorldRoutertest()
@@ -95,6 +99,7 @@ WorldRoutertest::WorldRoutertest()
     ADD_TEST(WorldRoutertest::test_createSpawnPoint);
     ADD_TEST(WorldRoutertest::test_delEntity);
     ADD_TEST(WorldRoutertest::test_delEntity_world);
+    ADD_TEST(WorldRoutertest::test_monitors);
 }
 
 void WorldRoutertest::setup()
@@ -107,6 +112,7 @@ void WorldRoutertest::teardown()
     delete test_world;
 
     EntityBuilder::del();
+    Monitors::cleanup();
 }
 
 void WorldRoutertest::test_constructor()
@@ -270,6 +276,45 @@ void WorldRoutertest::test_delEntity_world()
     test_world->delEntity(&test_world->m_gameWorld);
 }
 
+static std::string readMonitor(const std::string & key)
+{
+    std::stringstream value;
+    int ret = Monitors::instance()->readVariable(key, value);
+    assert(ret == 0);
+    return value.str();
+}
+
+void WorldRoutertest::test_monitors()
+{
+    std::string id;
+    long int_id = newId(id);
+
+    Entity * ent2 = new Entity(id, int_id);
+    ent2->m_location.m_loc = &test_world->m_gameWorld;
+    ent2->m_location.m_pos = Point3D(0,0,0);
+    test_world->addEntity(ent2);
+
+    Tick tick;
+    tick->setFutureSeconds(1000);
+    tick->setTo(ent2->getId());
+    test_world->message(tick, *ent2);
+
+    test_world->idle(false);
+
+    ASSERT_EQUAL(readMonitor("world_queue_depth{queue=\"immediate\"}"), "0");
+    ASSERT_EQUAL(readMonitor("world_queue_depth{queue=\"future\"}"), "1");
+    ASSERT_EQUAL(readMonitor("world_queue_depth{queue=\"suspended\"}"), "0");
+    ASSERT_EQUAL(readMonitor("world_dispatch_budget_usec"), "5000");
+    readMonitor("world_ops_per_second");
+    readMonitor("world_dispatch_latency_usec");
+
+    // The exported text has label values quoted.
+    std::stringstream text;
+    Monitors::instance()->send(text);
+    ASSERT_NOT_EQUAL(text.str().find("world_queue_depth{queue=\"future\"} 1\n"),
+                     std::string::npos);
+}
+
 int main()
 {
     WorldRoutertest t;
@@ -580,49 +625,16 @@ const TypeNode * Inheritance::getType(const std::string & parent)
     return I->second;
 }
 
-VariableBase::~VariableBase()
-{
-}
-
-template <typename T>
-Variable<T>::Variable(const T & variable) : m_variable(variable)
-{
-}
-
-template <typename T>
-Variable<T>::~Variable()
-{
-}
-
-template <typename T>
-void Variable<T>::send(std::ostream & o)
-{
-    o << m_variable;
-}
-
-template class Variable<int>;
-
-Monitors * Monitors::m_instance = NULL;
-
-Monitors::Monitors()
-{
-}
-
-Monitors::~Monitors()
+bool TypeNode::isTypeOf(const TypeNode * base_type) const
 {
+    return false;
 }
 
-Monitors * Monitors::instance()
-{
-    if (m_instance == NULL) {
-        m_instance = new Monitors();
-    }
-    return m_instance;
-}
-
-void Monitors::watch(const::std::string & name, VariableBase * monitor)
+int_config_register::int_config_register(int & var,
+                                         const char * section,
+                                         const char * setting,
+                                         const char * help)
 {
-    delete monitor;
 }
 
 ArithmeticBuilder * ArithmeticBuilder::m_instance = 0;
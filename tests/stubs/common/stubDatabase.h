@@ -40,6 +40,11 @@ void Database::shutdownConnection()
 {
 }
 
+PGconn * Database::openConnection(std::string & error_msg) const
+{
+    return 0;
+}
+
 int Database::registerRelation(std::string & tablename,
                                const std::string & sourcetable,
                                const std::string & targettable,
@@ -193,18 +198,61 @@ const DatabaseResult Database::selectEntities(const std::string & loc)
     return DatabaseResult(0);
 }
 
+const DatabaseResult Database::selectAllEntities()
+{
+    return DatabaseResult(0);
+}
+
+int Database::openCursor(const std::string & name, const std::string & query)
+{
+    return 0;
+}
+
+const DatabaseResult Database::fetchFromCursor(const std::string & name,
+                                               int count)
+{
+    return DatabaseResult(0);
+}
+
+int Database::closeCursor(const std::string & name)
+{
+    return 0;
+}
+
 int Database::encodeObject(const MapType & o,
                            std::string & data)
 {
     return 0;
 }
 
+std::string Database::escapeString(const std::string & raw)
+{
+    return raw;
+}
+
+std::string Database::escapeBinary(const std::string & raw)
+{
+    return raw;
+}
+
 int Database::decodeMessage(const std::string & data,
                             MapType &o)
 {
     return 0;
 }
 
+int Database::decodeMessage(Decoder & decoder,
+                            const std::string & data,
+                            MapType &o)
+{
+    return 0;
+}
+
+int Database::decodeBinary(const char * field, std::string & data)
+{
+    return 0;
+}
+
 int Database::insertEntity(const std::string & id,
                            const std::string & loc,
                            const std::string & type,
@@ -246,6 +294,37 @@ int Database::updateProperties(const std::string & id,
     return 0;
 }
 
+void Database::batchInsertEntity(const std::string & id,
+                                 const std::string & loc,
+                                 const std::string & type,
+                                 int seq,
+                                 const std::string & value)
+{
+}
+
+void Database::batchUpdateEntity(const std::string & id,
+                                 int seq,
+                                 const std::string & location_data,
+                                 const std::string & location_entity_id)
+{
+}
+
+void Database::batchWriteProperties(const std::string & id,
+                                    const KeyValues & tuples)
+{
+}
+
+void Database::batchCreateRelationRow(const std::string & name,
+                                      const std::string & id,
+                                      const std::string & other)
+{
+}
+
+int Database::flushBatch(const sigc::slot<void, bool> & done)
+{
+    return 0;
+}
+
 const DatabaseResult Database::selectThoughts(const std::string & loc)
 {
     return DatabaseResult(0);
@@ -32,5 +32,9 @@ void Link::send(const Operation & op) const
 {
 }
 
+void Link::sendPending() const
+{
+}
+
 
 #endif /* STUBLINK_H_ */
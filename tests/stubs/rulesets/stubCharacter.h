@@ -22,6 +22,7 @@
 Character::Character(const std::string & id, long intId) :
            Thing(id, intId),
                m_movement(*(Movement*)0),
+               m_mindSuspended(false),
                m_mind(0), m_externalMind(0)
 {
 }
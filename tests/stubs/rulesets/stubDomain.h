@@ -39,5 +39,31 @@ void Domain::tick(double t)
 
 }
 
+bool Domain::findObserverCandidates(const LocatedEntity& observedEntity, std::vector<LocatedEntity*>& candidates) const
+{
+    return false;
+}
+
+void Domain::addEntity(LocatedEntity& entity)
+{
+}
+
+void Domain::removeEntity(LocatedEntity& entity)
+{
+}
+
+void Domain::updatePosition(LocatedEntity& entity)
+{
+}
+
+bool Domain::addMover(LocatedEntity& entity, Motion& motion, double nextUpdate)
+{
+    return false;
+}
+
+void Domain::removeMover(LocatedEntity& entity)
+{
+}
+
 
 #endif /* STUBDOMAIN_H_ */
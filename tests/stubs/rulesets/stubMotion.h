@@ -20,6 +20,7 @@
 
 
 Motion::Motion(LocatedEntity & body, Domain& domain) : m_entity(body), m_domain(domain), m_serialno(0),
+                                m_updateHandle(0),
                                 m_collision(false)
 {
 }
@@ -21,7 +21,8 @@
 
 TerrainProperty::TerrainProperty() :
       m_data(*(Mercator::Terrain*)0),
-      m_tileShader(nullptr)
+      m_tileShader(nullptr),
+      m_segments(nullptr)
 {
 }
 
@@ -0,0 +1,54 @@
+/*
+ Copyright (C) 2014 Erik Ogenvik
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#ifndef STUBMINDWORKERPOOL_H_
+#define STUBMINDWORKERPOOL_H_
+
+MindWorkerPool * MindWorkerPool::m_instance = 0;
+
+MindWorkerPool::MindWorkerPool(int size, const std::string & command) :
+                m_size(size), m_command(command)
+{
+}
+
+MindWorkerPool::~MindWorkerPool()
+{
+}
+
+bool MindWorkerPool::checkToken(const std::string & hash) const
+{
+    return !m_token.empty() && m_token == hash;
+}
+
+void MindWorkerPool::addMind(Character & chr,
+                             const Atlas::Message::MapType & mind)
+{
+}
+
+void MindWorkerPool::addWorker(MindWorkerAccount * worker)
+{
+}
+
+void MindWorkerPool::removeWorker(MindWorkerAccount * worker)
+{
+}
+
+void MindWorkerPool::idle()
+{
+}
+
+#endif /* STUBMINDWORKERPOOL_H_ */
@@ -21,6 +21,7 @@
 
 WorldRouter::WorldRouter(const SystemTime &) :
       BaseWorld(*new Entity(consts::rootWorldId, consts::rootWorldIntId)),
+      m_operationQueue(0.01),
       m_entityCount(1)
 
 {
@@ -91,11 +92,25 @@ void WorldRouter::message(const Operation & op, LocatedEntity & ent)
 {
 }
 
+std::uint64_t WorldRouter::scheduleOperation(const Operation & op, LocatedEntity & ent)
+{
+    return 0;
+}
+
+void WorldRouter::cancelOperation(std::uint64_t handle)
+{
+}
+
 bool WorldRouter::idle()
 {
     return false;
 }
 
+bool WorldRouter::idle(bool ioPending)
+{
+    return false;
+}
+
 LocatedEntity * WorldRouter::findByName(const std::string & name)
 {
     return 0;
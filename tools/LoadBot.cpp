@@ -0,0 +1,545 @@
+// Cyphesis Online RPG Server and AI Engine
+// Copyright (C) 2014 Erik Ogenvik
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "LoadBot.h"
+
+#include "common/AtlasStreamClient.h"
+#include "common/compose.hpp"
+#include "common/log.h"
+
+#include <Atlas/Objects/Anonymous.h>
+#include <Atlas/Objects/Encoder.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+
+using Atlas::Message::Element;
+using Atlas::Message::ListType;
+using Atlas::Objects::Root;
+using Atlas::Objects::Entity::Anonymous;
+using Atlas::Objects::Operation::Create;
+using Atlas::Objects::Operation::Look;
+using Atlas::Objects::Operation::Move;
+using Atlas::Objects::Operation::RootOperation;
+using Atlas::Objects::Operation::Talk;
+
+/// \brief Largest number of entity identifiers a bot remembers
+static const std::size_t maxSeen = 32;
+
+static const char * phrases[] = {
+    "Hello",
+    "Nice weather today",
+    "Have you seen the smithy?",
+    "I am looking for wood",
+    "Farewell"
+};
+
+int LoadBot::s_thinkInterval = 1000;
+
+LatencyBuckets::LatencyBuckets() :
+      m_counts(upperBucket + 1), m_count(0), m_max(0)
+{
+}
+
+/// \brief Find the bucket a time is counted in
+int LatencyBuckets::bucket(long usec)
+{
+    if (usec < 2 * subBuckets) {
+        return std::max(usec, 0L);
+    }
+    int shift = 0;
+    while ((usec >> shift) >= 2 * subBuckets) {
+        ++shift;
+    }
+    return shift * subBuckets + (usec >> shift);
+}
+
+/// \brief Find the largest time counted in a bucket
+long LatencyBuckets::upperBound(int bucket)
+{
+    if (bucket < 2 * subBuckets) {
+        return bucket;
+    }
+    int shift = bucket / subBuckets - 1;
+    long mantissa = bucket - shift * subBuckets;
+    return ((mantissa + 1) << shift) - 1;
+}
+
+void LatencyBuckets::record(long usec)
+{
+    int i = bucket(usec);
+    ++m_counts[i < upperBucket ? i : upperBucket];
+    ++m_count;
+    m_max = std::max(m_max, usec);
+}
+
+/// \brief Find the time a percentage of the round trips took at most
+///
+/// @return The upper bound of the bucket the percentile falls in, or the
+/// longest time recorded if that is less.
+long LatencyBuckets::percentile(int percent) const
+{
+    long rank = (m_count - 1) * percent / 100;
+    long cumulative = 0;
+    for (int i = 0; i <= upperBucket; ++i) {
+        cumulative += m_counts[i];
+        if (cumulative > rank) {
+            return std::min(upperBound(i), m_max);
+        }
+    }
+    return m_max;
+}
+
+LoadStatistics::LoadStatistics() : m_sent(0), m_received(0), m_active(0),
+                                   m_failed(0), m_totalSent(0), m_lost(0)
+{
+}
+
+void LoadStatistics::reportLatency(std::ostream & io, long p50, long p90,
+                                   long p99, long max)
+{
+    io << "p50 " << p50 / 1000.
+       << "ms p90 " << p90 / 1000.
+       << "ms p99 " << p99 / 1000.
+       << "ms max " << max / 1000. << "ms";
+}
+
+void LoadStatistics::reportLatency(std::ostream & io,
+                                   std::vector<long> & samples)
+{
+    if (samples.empty()) {
+        io << "no replies";
+        return;
+    }
+    std::sort(samples.begin(), samples.end());
+    std::size_t last = samples.size() - 1;
+    reportLatency(io, samples[last * 50 / 100], samples[last * 90 / 100],
+                  samples[last * 99 / 100], samples[last]);
+}
+
+void LoadStatistics::reportLatency(std::ostream & io,
+                                   const LatencyBuckets & buckets)
+{
+    if (buckets.count() == 0) {
+        io << "no replies";
+        return;
+    }
+    reportLatency(io, buckets.percentile(50), buckets.percentile(90),
+                  buckets.percentile(99), buckets.max());
+}
+
+/// \brief Write the throughput and latency since the last report
+///
+/// @param seconds Length of the interval since the last report
+void LoadStatistics::report(std::ostream & io, double seconds)
+{
+    io << m_active << " active, "
+       << m_sent / seconds << " ops/s sent, "
+       << m_received / seconds << " ops/s received, ";
+    reportLatency(io, m_interval);
+    io << std::endl << std::flush;
+
+    m_interval.clear();
+    m_sent = 0;
+    m_received = 0;
+}
+
+/// \brief Write the throughput and latency for the whole run
+///
+/// @param seconds Length of the run
+void LoadStatistics::summary(std::ostream & io, double seconds)
+{
+    io << "Bots active: " << m_active << ", failed: " << m_failed
+       << std::endl;
+    io << "Operations sent: " << m_totalSent << " ("
+       << m_totalSent / seconds << " ops/s), answered: " << m_total.count()
+       << ", lost: " << m_lost << std::endl;
+    io << "Round trip: ";
+    reportLatency(io, m_total);
+    io << std::endl << std::flush;
+}
+
+LoadBot::LoadBot(boost::asio::io_service & io_service,
+                 LoadStatistics & statistics, int index,
+                 const std::string & type) :
+      m_io_service(io_service), m_statistics(statistics), m_socket(0),
+      m_timer(io_service), m_state(INIT), m_index(index), m_serialNo(0),
+      m_setupSerialNo(0), m_type(type), m_pos()
+{
+}
+
+LoadBot::~LoadBot()
+{
+    delete m_socket;
+}
+
+/// \brief Connect to the server and start creating an account
+///
+/// Negotiation blocks, but once it is done everything else the bot does
+/// happens in handlers run by the io_service.
+int LoadBot::connect(const boost::asio::ip::tcp::endpoint & endpoint)
+{
+    try {
+        std::function<void()> dispatcher = [this]{this->dispatch();};
+        m_socket = new TcpStreamClientSocket(m_io_service, dispatcher,
+                                             endpoint);
+    } catch (const std::exception & e) {
+        fail(e.what());
+        return -1;
+    }
+    if (m_socket->negotiate(*this) != 0) {
+        fail("negotiation failed");
+        return -1;
+    }
+
+    Create c;
+    Anonymous account;
+    account->setAttr("username", String::compose("loadgen%1_%2",
+                                                 ::time(0), m_index));
+    account->setAttr("password", "loadgen");
+    account->setParents(std::list<std::string>(1, "player"));
+    c->setArgs1(account);
+    m_setupSerialNo = ++m_serialNo;
+    c->setSerialno(m_setupSerialNo);
+
+    m_state = ACCOUNT;
+    send(c);
+    return 0;
+}
+
+void LoadBot::objectArrived(const Root & obj)
+{
+    RootOperation op = Atlas::Objects::smart_dynamic_cast<RootOperation>(obj);
+    if (!op.isValid()) {
+        return;
+    }
+    // Operations are handled once decoding has finished, as the stream
+    // can't be written to while it is being read.
+    m_ops.push_back(op);
+}
+
+void LoadBot::dispatch()
+{
+    for (auto & op : m_ops) {
+        operation(op);
+    }
+    m_ops.clear();
+}
+
+void LoadBot::operation(const RootOperation & op)
+{
+    m_statistics.received();
+
+    if (m_state == ACCOUNT || m_state == CHARACTER) {
+        if (!op->isDefaultRefno() && op->getRefno() == m_setupSerialNo) {
+            setupReply(op);
+        }
+        return;
+    }
+    if (m_state != ACTIVE) {
+        return;
+    }
+
+    if (!op->isDefaultRefno()) {
+        answered(op->getRefno());
+    }
+
+    int class_no = op->getClassNo();
+    const std::vector<Root> & args = op->getArgs();
+    if (class_no == Atlas::Objects::Operation::APPEARANCE_NO) {
+        for (auto & arg : args) {
+            noticeEntities(arg);
+        }
+    } else if (class_no == Atlas::Objects::Operation::SIGHT_NO ||
+               class_no == Atlas::Objects::Operation::SOUND_NO) {
+        if (args.empty()) {
+            return;
+        }
+        RootOperation seen_op =
+              Atlas::Objects::smart_dynamic_cast<RootOperation>(args.front());
+        if (seen_op.isValid()) {
+            // Our own actions come back to us wrapped in a Sight or Sound,
+            // which is as good as a reply.
+            if (seen_op->getFrom() == m_characterId &&
+                !seen_op->isDefaultSerialno()) {
+                answered(seen_op->getSerialno());
+            }
+        } else {
+            noticeEntities(args.front());
+        }
+    }
+}
+
+/// \brief Record the round trip time of an operation which was answered
+void LoadBot::answered(long serialno)
+{
+    auto I = m_outstanding.find(serialno);
+    if (I == m_outstanding.end()) {
+        return;
+    }
+    m_statistics.latency(std::chrono::duration_cast<std::chrono::microseconds>(
+          clock::now() - I->second).count());
+    m_outstanding.erase(I);
+}
+
+/// \brief Remember entities the bot sees, so it has things to act on
+void LoadBot::noticeEntities(const Root & ent)
+{
+    if (ent->isDefaultId()) {
+        return;
+    }
+    const std::string & id = ent->getId();
+    if (id == m_characterId) {
+        Element pos;
+        if (ent->copyAttr("pos", pos) == 0 && pos.isList() &&
+            pos.List().size() == 3) {
+            for (int i = 0; i < 3; ++i) {
+                if (pos.List()[i].isNum()) {
+                    m_pos[i] = pos.List()[i].asNum();
+                }
+            }
+        }
+        return;
+    }
+
+    std::vector<std::string> ids(1, id);
+    Element contains;
+    if (id == m_locationId && ent->copyAttr("contains", contains) == 0 &&
+        contains.isList()) {
+        for (auto & child : contains.List()) {
+            if (child.isString() && child.String() != m_characterId) {
+                ids.push_back(child.String());
+            }
+        }
+    }
+    for (auto & seen : ids) {
+        if (seen == m_locationId ||
+            std::find(m_seen.begin(), m_seen.end(), seen) != m_seen.end()) {
+            continue;
+        }
+        if (m_seen.size() < maxSeen) {
+            m_seen.push_back(seen);
+        } else {
+            m_seen[::rand() % maxSeen] = seen;
+        }
+    }
+}
+
+/// \brief Handle the reply to account or character creation
+void LoadBot::setupReply(const RootOperation & op)
+{
+    if (op->getClassNo() == Atlas::Objects::Operation::ERROR_NO) {
+        std::string message = "error from server";
+        if (!op->getArgs().empty()) {
+            Element message_attr;
+            if (op->getArgs().front()->copyAttr("message", message_attr) == 0 &&
+                message_attr.isString()) {
+                message = message_attr.String();
+            }
+        }
+        fail(message);
+        return;
+    }
+    if (op->getClassNo() != Atlas::Objects::Operation::INFO_NO) {
+        return;
+    }
+    if (op->getArgs().empty() || op->getArgs().front()->isDefaultId()) {
+        fail("malformed reply from server");
+        return;
+    }
+    const Root & arg = op->getArgs().front();
+
+    if (m_state == ACCOUNT) {
+        m_accountId = arg->getId();
+
+        Create c;
+        Anonymous character;
+        character->setParents(std::list<std::string>(1, m_type));
+        character->setName(String::compose("bot%1", m_index));
+        c->setArgs1(character);
+        c->setFrom(m_accountId);
+        m_setupSerialNo = ++m_serialNo;
+        c->setSerialno(m_setupSerialNo);
+
+        m_state = CHARACTER;
+        send(c);
+        return;
+    }
+
+    m_characterId = arg->getId();
+    Element loc;
+    if (arg->copyAttr("loc", loc) == 0 && loc.isString()) {
+        m_locationId = loc.String();
+    }
+    noticeEntities(arg);
+
+    m_state = ACTIVE;
+    ++m_statistics.m_active;
+    look();
+    schedule(::rand() % s_thinkInterval);
+}
+
+void LoadBot::fail(const std::string & reason)
+{
+    if (m_state == FAILED) {
+        return;
+    }
+    log(WARNING, String::compose("Bot %1 failed: %2", m_index, reason));
+    if (m_state == ACTIVE) {
+        --m_statistics.m_active;
+    }
+    ++m_statistics.m_failed;
+    m_state = FAILED;
+    m_timer.cancel();
+}
+
+void LoadBot::send(const RootOperation & op)
+{
+    try {
+        m_socket->getEncoder().streamObjectsMessage(op);
+        m_socket->write();
+    } catch (const std::exception & e) {
+        fail(e.what());
+    }
+}
+
+/// \brief Send an operation from the character, and time its answer
+void LoadBot::sendTimed(const RootOperation & op)
+{
+    long serialno = ++m_serialNo;
+    op->setSerialno(serialno);
+    op->setFrom(m_characterId);
+    m_outstanding[serialno] = clock::now();
+    m_statistics.sent();
+    send(op);
+}
+
+void LoadBot::schedule(int msec)
+{
+    m_timer.expires_from_now(boost::posix_time::milliseconds(msec));
+    m_timer.async_wait([this](boost::system::error_code ec) {
+        if (!ec) {
+            this->think();
+        }
+    });
+}
+
+/// \brief Pick the next action at random and carry it out
+void LoadBot::think()
+{
+    if (m_state != ACTIVE) {
+        return;
+    }
+    if (!m_socket->isConnected()) {
+        fail("disconnected");
+        return;
+    }
+
+    clock::time_point expired = clock::now() -
+                                std::chrono::seconds(replyTimeout);
+    for (auto I = m_outstanding.begin(); I != m_outstanding.end();) {
+        if (I->second < expired) {
+            ++m_statistics.m_lost;
+            I = m_outstanding.erase(I);
+        } else {
+            ++I;
+        }
+    }
+
+    int action = ::rand() % 10;
+    if (action < 5) {
+        walk();
+    } else if (action < 7) {
+        talk();
+    } else if (action < 9) {
+        look();
+    } else {
+        pickUpOrDrop();
+    }
+
+    schedule(s_thinkInterval / 2 + ::rand() % (s_thinkInterval + 1));
+}
+
+void LoadBot::walk()
+{
+    std::vector<double> pos(m_pos, m_pos + 3);
+    pos[0] += (::rand() % 11) - 5;
+    pos[1] += (::rand() % 11) - 5;
+
+    Move m;
+    Anonymous arg;
+    arg->setId(m_characterId);
+    arg->setLoc(m_locationId);
+    arg->setPos(pos);
+    m->setArgs1(arg);
+    sendTimed(m);
+
+    m_pos[0] = pos[0];
+    m_pos[1] = pos[1];
+}
+
+void LoadBot::talk()
+{
+    Talk t;
+    Anonymous arg;
+    arg->setAttr("say", phrases[::rand() % (sizeof(phrases) / sizeof(phrases[0]))]);
+    t->setArgs1(arg);
+    sendTimed(t);
+}
+
+void LoadBot::look()
+{
+    Look l;
+    Anonymous arg;
+    if (m_seen.empty() || ::rand() % 4 == 0) {
+        arg->setId(m_locationId);
+    } else {
+        arg->setId(m_seen[::rand() % m_seen.size()]);
+    }
+    l->setArgs1(arg);
+    sendTimed(l);
+}
+
+void LoadBot::pickUpOrDrop()
+{
+    Move m;
+    Anonymous arg;
+    if (m_carrying.empty()) {
+        if (m_seen.empty()) {
+            look();
+            return;
+        }
+        m_carrying = m_seen[::rand() % m_seen.size()];
+        arg->setId(m_carrying);
+        arg->setLoc(m_characterId);
+        arg->setPos(std::vector<double>(3, 0.));
+    } else {
+        arg->setId(m_carrying);
+        arg->setLoc(m_locationId);
+        arg->setPos(std::vector<double>(m_pos, m_pos + 3));
+        m_carrying.clear();
+    }
+    m->setArgs1(arg);
+    sendTimed(m);
+}
@@ -0,0 +1,200 @@
+// Cyphesis Online RPG Server and AI Engine
+// Copyright (C) 2014 Erik Ogenvik
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+
+#ifndef TOOLS_LOAD_BOT_H
+#define TOOLS_LOAD_BOT_H
+
+#include <Atlas/Objects/Decoder.h>
+#include <Atlas/Objects/ObjectsFwd.h>
+#include <Atlas/Objects/SmartPtr.h>
+#include <Atlas/Objects/Operation.h>
+
+#include <boost/asio.hpp>
+
+#include <chrono>
+#include <iosfwd>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+class StreamClientSocketBase;
+
+/// \brief Round trip times counted in buckets a few percent wide
+///
+/// Used for the whole run, which may be too long to keep every time.
+/// Times below 64 microseconds have a bucket each. Above that, each power
+/// of two is split into 32 buckets, so percentiles are within about 3%.
+class LatencyBuckets
+{
+  protected:
+    /// \brief Buckets for each power of two above the exact range
+    static const int subBuckets = 32;
+    /// \brief The last bucket, which goes up to about 19 hours and also
+    /// counts anything longer
+    static const int upperBucket = 1023;
+
+    std::vector<long> m_counts;
+    long m_count;
+    long m_max;
+
+    static int bucket(long usec);
+    static long upperBound(int bucket);
+  public:
+    LatencyBuckets();
+
+    void record(long usec);
+
+    long count() const {
+        return m_count;
+    }
+
+    long max() const {
+        return m_max;
+    }
+
+    long percentile(int percent) const;
+};
+
+/// \brief Counts and round trip times gathered from all the bots
+///
+/// Latencies are kept both for the current reporting interval and for
+/// the whole run, so that percentiles can be reported for each.
+class LoadStatistics
+{
+  protected:
+    /// \brief Round trip times in microseconds since the last report
+    std::vector<long> m_interval;
+    /// \brief Round trip times for the whole run
+    LatencyBuckets m_total;
+    /// \brief Operations sent since the last report
+    long m_sent;
+    /// \brief Operations received since the last report
+    long m_received;
+
+    static void reportLatency(std::ostream &, long p50, long p90, long p99,
+                              long max);
+    static void reportLatency(std::ostream &, std::vector<long> &);
+    static void reportLatency(std::ostream &, const LatencyBuckets &);
+  public:
+    /// \brief Bots which have a character in the world
+    int m_active;
+    /// \brief Bots which failed to connect or create a character
+    int m_failed;
+    /// \brief Operations sent for the whole run
+    long m_totalSent;
+    /// \brief Operations which were not answered in time
+    long m_lost;
+
+    LoadStatistics();
+
+    void sent() {
+        ++m_sent;
+        ++m_totalSent;
+    }
+
+    void received() {
+        ++m_received;
+    }
+
+    void latency(long usec) {
+        m_interval.push_back(usec);
+        m_total.record(usec);
+    }
+
+    void report(std::ostream &, double seconds);
+    void summary(std::ostream &, double seconds);
+};
+
+/// \brief A scripted client used to put load on a server
+///
+/// Each bot creates an account and a character, and then acts at random
+/// intervals, walking about, talking, looking at things and picking them
+/// up and dropping them. Bots share one io_service so that many of them
+/// can be run from a single thread.
+class LoadBot : public Atlas::Objects::ObjectsDecoder
+{
+  public:
+    typedef std::chrono::steady_clock clock;
+
+    /// \brief How long an operation may wait for its answer
+    static const int replyTimeout = 10;
+  protected:
+    enum State {
+        INIT,
+        ACCOUNT,
+        CHARACTER,
+        ACTIVE,
+        FAILED
+    };
+
+    boost::asio::io_service & m_io_service;
+    LoadStatistics & m_statistics;
+    StreamClientSocketBase * m_socket;
+    boost::asio::deadline_timer m_timer;
+    State m_state;
+    int m_index;
+    int m_serialNo;
+    int m_setupSerialNo;
+    std::string m_type;
+    std::string m_accountId;
+    std::string m_characterId;
+    std::string m_locationId;
+    double m_pos[3];
+    /// \brief Identifiers of entities the bot has seen
+    std::vector<std::string> m_seen;
+    /// \brief Identifier of the entity the bot is carrying, if any
+    std::string m_carrying;
+    /// \brief Time each unanswered operation was sent, by serial number
+    std::map<long, clock::time_point> m_outstanding;
+    std::list<Atlas::Objects::Operation::RootOperation> m_ops;
+
+    virtual void objectArrived(const Atlas::Objects::Root &);
+
+    void dispatch();
+    void operation(const Atlas::Objects::Operation::RootOperation &);
+    void answered(long serialno);
+    void noticeEntities(const Atlas::Objects::Root &);
+    void setupReply(const Atlas::Objects::Operation::RootOperation &);
+    void fail(const std::string & reason);
+
+    void send(const Atlas::Objects::Operation::RootOperation &);
+    void sendTimed(const Atlas::Objects::Operation::RootOperation &);
+    void schedule(int msec);
+    void think();
+
+    void walk();
+    void talk();
+    void look();
+    void pickUpOrDrop();
+  public:
+    LoadBot(boost::asio::io_service &, LoadStatistics &, int index,
+            const std::string & type);
+    virtual ~LoadBot();
+
+    int connect(const boost::asio::ip::tcp::endpoint &);
+
+    bool isActive() const {
+        return m_state == ACTIVE;
+    }
+
+    /// \brief Milliseconds between the actions of a bot, on average
+    static int s_thinkInterval;
+};
+
+#endif // TOOLS_LOAD_BOT_H
@@ -33,6 +33,7 @@
 #include "common/globals.h"
 #include "common/system.h"
 #include "common/Storage.h"
+#include "common/ElementEncoding.h"
 
 #include <varconf/config.h>
 
@@ -53,6 +54,8 @@ extern "C" {
 }
 #endif
 
+using Atlas::Message::MapType;
+
 typedef int (*dbcmd_function)(Storage & ab, struct dbsys * system,
                               int argc, char ** argv);
 
@@ -103,6 +106,76 @@ static int world_purge(Storage & ab, struct dbsys * system,
     return 0;
 }
 
+/// \brief Convert property values stored as XML to the binary encoding
+///
+/// The server converts properties as they are written, so this is only
+/// needed to finish the conversion of a world in one go.
+static int world_convert(Storage & ab, struct dbsys * system,
+                         int argc, char ** argv)
+{
+    Database * db = Database::instance();
+    if (db->registerPropertyTable() != 0) {
+        std::cout << "Property table upgrade fail" << std::endl << std::flush;
+        return 1;
+    }
+    if (db->openCursor("convert_properties",
+                       "SELECT id, name, value FROM properties "
+                       "WHERE data IS NULL AND value IS NOT NULL") != 0) {
+        std::cout << "Property query fail" << std::endl << std::flush;
+        return 1;
+    }
+    int converted = 0, failed = 0;
+    while (true) {
+        DatabaseResult res = db->fetchFromCursor("convert_properties", 1000);
+        if (res.error()) {
+            std::cout << "Property query fail" << std::endl << std::flush;
+            db->closeCursor("convert_properties");
+            return 1;
+        }
+        if (res.empty()) {
+            break;
+        }
+        int rows = res.size();
+        for (int i = 0; i < rows; ++i) {
+            const std::string id = res.field("id", i);
+            const std::string name = res.field("name", i);
+            MapType value;
+            MapType::const_iterator J;
+            if (db->decodeMessage(res.field("value", i), value) != 0 ||
+                (J = value.find("val")) == value.end()) {
+                std::cout << "Property " << id << ":" << name
+                          << " could not be decoded" << std::endl;
+                ++failed;
+                continue;
+            }
+            Database::KeyValues tuples;
+            encodeElement(J->second, tuples[name]);
+            db->batchWriteProperties(id, tuples);
+            ++converted;
+        }
+        db->flushBatch();
+        while (db->queryQueueSize() != 0) {
+            if (!db->queryInProgress()) {
+                if (db->launchNewQuery() != 0) {
+                    break;
+                }
+            } else {
+                db->clearPendingQuery();
+            }
+        }
+    }
+    if (db->closeCursor("convert_properties") != 0) {
+        std::cout << "Property conversion fail" << std::endl << std::flush;
+        return 1;
+    }
+    std::cout << "Converted " << converted << " properties";
+    if (failed != 0) {
+        std::cout << ", " << failed << " could not be decoded";
+    }
+    std::cout << std::endl << std::flush;
+    return 0;
+}
+
 static int users_purge(Storage & ab, struct dbsys * system,
                       int argc, char ** argv)
 {
@@ -293,6 +366,8 @@ int dbs_generic(Storage & ab, struct dbsys * system,
 
 struct dbsys world_cmds[] = {
     { "purge", "Purge world data", &world_purge, 0 },
+    { "convert", "Convert stored property values to the binary encoding",
+                 &world_convert, 0 },
     { "help",  "Show world help", &dbs_help, &world_cmds[0] },
     { NULL,    "Guard", }
 };
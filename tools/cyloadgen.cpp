@@ -0,0 +1,175 @@
+// Cyphesis Online RPG Server and AI Engine
+// Copyright (C) 2014 Erik Ogenvik
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+
+/// \page cyloadgen_index
+///
+/// \section Introduction
+///
+/// cyloadgen connects a swarm of scripted bots to a server, and reports
+/// the round trip latency and throughput of the operations they send.
+/// All the bots share one io_service, so a single process can run
+/// thousands of them.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "LoadBot.h"
+
+#include "common/compose.hpp"
+#include "common/globals.h"
+#include "common/log.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <functional>
+#include <iostream>
+
+static void usage(char * prg)
+{
+    std::cerr << "usage: " << prg << " [options] [server]" << std::endl
+              << std::flush;
+}
+
+INT_OPTION(bot_count, 100, "loadgen", "bots",
+           "Number of bots to connect to the server");
+INT_OPTION(run_duration, 60, "loadgen", "duration",
+           "Seconds to run for, including the time taken to connect");
+INT_OPTION(ramp_interval, 20, "loadgen", "rampinterval",
+           "Milliseconds between bots connecting");
+INT_OPTION(think_interval, 1000, "loadgen", "thinkinterval",
+           "Milliseconds between the actions of each bot, on average");
+INT_OPTION(report_interval, 5, "loadgen", "reportinterval",
+           "Seconds between latency reports");
+STRING_OPTION(character_type, "settler", "loadgen", "type",
+              "Type of character created by each bot");
+
+typedef std::chrono::steady_clock clock_type;
+
+int main(int argc, char ** argv)
+{
+    int config_status = loadConfig(argc, argv, USAGE_CYCMD);
+    if (config_status < 0) {
+        if (config_status == CONFIG_VERSION) {
+            reportVersion(argv[0]);
+            return 0;
+        } else if (config_status == CONFIG_HELP) {
+            showUsage(argv[0], USAGE_CYCMD);
+            return 0;
+        } else if (config_status != CONFIG_ERROR) {
+            log(ERROR, "Unknown error reading configuration.");
+        }
+        // Fatal error loading config file
+        return 1;
+    }
+
+    std::string server;
+    readConfigItem("client", "serverhost", server);
+
+    int optind = config_status;
+    if ((argc - optind) == 1) {
+        server = argv[optind];
+    } else if ((argc - optind) > 1) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (server.empty()) {
+        server = "localhost";
+    }
+
+    ::srand(::time(0));
+    LoadBot::s_thinkInterval = std::max(think_interval, 1);
+
+    boost::asio::io_service io_service;
+    boost::asio::ip::tcp::endpoint endpoint;
+    try {
+        boost::asio::ip::tcp::resolver resolver(io_service);
+        boost::asio::ip::tcp::resolver::query query(server,
+              String::compose("%1", client_port_num));
+        endpoint = *resolver.resolve(query);
+    } catch (const std::exception & e) {
+        log(ERROR, String::compose("Could not resolve %1: %2",
+                                   server, e.what()));
+        return 1;
+    }
+
+    LoadStatistics statistics;
+    std::vector<LoadBot *> bots;
+
+    // Bots are connected one at a time, so that logging in does not
+    // itself swamp the server.
+    boost::asio::deadline_timer ramp_timer(io_service);
+    std::function<void()> ramp = [&]() {
+        LoadBot * bot = new LoadBot(io_service, statistics, bots.size(),
+                                    character_type);
+        bots.push_back(bot);
+        bot->connect(endpoint);
+        if ((int)bots.size() < bot_count) {
+            ramp_timer.expires_from_now(
+                  boost::posix_time::milliseconds(ramp_interval));
+            ramp_timer.async_wait([&](boost::system::error_code ec) {
+                if (!ec) {
+                    ramp();
+                }
+            });
+        }
+    };
+
+    clock_type::time_point start = clock_type::now();
+    clock_type::time_point last_report = start;
+
+    boost::asio::deadline_timer report_timer(io_service);
+    std::function<void()> report = [&]() {
+        report_timer.expires_from_now(
+              boost::posix_time::seconds(std::max(report_interval, 1)));
+        report_timer.async_wait([&](boost::system::error_code ec) {
+            if (!ec) {
+                clock_type::time_point now = clock_type::now();
+                statistics.report(std::cout,
+                      std::chrono::duration<double>(now - last_report).count());
+                last_report = now;
+                report();
+            }
+        });
+    };
+
+    boost::asio::deadline_timer stop_timer(io_service);
+    stop_timer.expires_from_now(boost::posix_time::seconds(run_duration));
+    stop_timer.async_wait([&](boost::system::error_code ec) {
+        io_service.stop();
+    });
+
+    std::cout << "Connecting " << bot_count << " bots to " << endpoint
+              << std::endl << std::flush;
+
+    if (bot_count > 0) {
+        io_service.post(ramp);
+    }
+    report();
+    io_service.run();
+
+    statistics.summary(std::cout,
+          std::chrono::duration<double>(clock_type::now() - start).count());
+
+    for (LoadBot * bot : bots) {
+        delete bot;
+    }
+
+    return 0;
+}